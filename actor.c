@@ -4,6 +4,15 @@
 
 // Implementation of ucncActorNew, ucncActorRender, ucncActorFree
 
+// Level of detail settings applied to newly created actors
+static int gLodLevels = 0;
+static int gLodBackground = 0;
+static char gLodCacheDir[1024] = "";
+static float gLodPixelError = 1.0f;
+static unsigned long gLodSettingsGeneration = 0; // Bumped on threshold changes
+static int gAsyncLoading = 0;
+static atomic_ulong gGeometryGeneration;   // Bumped when procedural geometry changes
+
 ucncActor* ucncActorNew(const char *name, const char *stlFile, float colorR, float colorG, float colorB, const char *configDir) {
 
     if (!stlFile) {
@@ -11,12 +20,6 @@ ucncActor* ucncActorNew(const char *name, const char *stlFile, float colorR, flo
         return NULL;
     }
 
-    ucncActor *actor = malloc(sizeof(ucncActor));
-    if (!actor) {
-        fprintf(stderr, "Memory allocation failed for ucncActor '%s'.\n", name);
-        return NULL;
-    }
-
     // Buffer to store the full STL file path
     char fullPath[1024];
 
@@ -24,12 +27,30 @@ ucncActor* ucncActorNew(const char *name, const char *stlFile, float colorR, flo
     int ret = snprintf(fullPath, sizeof(fullPath), "%s/%s", configDir, stlFile);
     if (ret < 0 || ret >= sizeof(fullPath)) {
         fprintf(stderr, "STL file path too long for actor '%s'.\n", name);
-        free(actor);
         return NULL;
     }
 
     printf("Loading STL file from: %s\n", fullPath);
 
+    // Share the geometry with other actors using the same STL file
+    ucncMesh *mesh = gAsyncLoading ? ucncMeshAcquireAsync(fullPath, gLodLevels, gLodCacheDir)
+                                   : ucncMeshAcquire(fullPath);
+    if (!mesh) {
+        fprintf(stderr, "Failed to load STL file '%s' for actor '%s'.\n", stlFile, name);
+        return NULL;
+    }
+
+    return ucncActorNewFromMesh(name, mesh, colorR, colorG, colorB);
+}
+
+
+static ucncActor *actorNew(const char *name, ucncMesh *mesh, float colorR, float colorG, float colorB) {
+    ucncActor *actor = malloc(sizeof(ucncActor));
+    if (!actor) {
+        fprintf(stderr, "Memory allocation failed for ucncActor '%s'.\n", name);
+        return NULL;
+    }
+
     // Initialize actor properties
     strncpy(actor->name, name, sizeof(actor->name) - 1);
     actor->name[sizeof(actor->name) - 1] = '\0';  // Ensure null-termination
@@ -39,58 +60,196 @@ ucncActor* ucncActorNew(const char *name, const char *stlFile, float colorR, flo
     actor->colorR = colorR;
     actor->colorG = colorG;
     actor->colorB = colorB;
-    actor->stlObject = NULL; // Initialize to NULL
-    actor->triangleCount = 0;
-    actor->stride = 0;
-
-    // Load STL file using libstlio
-    union {
-        struct stlTriangle* lpTri;
-        unsigned char* lpBuff;
-    } buf;
-    unsigned long int dwTriCount;
-    unsigned long int dwStride;
-    enum stlioError e;
-    enum stlFileType fType;
-
-    e = stlioReadFileMem(
-        (char*)fullPath,  // Cast to char* as required by stlioReadFileMem
-        &(buf.lpTri),
-        &dwTriCount,
-        &dwStride,
-        NULL,   // Error callback can be NULL for simple cases
-        NULL,   // No user data
-        &fType
-    );
-
-    if (e != stlioE_Ok) {
-        fprintf(stderr, "Failed to load STL file '%s' for actor '%s': %s\n", stlFile, name, stlioErrorStringC(e));
-        free(actor);  // Free actor if STL loading fails
+    actor->mesh = mesh;
+    actor->geometry.render = NULL;
+    actor->geometry.context = NULL;
+    ucncActorUpdateTransform(actor);
+    return actor;
+}
+
+
+ucncActor* ucncActorNewFromMesh(const char *name, ucncMesh *mesh, float colorR, float colorG, float colorB) {
+    ucncActor *actor = actorNew(name, mesh, colorR, colorG, colorB);
+    if (!actor) {
+        ucncMeshRelease(mesh);
         return NULL;
     }
 
-    // Store the loaded STL data buffer
-    actor->stlObject = buf.lpBuff;
-    actor->triangleCount = dwTriCount;
-    actor->stride = dwStride;
+    // Generate simplified levels if enabled (a no-op for meshes that have them;
+    // background loads build theirs once the geometry is read)
+    if (gLodLevels > 0 && atomic_load(&mesh->visible)) {
+        if (gLodBackground) {
+            ucncMeshBuildLodsAsync(actor->mesh, gLodLevels, gLodCacheDir);
+        } else {
+            ucncMeshBuildLods(actor->mesh, gLodLevels, gLodCacheDir);
+        }
+    }
+
+    return actor;
+}
 
+
+ucncActor* ucncActorNewProcedural(const char *name, const ucncActorGeometry *geometry,
+                                  const float boundMin[3], const float boundMax[3],
+                                  float colorR, float colorG, float colorB) {
+    if (!name || !geometry || !geometry->render || !boundMin || !boundMax) {
+        return NULL;
+    }
+    ucncMesh *mesh = ucncMeshNewBounds(boundMin, boundMax);
+    if (!mesh) {
+        return NULL;
+    }
+    ucncActor *actor = actorNew(name, mesh, colorR, colorG, colorB);
+    if (!actor) {
+        ucncMeshDestroy(mesh);
+        return NULL;
+    }
+    actor->geometry = *geometry;
     return actor;
 }
 
 
+void ucncActorGeometryChanged(void) {
+    atomic_fetch_add(&gGeometryGeneration, 1);
+}
+
+
+void ucncActorUpdateTransform(ucncActor *actor) {
+    if (!actor) {
+        return;
+    }
+    // Actors apply T(position) * R * T(origin), unlike assemblies which
+    // rotate about their origin
+    float m[16], offset[16];
+    ucncMatrixFromPose(m, actor->positionX, actor->positionY, actor->positionZ,
+                       0.0f, 0.0f, 0.0f,
+                       actor->rotationX, actor->rotationY, actor->rotationZ);
+    ucncMatrixIdentity(offset);
+    offset[12] = actor->originX;
+    offset[13] = actor->originY;
+    offset[14] = actor->originZ;
+    ucncMatrixMultiply(actor->localMatrix, m, offset);
+    actor->hasTransform = !ucncMatrixIsIdentity(actor->localMatrix);
+}
+
+
+void ucncActorSetLodOptions(int levels, int background, const char *cacheDir) {
+    if (levels < 0) levels = 0;
+    if (levels > UCNC_LOD_MAX_LEVELS) levels = UCNC_LOD_MAX_LEVELS;
+    gLodLevels = levels;
+    gLodBackground = background;
+    snprintf(gLodCacheDir, sizeof(gLodCacheDir), "%s", cacheDir ? cacheDir : "");
+}
+
+
+void ucncActorSetAsyncLoading(int enable) {
+    gAsyncLoading = enable;
+}
+
+
+void ucncActorSetLodPixelError(float pixels) {
+    gLodPixelError = pixels > 0.0f ? pixels : 1.0f;
+    gLodSettingsGeneration++;
+}
+
+unsigned long ucncActorLodGeneration(void) {
+    return ucncMeshLodGeneration() + gLodSettingsGeneration + atomic_load(&gGeometryGeneration);
+}
+
+
+int ucncActorBuildLods(ucncActor *actor, int levels) {
+    if (!actor) {
+        return 0;
+    }
+    return ucncMeshBuildLods(actor->mesh, levels, gLodCacheDir);
+}
+
+
+// Pick the coarsest level whose geometric error projects below the pixel
+// threshold. The scale comes from the current projection matrix, so it
+// follows the active camera FOV or orthographic scale.
+int ucncActorSelectLod(const ucncActor *actor) {
+    if (!actor || !actor->mesh) {
+        return 0;
+    }
+    const ucncMesh *mesh = actor->mesh;
+    int count = atomic_load_explicit(&mesh->lodCount, memory_order_acquire);
+    if (count == 0 || !atomic_load_explicit(&mesh->visible, memory_order_acquire)) {
+        return 0;
+    }
+
+    GLfloat modelview[16], projection[16];
+    GLint viewport[4];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);     // TinyGL returns row-major matrices
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    float center[3];
+    const float bound[3] = { mesh->boundCenterX, mesh->boundCenterY, mesh->boundCenterZ };
+    ucncMatrixTransformPoint(actor->localMatrix, bound, center);
+    float scale = sqrtf(modelview[0] * modelview[0] + modelview[4] * modelview[4] + modelview[8] * modelview[8]);
+    float pixelsPerUnit = 0.5f * (float)viewport[3] * fabsf(projection[5]) * scale;
+
+    if (projection[14] != 0.0f) {
+        // Perspective: use the nearest point of the bounding sphere
+        float eyeZ = modelview[8] * center[0] + modelview[9] * center[1] + modelview[10] * center[2] + modelview[11];
+        float depth = -eyeZ - mesh->boundRadius * scale;
+        if (depth <= 1e-3f) {
+            return 0;
+        }
+        pixelsPerUnit /= depth;
+    }
+
+    int level = 0;
+    for (int i = 0; i < count; i++) {
+        if (mesh->lods[i].geometricError * pixelsPerUnit > gLodPixelError) {
+            break;
+        }
+        level = i + 1;
+    }
+    return level;
+}
+
+
+// Solid box standing in for a mesh that is still loading
+static void renderProxy(const float *lo, const float *hi) {
+    static const int faces[6][4] = {
+        { 0, 4, 6, 2 }, { 1, 3, 7, 5 },   // -X, +X (counter-clockwise
+        { 0, 1, 5, 4 }, { 2, 6, 7, 3 },   // -Y, +Y  seen from outside)
+        { 0, 2, 3, 1 }, { 4, 5, 7, 6 },   // -Z, +Z
+    };
+    glBegin(GL_QUADS);
+    for (int f = 0; f < 6; f++) {
+        float n[3] = { 0.0f, 0.0f, 0.0f };
+        n[f / 2] = (f & 1) ? 1.0f : -1.0f;
+        glNormal3f(n[0], n[1], n[2]);
+        for (int c = 0; c < 4; c++) {
+            int corner = faces[f][c];  // Bit 0 selects x, bit 1 y, bit 2 z
+            glVertex3f((corner & 1) ? hi[0] : lo[0], (corner & 2) ? hi[1] : lo[1],
+                       (corner & 4) ? hi[2] : lo[2]);
+        }
+    }
+    glEnd();
+}
+
+
 void ucncActorRender(ucncActor *actor) {
-    if (!actor || !actor->stlObject) {
+    ucncActorRenderLod(actor, 0);
+}
+
+
+void ucncActorRenderLod(ucncActor *actor, int level) {
+    if (!actor || !actor->mesh) {
         fprintf(stderr, "Error: Actor or STL object is NULL.\n");
         return;
     }
+    const ucncMesh *mesh = actor->mesh;
 
-    // Apply the actor's transformation
+    // Apply the actor's cached transformation
     glPushMatrix();
-    glTranslatef(actor->positionX, actor->positionY, actor->positionZ);
-    glRotatef(actor->rotationX, 1.0f, 0.0f, 0.0f);
-    glRotatef(actor->rotationY, 0.0f, 1.0f, 0.0f);
-    glRotatef(actor->rotationZ, 0.0f, 0.0f, 1.0f);
-    glTranslatef(actor->originX, actor->originY, actor->originZ);
+    if (actor->hasTransform) {
+        glMultMatrixf(actor->localMatrix);
+    }
 
     // Set material properties
     GLfloat matAmbient[] = { actor->colorR * 0.2f, actor->colorG * 0.2f, actor->colorB * 0.2f, 1.0f };
@@ -108,16 +267,40 @@ void ucncActorRender(ucncActor *actor) {
     //   actor->name, actor->positionX, actor->positionY, actor->positionZ,
     //   actor->rotationX, actor->rotationY, actor->rotationZ);
 
-    // Render triangles from the STL data
-    glBegin(GL_TRIANGLES);
-    for (unsigned long i = 0; i < actor->triangleCount; i++) {
-        struct stlTriangle* lpTriangle = (struct stlTriangle*)(actor->stlObject + actor->stride * i);
+    if (actor->geometry.render) {
+        actor->geometry.render(actor->geometry.context);
+        glPopMatrix();
+        return;
+    }
 
-        glNormal3f(lpTriangle->surfaceNormal[0], lpTriangle->surfaceNormal[1], lpTriangle->surfaceNormal[2]);
+    // Until a background load is committed, draw the box it sampled
+    if (!atomic_load_explicit(&mesh->visible, memory_order_acquire)) {
+        if (mesh->hasProxy) {
+            renderProxy(mesh->proxyMin, mesh->proxyMax);
+        }
+        glPopMatrix();
+        return;
+    }
 
-        glVertex3f(lpTriangle->vertices[0][0], lpTriangle->vertices[0][1], lpTriangle->vertices[0][2]);
-        glVertex3f(lpTriangle->vertices[1][0], lpTriangle->vertices[1][1], lpTriangle->vertices[1][2]);
-        glVertex3f(lpTriangle->vertices[2][0], lpTriangle->vertices[2][1], lpTriangle->vertices[2][2]);
+    // Render a simplified level when one was selected and is available
+    const float *vertices = mesh->vertices;
+    const float *normals = mesh->normals;
+    unsigned long triangleCount = mesh->triangleCount;
+    if (level > 0 && level <= atomic_load_explicit(&mesh->lodCount, memory_order_acquire)) {
+        const ucncLodMesh *lod = &mesh->lods[level - 1];
+        vertices = lod->vertices;
+        normals = lod->normals;
+        triangleCount = lod->triangleCount;
+    }
+
+    glBegin(GL_TRIANGLES);
+    for (unsigned long i = 0; i < triangleCount; i++) {
+        const float *n = &normals[i * 3];
+        const float *v = &vertices[i * 9];
+        glNormal3f(n[0], n[1], n[2]);
+        glVertex3f(v[0], v[1], v[2]);
+        glVertex3f(v[3], v[4], v[5]);
+        glVertex3f(v[6], v[7], v[8]);
     }
     glEnd();
 
@@ -128,7 +311,11 @@ void ucncActorRender(ucncActor *actor) {
 
 void ucncActorFree(ucncActor *actor) {
     if (actor) {
-        free(actor->stlObject);  // Free the STL object buffer
+        if (actor->geometry.render) {
+            ucncMeshDestroy(actor->mesh);  // Bounds only, never cached
+        } else {
+            ucncMeshRelease(actor->mesh);  // Geometry stays cached until purged
+        }
         free(actor);
     }
 }
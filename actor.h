@@ -5,10 +5,18 @@
 
 #include "cncvis.h"
 
-#include "libstlio/include/stlio.h"
+#include "mesh.h"
+#include "transform.h"
 
 #define MAX_NAME_LENGTH 64
 
+// Geometry drawn by a callback in place of a mesh, e.g. a voxel stock. It is
+// called in actor space with the actor's material set.
+typedef struct ucncActorGeometry {
+    void (*render)(void *context);
+    void *context;
+} ucncActorGeometry;
+
 // Define ucncActor structure
 typedef struct ucncActor {
     char name[MAX_NAME_LENGTH];               // Unique name
@@ -16,14 +24,48 @@ typedef struct ucncActor {
     float positionX, positionY, positionZ;    // Position in world space
     float rotationX, rotationY, rotationZ;    // Rotation in degrees
     float colorR, colorG, colorB;             // Color (RGB)
-    unsigned char *stlObject;                 // STL data buffer
-    unsigned long triangleCount;              // Number of triangles
-    unsigned long stride;                     // Stride size for triangle data
+    ucncMesh *mesh;                           // Shared geometry, bounds and LODs
+    float localMatrix[16];                    // Cached transform (column-major)
+    int hasTransform;                         // 0 when localMatrix is identity
+    ucncActorGeometry geometry;               // render is NULL for mesh actors
 } ucncActor;
 
 // Function declarations for creating and freeing actors
 ucncActor* ucncActorNew(const char *name, const char *stlFile, float colorR, float colorG, float colorB, const char *configDir);
+// Wrap a mesh reference obtained from the mesh cache; the actor takes it over
+ucncActor* ucncActorNewFromMesh(const char *name, ucncMesh *mesh, float colorR, float colorG, float colorB);
+// Actor drawn by geometry; the box bounds it for culling and LOD selection.
+// The actor owns a bounds-only mesh and does not take part in collision
+// checks or scene bundles.
+ucncActor* ucncActorNewProcedural(const char *name, const ucncActorGeometry *geometry,
+                                  const float boundMin[3], const float boundMax[3],
+                                  float colorR, float colorG, float colorB);
+// Call after procedural geometry changed, so cached frames redraw
+void ucncActorGeometryChanged(void);
 void ucncActorRender(ucncActor *actor);
 void ucncActorFree(ucncActor *actor);
+// Rebuild the cached matrix after changing position/rotation/origin fields
+void ucncActorUpdateTransform(ucncActor *actor);
+
+// Background loading, off by default. When enabled, actors created afterwards
+// return at once and show a box around a sample of their STL file until the
+// mesh, read on a background thread, is committed by ucncMeshCacheCommit
+// (cncvis_render does that before each frame).
+void ucncActorSetAsyncLoading(int enable);
+
+// Level of detail. Generation is off by default; when enabled every mesh
+// loaded afterwards gets up to `levels` simplified versions, built on a
+// background thread if requested and cached in cacheDir when not NULL.
+// Actors sharing an STL file share its levels. These options, the pixel
+// error below and background loading above are process-wide, shared by all
+// cncvis instances (api.h); set them before instances start loading.
+void ucncActorSetLodOptions(int levels, int background, const char *cacheDir);
+void ucncActorSetLodPixelError(float pixels);
+int ucncActorBuildLods(ucncActor *actor, int levels);
+int ucncActorSelectLod(const ucncActor *actor);
+void ucncActorRenderLod(ucncActor *actor, int level);
+// Changes when levels are published, the pixel error threshold is set or
+// procedural geometry changes, so cached frames know to redraw
+unsigned long ucncActorLodGeneration(void);
 
 #endif // ACTOR_H
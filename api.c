@@ -1,15 +1,275 @@
 #include "api.h"
 
+// Collision checking of motion requests
+typedef struct {
+  int enabled;
+  float clearance;
+  ucncCollisionWorld *world; // Built on first use for the tree being moved
+  const ucncAssembly *root;
+  unsigned long sceneGeneration; // Of root when the world was built
+  int deferred; // Inside ucncSetAxesBatch: checked once after all axes
+} CollisionState;
+
+// Toolpath overlay, drawn in the space of a named assembly
+typedef struct {
+  ucncToolpath *toolpath;
+  char frame[64]; // Assembly name, empty for world space
+} ToolpathOverlay;
+
+// Material removal: the tool's path through the stock assembly's space
+typedef struct {
+  ucncStock *stock;
+  ucncVoxelStock *voxels;
+  char frame[64], tool[64]; // Assembly names; empty frame for world space
+  float tip[3], axis[3];    // Last tool pose in stock space
+  int hasTip;
+  int deferred; // Inside a batch of axis updates
+} StockSimulation;
+
+// Axis positions streamed from a controller thread through a motion ring
+typedef struct {
+  ucncMotionRing *ring;
+  ucncAxisHandle handles[UCNC_MOTION_MAX_AXES];
+  double delay; // Display time lags the clock by this much (ms)
+} MotionSource;
+
+// Cached color+depth render of the static part of the scene
+typedef struct {
+  int enabled;
+  int valid;
+  PIXEL *color;
+  GLushort *depth;
+  size_t colorSize, depthSize;
+  GLfloat modelview[16], projection[16];
+  const ucncAssembly *scene;
+  unsigned long staticGeneration;
+  unsigned long lightGeneration;
+  unsigned long lodGeneration;
+} StaticLayer;
+
+// Inputs that produced the image currently in the framebuffer
+typedef struct {
+  int valid;
+  GLfloat modelview[16], projection[16];
+  const ucncAssembly *scene;
+  const ZBuffer *framebuffer;
+  int width, height;
+  unsigned long poseGeneration;
+  unsigned long staticGeneration;
+  unsigned long lightGeneration;
+  unsigned long lodGeneration;
+  unsigned long toolpathGeneration;
+  unsigned long stockGeneration;
+} FrameState;
+
+// Dirty-region rendering state
+typedef struct {
+  int enabled;
+  ucncRect coordRect; // Machine coordinate text
+  ucncRect rects[UCNC_MAX_DIRTY_RECTS];
+  int rectCount;
+} DirtyRegions;
+
+// Everything a visualizer owns besides its scene objects
+typedef struct {
+  CollisionState collision;
+  ToolpathOverlay toolpath;
+  StockSimulation stock;
+  MotionSource motion;
+  StaticLayer staticLayer;
+  FrameState lastFrame;
+  int renderOnChange;
+  DirtyRegions dirty;
+  FPSCounter fps;
+} RenderState;
+
+struct cncvisInstance {
+  // Scene objects; the default instance's are the application's globals
+  ZBuffer *framebuffer;
+  ucncAssembly *scene;
+  ucncCamera *camera;
+  ucncLight **lights;
+  int lightCount;
+  RenderState render;
+  OSDContext osd;
+  void *gl;           // TinyGL context
+  atomic_int current; // Current on some thread
+};
+
+// The default instance's state, shared by all threads without an instance
+static RenderState gDefaultRender;
+static _Thread_local cncvisInstance *gInstance; // NULL: the default instance
+
+static RenderState *current(void) {
+  return gInstance ? &gInstance->render : &gDefaultRender;
+}
+
+// Where the current instance keeps its scene objects
+static ZBuffer **framebufferSlot(void) {
+  return gInstance ? &gInstance->framebuffer : &globalFramebuffer;
+}
+
+static ucncAssembly **sceneSlot(void) {
+  return gInstance ? &gInstance->scene : &globalScene;
+}
+
+static ucncCamera **cameraSlot(void) {
+  return gInstance ? &gInstance->camera : &globalCamera;
+}
+
+static ucncLight ***lightsSlot(void) {
+  return gInstance ? &gInstance->lights : &globalLights;
+}
+
+static int *lightCountSlot(void) {
+  return gInstance ? &gInstance->lightCount : &globalLightCount;
+}
+
+ZBuffer *ucncGetFramebuffer(void) { return *framebufferSlot(); }
+ucncAssembly *ucncGetScene(void) { return *sceneSlot(); }
+ucncCamera *ucncGetCamera(void) { return *cameraSlot(); }
+
+ucncLight **ucncGetLights(int *count) {
+  if (count)
+    *count = *lightCountSlot();
+  return *lightsSlot();
+}
+
+static ucncAssembly *stockFrame(void) {
+  RenderState *state = current();
+  ucncAssembly *scene = ucncGetScene();
+  if (!state->stock.frame[0] || !scene)
+    return NULL;
+  return findAssemblyByName(scene, state->stock.frame);
+}
+
+// Tool tip (the tool assembly's origin) and axis (its +z) in stock space
+static int stockToolPose(float tip[3], float axis[3]) {
+  ucncAssembly *scene = ucncGetScene();
+  ucncAssembly *tool =
+      scene ? findAssemblyByName(scene, current()->stock.tool) : NULL;
+  if (!tool)
+    return 0;
+  const float *toolWorld = ucncAssemblyGetWorldMatrix(tool);
+  const float origin[3] = {tool->originX, tool->originY, tool->originZ};
+  const float above[3] = {tool->originX, tool->originY, tool->originZ + 1.0f};
+  float world[3], worldAbove[3], stockAbove[3];
+  ucncMatrixTransformPoint(toolWorld, origin, world);
+  ucncMatrixTransformPoint(toolWorld, above, worldAbove);
+  ucncAssembly *frame = stockFrame();
+  if (frame) {
+    float toStock[16];
+    ucncMatrixInvertRigid(toStock, ucncAssemblyGetWorldMatrix(frame));
+    ucncMatrixTransformPoint(toStock, world, tip);
+    ucncMatrixTransformPoint(toStock, worldAbove, stockAbove);
+  } else {
+    memcpy(tip, world, sizeof(world));
+    memcpy(stockAbove, worldAbove, sizeof(worldAbove));
+  }
+  for (int k = 0; k < 3; k++)
+    axis[k] = stockAbove[k] - tip[k];
+  return 1;
+}
+
+// Cut along the tool's move since the last update
+static void stockFollowTool(void) {
+  RenderState *state = current();
+  float tip[3], axis[3];
+  if ((!state->stock.stock && !state->stock.voxels) || state->stock.deferred ||
+      !stockToolPose(tip, axis))
+    return;
+  if (state->stock.hasTip) {
+    int moved = memcmp(tip, state->stock.tip, sizeof(tip)) != 0;
+    if (state->stock.stock && moved)
+      ucncStockCut(state->stock.stock, state->stock.tip, tip);
+    if (state->stock.voxels &&
+        (moved || memcmp(axis, state->stock.axis, sizeof(axis))))
+      ucncVoxelStockCut(state->stock.voxels, state->stock.tip,
+                        state->stock.axis, tip, axis);
+  }
+  memcpy(state->stock.tip, tip, sizeof(tip));
+  memcpy(state->stock.axis, axis, sizeof(axis));
+  state->stock.hasTip = 1;
+}
+
+static void setStockAssemblies(const char *stockAssemblyName,
+                               const char *toolAssemblyName) {
+  RenderState *state = current();
+  snprintf(state->stock.frame, sizeof(state->stock.frame), "%s",
+           stockAssemblyName ? stockAssemblyName : "");
+  snprintf(state->stock.tool, sizeof(state->stock.tool), "%s",
+           toolAssemblyName ? toolAssemblyName : "");
+  state->stock.hasTip = 0;
+  stockFollowTool();
+}
+
+void ucncSetStock(ucncStock *stock, const char *stockAssemblyName,
+                  const char *toolAssemblyName) {
+  current()->stock.stock = stock;
+  setStockAssemblies(stockAssemblyName, toolAssemblyName);
+  ucncRequestRedraw();
+}
+
+void ucncSetVoxelStock(ucncVoxelStock *stock, const char *stockAssemblyName,
+                       const char *toolAssemblyName) {
+  current()->stock.voxels = stock;
+  setStockAssemblies(stockAssemblyName, toolAssemblyName);
+}
+
+static void resetCollisionWorld(void) {
+  RenderState *state = current();
+  ucncCollisionWorldFree(state->collision.world);
+  state->collision.world = NULL;
+  state->collision.root = NULL;
+}
+
+static ucncCollisionWorld *collisionWorld(ucncAssembly *root) {
+  RenderState *state = current();
+  if (state->collision.root != root ||
+      state->collision.sceneGeneration != root->sceneGeneration) {
+    resetCollisionWorld();
+    state->collision.world = ucncCollisionWorldNew(root);
+    state->collision.root = state->collision.world ? root : NULL;
+    state->collision.sceneGeneration = root->sceneGeneration;
+  }
+  return state->collision.world;
+}
+
+void ucncSetCollisionChecking(int enable, float clearance) {
+  RenderState *state = current();
+  state->collision.enabled = enable;
+  state->collision.clearance = clearance > 0.0f ? clearance : 0.0f;
+}
+
+int ucncCheckCollisions(float clearance, ucncCollisionPair *pairs,
+                        int maxPairs) {
+  ucncAssembly *scene = ucncGetScene();
+  if (!scene)
+    return 0;
+  return ucncCollisionCheck(collisionWorld(scene), NULL, clearance, pairs,
+                            maxPairs);
+}
+
+// Whether the actors below assembly now collide with the rest of its tree
+static int moveCollides(ucncAssembly *assembly) {
+  ucncAssembly *root = assembly;
+  while (root->parent)
+    root = root->parent;
+  ucncCollisionPair pair;
+  return ucncCollisionCheck(collisionWorld(root), assembly,
+                            current()->collision.clearance, &pair, 1) > 0;
+}
+
 // Motion handling function by assembly name
 int ucncUpdateMotionByName(const char *assemblyName, float value) {
-  ucncAssembly *assembly = findAssemblyByName(globalScene, assemblyName);
+  ucncAssembly *assembly = findAssemblyByName(ucncGetScene(), assemblyName);
 
   if (!assembly) {
     fprintf(stderr, "Assembly '%s' not found.\n", assemblyName);
     return -1;
   }
 
-  if (strcmp(assembly->motionType, MOTION_TYPE_NONE) == 0) {
+  if (assembly->motionType == UCNC_MOTION_NONE) {
     fprintf(stderr, "Assembly '%s' has no motion defined.\n", assemblyName);
     return -1;
   }
@@ -17,9 +277,74 @@ int ucncUpdateMotionByName(const char *assemblyName, float value) {
   return ucncUpdateMotion(assembly, value);
 }
 
+// Pose field driven by the assembly's motion axis, or NULL if it has none
+static float *motionField(ucncAssembly *assembly) {
+  if (assembly->motionType == UCNC_MOTION_ROTATIONAL) {
+    switch (assembly->motionAxis) {
+    case AXIS_X:
+      return &assembly->rotationX;
+    case AXIS_Y:
+      return &assembly->rotationY;
+    case AXIS_Z:
+      return &assembly->rotationZ;
+    default:
+      fprintf(stderr, "Invalid motion axis '%c' for rotational motion.\n",
+              assembly->motionAxis);
+      return NULL;
+    }
+  } else if (assembly->motionType == UCNC_MOTION_LINEAR) {
+    switch (assembly->motionAxis) {
+    case AXIS_X:
+      return &assembly->positionX;
+    case AXIS_Y:
+      return &assembly->positionY;
+    case AXIS_Z:
+      return &assembly->positionZ;
+    default:
+      fprintf(stderr, "Invalid motion axis '%c' for linear motion.\n",
+              assembly->motionAxis);
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+// Move the axis to newVal, enforcing limits (1 unit tolerance)
+static int applyMotion(ucncAssembly *assembly, float *field, float newVal) {
+  float minVal, maxVal;
+  if (assembly->motionType == UCNC_MOTION_ROTATIONAL) {
+    minVal = assembly->minRot;
+    maxVal = assembly->maxRot;
+  } else {
+    minVal = assembly->minPos;
+    maxVal = assembly->maxPos;
+  }
+
+  if (newVal < minVal - 1.0f || newVal > maxVal + 1.0f) {
+    assembly->limitTriggered = 1;
+    return -1;
+  }
+
+  if (*field != newVal) {
+    float oldVal = *field;
+    *field = newVal;
+    ucncAssemblyMarkDirty(assembly);
+    CollisionState *collision = &current()->collision;
+    if (collision->enabled && !collision->deferred &&
+        moveCollides(assembly)) {
+      *field = oldVal;
+      ucncAssemblyMarkDirty(assembly);
+      assembly->collisionTriggered = 1;
+      return -1;
+    }
+    stockFollowTool();
+  }
+  return 0;
+}
+
 // Update motion for a given assembly
 int ucncUpdateMotion(ucncAssembly *assembly, float value) {
-  if (!assembly || strcmp(assembly->motionType, MOTION_TYPE_NONE) == 0) {
+  if (!assembly || assembly->motionType == UCNC_MOTION_NONE) {
     return -1;
   }
 
@@ -31,84 +356,131 @@ int ucncUpdateMotion(ucncAssembly *assembly, float value) {
     value = -value;
   }
 
-  if (strcmp(assembly->motionType, MOTION_TYPE_ROTATIONAL) == 0) {
-    switch (assembly->motionAxis) {
-    case AXIS_X: {
-      float newVal = assembly->rotationX + value;
-      if (newVal < assembly->minRot - 1.0f ||
-          newVal > assembly->maxRot + 1.0f) {
-        assembly->limitTriggered = 1;
-        return -1;
-      }
-      assembly->rotationX = newVal;
-    } break;
-    case AXIS_Y: {
-      float newVal = assembly->rotationY + value;
-      if (newVal < assembly->minRot - 1.0f ||
-          newVal > assembly->maxRot + 1.0f) {
-        assembly->limitTriggered = 1;
-        return -1;
+  float *field = motionField(assembly);
+  if (!field) {
+    return 0;
+  }
+  return applyMotion(assembly, field, *field + value);
+}
+
+// Set the absolute axis position for a given assembly
+int ucncSetMotion(ucncAssembly *assembly, float value) {
+  if (!assembly || assembly->motionType == UCNC_MOTION_NONE ||
+      assembly->limitTriggered) {
+    return -1;
+  }
+
+  float *field = motionField(assembly);
+  if (!field) {
+    return -1;
+  }
+  return applyMotion(assembly, field, assembly->invertMotion ? -value : value);
+}
+
+ucncAxisHandle ucncGetAxisHandle(const char *assemblyName) {
+  ucncAssembly *scene = ucncGetScene();
+  if (!scene || !assemblyName)
+    return -1;
+  if (!scene->index && !ucncAssemblyBuildIndex(scene))
+    return -1;
+
+  const ucncAssemblyIndex *index = scene->index;
+  for (int i = 0; i < index->axisCount; i++) {
+    if (strcmp(index->axes[i]->name, assemblyName) == 0)
+      return i;
+  }
+  fprintf(stderr, "Assembly '%s' is not a motion axis.\n", assemblyName);
+  return -1;
+}
+
+int ucncSetAxesBatch(const ucncAxisHandle *handles, const float *values,
+                     int count) {
+  RenderState *state = current();
+  ucncAssembly *scene = ucncGetScene();
+  if (!scene || !scene->index || !handles || !values)
+    return -1;
+
+  const ucncAssemblyIndex *index = scene->index;
+  int result = 0;
+  state->stock.deferred = 1; // One straight cut for the combined move
+  // All axes move before one collision check, per group of up to
+  // UCNC_MOTION_MAX_AXES; a colliding group is taken back as a whole
+  for (int first = 0; first < count; first += UCNC_MOTION_MAX_AXES) {
+    int end = first + UCNC_MOTION_MAX_AXES;
+    if (end > count)
+      end = count;
+    ucncAssembly *moved[UCNC_MOTION_MAX_AXES];
+    float *fields[UCNC_MOTION_MAX_AXES], previous[UCNC_MOTION_MAX_AXES];
+    int movedCount = 0;
+    state->collision.deferred = 1;
+    for (int i = first; i < end; i++) {
+      if (handles[i] < 0 || handles[i] >= index->axisCount) {
+        result = -1;
+        continue;
       }
-      assembly->rotationY = newVal;
-    } break;
-    case AXIS_Z: {
-      float newVal = assembly->rotationZ + value;
-      if (newVal < assembly->minRot - 1.0f ||
-          newVal > assembly->maxRot + 1.0f) {
-        assembly->limitTriggered = 1;
-        return -1;
+      ucncAssembly *axis = index->axes[handles[i]];
+      float *field = motionField(axis);
+      float old = field ? *field : 0.0f;
+      if (ucncSetMotion(axis, values[i]) != 0)
+        result = -1;
+      else if (*field != old) {
+        moved[movedCount] = axis;
+        fields[movedCount] = field;
+        previous[movedCount++] = old;
       }
-      assembly->rotationZ = newVal;
-    } break;
-    default:
-      fprintf(stderr, "Invalid motion axis '%c' for rotational motion.\n",
-              assembly->motionAxis);
-      break;
     }
-  } else if (strcmp(assembly->motionType, MOTION_TYPE_LINEAR) == 0) {
-    switch (assembly->motionAxis) {
-    case AXIS_X: {
-      float newVal = assembly->positionX + value;
-      if (newVal < assembly->minPos - 1.0f ||
-          newVal > assembly->maxPos + 1.0f) {
-        assembly->limitTriggered = 1;
-        return -1;
+    state->collision.deferred = 0;
+
+    ucncCollisionPair pair;
+    if (movedCount > 0 && state->collision.enabled &&
+        ucncCollisionCheckMoves(collisionWorld(scene),
+                                (const ucncAssembly *const *)moved,
+                                movedCount, state->collision.clearance, &pair,
+                                1) > 0) {
+      for (int m = movedCount - 1; m >= 0; m--) { // Repeated axes last first
+        *fields[m] = previous[m];
+        ucncAssemblyMarkDirty(moved[m]);
+        moved[m]->collisionTriggered = 1;
       }
-      assembly->positionX = newVal;
-    } break;
-    case AXIS_Y: {
-      float newVal = assembly->positionY + value;
-      if (newVal < assembly->minPos - 1.0f ||
-          newVal > assembly->maxPos + 1.0f) {
-        assembly->limitTriggered = 1;
-        return -1;
-      }
-      assembly->positionY = newVal;
-    } break;
-    case AXIS_Z: {
-      float newVal = assembly->positionZ + value;
-      if (newVal < assembly->minPos - 1.0f ||
-          newVal > assembly->maxPos + 1.0f) {
-        assembly->limitTriggered = 1;
-        return -1;
-      }
-      assembly->positionZ = newVal;
-    } break;
-    default:
-      fprintf(stderr, "Invalid motion axis '%c' for linear motion.\n",
-              assembly->motionAxis);
-      break;
+      result = -1;
     }
   }
+  state->stock.deferred = 0;
+  stockFollowTool();
+  return result;
+}
 
+int ucncSetMotionSource(ucncMotionRing *ring, const ucncAxisHandle *handles,
+                        double delayMs) {
+  RenderState *state = current();
+  if (ring && !handles)
+    return -1;
+  state->motion.ring = ring;
+  if (ring)
+    memcpy(state->motion.handles, handles,
+           ucncMotionRingAxisCount(ring) * sizeof(ucncAxisHandle));
+  state->motion.delay = delayMs;
   return 0;
 }
 
+// Pose the axes as the ring had them at this frame's display time
+static void followMotionSource(void) {
+  RenderState *state = current();
+  float values[UCNC_MOTION_MAX_AXES];
+  if (state->motion.ring &&
+      ucncMotionRingSample(state->motion.ring,
+                           getCurrentTimeInMs() - state->motion.delay,
+                           values) == 0)
+    ucncSetAxesBatch(state->motion.handles, values,
+                     ucncMotionRingAxisCount(state->motion.ring));
+}
+
 int ucncClearLimitWarning(const char *assemblyName) {
-  ucncAssembly *assembly = findAssemblyByName(globalScene, assemblyName);
+  ucncAssembly *assembly = findAssemblyByName(ucncGetScene(), assemblyName);
   if (!assembly)
     return -1;
   assembly->limitTriggered = 0;
+  assembly->collisionTriggered = 0;
   return 0;
 }
 
@@ -119,22 +491,21 @@ void cncvis_handle_mouse_motion(int dx, int dy) {
 }
 
 void cncvis_handle_mouse_wheel(int wheel_delta) {
-  if (!globalCamera)
+  ucncCamera *camera = ucncGetCamera();
+  if (!camera)
     return;
   // Use the proper CAD camera zoom function
-  ucncCameraZoom(globalCamera, wheel_delta * 2.0f);
+  ucncCameraZoom(camera, wheel_delta * 2.0f);
   // Update camera matrix
-  update_camera_matrix(globalCamera);
+  update_camera_matrix(camera);
 }
 
-// Set all assemblies to their home position
-void ucncSetAllAssembliesToHome(ucncAssembly *assembly) {
+// Set all assemblies to their home position, logging each one that moves
+static void setAssembliesToHome(ucncAssembly *assembly, int log) {
   if (!assembly)
     return;
 
-  // Check if motionType is not null before comparing
-  if (assembly->motionType &&
-      strcmp(assembly->motionType, MOTION_TYPE_NONE) != 0) {
+  if (assembly->motionType != UCNC_MOTION_NONE) {
     // Set assembly's position and rotation to its home position
     assembly->positionX = assembly->homePositionX;
     assembly->positionY = assembly->homePositionY;
@@ -142,20 +513,30 @@ void ucncSetAllAssembliesToHome(ucncAssembly *assembly) {
     assembly->rotationX = assembly->homeRotationX;
     assembly->rotationY = assembly->homeRotationY;
     assembly->rotationZ = assembly->homeRotationZ;
-
-    printf("Assembly '%s' set to home position (%.2f, %.2f, %.2f) and rotation "
-           "(%.2f, %.2f, %.2f).\n",
-           assembly->name, assembly->homePositionX, assembly->homePositionY,
-           assembly->homePositionZ, assembly->homeRotationX,
-           assembly->homeRotationY, assembly->homeRotationZ);
+    ucncAssemblyMarkDirty(assembly);
+
+    if (log)
+      printf("Assembly '%s' set to home position (%.2f, %.2f, %.2f) and "
+             "rotation (%.2f, %.2f, %.2f).\n",
+             assembly->name, assembly->homePositionX, assembly->homePositionY,
+             assembly->homePositionZ, assembly->homeRotationX,
+             assembly->homeRotationY, assembly->homeRotationZ);
   }
 
   // Recursively set all child assemblies to their home positions
   for (int i = 0; i < assembly->assemblyCount; i++) {
-    ucncSetAllAssembliesToHome(assembly->assemblies[i]);
+    setAssembliesToHome(assembly->assemblies[i], log);
   }
 }
 
+void ucncSetAllAssembliesToHome(ucncAssembly *assembly) {
+  setAssembliesToHome(assembly, 1);
+}
+
+void ucncResetAssembliesToHome(ucncAssembly *assembly) {
+  setAssembliesToHome(assembly, 0);
+}
+
 // Set the dimensions of the TinyGL Z-buffer and return width/height
 void ucncSetZBufferDimensions(int width, int height) {
   // Ensure width is a multiple of 4 (TinyGL requirement)
@@ -168,32 +549,43 @@ void ucncSetZBufferDimensions(int width, int height) {
     width = new_width;
   }
 
-  if (globalFramebuffer) {
-    ZB_close(globalFramebuffer);
+  ZBuffer **framebuffer = framebufferSlot();
+  if (*framebuffer && ucncGetCamera()) {
+    // Initialized: TinyGL draws into this framebuffer, so resize it in place
+    ZB_resize(*framebuffer, NULL, width, height);
+    glViewport(0, 0, width, height);
+    glScissor(0, 0, width, height);
+  } else {
+    if (*framebuffer) {
+      ZB_close(*framebuffer);
+    }
+    *framebuffer = ZB_open(width, height, ZB_MODE_NATIVE, 0);
   }
-  globalFramebuffer = ZB_open(width, height, ZB_MODE_RGBA, 0);
-  if (!globalFramebuffer) {
+  ucncRequestRedraw();
+  ZBuffer *zb = *framebuffer;
+  if (!zb) {
     fprintf(stderr, "Failed to initialize Z-buffer with dimensions %d x %d.\n",
             width, height);
     return;
   }
   printf(
       "ucncSetZBufferDimensions: Initialized framebuffer with size: %d x %d\n",
-      globalFramebuffer->xsize, globalFramebuffer->ysize);
-  if (globalFramebuffer->xsize != width || globalFramebuffer->ysize != height) {
+      zb->xsize, zb->ysize);
+  if (zb->xsize != width || zb->ysize != height) {
     fprintf(stderr,
             "Framebuffer size mismatch: expected %d x %d, got %d x %d\n", width,
-            height, globalFramebuffer->xsize, globalFramebuffer->ysize);
+            height, zb->xsize, zb->ysize);
   }
 }
 
 // Expose Z-buffer output for external use
 const float *ucncGetZBufferOutput(void) {
-  if (!globalFramebuffer) {
+  ZBuffer *framebuffer = ucncGetFramebuffer();
+  if (!framebuffer) {
     fprintf(stderr, "Framebuffer is not initialized.\n");
     return NULL;
   }
-  return (const float *)globalFramebuffer->zbuf;
+  return (const float *)framebuffer->zbuf;
 }
 
 void ucncFrameReady(ZBuffer *framebuffer) {
@@ -212,41 +604,43 @@ int cncvis_init(const char *configFile) {
 
   // === [2] Set framebuffer size and initialize TinyGL Z-buffer ===
   ucncSetZBufferDimensions(ZGL_FB_WIDTH, ZGL_FB_HEIGHT);
-  if (!globalFramebuffer) {
+  ZBuffer *framebuffer = ucncGetFramebuffer();
+  if (!framebuffer) {
     fprintf(stderr, "Failed to initialize framebuffer.\n");
     return EXIT_FAILURE;
   }
 
   // === [3] Load scene and light configuration ===
-  if (!loadConfiguration(configFile, &globalScene, &globalLights,
-                         &globalLightCount)) {
+  if (!loadConfiguration(configFile, sceneSlot(), lightsSlot(),
+                         lightCountSlot())) {
     fprintf(stderr, "Failed to load configuration from '%s'.\n", configFile);
     return EXIT_FAILURE;
   }
 
-  ucncSetAllAssembliesToHome(globalScene);
-  printAssemblyHierarchy(globalScene, 0);
-  printLightHierarchy(globalLights, globalLightCount, 0);
+  ucncSetAllAssembliesToHome(ucncGetScene());
+  printAssemblyHierarchy(ucncGetScene(), 0);
+  printLightHierarchy(*lightsSlot(), *lightCountSlot(), 0);
 
   // === [4] Initialize TinyGL with the framebuffer ===
-  glInit(globalFramebuffer);
+  glInit(framebuffer);
 
   // === [5] Initialize camera ===
-  globalCamera = ucncCameraNew(800.0f, 800.0f, 400.0f, 0.0f, 0.0f, 1.0f);
-  if (!globalCamera) {
+  ucncCamera *camera = ucncCameraNew(800.0f, 800.0f, 400.0f, 0.0f, 0.0f, 1.0f);
+  *cameraSlot() = camera;
+  if (!camera) {
     fprintf(stderr, "Failed to initialize camera.\n");
     return EXIT_FAILURE;
   }
 
-  globalCamera->targetX = 0.0f;
-  globalCamera->targetY = 0.0f;
-  globalCamera->targetZ = 0.0f;
-  globalCamera->fov = 45.0f;
-  globalCamera->distance =
+  camera->targetX = 0.0f;
+  camera->targetY = 0.0f;
+  camera->targetZ = 0.0f;
+  camera->fov = 45.0f;
+  camera->distance =
       sqrtf(800.0f * 800.0f + 800.0f * 800.0f + 400.0f * 400.0f);
-  globalCamera->orthoMode = false;
-  globalCamera->orthoScale = 1.0f;
-  printCameraDetails(globalCamera);
+  camera->orthoMode = false;
+  camera->orthoScale = 1.0f;
+  printCameraDetails(camera);
 
   // === [6] Set OpenGL render state ===
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -264,15 +658,14 @@ int cncvis_init(const char *configFile) {
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   GLfloat aspectRatio =
-      (GLfloat)globalFramebuffer->xsize / (GLfloat)globalFramebuffer->ysize;
+      (GLfloat)framebuffer->xsize / (GLfloat)framebuffer->ysize;
   gluPerspective(60.0f, aspectRatio, 1.0f, 5000.0f);
 
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
-  gluLookAt_custom(globalCamera->positionX, globalCamera->positionY,
-                   globalCamera->positionZ, globalCamera->targetX,
-                   globalCamera->targetY, globalCamera->targetZ,
-                   globalCamera->upX, globalCamera->upY, globalCamera->upZ);
+  gluLookAt_custom(camera->positionX, camera->positionY, camera->positionZ,
+                   camera->targetX, camera->targetY, camera->targetZ,
+                   camera->upX, camera->upY, camera->upZ);
 
   // === [8] Render initial background gradient ===
   float topColor[3] = {0.529f, 0.808f, 0.980f};    // Light Sky Blue
@@ -280,7 +673,7 @@ int cncvis_init(const char *configFile) {
   setBackgroundGradient(topColor, bottomColor);
 
   // === [9] Initialize OSD system ===
-  osdInit(globalFramebuffer);
+  osdInit(framebuffer);
   osdSetDefaultStyle(1.0f, 1.0f, 0.0f, 1.5f, 1); // Yellow text, scale 1.5x
 
   // === [10] Draw reference axis initially ===
@@ -295,30 +688,39 @@ int cncvis_init(const char *configFile) {
 // Function to reset the scene and load a new configuration
 int ucncLoadNewConfiguration(const char *configFile) {
   // Free the existing scene if it's already loaded
-  if (globalScene) {
-    ucncAssemblyFree(globalScene);
-    globalScene = NULL;
+  ucncAssembly **scene = sceneSlot();
+  if (*scene) {
+    resetCollisionWorld();
+    ucncAssemblyFree(*scene);
+    *scene = NULL;
+    current()->stock.hasTip = 0; // The tool starts over at its home position
+    current()->motion.ring = NULL; // Its axis handles belong to the old scene
   }
 
   // Reset camera, if needed
-  if (globalCamera) {
-    ucncCameraFree(globalCamera);
-    globalCamera = NULL;
+  ucncCamera **camera = cameraSlot();
+  if (*camera) {
+    ucncCameraFree(*camera);
+    *camera = NULL;
   }
 
-  // Load the new configuration from the provided XML file
-  if (!loadConfiguration(configFile, &globalScene, &globalLights,
-                         &globalLightCount)) {
+  // Load the new configuration from the provided XML file. Meshes released
+  // with the old scene are still cached and get picked up again here.
+  int loaded =
+      loadConfiguration(configFile, scene, lightsSlot(), lightCountSlot());
+  ucncMeshCachePurge(); // Drop meshes the new scene no longer uses
+  if (!loaded) {
     fprintf(stderr, "Failed to load configuration from '%s'.\n", configFile);
     return EXIT_FAILURE;
   }
 
   // Set all assemblies to their home positions
-  ucncSetAllAssembliesToHome(globalScene);
+  ucncSetAllAssembliesToHome(*scene);
+  ucncInvalidateStaticLayer();
 
   // Re-initialize the camera (assuming root assembly at origin)
-  globalCamera = ucncCameraNew(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f); // Z is up
-  if (!globalCamera) {
+  *camera = ucncCameraNew(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f); // Z is up
+  if (!*camera) {
     fprintf(stderr, "Failed to create camera.\n");
     return EXIT_FAILURE;
   }
@@ -327,140 +729,775 @@ int ucncLoadNewConfiguration(const char *configFile) {
   return EXIT_SUCCESS;
 }
 
-void cncvis_render(void) {
-  // === [1] Clear color and depth buffers ===
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-  // === [2] Render background gradient ===
-  {
-    float topColor[3] = {0.529f, 0.808f, 0.980f};    // Light Sky Blue
-    float bottomColor[3] = {0.000f, 0.000f, 0.545f}; // Dark Blue
-    setBackgroundGradient(topColor, bottomColor);
+void ucncSetStaticLayerCaching(int enable) {
+  RenderState *state = current();
+  state->staticLayer.enabled = enable;
+  if (!enable) {
+    free(state->staticLayer.color);
+    free(state->staticLayer.depth);
+    state->staticLayer.color = NULL;
+    state->staticLayer.depth = NULL;
+    state->staticLayer.colorSize = state->staticLayer.depthSize = 0;
   }
+  state->staticLayer.valid = 0;
+  state->lastFrame.valid = 0;
+}
+
+void ucncInvalidateStaticLayer(void) {
+  RenderState *state = current();
+  state->staticLayer.valid = 0;
+  state->lastFrame.valid = 0;
+}
+
+void ucncRequestRedraw(void) { current()->lastFrame.valid = 0; }
+
+void ucncSetToolpath(ucncToolpath *toolpath, const char *assemblyName) {
+  RenderState *state = current();
+  state->toolpath.toolpath = toolpath;
+  snprintf(state->toolpath.frame, sizeof(state->toolpath.frame), "%s",
+           assemblyName ? assemblyName : "");
+  ucncRequestRedraw();
+}
+
+static ucncAssembly *toolpathFrame(void) {
+  RenderState *state = current();
+  ucncAssembly *scene = ucncGetScene();
+  if (!state->toolpath.frame[0] || !scene)
+    return NULL;
+  return findAssemblyByName(scene, state->toolpath.frame);
+}
+
+// Changes with the path and with every move of its frame or an ancestor
+static unsigned long toolpathGeneration(void) {
+  RenderState *state = current();
+  if (!state->toolpath.toolpath)
+    return 0;
+  unsigned long generation = ucncToolpathGeneration(state->toolpath.toolpath);
+  for (ucncAssembly *a = toolpathFrame(); a; a = a->parent)
+    generation += a->changeStamp;
+  return generation;
+}
+
+// Changes with the stock surface and with every move of its frame
+static unsigned long stockGeneration(void) {
+  RenderState *state = current();
+  if (!state->stock.stock)
+    return 0;
+  unsigned long generation = ucncStockGeneration(state->stock.stock);
+  for (ucncAssembly *a = stockFrame(); a; a = a->parent)
+    generation += a->changeStamp;
+  return generation;
+}
+
+static void renderStock(void) {
+  RenderState *state = current();
+  if (!state->stock.stock)
+    return;
+  ucncAssembly *frame = stockFrame();
+  glPushMatrix();
+  if (frame)
+    glMultMatrixf(ucncAssemblyGetWorldMatrix(frame));
+  ucncStockRender(state->stock.stock);
+  glPopMatrix();
+}
+
+static void renderToolpath(const ucncRect *clip) {
+  RenderState *state = current();
+  if (!state->toolpath.toolpath)
+    return;
+  ucncAssembly *frame = toolpathFrame();
+  glPushMatrix();
+  if (frame)
+    glMultMatrixf(ucncAssemblyGetWorldMatrix(frame));
+  ucncToolpathRender(state->toolpath.toolpath, ucncGetFramebuffer(), clip);
+  glPopMatrix();
+}
 
-  // === [3] Set up 3D projection ===
+void ucncSetRenderOnChange(int enable) { current()->renderOnChange = enable; }
+
+void ucncSetDirtyRegionRendering(int enable) {
+  RenderState *state = current();
+  state->dirty.enabled = enable;
+  // Assembly screen rects are only kept while enabled
+  state->lastFrame.valid = 0;
+}
+
+int ucncGetDirtyRects(ucncRect *rects, int maxRects) {
+  RenderState *state = current();
+  int count =
+      state->dirty.rectCount < maxRects ? state->dirty.rectCount : maxRects;
+  if (rects && count > 0)
+    memcpy(rects, state->dirty.rects, count * sizeof(ucncRect));
+  return state->dirty.rectCount;
+}
+
+static void renderBackground(void) {
+  float topColor[3] = {0.529f, 0.808f, 0.980f};    // Light Sky Blue
+  float bottomColor[3] = {0.000f, 0.000f, 0.545f}; // Dark Blue
+  setBackgroundGradient(topColor, bottomColor);
+}
+
+static void setupProjectionAndCamera(void) {
+  ZBuffer *zb = ucncGetFramebuffer();
+  ucncCamera *camera = ucncGetCamera();
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
-  GLfloat aspect =
-      (GLfloat)globalFramebuffer->xsize / (GLfloat)globalFramebuffer->ysize;
+  GLfloat aspect = (GLfloat)zb->xsize / (GLfloat)zb->ysize;
   gluPerspective(60.0f, aspect, 1.0f, 5000.0f);
 
-  // === [4] Set up camera (modelview matrix) ===
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
-  gluLookAt_custom(globalCamera->positionX, globalCamera->positionY,
-                   globalCamera->positionZ, globalCamera->targetX,
-                   globalCamera->targetY, globalCamera->targetZ,
-                   globalCamera->upX, globalCamera->upY, globalCamera->upZ);
+  gluLookAt_custom(camera->positionX, camera->positionY, camera->positionZ,
+                   camera->targetX, camera->targetY, camera->targetZ,
+                   camera->upX, camera->upY, camera->upZ);
+}
 
-  // === [5] Ensure proper OpenGL state for 3D rendering ===
+static void enable3DState(void) {
   glEnable(GL_DEPTH_TEST);
   glDepthMask(GL_TRUE);
   glEnable(GL_LIGHTING);
   glEnable(GL_COLOR_MATERIAL);
+}
+
+static int staticLayerCurrent(const GLfloat *modelview,
+                              const GLfloat *projection) {
+  ucncAssembly *scene = ucncGetScene();
+  const StaticLayer *layer = &current()->staticLayer;
+  ZBuffer *zb = ucncGetFramebuffer();
+  return layer->valid &&
+         layer->colorSize == (size_t)zb->ysize * zb->linesize &&
+         layer->depthSize ==
+             (size_t)zb->xsize * zb->ysize * sizeof(GLushort) &&
+         layer->scene == scene &&
+         layer->staticGeneration == scene->staticGeneration &&
+         layer->lightGeneration == ucncLightGeneration() &&
+         layer->lodGeneration == ucncActorLodGeneration() &&
+         memcmp(layer->modelview, modelview, 16 * sizeof(GLfloat)) == 0 &&
+         memcmp(layer->projection, projection, 16 * sizeof(GLfloat)) == 0;
+}
+
+// Restore the static layer, re-rendering it first if the view, lights or
+// static part of the scene changed, then draw the moving subtrees on top
+static void renderWithStaticLayer(const GLfloat *modelview,
+                                  const GLfloat *projection) {
+  ucncAssembly *scene = ucncGetScene();
+  StaticLayer *layer = &current()->staticLayer;
+  ZBuffer *zb = ucncGetFramebuffer();
+  size_t colorSize = (size_t)zb->ysize * zb->linesize;
+  size_t depthSize = (size_t)zb->xsize * zb->ysize * sizeof(GLushort);
+
+  if (!staticLayerCurrent(modelview, projection))
+    layer->valid = 0;
+
+  if (layer->valid) {
+    memcpy(zb->pbuf, layer->color, colorSize);
+    memcpy(zb->zbuf, layer->depth, depthSize);
+    ZB_markDirty(zb, 0, 0, zb->xsize, zb->ysize);
+  } else {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderBackground();
+    enable3DState();
+    ucncAssemblyRenderStatic(scene);
+    drawAxis(500.0f); // Optional reference axis
+
+    if (layer->colorSize != colorSize || layer->depthSize != depthSize) {
+      free(layer->color);
+      free(layer->depth);
+      layer->color = malloc(colorSize);
+      layer->depth = malloc(depthSize);
+      layer->colorSize = colorSize;
+      layer->depthSize = depthSize;
+    }
+    if (layer->color && layer->depth) {
+      memcpy(layer->color, zb->pbuf, colorSize);
+      memcpy(layer->depth, zb->zbuf, depthSize);
+      memcpy(layer->modelview, modelview, sizeof(layer->modelview));
+      memcpy(layer->projection, projection, sizeof(layer->projection));
+      layer->scene = scene;
+      layer->staticGeneration = scene->staticGeneration;
+      layer->lightGeneration = ucncLightGeneration();
+      layer->lodGeneration = ucncActorLodGeneration();
+      layer->valid = 1;
+    } else {
+      fprintf(stderr, "Memory allocation failed for static layer cache.\n");
+      layer->colorSize = layer->depthSize = 0;
+    }
+  }
+
+  enable3DState();
+  ucncAssemblyRenderDynamic(scene);
+  renderStock(); // Neither is part of the layer, both change while cutting
+  renderToolpath(NULL);
+}
+
+// Background panel behind the status text in the top right corner
+static const OSDStyle statusStyle = {0.0f, 1.0f, 0.0f, 1.2f, 1}; // Green, 1.2x
+
+static ucncRect statusPanelRect(void) {
+  int textW =
+      calculateTextWidth("RUNNING", statusStyle.scale, statusStyle.spacing);
+  int fpsW =
+      calculateTextWidth("100.0 FPS", statusStyle.scale, statusStyle.spacing);
+  int textWidth = (fpsW > textW ? fpsW : textW);
+  int textHeight = 8 * 2 * statusStyle.scale + 4;
+  int statusX = ucncGetFramebuffer()->xsize - 10;
+  int statusY = 10;
+
+  ucncRect rect = {statusX - textWidth - 6, statusY - 2, textWidth + 12,
+                   textHeight + 4};
+  return rect;
+}
+
+static void drawOSD(const char *coordText, float fps) {
+  ZBuffer *zb = ucncGetFramebuffer();
+  // Set up 2D orthographic projection for OSD
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  glOrtho(0.0, zb->xsize, 0.0, zb->ysize, -1.0,
+          1.0);
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+
+  // Disable depth test and lighting for OSD
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_LIGHTING);
+
+  // Draw machine coordinates
+  osdDrawText(coordText, 10, 10, OSD_ALIGN_LEFT);
+
+  // Prepare status text
+  char statusText[64];
+  snprintf(statusText, sizeof(statusText), "RUNNING\n%.1f FPS", fps);
+
+  // Draw background panel, inclusive of its far edges
+  ucncRect panel = statusPanelRect();
+  osdDrawRect(panel.x, panel.y, panel.width - 1, panel.height - 1, 0.0f, 0.0f,
+              0.0f, 0.7f // Semi-transparent black
+  );
+
+  // Draw text overlay
+  osdDrawTextStyled(statusText, zb->xsize - 10, 10,
+                    OSD_ALIGN_RIGHT, &statusStyle);
 
-  // === [6] Render 3D scene ===
-  ucncAssemblyRender(globalScene);
-  drawAxis(500.0f); // Optional reference axis
+  // Draw bottom help text
+  osdDrawTextf(zb->xsize / 2, zb->ysize - 20,
+               OSD_ALIGN_CENTER, "F1-F5: Views | Space: Toggle Projection");
 
-  // === [7] Calculate frame timing ===
-  float fps = calculateFPS();
+  // Restore matrices and states
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix();
+
+  // Restore 3D rendering states
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  glEnable(GL_LIGHTING);
+}
+
+// --- Dirty-region tracking ---
+
+#define DIRTY_MARGIN 3        // Pixels added around projected bounds
+#define DIRTY_MAX_COVERAGE 60 // Percent of the screen above which we redraw all
+// Without the static layer every rect renders the whole scene again, so the
+// rects are merged down to this many scene passes
+#define DIRTY_MAX_SCENE_PASSES 2
+
+static int rectEmpty(const ucncRect *r) {
+  return r->width <= 0 || r->height <= 0;
+}
+
+static ucncRect rectUnion(const ucncRect *a, const ucncRect *b) {
+  if (rectEmpty(a))
+    return *b;
+  if (rectEmpty(b))
+    return *a;
+  int x0 = a->x < b->x ? a->x : b->x;
+  int y0 = a->y < b->y ? a->y : b->y;
+  int x1 = a->x + a->width > b->x + b->width ? a->x + a->width
+                                             : b->x + b->width;
+  int y1 = a->y + a->height > b->y + b->height ? a->y + a->height
+                                               : b->y + b->height;
+  ucncRect r = {x0, y0, x1 - x0, y1 - y0};
+  return r;
+}
+
+static int rectsTouch(const ucncRect *a, const ucncRect *b) {
+  return a->x <= b->x + b->width && b->x <= a->x + a->width &&
+         a->y <= b->y + b->height && b->y <= a->y + a->height;
+}
+
+static long rectArea(const ucncRect *r) {
+  return rectEmpty(r) ? 0 : (long)r->width * r->height;
+}
 
-  // === [8] Determine machine/tool position ===
-  float machine_x = 0.0f, machine_y = 0.0f, machine_z = 0.0f;
-  ucncAssembly *tool = findAssemblyByName(globalScene, "tool");
+// Clip to the framebuffer and merge into the dirty list. Overlapping rects
+// are fused; once the list is full the new rect joins whichever existing one
+// grows the least.
+static void addDirtyRect(ucncRect rect) {
+  RenderState *state = current();
+  ZBuffer *zb = ucncGetFramebuffer();
+  int w = zb->xsize, h = zb->ysize;
+  int x1 = rect.x + rect.width, y1 = rect.y + rect.height;
+  rect.x = rect.x < 0 ? 0 : rect.x;
+  rect.y = rect.y < 0 ? 0 : rect.y;
+  rect.width = (x1 > w ? w : x1) - rect.x;
+  rect.height = (y1 > h ? h : y1) - rect.y;
+  if (rectEmpty(&rect))
+    return;
+
+  int merged;
+  do {
+    merged = 0;
+    for (int i = 0; i < state->dirty.rectCount; i++) {
+      if (rectsTouch(&rect, &state->dirty.rects[i])) {
+        rect = rectUnion(&rect, &state->dirty.rects[i]);
+        state->dirty.rects[i] = state->dirty.rects[--state->dirty.rectCount];
+        merged = 1;
+        break;
+      }
+    }
+  } while (merged);
+
+  if (state->dirty.rectCount == UCNC_MAX_DIRTY_RECTS) {
+    int best = 0;
+    long bestGrowth = -1;
+    for (int i = 0; i < state->dirty.rectCount; i++) {
+      ucncRect u = rectUnion(&rect, &state->dirty.rects[i]);
+      long growth = rectArea(&u) - rectArea(&state->dirty.rects[i]);
+      if (bestGrowth < 0 || growth < bestGrowth) {
+        best = i;
+        bestGrowth = growth;
+      }
+    }
+    rect = rectUnion(&rect, &state->dirty.rects[best]);
+    state->dirty.rects[best] = state->dirty.rects[--state->dirty.rectCount];
+    addDirtyRect(rect); // The grown rect may now overlap others
+    return;
+  }
+  state->dirty.rects[state->dirty.rectCount++] = rect;
+}
+
+// Fuse the pair of dirty rects that wastes the least area until at most
+// maxRects are left
+static void mergeDirtyRects(int maxRects) {
+  RenderState *state = current();
+  while (state->dirty.rectCount > maxRects) {
+    int bestA = 0, bestB = 1;
+    long bestGrowth = -1;
+    for (int a = 0; a < state->dirty.rectCount; a++) {
+      for (int b = a + 1; b < state->dirty.rectCount; b++) {
+        ucncRect u = rectUnion(&state->dirty.rects[a], &state->dirty.rects[b]);
+        long growth = rectArea(&u) - rectArea(&state->dirty.rects[a]) -
+                      rectArea(&state->dirty.rects[b]);
+        if (bestGrowth < 0 || growth < bestGrowth) {
+          bestA = a;
+          bestB = b;
+          bestGrowth = growth;
+        }
+      }
+    }
+    ucncRect rect =
+        rectUnion(&state->dirty.rects[bestA], &state->dirty.rects[bestB]);
+    state->dirty.rects[bestB] = state->dirty.rects[--state->dirty.rectCount];
+    state->dirty.rects[bestA] = state->dirty.rects[--state->dirty.rectCount];
+    addDirtyRect(rect); // The union may now overlap others
+  }
+}
+
+// Column-major projection * modelview from GL's row-major matrix readback
+static void viewProjectionMatrix(float out[16], const GLfloat *modelview,
+                                 const GLfloat *projection) {
+  float mv[16], p[16];
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 4; c++) {
+      mv[c * 4 + r] = modelview[r * 4 + c];
+      p[c * 4 + r] = projection[r * 4 + c];
+    }
+  }
+  ucncMatrixMultiply(out, p, mv);
+}
+
+typedef struct {
+  float x0, y0, x1, y1;
+  int unbounded; // A corner lies behind the eye
+} ScreenBounds;
+
+// Grow bounds by the eight corners of an axis-aligned box under clip matrix m
+static void projectBox(ScreenBounds *b, const float m[16], float x0, float y0,
+                       float z0, float x1, float y1, float z1) {
+  ZBuffer *zb = ucncGetFramebuffer();
+  int w = zb->xsize, h = zb->ysize;
+  for (int i = 0; i < 8; i++) {
+    float x = (i & 1) ? x1 : x0;
+    float y = (i & 2) ? y1 : y0;
+    float z = (i & 4) ? z1 : z0;
+    float cx = m[0] * x + m[4] * y + m[8] * z + m[12];
+    float cy = m[1] * x + m[5] * y + m[9] * z + m[13];
+    float cw = m[3] * x + m[7] * y + m[11] * z + m[15];
+    if (cw <= 1e-6f) {
+      b->unbounded = 1;
+      return;
+    }
+    // Screen y grows downwards, matching the framebuffer rows
+    float sx = (cx / cw + 1.0f) * 0.5f * w;
+    float sy = (1.0f - cy / cw) * 0.5f * h;
+    b->x0 = sx < b->x0 ? sx : b->x0;
+    b->y0 = sy < b->y0 ? sy : b->y0;
+    b->x1 = sx > b->x1 ? sx : b->x1;
+    b->y1 = sy > b->y1 ? sy : b->y1;
+  }
+}
+
+// Screen footprint of what renderAssembly draws for this assembly alone:
+// its axis marker and the bounding spheres of its actors
+static ucncRect assemblyScreenRect(ucncAssembly *assembly,
+                                   const float viewProjection[16]) {
+  ZBuffer *zb = ucncGetFramebuffer();
+  ScreenBounds b = {1e30f, 1e30f, -1e30f, -1e30f, 0};
+  float m[16];
+  ucncMatrixMultiply(m, viewProjection, ucncAssemblyGetWorldMatrix(assembly));
+
+  // drawAxis(100) arrow heads reach 10 units past the axis lines
+  projectBox(&b, m, assembly->originX - 10.0f, assembly->originY - 10.0f,
+             assembly->originZ - 10.0f, assembly->originX + 110.0f,
+             assembly->originY + 110.0f, assembly->originZ + 110.0f);
+
+  for (int i = 0; i < assembly->actorCount && !b.unbounded; i++) {
+    const ucncActor *actor = assembly->actors[i];
+    float am[16];
+    const float *mm = m;
+    if (actor->hasTransform) {
+      ucncMatrixMultiply(am, m, actor->localMatrix);
+      mm = am;
+    }
+    const ucncMesh *mesh = actor->mesh;
+    float r = mesh->boundRadius;
+    projectBox(&b, mm, mesh->boundCenterX - r, mesh->boundCenterY - r,
+               mesh->boundCenterZ - r, mesh->boundCenterX + r,
+               mesh->boundCenterY + r, mesh->boundCenterZ + r);
+  }
+
+  if (b.unbounded) {
+    ucncRect full = {0, 0, zb->xsize, zb->ysize};
+    return full;
+  }
+  ucncRect rect = {(int)floorf(b.x0) - DIRTY_MARGIN,
+                   (int)floorf(b.y0) - DIRTY_MARGIN, 0, 0};
+  rect.width = (int)ceilf(b.x1) + DIRTY_MARGIN - rect.x;
+  rect.height = (int)ceilf(b.y1) + DIRTY_MARGIN - rect.y;
+  return rect;
+}
+
+// Refresh the screen rects of moving assemblies. When collecting, every
+// assembly that moved since `since` (or sits below one that did) adds both
+// the rect it covered last frame and the one it covers now.
+static void trackAssemblyRects(ucncAssembly *assembly,
+                               const float viewProjection[16],
+                               unsigned long since, int collect,
+                               int ancestorMoved) {
+  int moved = ancestorMoved || assembly->changeStamp > since;
+
+  if (assembly->isDynamic && (!collect || moved)) {
+    ucncRect rect = assemblyScreenRect(assembly, viewProjection);
+    if (collect) {
+      addDirtyRect(assembly->screenRect);
+      addDirtyRect(rect);
+    }
+    assembly->screenRect = rect;
+  }
+
+  for (int i = 0; i < assembly->assemblyCount; i++) {
+    trackAssemblyRects(assembly->assemblies[i], viewProjection, since, collect,
+                       moved);
+  }
+}
+
+static ucncRect coordTextRect(const char *coordText) {
+  ucncRect rect = {10, 10, calculateTextWidth(coordText, 1.0f, 1), 8};
+  return rect;
+}
+
+// Everything but the assembly poses matches, so the previous frame can be
+// patched in place
+static int sameView(const FrameState *a, const FrameState *b) {
+  return a->scene == b->scene && a->framebuffer == b->framebuffer &&
+         a->width == b->width && a->height == b->height &&
+         a->staticGeneration == b->staticGeneration &&
+         a->lightGeneration == b->lightGeneration &&
+         a->lodGeneration == b->lodGeneration &&
+         a->toolpathGeneration == b->toolpathGeneration &&
+         a->stockGeneration == b->stockGeneration &&
+         memcmp(a->modelview, b->modelview, sizeof(a->modelview)) == 0 &&
+         memcmp(a->projection, b->projection, sizeof(a->projection)) == 0;
+}
+
+static FrameState currentFrameState(void) {
+  ucncAssembly *scene = ucncGetScene();
+  ZBuffer *zb = ucncGetFramebuffer();
+  FrameState state;
+  state.valid = 1;
+  glGetFloatv(GL_MODELVIEW_MATRIX, state.modelview);
+  glGetFloatv(GL_PROJECTION_MATRIX, state.projection);
+  state.scene = scene;
+  state.framebuffer = zb;
+  state.width = zb->xsize;
+  state.height = zb->ysize;
+  state.poseGeneration = scene->poseGeneration;
+  state.staticGeneration = scene->staticGeneration;
+  state.lightGeneration = ucncLightGeneration();
+  state.lodGeneration = ucncActorLodGeneration();
+  state.toolpathGeneration = toolpathGeneration();
+  state.stockGeneration = stockGeneration();
+  return state;
+}
+
+// Work out which parts of the previous frame must be redrawn. Returns 0 when
+// the whole frame has to be rendered instead.
+static int collectDirtyRects(const FrameState *now, const ucncRect *coordRect) {
+  RenderState *state = current();
+  ZBuffer *zb = ucncGetFramebuffer();
+
+  state->dirty.rectCount = 0;
+  if (!state->lastFrame.valid || !sameView(&state->lastFrame, now))
+    return 0;
+  if (state->staticLayer.enabled &&
+      !staticLayerCurrent(now->modelview, now->projection))
+    return 0;
+
+  if (state->lastFrame.poseGeneration != now->poseGeneration) {
+    float viewProjection[16];
+    viewProjectionMatrix(viewProjection, now->modelview, now->projection);
+    trackAssemblyRects(ucncGetScene(), viewProjection,
+                       state->lastFrame.poseGeneration, 1, 0);
+  }
+
+  // The coordinate text and the FPS panel change every frame
+  addDirtyRect(rectUnion(&state->dirty.coordRect, coordRect));
+  addDirtyRect(statusPanelRect());
+  if (!state->staticLayer.enabled)
+    mergeDirtyRects(DIRTY_MAX_SCENE_PASSES);
+
+  long area = 0;
+  for (int i = 0; i < state->dirty.rectCount; i++)
+    area += rectArea(&state->dirty.rects[i]);
+  return area * 100 <= (long)zb->xsize * zb->ysize * DIRTY_MAX_COVERAGE;
+}
+
+// Re-render only inside the dirty rects, leaving the rest of the previous
+// frame in place
+static void renderDirtyRects(const char *coordText, float fps) {
+  RenderState *state = current();
+  ucncAssembly *scene = ucncGetScene();
+  ZBuffer *zb = ucncGetFramebuffer();
+  const StaticLayer *layer = &state->staticLayer;
+  int useLayer = layer->enabled;
+
+  for (int i = 0; i < state->dirty.rectCount; i++) {
+    const ucncRect *r = &state->dirty.rects[i];
+
+    glScissor(r->x, r->y, r->width, r->height);
+    glEnable(GL_SCISSOR_TEST);
+
+    if (useLayer) {
+      // staticLayerCurrent() was checked while collecting the rects
+      for (int y = r->y; y < r->y + r->height; y++) {
+        size_t colorRow = (size_t)y * zb->linesize;
+        size_t depthRow = (size_t)y * zb->xsize;
+        memcpy((char *)zb->pbuf + colorRow + r->x * sizeof(PIXEL),
+               (char *)layer->color + colorRow + r->x * sizeof(PIXEL),
+               r->width * sizeof(PIXEL));
+        memcpy(zb->zbuf + depthRow + r->x, layer->depth + depthRow + r->x,
+               r->width * sizeof(GLushort));
+      }
+      ZB_markDirty(zb, r->x, r->y, r->width, r->height);
+      enable3DState();
+      ucncAssemblyRenderDynamic(scene);
+    } else {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      renderBackground();
+      enable3DState();
+      ucncAssemblyRender(scene);
+      drawAxis(500.0f);
+    }
+    renderStock();
+    renderToolpath(r);
+
+    drawOSD(coordText, fps);
+    glDisable(GL_SCISSOR_TEST);
+  }
+}
+
+int cncvis_render(void) {
+  RenderState *state = current();
+  ucncAssembly *scene = ucncGetScene();
+  ZBuffer *zb = ucncGetFramebuffer();
+
+  // === [0] Take this frame's pose from the motion stream, if any ===
+  followMotionSource();
+
+  // === [1] Set up 3D projection and camera (modelview matrix) ===
+  setupProjectionAndCamera();
+  ucncMeshCacheCommit(); // Swap in meshes loaded in the background
+  FrameState now = currentFrameState();
+
+  // === [2] Skip the frame if nothing it depends on changed ===
+  if (state->renderOnChange && state->lastFrame.valid &&
+      sameView(&state->lastFrame, &now) &&
+      state->lastFrame.poseGeneration == now.poseGeneration) {
+    state->dirty.rectCount = 0;
+    return UCNC_FRAME_UNCHANGED;
+  }
+
+  // === [3] Calculate frame timing ===
+  float fps = updateFPS(&state->fps);
+
+  // === [4] Determine the world-space tool center point ===
+  float tcp[3] = {0.0f, 0.0f, 0.0f};
+  ucncAssembly *tool = findAssemblyByName(scene, "tool");
+  if (!tool)
+    tool = findAssemblyByName(scene, "end_effector");
   if (tool) {
-    machine_x = tool->positionX;
-    machine_y = tool->positionY;
-    machine_z = tool->positionZ;
+    const float origin[3] = {tool->originX, tool->originY, tool->originZ};
+    ucncMatrixTransformPoint(ucncAssemblyGetWorldMatrix(tool), origin, tcp);
+  }
+  char coordText[96];
+  snprintf(coordText, sizeof(coordText), "X: %.3f Y: %.3f Z: %.3f", tcp[0],
+           tcp[1], tcp[2]);
+  ucncRect coordRect = coordTextRect(coordText);
+
+  if (state->dirty.enabled && collectDirtyRects(&now, &coordRect)) {
+    // === [5-8] Patch only the regions that changed since the last frame ===
+    renderDirtyRects(coordText, fps);
   } else {
-    ucncAssembly *endEffector = findAssemblyByName(globalScene, "end_effector");
-    if (endEffector) {
-      machine_x = endEffector->positionX;
-      machine_y = endEffector->positionY;
-      machine_z = endEffector->positionZ;
+    if (state->staticLayer.enabled) {
+      // === [5-7] Restore cached static layer, render moving parts ===
+      renderWithStaticLayer(now.modelview, now.projection);
+    } else {
+      // === [5] Clear color and depth buffers ===
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+      // === [6] Render background gradient, then restore 3D state ===
+      renderBackground();
+      enable3DState();
+
+      // === [7] Render 3D scene ===
+      ucncAssemblyRender(scene);
+      drawAxis(500.0f); // Optional reference axis
+      renderStock();
+      renderToolpath(NULL);
+    }
+
+    // === [8] Render OSD (on-screen display) ===
+    drawOSD(coordText, fps);
+
+    // The whole frame changed; remember where the moving parts landed
+    ucncRect full = {0, 0, zb->xsize, zb->ysize};
+    state->dirty.rects[0] = full;
+    state->dirty.rectCount = 1;
+    if (state->dirty.enabled) {
+      float viewProjection[16];
+      viewProjectionMatrix(viewProjection, now.modelview, now.projection);
+      trackAssemblyRects(scene, viewProjection, 0, 0, 0);
     }
   }
+  state->dirty.coordRect = coordRect;
+  state->lastFrame = now;
 
-  // === [9] Render OSD (on-screen display) ===
-  {
-    // Set up 2D orthographic projection for OSD
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(0.0, globalFramebuffer->xsize, 0.0, globalFramebuffer->ysize, -1.0,
-            1.0);
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    // Disable depth test and lighting for OSD
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
-
-    // Draw machine coordinates
-    osdDrawTextf(10, 10, OSD_ALIGN_LEFT, "X: %.3f Y: %.3f Z: %.3f", machine_x,
-                 machine_y, machine_z);
-
-    // Prepare status text
-    char statusText[64];
-    snprintf(statusText, sizeof(statusText), "RUNNING\n%.1f FPS", fps);
-
-    // Calculate bounding box for status panel
-    OSDStyle style = {0.0f, 1.0f, 0.0f, 1.2f, 1}; // Green, 1.2x scale
-    int textW = calculateTextWidth("RUNNING", style.scale, style.spacing);
-    int fpsW = calculateTextWidth("100.0 FPS", style.scale, style.spacing);
-    int textWidth = (fpsW > textW ? fpsW : textW);
-    int textHeight = 8 * 2 * style.scale + 4;
-
-    int statusX = globalFramebuffer->xsize - 10;
-    int statusY = 10;
-
-    // Draw background panel
-    osdDrawRect(statusX - textWidth - 6, statusY - 2, textWidth + 12,
-                textHeight + 4, 0.0f, 0.0f, 0.0f, 0.7f // Semi-transparent black
-    );
-
-    // Draw text overlay
-    osdDrawTextStyled(statusText, statusX, statusY, OSD_ALIGN_RIGHT, &style);
-
-    // Draw bottom help text
-    osdDrawTextf(globalFramebuffer->xsize / 2, globalFramebuffer->ysize - 20,
-                 OSD_ALIGN_CENTER, "F1-F5: Views | Space: Toggle Projection");
-
-    // Restore matrices and states
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-
-    // Restore 3D rendering states
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glEnable(GL_LIGHTING);
-  }
-
-  // === [10] Ensure all GL commands are executed ===
+  // === [9] Ensure all GL commands are executed ===
   glFlush();
+  return UCNC_FRAME_RENDERED;
 }
 
 void cncvis_cleanup() {
-
-  // Free assemblies and actors
-  ucncAssemblyFree(globalScene);
-  globalScene = NULL;
+  RenderState *state = current();
+
+  // Free assemblies, actors and their meshes
+  resetCollisionWorld();
+  ucncAssemblyFree(*sceneSlot());
+  *sceneSlot() = NULL;
+  ucncMeshCachePurge();
+  ucncInvalidateStaticLayer();
+  state->toolpath.toolpath = NULL; // Owned by the caller
+  state->stock.stock = NULL;
+  state->stock.voxels = NULL;
+  state->motion.ring = NULL;
 
   // Free lights
-  freeAllLights(&globalLights, globalLightCount);
-  globalLights = NULL;
-  globalLightCount = 0;
+  freeAllLights(lightsSlot(), *lightCountSlot());
+  *lightsSlot() = NULL;
+  *lightCountSlot() = 0;
 
   // Free camera
-  ucncCameraFree(globalCamera);
-  globalCamera = NULL;
+  ucncCameraFree(*cameraSlot());
+  *cameraSlot() = NULL;
 
   // Close TinyGL context
   glClose();
-  ZB_close(globalFramebuffer);
-  globalFramebuffer = NULL;
-}
\ No newline at end of file
+  if (*framebufferSlot())
+    ZB_close(*framebufferSlot());
+  *framebufferSlot() = NULL;
+}
+
+int cncvisMakeCurrent(cncvisInstance *instance) {
+  if (instance == gInstance)
+    return 0;
+  if (instance) {
+    int idle = 0;
+    if (!atomic_compare_exchange_strong(&instance->current, &idle, 1))
+      return -1; // Current on another thread
+  }
+  if (gInstance)
+    atomic_store(&gInstance->current, 0);
+
+  gInstance = instance;
+  glMakeCurrent(instance ? instance->gl : NULL);
+  osdMakeCurrent(instance ? &instance->osd : NULL);
+  return 0;
+}
+
+cncvisInstance *cncvisGetCurrent(void) { return gInstance; }
+
+cncvisInstance *cncvisInstanceNew(const char *configFile) {
+  cncvisInstance *instance = calloc(1, sizeof(*instance));
+  if (!instance)
+    return NULL;
+  instance->osd = (OSDContext)OSD_CONTEXT_INIT;
+  instance->gl = glCreateContext();
+  if (!instance->gl) {
+    free(instance);
+    return NULL;
+  }
+
+  cncvisInstance *previous = gInstance;
+  cncvisMakeCurrent(instance);
+  int status = cncvis_init(configFile);
+  if (status != EXIT_SUCCESS) {
+    cncvis_cleanup();
+  }
+  cncvisMakeCurrent(previous);
+  if (status != EXIT_SUCCESS) {
+    glDeleteContext(instance->gl);
+    free(instance);
+    return NULL;
+  }
+  return instance;
+}
+
+void cncvisInstanceFree(cncvisInstance *instance) {
+  if (!instance)
+    return;
+  cncvisInstance *previous = gInstance == instance ? NULL : gInstance;
+  if (cncvisMakeCurrent(instance) != 0) {
+    fprintf(stderr, "cncvisInstanceFree: instance is current on another "
+                    "thread.\n");
+    return;
+  }
+  ucncSetStaticLayerCaching(0); // Free the cached layer
+  cncvis_cleanup();
+  cncvisMakeCurrent(previous);
+  glDeleteContext(instance->gl);
+  free(instance);
+}
@@ -4,9 +4,18 @@
 #include "actor.h"
 #include "assembly.h"
 #include "camera.h"
+#include "collision.h"
 #include "config.h"
+#include "framesink.h"
+#include "imageexport.h"
+#include "kinematics.h"
 #include "light.h"
+#include "motion.h"
 #include "osd.h"
+#include "shmexport.h"
+#include "stock.h"
+#include "toolpath.h"
+#include "voxel.h"
 #include "utils.h"
 
 #define ZGL_FB_WIDTH 640
@@ -22,26 +31,140 @@ extern ucncCamera *globalCamera;
 extern ucncLight **globalLights;
 extern int globalLightCount;
 
+// The scene objects of the calling thread's current instance (see
+// cncvisMakeCurrent below); the globals above while none is current
+ucncAssembly *ucncGetScene(void);
+ucncCamera *ucncGetCamera(void);
+ucncLight **ucncGetLights(int *count);
+
 // Motion and scene control functions
 int ucncUpdateMotionByName(const char *assemblyName, float value);
 void ucncSetAllAssembliesToHome(ucncAssembly *assembly);
+// Same without the per-assembly log, for callers that reset every frame
+void ucncResetAssembliesToHome(ucncAssembly *assembly);
 int ucncUpdateMotion(ucncAssembly *assembly, float value);
 int ucncClearLimitWarning(const char *assemblyName);
+int ucncSetMotion(ucncAssembly *assembly, float value);
+
+// Axis handles index the moving assemblies of the loaded scene and stay valid
+// until the configuration is reloaded. ucncSetAxesBatch applies absolute axis
+// positions; it returns -1 if any handle is invalid or any axis hit a limit.
+typedef int ucncAxisHandle;
+ucncAxisHandle ucncGetAxisHandle(const char *assemblyName);
+int ucncSetAxesBatch(const ucncAxisHandle *handles, const float *values,
+                     int count);
+
+// Drive the axes from a motion ring instead of direct calls: every
+// cncvis_render starts by applying the ring's joint vector at the current
+// time minus delayMs, interpolated between the samples around it, through
+// ucncSetAxesBatch. handles[i] is the axis of the ring's value i. The
+// controller only pushes to the ring, so it never shares assembly state with
+// the render thread. Pass NULL to detach; reloading the configuration
+// detaches it as well.
+int ucncSetMotionSource(ucncMotionRing *ring, const ucncAxisHandle *handles,
+                        double delayMs);
+
+// Collision checking: when enabled, ucncUpdateMotion and ucncSetMotion
+// reject moves after which an actor of the moved subtree intersects the rest
+// of the machine (or comes closer than clearance). The pose is left as it
+// was and collisionTriggered is set on the assembly; unlike limitTriggered it
+// does not block further moves, so the axis can be backed off.
+// ucncSetAxesBatch moves all its axes first and checks the combined pose
+// once; a collision takes back every axis of the batch and flags each.
+// ucncClearLimitWarning clears both flags. ucncCheckCollisions tests the
+// whole scene as it stands and returns the number of pairs stored.
+void ucncSetCollisionChecking(int enable, float clearance);
+int ucncCheckCollisions(float clearance, ucncCollisionPair *pairs,
+                        int maxPairs);
 
 // Z-buffer handling
 void ucncSetZBufferDimensions(int width, int height);
 const float *ucncGetZBufferOutput(void);
 void ucncFrameReady(ZBuffer *framebuffer);
 
+// Static-layer caching: render assemblies that never move once into a cached
+// color+depth layer and only draw the moving subtrees each frame. The layer
+// is rebuilt automatically when the view, lights or static poses change;
+// call ucncInvalidateStaticLayer after other changes (e.g. actor colors).
+void ucncSetStaticLayerCaching(int enable);
+void ucncInvalidateStaticLayer(void);
+
+// Dirty-region rendering: only the screen areas covered by assemblies that
+// moved since the last frame (before and after the move) are cleared and
+// re-rendered under a scissor; the rest of the previous frame is kept.
+// Without the static layer each area renders the whole scene, so they are
+// merged into at most two. Any view, light or static change falls back to a
+// full redraw, as does ucncInvalidateStaticLayer. ucncGetDirtyRects reports
+// the areas the last cncvis_render touched (the whole framebuffer after a
+// full redraw) so the display flush can be partial too; it returns the total
+// count and copies at most maxRects of them.
+#define UCNC_MAX_DIRTY_RECTS 8
+void ucncSetDirtyRegionRendering(int enable);
+int ucncGetDirtyRects(ucncRect *rects, int maxRects);
+
+// Toolpath overlay drawn over the scene, in the space of the named assembly
+// (e.g. the table, so the path moves with the part) or in world space for
+// NULL. The caller keeps ownership; pass NULL to remove it. Appends and
+// moves of the assembly trigger redraws, also with render-on-change.
+void ucncSetToolpath(ucncToolpath *toolpath, const char *assemblyName);
+
+// Material removal: every successful motion update cuts the stock along the
+// straight move of the tool tip, the origin of the tool assembly, expressed
+// in the space of the stock assembly (NULL for world space).
+// ucncSetAxesBatch makes one cut for the combined move. The stock is drawn
+// with the scene; the caller keeps ownership, pass NULL to detach it.
+void ucncSetStock(ucncStock *stock, const char *stockAssemblyName,
+                  const char *toolAssemblyName);
+// The same for a voxel stock, which also follows the tool's orientation: its
+// axis is the tool assembly's +z. Draw the stock by adding the actor from
+// ucncVoxelStockNewActor to the stock assembly. Both kinds of stock follow
+// the assemblies named last.
+void ucncSetVoxelStock(ucncVoxelStock *stock, const char *stockAssemblyName,
+                       const char *toolAssemblyName);
+
 // load an xml config file
 int ucncLoadNewConfiguration(const char *configFile);
 
 void cncvis_handle_mouse_motion(int dx, int dy);
 void cncvis_handle_mouse_wheel(int wheel_delta);
 
+// Render-on-change: when enabled, cncvis_render returns UCNC_FRAME_UNCHANGED
+// without touching the framebuffer if the assembly poses, camera, lights,
+// LOD levels and framebuffer are the same as for the previous frame (the OSD
+// only shows data derived from those; the FPS readout is left as it was).
+// Callers can then skip their flush and sleep. ucncRequestRedraw forces the
+// next frame after changes the renderer cannot see, e.g. actor colors.
+#define UCNC_FRAME_RENDERED 0
+#define UCNC_FRAME_UNCHANGED 1
+void ucncSetRenderOnChange(int enable);
+void ucncRequestRedraw(void);
+
 // Initialization and cleanup (if needed)
 int cncvis_init(const char *configFile);
-void cncvis_render(void);
+int cncvis_render(void);
 void cncvis_cleanup();
 
+// Instances: independent visualizers that can render on separate threads at
+// the same time, e.g. one per machine of a cell. An instance owns its scene,
+// camera, lights, framebuffer, TinyGL context and OSD, and the per-visualizer
+// settings above: collision checking, static layer, dirty regions,
+// render-on-change, toolpath, stock and motion source. Every function in
+// this header works on the calling thread's current instance. A thread with
+// none current uses the default instance, the one cncvis_init sets up in
+// the globals, shared by all such threads as before. An instance is current
+// on at most one thread at a time. Process-wide and shared by all instances:
+// the mesh cache (instances loading the same STL files share the meshes),
+// LOD and background loading options (ucncActorSetLodOptions,
+// ucncActorSetAsyncLoading) and the light and LOD generation counters.
+typedef struct cncvisInstance cncvisInstance;
+
+// Load configFile into a new instance; the current one is left as it was
+cncvisInstance *cncvisInstanceNew(const char *configFile);
+// Free an instance that is not current on another thread
+void cncvisInstanceFree(cncvisInstance *instance);
+// Switch this thread to instance, or back to the default one for NULL. -1
+// if the instance is current on another thread.
+int cncvisMakeCurrent(cncvisInstance *instance);
+cncvisInstance *cncvisGetCurrent(void);
+
 #endif // API_H
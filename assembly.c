@@ -63,14 +63,8 @@ ucncAssemblyNew(const char *name, const char *parentName, float originX,
   assembly->colorG = colorG;
   assembly->colorB = colorB;
 
-  // Initialize motion fields
-  if (motionType && strlen(motionType) > 0) {
-    snprintf(assembly->motionType, sizeof(assembly->motionType), "%s",
-             motionType);
-  } else {
-    snprintf(assembly->motionType, sizeof(assembly->motionType),
-             "none"); // Default to "none"
-  }
+  // Initialize motion fields, defaulting to no motion
+  assembly->motionType = ucncMotionTypeFromString(motionType);
 
   assembly->motionAxis = motionAxis;
   assembly->invertMotion = invertMotion;
@@ -80,12 +74,27 @@ ucncAssemblyNew(const char *name, const char *parentName, float originX,
   assembly->minRot = minRot;
   assembly->maxRot = maxRot;
   assembly->limitTriggered = 0;
+  assembly->collisionTriggered = 0;
 
   // Initialize actor and assembly lists (empty arrays)
   assembly->actors = NULL;
   assembly->actorCount = 0;
   assembly->assemblies = NULL;
   assembly->assemblyCount = 0;
+  assembly->parent = NULL;
+  assembly->index = NULL;
+  assembly->isDynamic = assembly->motionType != UCNC_MOTION_NONE;
+  assembly->poseGeneration = 0;
+  assembly->staticGeneration = 0;
+  assembly->sceneGeneration = 0;
+  assembly->changeStamp = 0;
+  memset(&assembly->screenRect, 0, sizeof(assembly->screenRect));
+
+  // Transforms are built on first use
+  ucncMatrixIdentity(assembly->localMatrix);
+  ucncMatrixIdentity(assembly->worldMatrix);
+  assembly->localDirty = 1;
+  assembly->worldDirty = 1;
 
   return assembly;
 }
@@ -108,9 +117,24 @@ int ucncAssemblyAddActor(ucncAssembly *assembly, ucncActor *actor) {
   assembly->actors[assembly->actorCount] = actor; // Add the new actor
   assembly->actorCount++;                         // Increment the actor count
 
+  // Caches of the tree's actors (collision world) are now stale
+  ucncAssembly *root = assembly;
+  while (root->parent)
+    root = root->parent;
+  root->sceneGeneration++;
+  ucncAssemblyMarkDirty(assembly);
+
   return 1; // Success
 }
 
+// Propagate the dynamic flag from a (possibly newly attached) parent
+static void classifyAssembly(ucncAssembly *assembly, int parentDynamic) {
+  assembly->isDynamic =
+      parentDynamic || assembly->motionType != UCNC_MOTION_NONE;
+  for (int i = 0; i < assembly->assemblyCount; i++)
+    classifyAssembly(assembly->assemblies[i], assembly->isDynamic);
+}
+
 int ucncAssemblyAddAssembly(ucncAssembly *parent, ucncAssembly *child) {
   if (!parent || !child) {
     fprintf(stderr, "Invalid parameters: parent or child assembly is NULL.\n");
@@ -136,56 +160,256 @@ int ucncAssemblyAddAssembly(ucncAssembly *parent, ucncAssembly *child) {
   // Add the child assembly to the parent's assembly list
   parent->assemblies[parent->assemblyCount] = child;
   parent->assemblyCount++;
+  child->parent = parent;
+  classifyAssembly(child, parent->isDynamic);
+
+  // The hierarchy changed; drop any index held by the tree's root
+  ucncAssembly *root = parent;
+  while (root->parent)
+    root = root->parent;
+  ucncAssemblyFreeIndex(root);
+  root->sceneGeneration++;
+  ucncAssemblyMarkDirty(child);
 
   return 1; // Success
 }
 
-void ucncAssemblyRender(const ucncAssembly *assembly) {
+static void invalidateWorld(ucncAssembly *assembly) {
+  assembly->worldDirty = 1;
+  for (int i = 0; i < assembly->assemblyCount; i++) {
+    // A dirty world matrix implies the whole subtree is already flagged
+    if (!assembly->assemblies[i]->worldDirty) {
+      invalidateWorld(assembly->assemblies[i]);
+    }
+  }
+}
+
+void ucncAssemblyMarkDirty(ucncAssembly *assembly) {
+  if (!assembly)
+    return;
+  assembly->localDirty = 1;
+  invalidateWorld(assembly);
+
+  ucncAssembly *root = assembly;
+  while (root->parent)
+    root = root->parent;
+  root->poseGeneration++;
+  assembly->changeStamp = root->poseGeneration;
+  if (!assembly->isDynamic)
+    root->staticGeneration++;
+}
+
+// Bring this assembly's matrices up to date, refreshing ancestors first
+static void updateTransform(ucncAssembly *assembly) {
+  if (assembly->parent &&
+      (assembly->parent->localDirty || assembly->parent->worldDirty)) {
+    updateTransform(assembly->parent);
+  }
+
+  if (assembly->localDirty) {
+    ucncMatrixFromPose(assembly->localMatrix, assembly->positionX,
+                       assembly->positionY, assembly->positionZ,
+                       assembly->originX, assembly->originY, assembly->originZ,
+                       assembly->rotationX, assembly->rotationY,
+                       assembly->rotationZ);
+    assembly->localDirty = 0;
+  }
+
+  if (assembly->worldDirty) {
+    if (assembly->parent) {
+      ucncMatrixMultiply(assembly->worldMatrix, assembly->parent->worldMatrix,
+                         assembly->localMatrix);
+    } else {
+      memcpy(assembly->worldMatrix, assembly->localMatrix,
+             sizeof(assembly->worldMatrix));
+    }
+    assembly->worldDirty = 0;
+  }
+}
+
+void ucncAssemblyUpdateTransforms(ucncAssembly *assembly) {
+  if (!assembly)
+    return;
+  updateTransform(assembly);
+  for (int i = 0; i < assembly->assemblyCount; i++) {
+    ucncAssemblyUpdateTransforms(assembly->assemblies[i]);
+  }
+}
+
+const float *ucncAssemblyGetLocalMatrix(ucncAssembly *assembly) {
+  if (!assembly)
+    return NULL;
+  updateTransform(assembly);
+  return assembly->localMatrix;
+}
+
+const float *ucncAssemblyGetWorldMatrix(ucncAssembly *assembly) {
+  if (!assembly)
+    return NULL;
+  updateTransform(assembly);
+  return assembly->worldMatrix;
+}
+
+enum { RENDER_ALL, RENDER_STATIC, RENDER_DYNAMIC };
+
+static void renderAssembly(ucncAssembly *assembly, int pass) {
+  // Static subtrees contain no moving parts, dynamic ones nothing static
+  if (pass == RENDER_STATIC && assembly->isDynamic)
+    return;
+  if (pass == RENDER_DYNAMIC && assembly->isDynamic)
+    pass = RENDER_ALL;
+
+  if (assembly->localDirty) {
+    updateTransform(assembly);
+  }
 
   glPushMatrix(); // Save the current transformation matrix
 
-  // Apply assembly transformations
-  // Translate to the assembly position in world space
-  glTranslatef(assembly->positionX, assembly->positionY, assembly->positionZ);
-
-  // Translate to the origin, then apply rotations
-  glTranslatef(assembly->originX, assembly->originY, assembly->originZ);
-  glRotatef(assembly->rotationX, 1.0f, 0.0f, 0.0f); // X-axis rotation
-  glRotatef(assembly->rotationY, 0.0f, 1.0f, 0.0f); // Y-axis rotation
-  glRotatef(assembly->rotationZ, 0.0f, 0.0f, 1.0f); // Z-axis rotation
-  drawAxis(100.0f);
-  // Translate back by the origin (undo translation)
-  glTranslatef(-assembly->originX, -assembly->originY, -assembly->originZ);
-
-  // Debugging output: Print assembly details
-  // printf("Rendering assembly: %s at position (%.2f, %.2f, %.2f) with rotation
-  // (%.2f, %.2f, %.2f)\n",
-  //       assembly->name, assembly->positionX, assembly->positionY,
-  //       assembly->positionZ, assembly->rotationX, assembly->rotationY,
-  //       assembly->rotationZ);
-
-  // Render all actors in this assembly
-  for (int i = 0; i < assembly->actorCount; i++) {
-    ucncActorRender(assembly->actors[i]);
+  // Apply the cached position * origin * rotation * -origin transform
+  glMultMatrixf(assembly->localMatrix);
+
+  if (pass != RENDER_DYNAMIC) {
+    // Axis marker sits at the rotation origin
+    glPushMatrix();
+    glTranslatef(assembly->originX, assembly->originY, assembly->originZ);
+    drawAxis(100.0f);
+    glPopMatrix();
+
+    // Render all actors in this assembly, each at the level of detail that
+    // matches its current on-screen size
+    for (int i = 0; i < assembly->actorCount; i++) {
+      ucncActor *actor = assembly->actors[i];
+      ucncActorRenderLod(actor, ucncActorSelectLod(actor));
+    }
   }
 
   // Render all child assemblies recursively
   for (int i = 0; i < assembly->assemblyCount; i++) {
-    ucncAssemblyRender(assembly->assemblies[i]);
+    renderAssembly(assembly->assemblies[i], pass);
   }
 
   glPopMatrix(); // Restore the previous transformation matrix
 }
 
+void ucncAssemblyRender(ucncAssembly *assembly) {
+  renderAssembly(assembly, RENDER_ALL);
+}
+
+void ucncAssemblyRenderStatic(ucncAssembly *assembly) {
+  renderAssembly(assembly, RENDER_STATIC);
+}
+
+void ucncAssemblyRenderDynamic(ucncAssembly *assembly) {
+  renderAssembly(assembly, RENDER_DYNAMIC);
+}
+
+ucncMotionType ucncMotionTypeFromString(const char *motionType) {
+  if (motionType && strcmp(motionType, MOTION_TYPE_ROTATIONAL) == 0)
+    return UCNC_MOTION_ROTATIONAL;
+  if (motionType && strcmp(motionType, MOTION_TYPE_LINEAR) == 0)
+    return UCNC_MOTION_LINEAR;
+  return UCNC_MOTION_NONE;
+}
+
+const char *ucncMotionTypeToString(ucncMotionType motionType) {
+  switch (motionType) {
+  case UCNC_MOTION_ROTATIONAL:
+    return MOTION_TYPE_ROTATIONAL;
+  case UCNC_MOTION_LINEAR:
+    return MOTION_TYPE_LINEAR;
+  default:
+    return MOTION_TYPE_NONE;
+  }
+}
+
+static uint32_t hashName(const char *name) {
+  uint32_t h = 2166136261u; // FNV-1a
+  while (*name) {
+    h ^= (unsigned char)*name++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static int countAssemblies(const ucncAssembly *assembly) {
+  int count = 1;
+  for (int i = 0; i < assembly->assemblyCount; i++)
+    count += countAssemblies(assembly->assemblies[i]);
+  return count;
+}
+
+static void indexInsert(ucncAssemblyIndex *index, ucncAssembly *assembly) {
+  uint32_t slot = hashName(assembly->name) & (index->capacity - 1);
+  while (index->slots[slot]) {
+    if (strcmp(index->slots[slot]->name, assembly->name) == 0)
+      return; // Keep the first match in depth-first order, like the walk
+    slot = (slot + 1) & (index->capacity - 1);
+  }
+  index->slots[slot] = assembly;
+
+  if (assembly->motionType != UCNC_MOTION_NONE)
+    index->axes[index->axisCount++] = assembly;
+
+  for (int i = 0; i < assembly->assemblyCount; i++)
+    indexInsert(index, assembly->assemblies[i]);
+}
+
+int ucncAssemblyBuildIndex(ucncAssembly *root) {
+  if (!root)
+    return 0;
+  ucncAssemblyFreeIndex(root);
+
+  int count = countAssemblies(root);
+  ucncAssemblyIndex *index = calloc(1, sizeof(ucncAssemblyIndex));
+  if (!index) {
+    fprintf(stderr, "Memory allocation failed for assembly index.\n");
+    return 0;
+  }
+  index->capacity = 16;
+  while (index->capacity < count * 2)
+    index->capacity <<= 1;
+  index->slots = calloc(index->capacity, sizeof(ucncAssembly *));
+  index->axes = calloc(count, sizeof(ucncAssembly *));
+  if (!index->slots || !index->axes) {
+    fprintf(stderr, "Memory allocation failed for assembly index.\n");
+    free(index->slots);
+    free(index->axes);
+    free(index);
+    return 0;
+  }
+
+  indexInsert(index, root);
+  root->index = index;
+  return 1;
+}
+
+void ucncAssemblyFreeIndex(ucncAssembly *root) {
+  if (!root || !root->index)
+    return;
+  free(root->index->slots);
+  free(root->index->axes);
+  free(root->index);
+  root->index = NULL;
+}
+
 ucncAssembly *findAssemblyByName(ucncAssembly *rootAssembly, const char *name) {
   if (!rootAssembly || !name)
     return NULL;
 
-  printf("Checking assembly: %s\n", rootAssembly->name);
+  // Indexed lookup when searching from a root that owns an index
+  const ucncAssemblyIndex *index = rootAssembly->index;
+  if (index) {
+    uint32_t slot = hashName(name) & (index->capacity - 1);
+    while (index->slots[slot]) {
+      if (strcmp(index->slots[slot]->name, name) == 0)
+        return index->slots[slot];
+      slot = (slot + 1) & (index->capacity - 1);
+    }
+    return NULL;
+  }
 
   // Check if the root assembly's name matches
   if (strcmp(rootAssembly->name, name) == 0) {
-    printf("Found assembly: %s\n", rootAssembly->name);
     return rootAssembly;
   }
 
@@ -220,6 +444,7 @@ void ucncAssemblyFree(ucncAssembly *assembly) {
     }
   }
   free(assembly->assemblies); // Free the array of child assembly pointers
+  ucncAssemblyFreeIndex(assembly);
 
   // Free the memory allocated for the assembly itself
   free(assembly);
@@ -3,6 +3,7 @@
 
 #include "actor.h"
 #include "cncvis.h"
+#include "transform.h"
 
 #define MAX_NAME_LENGTH 64
 
@@ -20,15 +21,40 @@ typedef struct ucncAssembly {
   float minPos, maxPos;
   float minRot, maxRot;
   int limitTriggered;
-  char motionType[MAX_NAME_LENGTH];
+  int collisionTriggered; // A move was rejected by collision checking
+  ucncMotionType motionType;
   char motionAxis;
   int invertMotion;
   struct ucncActor **actors;
   int actorCount;
   struct ucncAssembly **assemblies;
   int assemblyCount;
+  struct ucncAssembly *parent;
+  // Cached transforms (column-major). localMatrix maps this assembly's space
+  // into its parent's, worldMatrix into the root's.
+  float localMatrix[16];
+  float worldMatrix[16];
+  int localDirty;
+  int worldDirty;
+  struct ucncAssemblyIndex *index; // Name/axis lookup, owned by the root only
+  int isDynamic; // Has motion itself or below a moving ancestor
+  // Change counters, maintained on the root only
+  unsigned long poseGeneration;   // Any pose change in the tree
+  unsigned long staticGeneration; // Pose changes of static assemblies
+  unsigned long sceneGeneration;  // Actors or assemblies added to the tree
+  unsigned long changeStamp; // Root poseGeneration of this assembly's last move
+  ucncRect screenRect;       // Where it was drawn last frame (dirty regions)
 } ucncAssembly;
 
+// Name -> assembly hash index plus a dense table of the moving assemblies,
+// which axis handles index into
+typedef struct ucncAssemblyIndex {
+  ucncAssembly **slots;
+  int capacity;
+  ucncAssembly **axes;
+  int axisCount;
+} ucncAssemblyIndex;
+
 ucncAssembly *
 ucncAssemblyNew(const char *name, const char *parentName, float originX,
                 float originY, float originZ, float positionX, float positionY,
@@ -41,10 +67,29 @@ ucncAssemblyNew(const char *name, const char *parentName, float originX,
 
 int ucncAssemblyAddActor(ucncAssembly *assembly, ucncActor *actor);
 int ucncAssemblyAddAssembly(ucncAssembly *parent, ucncAssembly *child);
-void ucncAssemblyRender(const ucncAssembly *assembly);
+void ucncAssemblyRender(ucncAssembly *assembly);
+// Split rendering for static-layer caching: the static pass draws only
+// assemblies that never move, the dynamic pass only the moving subtrees
+void ucncAssemblyRenderStatic(ucncAssembly *assembly);
+void ucncAssemblyRenderDynamic(ucncAssembly *assembly);
 void ucncAssemblyFree(ucncAssembly *assembly);
 ucncAssembly *findAssemblyByName(ucncAssembly *rootAssembly, const char *name);
 
+ucncMotionType ucncMotionTypeFromString(const char *motionType);
+const char *ucncMotionTypeToString(ucncMotionType motionType);
+
+// Build (or rebuild) the lookup index stored on the root assembly.
+// findAssemblyByName uses it whenever it is called with that root.
+int ucncAssemblyBuildIndex(ucncAssembly *root);
+void ucncAssemblyFreeIndex(ucncAssembly *root);
+
+// Call after changing position/rotation/origin fields directly; motion API
+// functions do this themselves. Descendants' world matrices are invalidated.
+void ucncAssemblyMarkDirty(ucncAssembly *assembly);
+void ucncAssemblyUpdateTransforms(ucncAssembly *assembly);
+const float *ucncAssemblyGetLocalMatrix(ucncAssembly *assembly);
+const float *ucncAssemblyGetWorldMatrix(ucncAssembly *assembly);
+
 void cleanupAssemblies(ucncAssembly **assemblies, int assemblyCount);
 
 #endif // ASSEMBLY_H
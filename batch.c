@@ -0,0 +1,364 @@
+/* batch.c */
+
+#define _DEFAULT_SOURCE // ftruncate with -std=c11
+
+#include "batch.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+
+#define UCNC_BATCH_MAX_THREADS 64
+// Shards take blocks of this many frames in turn, whatever their threads
+#define UCNC_BATCH_SHARD_FRAMES 4
+
+// Frames [first, first + count) of one job
+typedef struct {
+  int job;
+  int first, count;
+} BatchUnit;
+
+typedef struct {
+  const ucncBatchJob *jobs;
+  ucncBatchFormat format;
+  BatchUnit *units;
+  int unitCount;
+  atomic_int next;
+  atomic_int failed;
+} BatchRun;
+
+void ucncBatchScriptDefaults(ucncBatchScript *script) {
+  memset(script, 0, sizeof(*script));
+  script->frames = 1;
+}
+
+int ucncBatchScriptLoad(const char *path, ucncBatchScript *script) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Failed to open batch script '%s'.\n", path);
+    return -1;
+  }
+
+  char line[256];
+  int lineNumber = 0, result = 0;
+  while (result == 0 && fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char *comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+    char key[16], name[64];
+    float v[3];
+    if (sscanf(line, "%15s", key) != 1)
+      continue; // Blank line
+
+    int ok;
+    if (strcmp(key, "size") == 0) {
+      ok = sscanf(line, "%*s %d %d", &script->width, &script->height) == 2 &&
+           script->width > 0 && script->height > 0;
+    } else if (strcmp(key, "frames") == 0) {
+      ok = sscanf(line, "%*s %d", &script->frames) == 1 && script->frames > 0;
+    } else if (strcmp(key, "camera") == 0) {
+      ok = sscanf(line, "%*s %f %f %f", &v[0], &v[1], &v[2]) == 3;
+      if (ok) {
+        memcpy(script->camera, v, sizeof(v));
+        script->hasCamera = 1;
+      }
+    } else if (strcmp(key, "target") == 0) {
+      ok = sscanf(line, "%*s %f %f %f", &v[0], &v[1], &v[2]) == 3;
+      if (ok) {
+        memcpy(script->target, v, sizeof(v));
+        script->hasTarget = 1;
+      }
+    } else if (strcmp(key, "orbit") == 0) {
+      ok = sscanf(line, "%*s %f", &script->orbit) == 1;
+    } else if (strcmp(key, "axis") == 0) {
+      ok = sscanf(line, "%*s %63s %f %f", name, &v[0], &v[1]) == 3 &&
+           script->axisCount < UCNC_BATCH_MAX_AXES;
+      if (ok) {
+        int a = script->axisCount++;
+        snprintf(script->axes[a], sizeof(script->axes[a]), "%s", name);
+        script->from[a] = v[0];
+        script->to[a] = v[1];
+      }
+    } else {
+      ok = 0;
+    }
+
+    if (!ok) {
+      fprintf(stderr, "%s:%d: invalid or unknown setting '%s'.\n", path,
+              lineNumber, key);
+      result = -1;
+    }
+  }
+  fclose(file);
+  return result;
+}
+
+// Framebuffer size of a script, rounded as ucncSetZBufferDimensions does
+static void frameSize(const ucncBatchScript *script, int *width, int *height) {
+  *width = script->width > 0 ? (script->width + 3) & ~3 : ZGL_FB_WIDTH;
+  *height = script->height > 0 ? script->height : ZGL_FB_HEIGHT;
+}
+
+static void frameFileName(char *out, size_t size, const ucncBatchJob *job,
+                          ucncBatchFormat format, int frame) {
+  if (format == UCNC_BATCH_RAW)
+    snprintf(out, size, "%s.rgba", job->output);
+  else if (job->script.frames == 1)
+    snprintf(out, size, "%s.png", job->output);
+  else
+    snprintf(out, size, "%s_%04d.png", job->output, frame);
+}
+
+// Pose the scene and camera for one frame of the script. The camera starts
+// from home, the configuration's camera, so no frame depends on another.
+static int poseFrame(const ucncBatchScript *script, const ucncCamera *home,
+                     const ucncAxisHandle *handles, int frame) {
+  float t = script->frames > 1 ? (float)frame / (script->frames - 1) : 0.0f;
+  float values[UCNC_BATCH_MAX_AXES];
+  for (int a = 0; a < script->axisCount; a++)
+    values[a] = script->from[a] + (script->to[a] - script->from[a]) * t;
+  int result = 0;
+  if (script->axisCount > 0 &&
+      ucncSetAxesBatch(handles, values, script->axisCount) != 0)
+    result = -1;
+
+  ucncCamera *camera = ucncGetCamera();
+  *camera = *home;
+  if (script->hasCamera) {
+    camera->positionX = script->camera[0];
+    camera->positionY = script->camera[1];
+    camera->positionZ = script->camera[2];
+  }
+  if (script->hasTarget)
+    ucncCameraSetTarget(camera, script->target[0], script->target[1],
+                        script->target[2]);
+  if (script->orbit != 0.0f) {
+    float rad = script->orbit * frame * (float)M_PI / 180.0f;
+    float dx = camera->positionX - camera->targetX;
+    float dy = camera->positionY - camera->targetY;
+    camera->positionX = camera->targetX + dx * cosf(rad) - dy * sinf(rad);
+    camera->positionY = camera->targetY + dx * sinf(rad) + dy * cosf(rad);
+  }
+  update_camera_matrix(camera);
+  return result;
+}
+
+static int writeFrame(const ucncBatchJob *job, ucncBatchFormat format,
+                      int frame, unsigned char *rgba) {
+  char path[1024];
+  frameFileName(path, sizeof(path), job, format, frame);
+  ZBuffer *zb = ucncGetFramebuffer();
+  int w = zb->xsize, h = zb->ysize;
+  if (format == UCNC_BATCH_PNG)
+    return saveFramebufferAsImage(zb, path, w, h);
+
+  const PIXEL *pixels = zb->pbuf;
+  for (int i = 0; i < w * h; i++) {
+    rgba[4 * i + 0] = GET_RED(pixels[i]);
+    rgba[4 * i + 1] = GET_GREEN(pixels[i]);
+    rgba[4 * i + 2] = GET_BLUE(pixels[i]);
+    rgba[4 * i + 3] = 255;
+  }
+  size_t bytes = (size_t)w * h * 4;
+  int fd = open(path, O_WRONLY); // Own descriptor, so the seek is private
+  if (fd < 0)
+    return -1;
+  ssize_t written = -1;
+  if (lseek(fd, (off_t)frame * bytes, SEEK_SET) >= 0)
+    written = write(fd, rgba, bytes);
+  close(fd);
+  return written == (ssize_t)bytes ? 0 : -1;
+}
+
+static void *batchWorker(void *arg) {
+  BatchRun *run = arg;
+  cncvisInstance *instance = NULL;
+  const char *config = NULL; // Loaded into instance
+  ucncCamera home;
+  unsigned char *rgba = NULL;
+  size_t rgbaSize = 0;
+
+  int u;
+  while ((u = atomic_fetch_add(&run->next, 1)) < run->unitCount) {
+    const BatchUnit *unit = &run->units[u];
+    const ucncBatchJob *job = &run->jobs[unit->job];
+    const ucncBatchScript *script = &job->script;
+
+    if (instance && strcmp(config, job->config) == 0) {
+      ucncResetAssembliesToHome(ucncGetScene()); // Reuse the loaded scene
+    } else {
+      cncvisInstanceFree(instance);
+      config = NULL;
+      instance = cncvisInstanceNew(job->config);
+      if (!instance || cncvisMakeCurrent(instance) != 0) {
+        cncvisInstanceFree(instance);
+        instance = NULL;
+        atomic_fetch_add(&run->failed, unit->count);
+        continue;
+      }
+      config = job->config;
+      home = *ucncGetCamera();
+    }
+
+    int width, height;
+    frameSize(script, &width, &height);
+    ZBuffer *zb = ucncGetFramebuffer();
+    if (zb->xsize != width || zb->ysize != height)
+      ucncSetZBufferDimensions(width, height);
+    size_t size = (size_t)zb->xsize * zb->ysize * 4;
+    if (run->format == UCNC_BATCH_RAW && size > rgbaSize) {
+      free(rgba);
+      rgba = malloc(size);
+      rgbaSize = rgba ? size : 0;
+    }
+
+    ucncAxisHandle handles[UCNC_BATCH_MAX_AXES];
+    int posable = 1;
+    for (int a = 0; a < script->axisCount; a++) {
+      handles[a] = ucncGetAxisHandle(script->axes[a]);
+      if (handles[a] < 0) {
+        fprintf(stderr, "%s: no axis '%s'.\n", job->config, script->axes[a]);
+        posable = 0;
+      }
+    }
+    if (!posable || (run->format == UCNC_BATCH_RAW && !rgba)) {
+      atomic_fetch_add(&run->failed, unit->count);
+      continue;
+    }
+
+    for (int f = unit->first; f < unit->first + unit->count; f++) {
+      int status = poseFrame(script, &home, handles, f);
+      cncvis_render();
+      if (writeFrame(job, run->format, f, rgba) != 0)
+        status = -1;
+      if (status != 0)
+        atomic_fetch_add(&run->failed, 1);
+    }
+  }
+
+  cncvisInstanceFree(instance);
+  free(rgba);
+  return NULL;
+}
+
+// Cut this shard's frames into units for the workers, or only count them
+// when units is NULL. Which frames belong to a shard depends on nothing but
+// the frame's block and the shard count, so processes with different
+// thread counts still cover every frame exactly once; the thread count only
+// decides how finely a shard's own frames are split.
+static int planUnits(const ucncBatchJob *jobs, int jobCount, int shardIndex,
+                     int shardCount, int threads, BatchUnit *units) {
+  int unitCount = 0;
+  int block = 0; // Counted across jobs so short jobs spread over shards
+  for (int j = 0; j < jobCount; j++) {
+    int frames = jobs[j].script.frames;
+    int blocks = (frames + UCNC_BATCH_SHARD_FRAMES - 1) /
+                 UCNC_BATCH_SHARD_FRAMES;
+    int owned = 0;
+    for (int b = 0; b < blocks; b++)
+      if ((block + b) % shardCount == shardIndex) {
+        int first = b * UCNC_BATCH_SHARD_FRAMES;
+        owned += frames - first < UCNC_BATCH_SHARD_FRAMES
+                     ? frames - first
+                     : UCNC_BATCH_SHARD_FRAMES;
+      }
+    int chunk = (owned + threads * 4 - 1) / (threads * 4);
+    for (int b = 0; b < blocks; b++) {
+      if ((block + b) % shardCount != shardIndex)
+        continue;
+      // Consecutive owned blocks (a single shard) form one range
+      int first = b * UCNC_BATCH_SHARD_FRAMES;
+      while (b + 1 < blocks && (block + b + 1) % shardCount == shardIndex)
+        b++;
+      int end = (b + 1) * UCNC_BATCH_SHARD_FRAMES;
+      if (end > frames)
+        end = frames;
+      for (; first < end; first += chunk, unitCount++) {
+        if (units)
+          units[unitCount] = (BatchUnit){
+              .job = j,
+              .first = first,
+              .count = end - first < chunk ? end - first : chunk};
+      }
+    }
+    block += blocks;
+  }
+  return unitCount;
+}
+
+// Create the raw stream files at their final length; workers then write
+// frames at their offsets, in any order. Other shards may be writing to them
+// already, so nothing is truncated to zero, but every shard cuts off what a
+// longer earlier run left past the last frame. They all agree on the length.
+static int createRawStreams(const ucncBatchJob *jobs, int jobCount) {
+  for (int j = 0; j < jobCount; j++) {
+    char path[1024];
+    frameFileName(path, sizeof(path), &jobs[j], UCNC_BATCH_RAW, 0);
+    int width, height;
+    frameSize(&jobs[j].script, &width, &height);
+    off_t length = (off_t)jobs[j].script.frames * width * height * 4;
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, length) != 0) {
+      fprintf(stderr, "Failed to create '%s'.\n", path);
+      if (fd >= 0)
+        close(fd);
+      return -1;
+    }
+    close(fd);
+  }
+  return 0;
+}
+
+int ucncBatchRun(const ucncBatchJob *jobs, int jobCount,
+                 const ucncBatchOptions *options) {
+  if (!jobs || jobCount <= 0 || !options)
+    return -1;
+  int shardCount = options->shardCount > 1 ? options->shardCount : 1;
+  if (options->shardIndex < 0 || options->shardIndex >= shardCount)
+    return -1;
+  for (int j = 0; j < jobCount; j++)
+    if (jobs[j].script.frames <= 0 || !jobs[j].config || !jobs[j].output)
+      return -1;
+  if (options->format == UCNC_BATCH_RAW &&
+      createRawStreams(jobs, jobCount) != 0)
+    return -1;
+
+  int threads = options->threads;
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+  if (threads > UCNC_BATCH_MAX_THREADS)
+    threads = UCNC_BATCH_MAX_THREADS;
+
+  // Long sequences are split so every worker gets a share; a worker that
+  // stays on the same job keeps its instance, so splitting costs no loads
+  int unitCount = planUnits(jobs, jobCount, options->shardIndex, shardCount,
+                            threads, NULL);
+  BatchRun run = {.jobs = jobs, .format = options->format};
+  run.units = malloc((unitCount > 0 ? unitCount : 1) * sizeof(BatchUnit));
+  if (!run.units)
+    return -1;
+  run.unitCount = planUnits(jobs, jobCount, options->shardIndex, shardCount,
+                            threads, run.units);
+  atomic_init(&run.next, 0);
+  atomic_init(&run.failed, 0);
+
+  cncvisInstance *caller = cncvisGetCurrent(); // The calling thread works too
+  if (threads > run.unitCount)
+    threads = run.unitCount > 0 ? run.unitCount : 1;
+  pthread_t workers[UCNC_BATCH_MAX_THREADS];
+  int started = 0;
+  for (int i = 1; i < threads; i++) {
+    if (pthread_create(&workers[started], NULL, batchWorker, &run) != 0)
+      break;
+    started++;
+  }
+  batchWorker(&run);
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+  cncvisMakeCurrent(caller);
+
+  free(run.units);
+  return atomic_load(&run.failed);
+}
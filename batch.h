@@ -0,0 +1,68 @@
+/* batch.h */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "api.h"
+
+#define UCNC_BATCH_MAX_AXES 16 // Axis sweeps per script at most
+
+// Offline rendering of frame sequences for many configurations at once.
+// Jobs are cut into runs of frames that worker threads pick up in order,
+// each rendering into its own cncvis instance; a worker keeps its instance
+// while the next run uses the same configuration, and all of them share the
+// meshes through the mesh cache. Every frame is posed from its index alone,
+// so frames can be rendered in any order and by any worker.
+
+// Camera path and axis sweeps of one job. Text form, one setting per line,
+// '#' starting a comment:
+//
+//   size 320 240           framebuffer size (default 640 x 480)
+//   frames 60              number of frames (default 1)
+//   camera 800 800 400     camera position (default: the configuration's)
+//   target 0 0 100         look-at point
+//   orbit 6                degrees per frame about the target's z axis
+//   axis base -30 30       axis position swept from the first to last frame
+typedef struct {
+  int width, height; // 0 for the default framebuffer size
+  int frames;
+  int hasCamera, hasTarget;
+  float camera[3], target[3];
+  float orbit;
+  int axisCount;
+  char axes[UCNC_BATCH_MAX_AXES][64];
+  float from[UCNC_BATCH_MAX_AXES], to[UCNC_BATCH_MAX_AXES];
+} ucncBatchScript;
+
+typedef struct {
+  const char *config;     // Machine configuration
+  const char *output;     // Path prefix of the files written
+  ucncBatchScript script;
+} ucncBatchJob;
+
+// PNG writes output.png for a single frame and output_0000.png... for a
+// sequence. RAW writes all frames of a job to output.rgba, 8-bit RGBA in
+// frame order, as taken by ffmpeg -f rawvideo -pix_fmt rgba.
+typedef enum { UCNC_BATCH_PNG, UCNC_BATCH_RAW } ucncBatchFormat;
+
+typedef struct {
+  ucncBatchFormat format;
+  int threads; // 0 for one per core
+  // Fan out over processes too: frames are dealt out in blocks of 4, and
+  // this process renders every shardCount-th block starting with block
+  // shardIndex, whatever its thread count. shardCount 0 or 1 renders all.
+  int shardIndex, shardCount;
+} ucncBatchOptions;
+
+void ucncBatchScriptDefaults(ucncBatchScript *script);
+// Read a script file over the current settings; -1 on errors, reported on
+// stderr with the line number
+int ucncBatchScriptLoad(const char *path, ucncBatchScript *script);
+
+// Render the jobs; returns the number of frames that could not be rendered
+// as scripted (configuration or axis not found, axis limit, write error),
+// or -1 for invalid arguments
+int ucncBatchRun(const ucncBatchJob *jobs, int jobCount,
+                 const ucncBatchOptions *options);
+
+#endif // BATCH_H
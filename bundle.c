@@ -0,0 +1,626 @@
+/* bundle.c */
+
+#include "bundle.h"
+#include "config.h"
+#include "mesh.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BUNDLE_MAGIC "UCNCSCN\0"
+#define BUNDLE_BYTE_ORDER 0x01020304u
+#define BUNDLE_ALIGN 16
+#define BUNDLE_PATH_LENGTH 256
+
+// File layout: header, then the assembly, actor, light and mesh tables, then
+// one block per mesh holding 9 vertex floats per triangle followed by 3
+// normal floats per triangle. Every table and block starts on a BUNDLE_ALIGN
+// boundary.
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t headerSize;
+  uint32_t assemblyCount, actorCount, lightCount, meshCount;
+  uint32_t reserved;
+  uint64_t fileSize;
+  uint64_t configHash;
+  uint64_t assemblyOffset, actorOffset, lightOffset, meshOffset;
+} BundleHeader;
+
+// Assemblies are stored parents first; the root has parentIndex -1
+typedef struct {
+  char name[MAX_NAME_LENGTH];
+  char parentName[MAX_NAME_LENGTH];
+  int32_t parentIndex;
+  int32_t motionType;
+  int32_t invertMotion;
+  char motionAxis;
+  char pad[3];
+  float origin[3], position[3], rotation[3];
+  float homePosition[3], homeRotation[3];
+  float color[3];
+  float minPos, maxPos, minRot, maxRot;
+} BundleAssembly;
+
+typedef struct {
+  char name[MAX_NAME_LENGTH];
+  uint32_t assemblyIndex;
+  uint32_t meshIndex;
+  float color[3];
+  uint32_t pad;
+} BundleActor;
+
+typedef struct {
+  uint32_t lightId;
+  int32_t isSpotlight;
+  float position[4], ambient[4], diffuse[4], specular[4];
+  float spotDirection[3], spotCutoff, spotExponent;
+  float constantAttenuation, linearAttenuation, quadraticAttenuation;
+} BundleLight;
+
+typedef struct {
+  char path[BUNDLE_PATH_LENGTH]; // Relative to the configuration directory
+  int64_t fileSize, fileMtime;   // Source STL when the bundle was written
+  uint64_t triangleCount;
+  uint64_t dataOffset;
+  float boundCenter[3], boundRadius;
+} BundleMesh;
+
+// A mapped bundle stays alive while any mesh still borrows its geometry
+typedef struct {
+  void *base;
+  size_t size;
+  atomic_int refCount;
+} BundleMapping;
+
+static void mappingRetain(void *context) {
+  BundleMapping *mapping = context;
+  atomic_fetch_add(&mapping->refCount, 1);
+}
+
+static void mappingRelease(void *context) {
+  BundleMapping *mapping = context;
+  if (atomic_fetch_sub(&mapping->refCount, 1) == 1) {
+    munmap(mapping->base, mapping->size);
+    free(mapping);
+  }
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + BUNDLE_ALIGN - 1) & ~(uint64_t)(BUNDLE_ALIGN - 1);
+}
+
+// FNV-1a over the whole file; returns 0 if it cannot be read
+static int hashFile(const char *path, uint64_t *hash) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return 0;
+  uint64_t h = 0xcbf29ce484222325ull;
+  unsigned char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      h ^= buffer[i];
+      h *= 0x100000001b3ull;
+    }
+  }
+  int ok = !ferror(file);
+  fclose(file);
+  *hash = h;
+  return ok;
+}
+
+int ucncBundlePath(const char *configFile, char *bundleFile, size_t size) {
+  int ret = snprintf(bundleFile, size, "%s%s", configFile, UCNC_BUNDLE_SUFFIX);
+  return ret > 0 && (size_t)ret < size;
+}
+
+/* ---------------------------------------------------------------- writing */
+
+typedef struct {
+  ucncAssembly **assemblies;
+  int32_t *parents;
+  int assemblyCount;
+  ucncActor **actors;
+  uint32_t *actorAssemblies;
+  int actorCount;
+  ucncMesh **meshes;
+  int meshCount;
+} SceneTables;
+
+static int pushAssembly(SceneTables *t, ucncAssembly *assembly,
+                        int32_t parent) {
+  ucncAssembly **assemblies =
+      realloc(t->assemblies, (t->assemblyCount + 1) * sizeof(*assemblies));
+  if (!assemblies)
+    return 0;
+  t->assemblies = assemblies;
+  int32_t *parents =
+      realloc(t->parents, (t->assemblyCount + 1) * sizeof(*parents));
+  if (!parents)
+    return 0;
+  t->parents = parents;
+  int32_t index = t->assemblyCount++;
+  t->assemblies[index] = assembly;
+  t->parents[index] = parent;
+
+  for (int i = 0; i < assembly->actorCount; i++) {
+    if (assembly->actors[i]->geometry.render)
+      continue; // Procedural geometry has nothing to store
+    ucncActor **actors =
+        realloc(t->actors, (t->actorCount + 1) * sizeof(*actors));
+    if (!actors)
+      return 0;
+    t->actors = actors;
+    uint32_t *owners = realloc(t->actorAssemblies,
+                               (t->actorCount + 1) * sizeof(*owners));
+    if (!owners)
+      return 0;
+    t->actorAssemblies = owners;
+    t->actors[t->actorCount] = assembly->actors[i];
+    t->actorAssemblies[t->actorCount++] = (uint32_t)index;
+
+    int known = 0;
+    for (int m = 0; m < t->meshCount; m++)
+      known |= t->meshes[m] == assembly->actors[i]->mesh;
+    if (!known && !ucncMeshWait(assembly->actors[i]->mesh)) {
+      fprintf(stderr, "Mesh '%s' could not be loaded for the bundle.\n",
+              assembly->actors[i]->mesh->path);
+      return 0;
+    }
+    if (!known) {
+      ucncMesh **meshes =
+          realloc(t->meshes, (t->meshCount + 1) * sizeof(*meshes));
+      if (!meshes)
+        return 0;
+      t->meshes = meshes;
+      t->meshes[t->meshCount++] = assembly->actors[i]->mesh;
+    }
+  }
+
+  for (int i = 0; i < assembly->assemblyCount; i++) {
+    if (!pushAssembly(t, assembly->assemblies[i], index))
+      return 0;
+  }
+  return 1;
+}
+
+static void freeTables(SceneTables *t) {
+  free(t->assemblies);
+  free(t->parents);
+  free(t->actors);
+  free(t->actorAssemblies);
+  free(t->meshes);
+}
+
+static int writeAt(FILE *file, uint64_t offset, const void *data,
+                   size_t size) {
+  if (fseek(file, (long)offset, SEEK_SET) != 0)
+    return 0;
+  return size == 0 || fwrite(data, size, 1, file) == 1;
+}
+
+static void setVector(float *v, float x, float y, float z) {
+  v[0] = x;
+  v[1] = y;
+  v[2] = z;
+}
+
+static int writeTables(FILE *file, const SceneTables *t, ucncLight **lights,
+                       int lightCount, const char *configDir,
+                       uint64_t configHash) {
+  BundleHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+  header.version = UCNC_BUNDLE_VERSION;
+  header.byteOrder = BUNDLE_BYTE_ORDER;
+  header.headerSize = sizeof(BundleHeader);
+  header.assemblyCount = (uint32_t)t->assemblyCount;
+  header.actorCount = (uint32_t)t->actorCount;
+  header.lightCount = (uint32_t)lightCount;
+  header.meshCount = (uint32_t)t->meshCount;
+  header.configHash = configHash;
+  header.assemblyOffset = alignOffset(sizeof(BundleHeader));
+  header.actorOffset = alignOffset(header.assemblyOffset +
+                                   t->assemblyCount * sizeof(BundleAssembly));
+  header.lightOffset =
+      alignOffset(header.actorOffset + t->actorCount * sizeof(BundleActor));
+  header.meshOffset =
+      alignOffset(header.lightOffset + lightCount * sizeof(BundleLight));
+  uint64_t end = header.meshOffset + t->meshCount * sizeof(BundleMesh);
+
+  for (int i = 0; i < t->assemblyCount; i++) {
+    const ucncAssembly *a = t->assemblies[i];
+    BundleAssembly r;
+    memset(&r, 0, sizeof(r));
+    memcpy(r.name, a->name, sizeof(r.name));
+    memcpy(r.parentName, a->parentName, sizeof(r.parentName));
+    r.parentIndex = t->parents[i];
+    r.motionType = (int32_t)a->motionType;
+    r.invertMotion = a->invertMotion;
+    r.motionAxis = a->motionAxis;
+    setVector(r.origin, a->originX, a->originY, a->originZ);
+    setVector(r.position, a->positionX, a->positionY, a->positionZ);
+    setVector(r.rotation, a->rotationX, a->rotationY, a->rotationZ);
+    setVector(r.homePosition, a->homePositionX, a->homePositionY,
+              a->homePositionZ);
+    setVector(r.homeRotation, a->homeRotationX, a->homeRotationY,
+              a->homeRotationZ);
+    setVector(r.color, a->colorR, a->colorG, a->colorB);
+    r.minPos = a->minPos;
+    r.maxPos = a->maxPos;
+    r.minRot = a->minRot;
+    r.maxRot = a->maxRot;
+    if (!writeAt(file, header.assemblyOffset + i * sizeof(r), &r, sizeof(r)))
+      return 0;
+  }
+
+  for (int i = 0; i < t->actorCount; i++) {
+    const ucncActor *a = t->actors[i];
+    BundleActor r;
+    memset(&r, 0, sizeof(r));
+    memcpy(r.name, a->name, sizeof(r.name));
+    r.assemblyIndex = t->actorAssemblies[i];
+    for (int m = 0; m < t->meshCount; m++) {
+      if (t->meshes[m] == a->mesh)
+        r.meshIndex = (uint32_t)m;
+    }
+    setVector(r.color, a->colorR, a->colorG, a->colorB);
+    if (!writeAt(file, header.actorOffset + i * sizeof(r), &r, sizeof(r)))
+      return 0;
+  }
+
+  for (int i = 0; i < lightCount; i++) {
+    const ucncLight *l = lights[i];
+    BundleLight r;
+    memset(&r, 0, sizeof(r));
+    r.lightId = (uint32_t)l->lightId;
+    r.isSpotlight = l->is_spotlight;
+    memcpy(r.position, l->position, sizeof(r.position));
+    memcpy(r.ambient, l->ambient, sizeof(r.ambient));
+    memcpy(r.diffuse, l->diffuse, sizeof(r.diffuse));
+    memcpy(r.specular, l->specular, sizeof(r.specular));
+    memcpy(r.spotDirection, l->spot_direction, sizeof(r.spotDirection));
+    r.spotCutoff = l->spot_cutoff;
+    r.spotExponent = l->spot_exponent;
+    r.constantAttenuation = l->constant_attenuation;
+    r.linearAttenuation = l->linear_attenuation;
+    r.quadraticAttenuation = l->quadratic_attenuation;
+    if (!writeAt(file, header.lightOffset + i * sizeof(r), &r, sizeof(r)))
+      return 0;
+  }
+
+  size_t dirLength = strlen(configDir);
+  for (int i = 0; i < t->meshCount; i++) {
+    const ucncMesh *mesh = t->meshes[i];
+    BundleMesh r;
+    memset(&r, 0, sizeof(r));
+    // Store paths relative to the configuration so the pair can be moved
+    const char *path = mesh->path;
+    if (strncmp(path, configDir, dirLength) == 0 && path[dirLength] == '/')
+      path += dirLength + 1;
+    if (snprintf(r.path, sizeof(r.path), "%s", path) >= (int)sizeof(r.path)) {
+      fprintf(stderr, "STL path '%s' is too long for a scene bundle.\n",
+              mesh->path);
+      return 0;
+    }
+    r.fileSize = mesh->fileSize;
+    r.fileMtime = mesh->fileMtime;
+    r.triangleCount = mesh->triangleCount;
+    setVector(r.boundCenter, mesh->boundCenterX, mesh->boundCenterY,
+              mesh->boundCenterZ);
+    r.boundRadius = mesh->boundRadius;
+    r.dataOffset = alignOffset(end);
+    end = r.dataOffset + mesh->triangleCount * 12 * sizeof(float);
+
+    if (!writeAt(file, header.meshOffset + i * sizeof(r), &r, sizeof(r)) ||
+        !writeAt(file, r.dataOffset, mesh->vertices,
+                 mesh->triangleCount * 9 * sizeof(float)) ||
+        !writeAt(file, r.dataOffset + mesh->triangleCount * 9 * sizeof(float),
+                 mesh->normals, mesh->triangleCount * 3 * sizeof(float)))
+      return 0;
+  }
+
+  header.fileSize = end;
+  return writeAt(file, 0, &header, sizeof(header));
+}
+
+int ucncBundleWrite(const char *configFile, const char *bundleFile) {
+  uint64_t configHash;
+  if (!configFile || !bundleFile || !hashFile(configFile, &configHash)) {
+    fprintf(stderr, "Cannot read configuration file '%s'.\n",
+            configFile ? configFile : "(null)");
+    return 0;
+  }
+
+  ucncAssembly *root = NULL;
+  ucncLight **lights = NULL;
+  int lightCount = 0;
+  if (loadConfigurationXml(configFile, &root, &lights, &lightCount) != 1)
+    return 0;
+
+  char configDir[1024];
+  getDirectoryFromPath(configFile, configDir);
+
+  SceneTables tables;
+  memset(&tables, 0, sizeof(tables));
+  int ok = pushAssembly(&tables, root, -1);
+  if (!ok)
+    fprintf(stderr, "Memory allocation failed while writing scene bundle.\n");
+
+  // Write next to the target and rename, so readers never see half a file
+  char tempFile[1040];
+  if (ok && snprintf(tempFile, sizeof(tempFile), "%s.tmp", bundleFile) >=
+                (int)sizeof(tempFile)) {
+    fprintf(stderr, "Scene bundle path '%s' is too long.\n", bundleFile);
+    ok = 0;
+  }
+  FILE *file = ok ? fopen(tempFile, "wb") : NULL;
+  if (ok && !file) {
+    fprintf(stderr, "Cannot create scene bundle '%s'.\n", tempFile);
+    ok = 0;
+  }
+  if (file) {
+    ok = writeTables(file, &tables, lights, lightCount, configDir,
+                     configHash);
+    ok = (fclose(file) == 0) && ok;
+    if (ok && rename(tempFile, bundleFile) != 0)
+      ok = 0;
+    if (!ok) {
+      fprintf(stderr, "Failed to write scene bundle '%s'.\n", bundleFile);
+      remove(tempFile);
+    }
+  }
+
+  if (ok) {
+    printf("Wrote scene bundle '%s': %d assemblies, %d actors, %d meshes, "
+           "%d lights\n",
+           bundleFile, tables.assemblyCount, tables.actorCount,
+           tables.meshCount, lightCount);
+  }
+
+  freeTables(&tables);
+  ucncAssemblyFree(root);
+  freeAllLights(&lights, lightCount);
+  ucncMeshCachePurge();
+  return ok;
+}
+
+/* ---------------------------------------------------------------- loading */
+
+static int tableFits(const BundleHeader *h, uint64_t offset, uint64_t count,
+                     size_t recordSize) {
+  return offset % BUNDLE_ALIGN == 0 && offset <= h->fileSize &&
+         count <= (h->fileSize - offset) / recordSize;
+}
+
+// Check the header, table bounds and that nothing the bundle was built from
+// changed since
+static int bundleCurrent(const BundleHeader *h, size_t mappedSize,
+                         const char *configFile, const char *configDir) {
+  if (memcmp(h->magic, BUNDLE_MAGIC, sizeof(h->magic)) != 0 ||
+      h->version != UCNC_BUNDLE_VERSION ||
+      h->byteOrder != BUNDLE_BYTE_ORDER ||
+      h->headerSize != sizeof(BundleHeader) || h->fileSize != mappedSize ||
+      !tableFits(h, h->assemblyOffset, h->assemblyCount,
+                 sizeof(BundleAssembly)) ||
+      !tableFits(h, h->actorOffset, h->actorCount, sizeof(BundleActor)) ||
+      !tableFits(h, h->lightOffset, h->lightCount, sizeof(BundleLight)) ||
+      !tableFits(h, h->meshOffset, h->meshCount, sizeof(BundleMesh)) ||
+      h->assemblyCount == 0) {
+    fprintf(stderr, "Ignoring invalid scene bundle for '%s'.\n", configFile);
+    return 0;
+  }
+
+  uint64_t configHash;
+  if (!hashFile(configFile, &configHash) || configHash != h->configHash) {
+    printf("Scene bundle is out of date with '%s'.\n", configFile);
+    return 0;
+  }
+
+  const BundleMesh *meshes =
+      (const BundleMesh *)((const char *)h + h->meshOffset);
+  for (uint32_t i = 0; i < h->meshCount; i++) {
+    const BundleMesh *m = &meshes[i];
+    if (memchr(m->path, '\0', sizeof(m->path)) == NULL ||
+        m->dataOffset % BUNDLE_ALIGN != 0 || m->dataOffset > h->fileSize ||
+        m->triangleCount >
+            (h->fileSize - m->dataOffset) / (12 * sizeof(float))) {
+      fprintf(stderr, "Ignoring invalid scene bundle for '%s'.\n", configFile);
+      return 0;
+    }
+    char path[1024];
+    struct stat st;
+    if (snprintf(path, sizeof(path), "%s/%s", configDir, m->path) >=
+        (int)sizeof(path)) {
+      fprintf(stderr, "Ignoring invalid scene bundle for '%s'.\n", configFile);
+      return 0;
+    }
+    if (stat(path, &st) != 0 || (int64_t)st.st_size != m->fileSize ||
+        (int64_t)st.st_mtime != m->fileMtime) {
+      printf("Scene bundle is out of date with '%s'.\n", path);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static ucncAssembly *createAssembly(const BundleAssembly *r) {
+  char name[MAX_NAME_LENGTH], parentName[MAX_NAME_LENGTH];
+  snprintf(name, sizeof(name), "%.*s", (int)sizeof(r->name) - 1, r->name);
+  snprintf(parentName, sizeof(parentName), "%.*s",
+           (int)sizeof(r->parentName) - 1, r->parentName);
+  return ucncAssemblyNew(
+      name, parentName, r->origin[0], r->origin[1], r->origin[2],
+      r->position[0], r->position[1], r->position[2], r->rotation[0],
+      r->rotation[1], r->rotation[2], r->homePosition[0], r->homePosition[1],
+      r->homePosition[2], r->homeRotation[0], r->homeRotation[1],
+      r->homeRotation[2], r->color[0], r->color[1], r->color[2],
+      ucncMotionTypeToString((ucncMotionType)r->motionType), r->motionAxis,
+      r->invertMotion, r->minPos, r->maxPos, r->minRot, r->maxRot);
+}
+
+static ucncLight *createLight(const BundleLight *r) {
+  ucncLight *light = ucncLightNew(
+      (GLenum)r->lightId, r->position[0], r->position[1], r->position[2],
+      r->ambient[0], r->ambient[1], r->ambient[2], r->diffuse[0],
+      r->diffuse[1], r->diffuse[2], r->specular[0], r->specular[1],
+      r->specular[2]);
+  if (!light)
+    return NULL;
+  memcpy(light->position, r->position, sizeof(light->position));
+  memcpy(light->ambient, r->ambient, sizeof(light->ambient));
+  memcpy(light->diffuse, r->diffuse, sizeof(light->diffuse));
+  memcpy(light->specular, r->specular, sizeof(light->specular));
+  memcpy(light->spot_direction, r->spotDirection,
+         sizeof(light->spot_direction));
+  light->spot_cutoff = r->spotCutoff;
+  light->spot_exponent = r->spotExponent;
+  light->constant_attenuation = r->constantAttenuation;
+  light->linear_attenuation = r->linearAttenuation;
+  light->quadratic_attenuation = r->quadraticAttenuation;
+  light->is_spotlight = r->isSpotlight;
+  return light;
+}
+
+// Instantiate the scene from a validated mapping
+static int buildScene(BundleMapping *mapping, const char *configDir,
+                      ucncAssembly **rootAssembly, ucncLight ***lights,
+                      int *lightCount) {
+  const char *base = mapping->base;
+  const BundleHeader *h = (const BundleHeader *)base;
+  const BundleAssembly *assemblyRecords =
+      (const BundleAssembly *)(base + h->assemblyOffset);
+  const BundleActor *actorRecords =
+      (const BundleActor *)(base + h->actorOffset);
+  const BundleLight *lightRecords =
+      (const BundleLight *)(base + h->lightOffset);
+  const BundleMesh *meshRecords = (const BundleMesh *)(base + h->meshOffset);
+
+  ucncAssembly **assemblies = calloc(h->assemblyCount, sizeof(*assemblies));
+  ucncLight **loadedLights =
+      h->lightCount ? calloc(h->lightCount, sizeof(*loadedLights)) : NULL;
+  if (!assemblies || (h->lightCount && !loadedLights)) {
+    fprintf(stderr, "Memory allocation failed while loading scene bundle.\n");
+    free(assemblies);
+    free(loadedLights);
+    return 0;
+  }
+
+  // Parents come first, so every child can be linked as it is created
+  int ok = 1;
+  for (uint32_t i = 0; ok && i < h->assemblyCount; i++) {
+    int32_t parent = assemblyRecords[i].parentIndex;
+    ok = (i == 0) == (parent < 0) && parent < (int32_t)i;
+    assemblies[i] = ok ? createAssembly(&assemblyRecords[i]) : NULL;
+    ok = assemblies[i] != NULL;
+    if (ok && i > 0 &&
+        !ucncAssemblyAddAssembly(assemblies[parent], assemblies[i])) {
+      ucncAssemblyFree(assemblies[i]);
+      ok = 0;
+    }
+  }
+
+  for (uint32_t i = 0; ok && i < h->actorCount; i++) {
+    const BundleActor *r = &actorRecords[i];
+    if (r->assemblyIndex >= h->assemblyCount || r->meshIndex >= h->meshCount) {
+      ok = 0;
+      break;
+    }
+    const BundleMesh *m = &meshRecords[r->meshIndex];
+    const float *data = (const float *)(base + m->dataOffset);
+    ucncMeshSource source = {
+        .vertices = data,
+        .normals = data + m->triangleCount * 9,
+        .triangleCount = (unsigned long)m->triangleCount,
+        .boundCenter = {m->boundCenter[0], m->boundCenter[1],
+                        m->boundCenter[2]},
+        .boundRadius = m->boundRadius,
+        .retain = mappingRetain,
+        .release = mappingRelease,
+        .context = mapping,
+    };
+    char path[1024];
+    if (snprintf(path, sizeof(path), "%s/%s", configDir, m->path) >=
+        (int)sizeof(path)) {
+      ok = 0;
+      break;
+    }
+    ucncMesh *mesh =
+        ucncMeshAcquireSource(path, m->fileSize, m->fileMtime, &source);
+    char name[MAX_NAME_LENGTH];
+    snprintf(name, sizeof(name), "%.*s", (int)sizeof(r->name) - 1, r->name);
+    ucncActor *actor = mesh ? ucncActorNewFromMesh(name, mesh, r->color[0],
+                                                   r->color[1], r->color[2])
+                            : NULL;
+    if (!actor || !ucncAssemblyAddActor(assemblies[r->assemblyIndex], actor)) {
+      ucncActorFree(actor);
+      ok = 0;
+    }
+  }
+
+  int loadedLightCount = 0;
+  for (uint32_t i = 0; ok && i < h->lightCount; i++) {
+    loadedLights[i] = createLight(&lightRecords[i]);
+    ok = loadedLights[i] != NULL;
+    loadedLightCount += ok;
+  }
+
+  ucncAssembly *root = assemblies[0];
+  free(assemblies);
+  if (!ok) {
+    fprintf(stderr, "Failed to build the scene from its bundle.\n");
+    ucncAssemblyFree(root);
+    freeAllLights(&loadedLights, loadedLightCount);
+    return 0;
+  }
+
+  *rootAssembly = root;
+  *lights = loadedLights;
+  *lightCount = loadedLightCount;
+  ucncAssemblyBuildIndex(root);
+  return 1;
+}
+
+int ucncBundleLoad(const char *bundleFile, const char *configFile,
+                   ucncAssembly **rootAssembly, ucncLight ***lights,
+                   int *lightCount) {
+  int fd = open(bundleFile, O_RDONLY);
+  if (fd < 0)
+    return 0; // No bundle is the normal case
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BundleHeader)) {
+    close(fd);
+    fprintf(stderr, "Ignoring invalid scene bundle '%s'.\n", bundleFile);
+    return 0;
+  }
+
+  // Geometry pages are faulted in as they are first drawn
+  void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Cannot map scene bundle '%s'.\n", bundleFile);
+    return 0;
+  }
+  BundleMapping *mapping = malloc(sizeof(BundleMapping));
+  if (!mapping) {
+    munmap(base, (size_t)st.st_size);
+    return 0;
+  }
+  mapping->base = base;
+  mapping->size = (size_t)st.st_size;
+  atomic_init(&mapping->refCount, 1); // Ours until the scene is built
+
+  char configDir[1024];
+  getDirectoryFromPath(configFile, configDir);
+  int ok = bundleCurrent(base, mapping->size, configFile, configDir) &&
+           buildScene(mapping, configDir, rootAssembly, lights, lightCount);
+  if (ok)
+    printf("Loaded scene bundle '%s'.\n", bundleFile);
+
+  mappingRelease(mapping); // Meshes that adopted geometry keep it mapped
+  return ok;
+}
@@ -0,0 +1,36 @@
+/* bundle.h */
+
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include "cncvis.h"
+#include "assembly.h"
+#include "light.h"
+
+// Precompiled scene bundle: the assembly tree, limits, actors, lights and
+// float triangle soups of a configuration in one aligned file. Loading maps
+// it and hands the geometry to the mesh cache in place, so start-up skips
+// XML and STL parsing. The file uses the host byte order and is meant to be
+// built on (or for) the machine that loads it.
+//
+// A bundle records a hash of the configuration file and the size and mtime
+// of every STL file it was built from; when any of them changed it is
+// considered stale and ignored.
+
+#define UCNC_BUNDLE_SUFFIX ".bundle" // Appended to the configuration path
+#define UCNC_BUNDLE_VERSION 1
+
+// Default bundle location for a configuration file
+int ucncBundlePath(const char *configFile, char *bundleFile, size_t size);
+
+// Parse configFile the regular way and write its bundle. Returns 1 on success.
+int ucncBundleWrite(const char *configFile, const char *bundleFile);
+
+// Build the scene from bundleFile if it is valid and up to date with
+// configFile. Returns 1 on success and 0 when the bundle is missing, stale
+// or damaged, in which case nothing is allocated.
+int ucncBundleLoad(const char *bundleFile, const char *configFile,
+                   ucncAssembly **rootAssembly, ucncLight ***lights,
+                   int *lightCount);
+
+#endif // BUNDLE_H
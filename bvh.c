@@ -0,0 +1,475 @@
+/* bvh.c */
+
+#include "bvh.h"
+
+#include <float.h>
+
+// Top-down median split on the longest centroid axis, so the tree is
+// balanced and at most 32 levels deep. Queries walk both hierarchies at once:
+// a node of b is moved into a's space as the box around its rotated box,
+// and leaf triangles are compared with a separating axis test (closest
+// points between the features for distances).
+
+#define BVH_STACK_SIZE 128           // Pending node pairs; depth(a) + depth(b) + 1 suffice
+
+typedef struct {
+    const float *vertices;
+    float (*centroids)[3];
+    uint32_t *order;
+    ucncBvhNode *nodes;
+    unsigned long nodeCount;
+} BvhBuild;
+
+typedef struct {
+    float r[3][3];                   // Rotation, row major
+    float absR[3][3];
+    float t[3];
+} BvhTransform;
+
+typedef struct {
+    uint32_t a, b;
+} BvhPair;
+
+static void boxReset(float min[3], float max[3]) {
+    for (int k = 0; k < 3; k++) {
+        min[k] = FLT_MAX;
+        max[k] = -FLT_MAX;
+    }
+}
+
+static void boxAdd(float min[3], float max[3], const float *p) {
+    for (int k = 0; k < 3; k++) {
+        if (p[k] < min[k]) min[k] = p[k];
+        if (p[k] > max[k]) max[k] = p[k];
+    }
+}
+
+// Reorder the run so that position mid holds its median along axis, with
+// smaller centroids before it and larger ones after it
+static void selectMedian(BvhBuild *b, uint32_t *order, long count, long mid, int axis) {
+    long lo = 0, hi = count - 1;
+    while (lo < hi) {
+        float pivot = b->centroids[order[(lo + hi) / 2]][axis];
+        long i = lo, j = hi;
+        while (i <= j) {
+            while (b->centroids[order[i]][axis] < pivot) i++;
+            while (b->centroids[order[j]][axis] > pivot) j--;
+            if (i <= j) {
+                uint32_t swap = order[i];
+                order[i++] = order[j];
+                order[j--] = swap;
+            }
+        }
+        if (mid <= j) {
+            hi = j;
+        } else if (mid >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+}
+
+static uint32_t buildNode(BvhBuild *b, unsigned long first, unsigned long count) {
+    uint32_t index = (uint32_t)b->nodeCount++;
+    float cmin[3], cmax[3];
+    boxReset(b->nodes[index].min, b->nodes[index].max);
+    boxReset(cmin, cmax);
+    for (unsigned long i = first; i < first + count; i++) {
+        const float *v = &b->vertices[b->order[i] * 9ul];
+        for (int k = 0; k < 3; k++) {
+            boxAdd(b->nodes[index].min, b->nodes[index].max, v + k * 3);
+        }
+        boxAdd(cmin, cmax, b->centroids[b->order[i]]);
+    }
+
+    if (count <= UCNC_BVH_LEAF_TRIANGLES) {
+        b->nodes[index].offset = (uint32_t)first;
+        b->nodes[index].count = (uint32_t)count;
+        return index;
+    }
+
+    int axis = 0;
+    for (int k = 1; k < 3; k++) {
+        if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) axis = k;
+    }
+    unsigned long mid = count / 2;
+    selectMedian(b, b->order + first, (long)count, (long)mid, axis);
+    b->nodes[index].count = 0;
+    buildNode(b, first, mid);
+    b->nodes[index].offset = buildNode(b, first + mid, count - mid);
+    return index;
+}
+
+ucncBvh *ucncBvhBuild(const float *vertices, unsigned long triangleCount) {
+    if (!vertices || triangleCount == 0 || triangleCount > UINT32_MAX / 2) {
+        return NULL;
+    }
+    BvhBuild b = { vertices, NULL, NULL, NULL, 0 };
+    ucncBvh *bvh = calloc(1, sizeof(ucncBvh));
+    b.centroids = malloc(triangleCount * sizeof(*b.centroids));
+    b.order = malloc(triangleCount * sizeof(uint32_t));
+    b.nodes = malloc(2 * triangleCount * sizeof(ucncBvhNode));
+    float *triangles = malloc(triangleCount * 9 * sizeof(float));
+    if (!bvh || !b.centroids || !b.order || !b.nodes || !triangles) {
+        fprintf(stderr, "Memory allocation failed for bounding volume hierarchy.\n");
+        free(bvh);
+        free(b.centroids);
+        free(b.order);
+        free(b.nodes);
+        free(triangles);
+        return NULL;
+    }
+
+    for (unsigned long i = 0; i < triangleCount; i++) {
+        const float *v = &vertices[i * 9];
+        for (int k = 0; k < 3; k++) {
+            b.centroids[i][k] = (v[k] + v[3 + k] + v[6 + k]) * (1.0f / 3.0f);
+        }
+        b.order[i] = (uint32_t)i;
+    }
+    buildNode(&b, 0, triangleCount);
+
+    for (unsigned long i = 0; i < triangleCount; i++) {
+        memcpy(&triangles[i * 9], &vertices[b.order[i] * 9ul], 9 * sizeof(float));
+    }
+    free(b.centroids);
+    free(b.order);
+
+    // Keep only the nodes that were used
+    ucncBvhNode *nodes = realloc(b.nodes, b.nodeCount * sizeof(ucncBvhNode));
+    bvh->nodes = nodes ? nodes : b.nodes;
+    bvh->nodeCount = b.nodeCount;
+    bvh->triangles = triangles;
+    bvh->triangleCount = triangleCount;
+    return bvh;
+}
+
+void ucncBvhFree(ucncBvh *bvh) {
+    if (bvh) {
+        free(bvh->nodes);
+        free(bvh->triangles);
+        free(bvh);
+    }
+}
+
+static void transformSetup(BvhTransform *t, const float m[16]) {
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            t->r[row][col] = m[col * 4 + row];
+            t->absR[row][col] = fabsf(t->r[row][col]);
+        }
+        t->t[row] = m[12 + row];
+    }
+}
+
+static void transformPoint(const BvhTransform *t, const float *in, float *out) {
+    for (int row = 0; row < 3; row++) {
+        out[row] = t->r[row][0] * in[0] + t->r[row][1] * in[1] + t->r[row][2] * in[2] + t->t[row];
+    }
+}
+
+// Center and half extents of the box around the transformed node box
+static void transformBox(const BvhTransform *t, const ucncBvhNode *node, float center[3], float extent[3]) {
+    float c[3], e[3];
+    for (int k = 0; k < 3; k++) {
+        c[k] = 0.5f * (node->min[k] + node->max[k]);
+        e[k] = 0.5f * (node->max[k] - node->min[k]);
+    }
+    transformPoint(t, c, center);
+    for (int row = 0; row < 3; row++) {
+        extent[row] = t->absR[row][0] * e[0] + t->absR[row][1] * e[1] + t->absR[row][2] * e[2];
+    }
+}
+
+void ucncBvhBounds(const ucncBvh *bvh, const float m[16], float min[3], float max[3]) {
+    BvhTransform t;
+    float center[3], extent[3];
+    transformSetup(&t, m);
+    transformBox(&t, &bvh->nodes[0], center, extent);
+    for (int k = 0; k < 3; k++) {
+        min[k] = center[k] - extent[k];
+        max[k] = center[k] + extent[k];
+    }
+}
+
+// Squared gap between a node box and a center/extent box, 0 if they overlap
+static float boxGapSq(const ucncBvhNode *node, const float center[3], const float extent[3]) {
+    float gap = 0.0f;
+    for (int k = 0; k < 3; k++) {
+        float d = fabsf(0.5f * (node->min[k] + node->max[k]) - center[k]) -
+                  (0.5f * (node->max[k] - node->min[k]) + extent[k]);
+        if (d > 0.0f) gap += d * d;
+    }
+    return gap;
+}
+
+static float nodeSize(const ucncBvhNode *node) {
+    return (node->max[0] - node->min[0]) + (node->max[1] - node->min[1]) + (node->max[2] - node->min[2]);
+}
+
+// Queue the children of the larger node (leaves are never split)
+static int pushChildren(BvhPair *stack, int top, const ucncBvh *a, const ucncBvh *b, BvhPair pair) {
+    const ucncBvhNode *na = &a->nodes[pair.a], *nb = &b->nodes[pair.b];
+    if (nb->count || (!na->count && nodeSize(na) >= nodeSize(nb))) {
+        stack[top++] = (BvhPair){ pair.a + 1, pair.b };
+        stack[top++] = (BvhPair){ na->offset, pair.b };
+    } else {
+        stack[top++] = (BvhPair){ pair.a, pair.b + 1 };
+        stack[top++] = (BvhPair){ pair.a, nb->offset };
+    }
+    return top;
+}
+
+static void sub3(float *out, const float *a, const float *b) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+static float dot3(const float *a, const float *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cross3(float *out, const float *a, const float *b) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static int separatedOn(const float *axis, const float *p, const float *q) {
+    if (dot3(axis, axis) < 1e-20f) {
+        return 0;                    // Parallel edges give no axis
+    }
+    float pmin = FLT_MAX, pmax = -FLT_MAX, qmin = FLT_MAX, qmax = -FLT_MAX;
+    for (int i = 0; i < 3; i++) {
+        float dp = dot3(axis, p + i * 3), dq = dot3(axis, q + i * 3);
+        if (dp < pmin) pmin = dp;
+        if (dp > pmax) pmax = dp;
+        if (dq < qmin) qmin = dq;
+        if (dq > qmax) qmax = dq;
+    }
+    return pmax < qmin || qmax < pmin;
+}
+
+// Separating axis test: both normals, the nine edge cross products and the
+// in-plane edge normals, which settle the coplanar case
+static int trianglesIntersect(const float *p, const float *q) {
+    float ep[3][3], eq[3][3], np[3], nq[3], axis[3];
+    for (int i = 0; i < 3; i++) {
+        sub3(ep[i], p + ((i + 1) % 3) * 3, p + i * 3);
+        sub3(eq[i], q + ((i + 1) % 3) * 3, q + i * 3);
+    }
+    cross3(np, ep[0], ep[1]);
+    cross3(nq, eq[0], eq[1]);
+    if (separatedOn(np, p, q) || separatedOn(nq, p, q)) {
+        return 0;
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            cross3(axis, ep[i], eq[j]);
+            if (separatedOn(axis, p, q)) return 0;
+        }
+        cross3(axis, np, ep[i]);
+        if (separatedOn(axis, p, q)) return 0;
+        cross3(axis, nq, eq[i]);
+        if (separatedOn(axis, p, q)) return 0;
+    }
+    return 1;
+}
+
+// Closest point to p on triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+static void closestOnTriangle(const float *p, const float *a, const float *b, const float *c, float *out) {
+    float ab[3], ac[3], ap[3], bp[3], cp[3];
+    sub3(ab, b, a);
+    sub3(ac, c, a);
+    sub3(ap, p, a);
+    float d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        memcpy(out, a, 3 * sizeof(float));
+        return;
+    }
+    sub3(bp, p, b);
+    float d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        memcpy(out, b, 3 * sizeof(float));
+        return;
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        float v = d1 / (d1 - d3);
+        for (int k = 0; k < 3; k++) out[k] = a[k] + v * ab[k];
+        return;
+    }
+    sub3(cp, p, c);
+    float d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        memcpy(out, c, 3 * sizeof(float));
+        return;
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        float w = d2 / (d2 - d6);
+        for (int k = 0; k < 3; k++) out[k] = a[k] + w * ac[k];
+        return;
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        for (int k = 0; k < 3; k++) out[k] = b[k] + w * (c[k] - b[k]);
+        return;
+    }
+    float sum = va + vb + vc;
+    if (sum <= 0.0f) {
+        memcpy(out, a, 3 * sizeof(float));   // Degenerate triangle
+        return;
+    }
+    float v = vb / sum, w = vc / sum;
+    for (int k = 0; k < 3; k++) out[k] = a[k] + ab[k] * v + ac[k] * w;
+}
+
+static float clamp01(float x) {
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+// Squared distance between segments p1q1 and p2q2 (Ericson 5.1.9)
+static float segmentDistanceSq(const float *p1, const float *q1, const float *p2, const float *q2) {
+    const float eps = 1e-12f;
+    float d1[3], d2[3], r[3];
+    sub3(d1, q1, p1);
+    sub3(d2, q2, p2);
+    sub3(r, p1, p2);
+    float a = dot3(d1, d1), e = dot3(d2, d2), f = dot3(d2, r);
+    float s = 0.0f, t = 0.0f;
+    if (a <= eps && e <= eps) {
+        s = t = 0.0f;
+    } else if (a <= eps) {
+        t = clamp01(f / e);
+    } else {
+        float c = dot3(d1, r);
+        if (e <= eps) {
+            s = clamp01(-c / a);
+        } else {
+            float b = dot3(d1, d2);
+            float denom = a * e - b * b;
+            s = denom != 0.0f ? clamp01((b * f - c * e) / denom) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = clamp01(-c / a);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = clamp01((b - c) / a);
+            }
+        }
+    }
+    float diff[3];
+    for (int k = 0; k < 3; k++) diff[k] = (p1[k] + d1[k] * s) - (p2[k] + d2[k] * t);
+    return dot3(diff, diff);
+}
+
+// Squared distance between two disjoint triangles: the closest points lie on
+// a vertex of one and the face of the other, or on two edges
+static float triangleDistanceSq(const float *p, const float *q) {
+    float best = FLT_MAX, closest[3], diff[3];
+    for (int i = 0; i < 3; i++) {
+        closestOnTriangle(p + i * 3, q, q + 3, q + 6, closest);
+        sub3(diff, p + i * 3, closest);
+        float d = dot3(diff, diff);
+        if (d < best) best = d;
+        closestOnTriangle(q + i * 3, p, p + 3, p + 6, closest);
+        sub3(diff, q + i * 3, closest);
+        d = dot3(diff, diff);
+        if (d < best) best = d;
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            float d = segmentDistanceSq(p + i * 3, p + ((i + 1) % 3) * 3, q + j * 3, q + ((j + 1) % 3) * 3);
+            if (d < best) best = d;
+        }
+    }
+    return best;
+}
+
+// Triangles of a leaf of b, moved into a's space
+static const float *leafInA(const BvhTransform *t, const ucncBvh *b, const ucncBvhNode *leaf, float *out) {
+    const float *src = &b->triangles[leaf->offset * 9ul];
+    for (uint32_t i = 0; i < leaf->count * 3; i++) {
+        transformPoint(t, src + i * 3, out + i * 3);
+    }
+    return out;
+}
+
+int ucncBvhIntersect(const ucncBvh *a, const ucncBvh *b, const float bToA[16]) {
+    if (!a || !b) {
+        return 0;
+    }
+    BvhTransform t;
+    transformSetup(&t, bToA);
+    BvhPair stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = (BvhPair){ 0, 0 };
+
+    while (top > 0) {
+        BvhPair pair = stack[--top];
+        const ucncBvhNode *na = &a->nodes[pair.a], *nb = &b->nodes[pair.b];
+        float center[3], extent[3];
+        transformBox(&t, nb, center, extent);
+        if (boxGapSq(na, center, extent) > 0.0f) {
+            continue;
+        }
+        if (na->count && nb->count) {
+            float moved[UCNC_BVH_LEAF_TRIANGLES * 9];
+            leafInA(&t, b, nb, moved);
+            for (uint32_t i = 0; i < na->count; i++) {
+                for (uint32_t j = 0; j < nb->count; j++) {
+                    if (trianglesIntersect(&a->triangles[(na->offset + i) * 9ul], moved + j * 9)) {
+                        return 1;
+                    }
+                }
+            }
+            continue;
+        }
+        top = pushChildren(stack, top, a, b, pair);
+    }
+    return 0;
+}
+
+float ucncBvhDistance(const ucncBvh *a, const ucncBvh *b, const float bToA[16], float maxDistance) {
+    if (!a || !b || maxDistance <= 0.0f) {
+        return maxDistance;
+    }
+    BvhTransform t;
+    transformSetup(&t, bToA);
+    BvhPair stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = (BvhPair){ 0, 0 };
+    float best = maxDistance * maxDistance;
+
+    while (top > 0) {
+        BvhPair pair = stack[--top];
+        const ucncBvhNode *na = &a->nodes[pair.a], *nb = &b->nodes[pair.b];
+        float center[3], extent[3];
+        transformBox(&t, nb, center, extent);
+        if (boxGapSq(na, center, extent) >= best) {
+            continue;
+        }
+        if (na->count && nb->count) {
+            float moved[UCNC_BVH_LEAF_TRIANGLES * 9];
+            leafInA(&t, b, nb, moved);
+            for (uint32_t i = 0; i < na->count; i++) {
+                const float *p = &a->triangles[(na->offset + i) * 9ul];
+                for (uint32_t j = 0; j < nb->count; j++) {
+                    if (trianglesIntersect(p, moved + j * 9)) {
+                        return 0.0f;
+                    }
+                    float d = triangleDistanceSq(p, moved + j * 9);
+                    if (d < best) best = d;
+                }
+            }
+            continue;
+        }
+        top = pushChildren(stack, top, a, b, pair);
+    }
+    return sqrtf(best);
+}
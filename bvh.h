@@ -0,0 +1,42 @@
+/* bvh.h */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "cncvis.h"
+
+#define UCNC_BVH_LEAF_TRIANGLES 4    // Largest triangle run kept in one leaf
+
+// Axis-aligned bounding box hierarchy over a triangle soup, in mesh-local
+// space. Nodes are stored depth first, so an inner node's first child is the
+// next node; offset holds the index of the second child for inner nodes and
+// the first triangle of the run for leaves.
+typedef struct ucncBvhNode {
+    float min[3], max[3];
+    uint32_t offset;
+    uint32_t count;                  // Triangles in a leaf, 0 for inner nodes
+} ucncBvhNode;
+
+typedef struct ucncBvh {
+    ucncBvhNode *nodes;
+    unsigned long nodeCount;
+    float *triangles;                // 9 floats per triangle, in leaf order
+    unsigned long triangleCount;
+} ucncBvh;
+
+// Build a hierarchy over a copy of the triangles (9 floats each). Returns
+// NULL for empty meshes or when out of memory.
+ucncBvh *ucncBvhBuild(const float *vertices, unsigned long triangleCount);
+void ucncBvhFree(ucncBvh *bvh);
+
+// Box around the whole hierarchy after applying the rigid transform m
+void ucncBvhBounds(const ucncBvh *bvh, const float m[16], float min[3], float max[3]);
+
+// Queries between two meshes; bToA is the rigid transform taking b's space
+// into a's. Intersect returns 1 if any two triangles touch. Distance returns
+// the smallest distance between the surfaces if it is below maxDistance (0
+// when they intersect) and maxDistance otherwise.
+int ucncBvhIntersect(const ucncBvh *a, const ucncBvh *b, const float bToA[16]);
+float ucncBvhDistance(const ucncBvh *a, const ucncBvh *b, const float bToA[16], float maxDistance);
+
+#endif // BVH_H
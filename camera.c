@@ -6,8 +6,9 @@
 #include <stdlib.h>
 #include <time.h>
 
-extern ucncCamera *globalCamera;
-extern ZBuffer *globalFramebuffer;
+// The current instance's camera and framebuffer (api.c)
+ucncCamera *ucncGetCamera(void);
+ZBuffer *ucncGetFramebuffer(void);
 
 ucncCamera* ucncCameraNew(float posX, float posY, float posZ, float upX, float upY, float upZ) {
     ucncCamera *camera = malloc(sizeof(ucncCamera));
@@ -126,12 +127,12 @@ void ucncCameraApply(ucncCamera *camera) {
     
     if (camera->orthoMode) {
         // Orthographic projection
-        float aspect = (float)globalFramebuffer->xsize / (float)globalFramebuffer->ysize;
+        float aspect = (float)ucncGetFramebuffer()->xsize / (float)ucncGetFramebuffer()->ysize;
         float size = 100.0f * camera->orthoScale;
         glOrtho(-size * aspect, size * aspect, -size, size, 0.1f, 5000.0f);
     } else {
         // Perspective projection
-        float aspect = (float)globalFramebuffer->xsize / (float)globalFramebuffer->ysize;
+        float aspect = (float)ucncGetFramebuffer()->xsize / (float)ucncGetFramebuffer()->ysize;
         gluPerspective(camera->fov, aspect, 0.1f, 5000.0f);
     }
     
@@ -215,7 +216,7 @@ void update_camera_matrix(ucncCamera *camera) {
 // Update camera view based on mouse movement (dx, dy)
 void update_camera_view(int32_t dx, int32_t dy) {
     // Updated to use orbit around target instead of FPS-style rotation
-    ucncCameraOrbit(globalCamera, dx * 0.1f, dy * 0.1f);
+    ucncCameraOrbit(ucncGetCamera(), dx * 0.1f, dy * 0.1f);
 }
 
 
@@ -15,6 +15,19 @@
 #define MOTION_TYPE_ROTATIONAL "rotational"
 #define MOTION_TYPE_LINEAR "linear"
 #define MOTION_TYPE_NONE "none"
+
+typedef enum {
+  UCNC_MOTION_NONE = 0,
+  UCNC_MOTION_LINEAR,
+  UCNC_MOTION_ROTATIONAL
+} ucncMotionType;
+
+// Screen rectangle in framebuffer pixels, origin at the top-left corner
+typedef struct {
+  int x, y;
+  int width, height;
+} ucncRect;
+
 #define AXIS_X 'X'
 #define AXIS_Y 'Y'
 #define AXIS_Z 'Z'
@@ -0,0 +1,148 @@
+// cncvis_batch: render frame sequences and thumbnails for many
+// configurations, in parallel
+//
+//   cncvis_batch [-j threads] [-f png|raw] [-s index/count] jobs.txt
+//
+// Each line of the job list names a configuration, the output path prefix
+// and optionally a camera/motion script (see batch.h):
+//
+//   machines/meca500/config.xml  out/meca500        # one thumbnail
+//   machines/meca500/config.xml  out/orbit  orbit.txt
+//
+// Relative script paths are taken from the working directory. -s splits
+// the work over several processes, e.g. -s 0/4 ... -s 3/4 on four hosts
+// sharing the output directory.
+
+#include "batch.h"
+
+// The library expects the application to own the scene globals
+ZBuffer *globalFramebuffer = NULL;
+ucncAssembly *globalScene = NULL;
+ucncCamera *globalCamera = NULL;
+ucncLight **globalLights = NULL;
+int globalLightCount = 0;
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [-j threads] [-f png|raw] [-s index/count] jobs.txt\n",
+          program);
+}
+
+static char *copyString(const char *s) {
+  size_t size = strlen(s) + 1;
+  char *copy = malloc(size);
+  if (copy)
+    memcpy(copy, s, size);
+  return copy;
+}
+
+// Read the job list; NULL on errors
+static ucncBatchJob *loadJobs(const char *path, int *jobCount) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Failed to open job list '%s'.\n", path);
+    return NULL;
+  }
+
+  ucncBatchJob *jobs = NULL;
+  int count = 0, capacity = 0, lineNumber = 0, ok = 1;
+  char line[3 * 1024];
+  while (ok && fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char *comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+    char config[1024], output[1024], script[1024];
+    int fields = sscanf(line, "%1023s %1023s %1023s", config, output, script);
+    if (fields <= 0)
+      continue; // Blank line
+    if (fields < 2) {
+      fprintf(stderr, "%s:%d: expected a configuration and an output.\n",
+              path, lineNumber);
+      ok = 0;
+      break;
+    }
+
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 16;
+      ucncBatchJob *grown = realloc(jobs, capacity * sizeof(*jobs));
+      if (!grown) {
+        ok = 0;
+        break;
+      }
+      jobs = grown;
+    }
+    ucncBatchJob *job = &jobs[count++];
+    job->config = copyString(config);
+    job->output = copyString(output);
+    ucncBatchScriptDefaults(&job->script);
+    if (!job->config || !job->output ||
+        (fields == 3 && ucncBatchScriptLoad(script, &job->script) != 0))
+      ok = 0;
+  }
+  fclose(file);
+
+  if (ok && count == 0) {
+    fprintf(stderr, "No jobs in '%s'.\n", path);
+    ok = 0;
+  }
+  if (!ok) {
+    for (int i = 0; i < count; i++) {
+      free((char *)jobs[i].config);
+      free((char *)jobs[i].output);
+    }
+    free(jobs);
+    return NULL;
+  }
+  *jobCount = count;
+  return jobs;
+}
+
+int main(int argc, char **argv) {
+  ucncBatchOptions options = {.format = UCNC_BATCH_PNG, .shardCount = 1};
+  int arg = 1;
+  for (; arg < argc - 1 && argv[arg][0] == '-'; arg += 2) {
+    const char *value = argv[arg + 1];
+    if (strcmp(argv[arg], "-j") == 0) {
+      options.threads = atoi(value);
+    } else if (strcmp(argv[arg], "-f") == 0 && strcmp(value, "png") == 0) {
+      options.format = UCNC_BATCH_PNG;
+    } else if (strcmp(argv[arg], "-f") == 0 && strcmp(value, "raw") == 0) {
+      options.format = UCNC_BATCH_RAW;
+    } else if (strcmp(argv[arg], "-s") != 0 ||
+               sscanf(value, "%d/%d", &options.shardIndex,
+                      &options.shardCount) != 2 ||
+               options.shardIndex < 0 ||
+               options.shardIndex >= options.shardCount) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (arg != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int jobCount;
+  ucncBatchJob *jobs = loadJobs(argv[arg], &jobCount);
+  if (!jobs)
+    return 1;
+  int frames = 0;
+  for (int i = 0; i < jobCount; i++)
+    frames += jobs[i].script.frames;
+
+  double start = getCurrentTimeInMs();
+  int failed = ucncBatchRun(jobs, jobCount, &options);
+  double seconds = (getCurrentTimeInMs() - start) / 1000.0;
+  if (failed >= 0)
+    fprintf(stderr, "Shard %d/%d of %d jobs (%d frames): %.2f s, %d failed\n",
+            options.shardIndex, options.shardCount, jobCount, frames, seconds,
+            failed);
+
+  for (int i = 0; i < jobCount; i++) {
+    free((char *)jobs[i].config);
+    free((char *)jobs[i].output);
+  }
+  free(jobs);
+  return failed == 0 ? 0 : 1;
+}
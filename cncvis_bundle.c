@@ -0,0 +1,33 @@
+// cncvis_bundle: precompile a machine configuration into a scene bundle
+//
+//   cncvis_bundle config.xml [bundle]
+//
+// Without a bundle path the file is written next to the configuration as
+// config.xml.bundle, where cncvis_init() picks it up automatically.
+
+#include "api.h"
+#include "bundle.h"
+
+// The library expects the application to own the scene globals
+ZBuffer *globalFramebuffer = NULL;
+ucncAssembly *globalScene = NULL;
+ucncCamera *globalCamera = NULL;
+ucncLight **globalLights = NULL;
+int globalLightCount = 0;
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s config.xml [bundle]\n", argv[0]);
+    return 2;
+  }
+
+  char bundleFile[1024];
+  if (argc == 3) {
+    snprintf(bundleFile, sizeof(bundleFile), "%s", argv[2]);
+  } else if (!ucncBundlePath(argv[1], bundleFile, sizeof(bundleFile))) {
+    fprintf(stderr, "Configuration path too long.\n");
+    return 1;
+  }
+
+  return ucncBundleWrite(argv[1], bundleFile) ? 0 : 1;
+}
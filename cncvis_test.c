@@ -1,14 +1,27 @@
+#define _DEFAULT_SOURCE // mkdtemp with -std=c11
+
 #include "api.h"
 #include "assembly.h"
+#include "batch.h"
+#include "bundle.h"
+#include "config.h"
 #include "utils.h"
 #include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <math.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "tinygl/include/zbuffer.h"
 #include "tinygl/src/zmath.h"
 
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_TGA
+#include "stb/stb_image.h"
+
 ZBuffer *globalFramebuffer = NULL;
 ucncAssembly *globalScene = NULL;
 ucncCamera *globalCamera = NULL;
@@ -77,30 +90,1690 @@ static void test_limits(void) {
   cncvis_cleanup();
 }
 
+static void test_axis_handles(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  assert(globalScene->index != NULL);
+
+  const char *names[6] = {"link1", "link2", "link3", "link4", "link5", "link6"};
+  ucncAxisHandle handles[6];
+  float values[6];
+  for (int i = 0; i < 6; i++) {
+    handles[i] = ucncGetAxisHandle(names[i]);
+    assert(handles[i] >= 0);
+    values[i] = 5.0f * (i + 1);
+    // Only base and link1 carry limits in this config
+    ucncAssembly *a = findAssemblyByName(globalScene, names[i]);
+    a->minRot = -180.0f;
+    a->maxRot = 180.0f;
+  }
+  assert(ucncGetAxisHandle("meca500") == -1);
+  assert(ucncGetAxisHandle("missing") == -1);
+
+  assert(ucncSetAxesBatch(handles, values, 6) == 0);
+  for (int i = 0; i < 6; i++) {
+    ucncAssembly *a = findAssemblyByName(globalScene, names[i]);
+    assert(a == globalScene->index->axes[handles[i]]);
+    float expected = a->invertMotion ? -values[i] : values[i];
+    float actual = a->motionAxis == AXIS_X   ? a->rotationX
+                   : a->motionAxis == AXIS_Y ? a->rotationY
+                                             : a->rotationZ;
+    assert(actual == expected);
+  }
+
+  // Out of range values trip the limit flag and report failure
+  values[0] = 1000.0f;
+  assert(ucncSetAxesBatch(handles, values, 1) == -1);
+  assert(findAssemblyByName(globalScene, "link1")->limitTriggered == 1);
+  cncvis_cleanup();
+}
+
+// Count differing pixels outside the OSD bands at the top and bottom
+static int count_scene_diffs(const PIXEL *a, const PIXEL *b, int w, int h) {
+  int diffs = 0;
+  for (int y = 40; y < h - 40; y++)
+    for (int x = 0; x < w; x++)
+      diffs += a[y * w + x] != b[y * w + x];
+  return diffs;
+}
+
+static void test_static_layer(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  PIXEL *reference = malloc(bytes);
+  assert(reference);
+
+  // The base assembly moves, so only the root stays in the static layer
+  assert(!globalScene->isDynamic);
+  assert(findAssemblyByName(globalScene, "link3")->isDynamic);
+  ucncAssembly *link2 = findAssemblyByName(globalScene, "link2");
+  link2->minRot = -180.0f; // No limits in this config
+  link2->maxRot = 180.0f;
+
+  for (int frame = 0; frame < 3; frame++) {
+    assert(ucncUpdateMotionByName("link2", 4.0f) == 0);
+    if (frame == 2)
+      orbit_camera_z(10.0f);
+
+    ucncSetStaticLayerCaching(0);
+    cncvis_render();
+    memcpy(reference, globalFramebuffer->pbuf, bytes);
+
+    ucncSetStaticLayerCaching(1);
+    cncvis_render(); // builds the layer
+    cncvis_render(); // restores it
+    int diffs = count_scene_diffs(reference, globalFramebuffer->pbuf, w, h);
+    printf("static layer frame %d: %d differing pixels\n", frame, diffs);
+    assert(diffs < w * h / 200);
+  }
+
+  ucncSetStaticLayerCaching(0);
+  free(reference);
+  cncvis_cleanup();
+}
+
+static void test_dirty_regions(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  PIXEL *patched = malloc(bytes);
+  assert(patched);
+  ucncAssembly *link6 = findAssemblyByName(globalScene, "link6");
+  ucncRect rects[UCNC_MAX_DIRTY_RECTS];
+
+  for (int layer = 0; layer < 2; layer++) {
+    ucncSetStaticLayerCaching(layer);
+    ucncSetDirtyRegionRendering(1);
+
+    // The first frame is always drawn in full
+    cncvis_render();
+    int count = ucncGetDirtyRects(rects, UCNC_MAX_DIRTY_RECTS);
+    assert(count == 1 && rects[0].width == w && rects[0].height == h);
+
+    // A small wrist move only touches part of the screen
+    link6->maxRot = 180.0f; // No limits in this config
+    assert(ucncUpdateMotionByName("link6", 5.0f) == 0);
+    cncvis_render();
+    count = ucncGetDirtyRects(rects, UCNC_MAX_DIRTY_RECTS);
+    long area = 0;
+    for (int i = 0; i < count; i++)
+      area += (long)rects[i].width * rects[i].height;
+    printf("dirty regions (layer %d): %d rects, %ld of %d pixels\n", layer,
+           count, area, w * h);
+    // Without the layer each rect is a pass over the whole scene
+    assert(count >= 1 && count <= (layer ? UCNC_MAX_DIRTY_RECTS : 2));
+    assert(area < (long)w * h / 2);
+    memcpy(patched, globalFramebuffer->pbuf, bytes);
+
+    // Patching gives the same picture as a full redraw
+    ucncSetDirtyRegionRendering(0);
+    cncvis_render();
+    int diffs = count_scene_diffs(patched, globalFramebuffer->pbuf, w, h);
+    printf("dirty regions (layer %d): %d differing pixels\n", layer, diffs);
+    assert(diffs < w * h / 200);
+  }
+
+  ucncSetStaticLayerCaching(0);
+  free(patched);
+  cncvis_cleanup();
+}
+
+static void test_dirty_tiles(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  ZBuffer *zb = globalFramebuffer;
+  int w = zb->xsize, h = zb->ysize;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  PIXEL *before = malloc(bytes);
+  assert(before);
+  ucncAssembly *link6 = findAssemblyByName(globalScene, "link6");
+  link6->maxRot = 180.0f;
+  ucncSetStaticLayerCaching(1);
+  ucncSetDirtyRegionRendering(1);
+  ucncSetRenderOnChange(1);
+  ZBRect rects[16];
+
+  cncvis_render();
+  assert(ZB_dirtyRects(zb, rects, 16) == 1 && rects[0].w == w &&
+         rects[0].h == h);
+  ZB_clearDirty(zb);
+  memcpy(before, zb->pbuf, bytes);
+
+  // Every pixel a partial redraw changes lies in a tile TinyGL marked
+  assert(ucncUpdateMotionByName("link6", 5.0f) == 0);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  int count = ZB_dirtyRects(zb, rects, 16);
+  long area = 0;
+  for (int i = 0; i < count; i++)
+    area += (long)rects[i].w * rects[i].h;
+  int changed = 0, missed = 0;
+  for (int i = 0; i < w * h; i++) {
+    if (((PIXEL *)zb->pbuf)[i] == before[i])
+      continue;
+    changed++;
+    int x = i % w, y = i / w, covered = 0;
+    for (int r = 0; r < count && !covered; r++)
+      covered = x >= rects[r].x && x < rects[r].x + rects[r].w &&
+                y >= rects[r].y && y < rects[r].y + rects[r].h;
+    missed += !covered;
+  }
+  printf("dirty tiles: %d rects, %ld of %d pixels to flush, %d changed\n",
+         count, area, w * h, changed);
+  assert(changed > 0 && missed == 0);
+  assert(area < (long)w * h / 2);
+
+  // Nothing is drawn, and nothing needs flushing, while the scene is idle
+  ZB_clearDirty(zb);
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  assert(ZB_dirtyRects(zb, rects, 16) == 0);
+
+  ucncSetRenderOnChange(0);
+  ucncSetDirtyRegionRendering(0);
+  ucncSetStaticLayerCaching(0);
+  free(before);
+  cncvis_cleanup();
+}
+
+static void test_render_on_change(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  size_t bytes = (size_t)globalFramebuffer->xsize * globalFramebuffer->ysize *
+                 sizeof(PIXEL);
+  PIXEL *before = malloc(bytes);
+  assert(before);
+  ucncSetRenderOnChange(1);
+
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  memcpy(before, globalFramebuffer->pbuf, bytes);
+
+  // Idle frames leave the framebuffer alone and report nothing to flush
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  assert(memcmp(before, globalFramebuffer->pbuf, bytes) == 0);
+  assert(ucncGetDirtyRects(NULL, 0) == 0);
+
+  // Poses, camera and explicit requests all trigger a new frame
+  assert(ucncUpdateMotionByName("link1", 5.0f) == 0);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  orbit_camera_z(5.0f);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  ucncRequestRedraw();
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+
+  ucncSetRenderOnChange(0);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  free(before);
+  cncvis_cleanup();
+}
+
+static void test_transforms(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+
+  ucncAssembly *link1 = findAssemblyByName(globalScene, "link1");
+  ucncAssembly *link6 = findAssemblyByName(globalScene, "link6");
+  assert(link1 != NULL && link6 != NULL);
+
+  // The cached world matrix matches the glTranslatef/glRotatef chain
+  ucncAssembly *chain[16];
+  int depth = 0;
+  for (ucncAssembly *a = link6; a; a = a->parent)
+    chain[depth++] = a;
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  for (int i = depth - 1; i >= 0; i--) {
+    ucncAssembly *a = chain[i];
+    glTranslatef(a->positionX, a->positionY, a->positionZ);
+    glTranslatef(a->originX, a->originY, a->originZ);
+    glRotatef(a->rotationX, 1.0f, 0.0f, 0.0f);
+    glRotatef(a->rotationY, 0.0f, 1.0f, 0.0f);
+    glRotatef(a->rotationZ, 0.0f, 0.0f, 1.0f);
+    glTranslatef(-a->originX, -a->originY, -a->originZ);
+  }
+  GLfloat expected[16];
+  glGetFloatv(GL_MODELVIEW_MATRIX, expected); // row-major
+  glPopMatrix();
+
+  float before[16];
+  memcpy(before, ucncAssemblyGetWorldMatrix(link6), sizeof(before));
+  for (int r = 0; r < 4; r++)
+    for (int c = 0; c < 4; c++)
+      assert(fabsf(before[c * 4 + r] - expected[r * 4 + c]) < 1e-2f);
+
+  // Moving a parent invalidates descendants
+  assert(ucncUpdateMotionByName("link1", 10.0f) == 0);
+  assert(link6->worldDirty);
+  const float *moved = ucncAssemblyGetWorldMatrix(link6);
+  assert(fabsf(moved[12] - before[12]) + fabsf(moved[13] - before[13]) > 1e-3f);
+  assert(ucncUpdateMotionByName("link1", -10.0f) == 0);
+  const float *back = ucncAssemblyGetWorldMatrix(link6);
+  for (int i = 0; i < 16; i++)
+    assert(fabsf(back[i] - before[i]) < 1e-2f);
+
+  cncvis_cleanup();
+}
+
+static void test_kinematics(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  const char *axes[6] = {"link1", "link2", "link3", "link4", "link5", "link6"};
+  const char *targets[2] = {"link6", "link3"};
+  ucncAxisHandle handles[6];
+  for (int i = 0; i < 6; i++) {
+    handles[i] = ucncGetAxisHandle(axes[i]);
+    ucncAssembly *a = findAssemblyByName(globalScene, axes[i]);
+    a->minRot = -400.0f;
+    a->maxRot = 400.0f;
+  }
+  assert(ucncKinematicsNew(globalScene, axes, 6, (const char *[]){"x"}, 1) ==
+         NULL);
+  const char *notAxis[1] = {"meca500"};
+  assert(ucncKinematicsNew(globalScene, notAxis, 1, targets, 1) == NULL);
+  ucncKinematics *kinematics =
+      ucncKinematicsNew(globalScene, axes, 6, targets, 2);
+  assert(kinematics);
+
+  // Single joint vectors match the scene's own transforms
+  unsigned int seed = 12345;
+  float joints[6], world[2][16];
+  for (int n = 0; n < 50; n++) {
+    for (int i = 0; i < 6; i++) {
+      seed = seed * 1103515245u + 12345u;
+      joints[i] = (float)((seed >> 8) % 7200) / 10.0f - 360.0f;
+    }
+    assert(ucncSetAxesBatch(handles, joints, 6) == 0);
+    assert(ucncKinematicsSolve(kinematics, joints, world) == 0);
+    for (int t = 0; t < 2; t++) {
+      const float *expected = ucncAssemblyGetWorldMatrix(
+          findAssemblyByName(globalScene, targets[t]));
+      for (int e = 0; e < 16; e++)
+        assert(fabsf(world[t][e] - expected[e]) < (e >= 12 ? 1e-2f : 1e-4f));
+    }
+  }
+
+  // Axes outside the joint vector keep their current position
+  ucncKinematics *wrist =
+      ucncKinematicsNew(globalScene, axes + 3, 3, targets, 1);
+  assert(wrist);
+  assert(ucncKinematicsSolve(wrist, joints + 3, world) == 0);
+  const float *link6World =
+      ucncAssemblyGetWorldMatrix(findAssemblyByName(globalScene, "link6"));
+  for (int e = 0; e < 16; e++)
+    assert(fabsf(world[0][e] - link6World[e]) < 1e-2f);
+  ucncKinematicsFree(wrist);
+
+  // Batches in structure-of-arrays form agree with single solves
+  int count = 100003;
+  float *batch = malloc(6 * count * sizeof(float));
+  float *tcp = malloc(2 * 3 * count * sizeof(float));
+  float *toolAxes = malloc(2 * 3 * count * sizeof(float));
+  assert(batch && tcp && toolAxes);
+  for (int i = 0; i < 6 * count; i++) {
+    seed = seed * 1103515245u + 12345u;
+    batch[i] = (float)((seed >> 8) % 3600) / 10.0f - 180.0f;
+  }
+  double start = getCurrentTimeInMs();
+  assert(ucncKinematicsSolveBatch(kinematics, batch, count, tcp, toolAxes) ==
+         0);
+  printf("kinematics: %.1f ns per joint vector\n",
+         (getCurrentTimeInMs() - start) * 1e6 / count);
+  for (int i = 0; i < count; i += 997) {
+    for (int a = 0; a < 6; a++)
+      joints[a] = batch[a * count + i];
+    ucncKinematicsSolve(kinematics, joints, world);
+    for (int t = 0; t < 2; t++) {
+      const ucncAssembly *a = findAssemblyByName(globalScene, targets[t]);
+      const float origin[3] = {a->originX, a->originY, a->originZ};
+      float expected[3];
+      ucncMatrixTransformPoint(world[t], origin, expected);
+      for (int k = 0; k < 3; k++) {
+        assert(fabsf(tcp[(t * 3 + k) * count + i] - expected[k]) < 1e-2f);
+        assert(fabsf(toolAxes[(t * 3 + k) * count + i] - world[t][8 + k]) <
+               1e-4f);
+      }
+    }
+  }
+  free(batch);
+  free(tcp);
+  free(toolAxes);
+  ucncKinematicsFree(kinematics);
+  cncvis_cleanup();
+}
+
+// Producer pushing (t, 2t, -t) at "servo rate" until told to stop
+typedef struct {
+  ucncMotionRing *ring;
+  atomic_int stop;
+  int pushed;
+} MotionProducer;
+
+static void *motion_producer(void *arg) {
+  MotionProducer *producer = arg;
+  while (!atomic_load(&producer->stop)) {
+    float t = (float)(producer->pushed % 100000);
+    float values[3] = {t, 2.0f * t, -t};
+    assert(ucncMotionRingPush(producer->ring, producer->pushed, values) == 0);
+    producer->pushed++;
+  }
+  return NULL;
+}
+
+static void test_motion_ring(void) {
+  // Interpolation between samples, held at both ends of what is left
+  ucncMotionRing *ring = ucncMotionRingNew(2, 6);
+  assert(ring && ucncMotionRingAxisCount(ring) == 2);
+  float values[3];
+  assert(ucncMotionRingSample(ring, 0.0, values) == -1);
+  for (int i = 0; i < 20; i++) {
+    float sample[2] = {(float)i, -10.0f * i};
+    assert(ucncMotionRingPush(ring, i, sample) == 0);
+  }
+  const float older[2] = {0.0f, 0.0f};
+  assert(ucncMotionRingPush(ring, 18.0, older) == -1);
+  assert(ucncMotionRingSample(ring, 15.25, values) == 0);
+  assert(fabsf(values[0] - 15.25f) < 1e-5f && fabsf(values[1] + 152.5f) < 1e-4f);
+  assert(ucncMotionRingSample(ring, 100.0, values) == 0 && values[0] == 19.0f);
+  assert(ucncMotionRingSample(ring, 0.0, values) == 0 && values[0] == 12.0f);
+  ucncMotionRingFree(ring);
+
+  // A reader racing the producer never sees a torn joint vector
+  MotionProducer producer = {ucncMotionRingNew(3, 64), 0, 0};
+  assert(producer.ring);
+  pthread_t thread;
+  assert(pthread_create(&thread, NULL, motion_producer, &producer) == 0);
+  int reads = 0;
+  double start = getCurrentTimeInMs();
+  while (reads < 200000 && getCurrentTimeInMs() - start < 1000.0) {
+    if (ucncMotionRingSample(producer.ring, 1e12, values) != 0)
+      continue;
+    assert(values[1] == 2.0f * values[0] && values[2] == -values[0]);
+    reads++;
+  }
+  atomic_store(&producer.stop, 1);
+  pthread_join(thread, NULL);
+  printf("motion ring: %d samples pushed during %d reads\n", producer.pushed,
+         reads);
+  ucncMotionRingFree(producer.ring);
+
+  // Each frame takes its pose from the ring at the display time
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  const char *names[2] = {"link2", "link3"};
+  ucncAxisHandle handles[2] = {ucncGetAxisHandle(names[0]),
+                               ucncGetAxisHandle(names[1])};
+  for (int i = 0; i < 2; i++) {
+    ucncAssembly *a = findAssemblyByName(globalScene, names[i]);
+    a->minRot = -180.0f;
+    a->maxRot = 180.0f;
+  }
+  ring = ucncMotionRingNew(2, 256);
+  assert(ring);
+  assert(ucncSetMotionSource(ring, handles, 0.0) == 0);
+  double now = getCurrentTimeInMs();
+  const float first[2] = {10.0f, -20.0f}, second[2] = {30.0f, 0.0f};
+  assert(ucncMotionRingPush(ring, now - 1000.0, first) == 0);
+  cncvis_render();
+  ucncAssembly *link2 = findAssemblyByName(globalScene, "link2");
+  float expected = link2->invertMotion ? -10.0f : 10.0f;
+  assert(link2->rotationX == expected || link2->rotationY == expected ||
+         link2->rotationZ == expected);
+  assert(ucncMotionRingPush(ring, now - 500.0, second) == 0);
+  cncvis_render();
+  expected = link2->invertMotion ? -30.0f : 30.0f;
+  assert(link2->rotationX == expected || link2->rotationY == expected ||
+         link2->rotationZ == expected);
+  ucncSetMotionSource(NULL, NULL, 0.0);
+  cncvis_cleanup();
+  ucncMotionRingFree(ring);
+}
+
+// One machine of the cell: pose its instance and render it on this thread
+typedef struct {
+  cncvisInstance *instance;
+  float angle;
+  PIXEL *image;
+  int status;
+} InstanceJob;
+
+static void *render_instance(void *arg) {
+  InstanceJob *job = arg;
+  if (cncvisMakeCurrent(job->instance) != 0)
+    return NULL;
+  ucncAssembly *link2 = findAssemblyByName(ucncGetScene(), "link2");
+  link2->minRot = -180.0f;
+  link2->maxRot = 180.0f;
+  ucncAxisHandle handle = ucncGetAxisHandle("link2");
+  job->status = ucncSetAxesBatch(&handle, &job->angle, 1);
+  cncvis_render();
+  ZBuffer *zb = ucncGetFramebuffer();
+  memcpy(job->image, zb->pbuf, (size_t)zb->xsize * zb->ysize * sizeof(PIXEL));
+  cncvisMakeCurrent(NULL);
+  return NULL;
+}
+
+static void *claim_instance(void *arg) {
+  return (void *)(intptr_t)cncvisMakeCurrent(arg);
+}
+
+static void *default_scene(void *arg) {
+  (void)arg;
+  return ucncGetScene();
+}
+
+static void test_instances(void) {
+  // The thread's own visualizer is left alone by instances
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  ucncAssembly *scene = globalScene;
+  ZBuffer *framebuffer = globalFramebuffer;
+
+  enum { COUNT = 3 };
+  const float angles[COUNT] = {0.0f, 25.0f, -40.0f};
+  cncvisInstance *instances[COUNT];
+  InstanceJob jobs[COUNT];
+  PIXEL *references[COUNT];
+  int w = ZGL_FB_WIDTH, h = ZGL_FB_HEIGHT;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  for (int i = 0; i < COUNT; i++) {
+    instances[i] = cncvisInstanceNew("machines/meca500/config.xml");
+    assert(instances[i]);
+    assert(cncvisGetCurrent() == NULL && globalScene == scene);
+    references[i] = malloc(bytes);
+    jobs[i] = (InstanceJob){instances[i], angles[i], malloc(bytes), -1};
+    assert(references[i] && jobs[i].image);
+  }
+  assert(cncvisInstanceNew("machines/missing/config.xml") == NULL);
+
+  // An instance is current on one thread at a time
+  assert(cncvisMakeCurrent(instances[0]) == 0);
+  assert(cncvisGetCurrent() == instances[0] && ucncGetScene() != scene);
+  assert(globalScene == scene && ucncGetFramebuffer() != framebuffer);
+  pthread_t thread;
+  void *claimed;
+  assert(pthread_create(&thread, NULL, claim_instance, instances[0]) == 0);
+  pthread_join(thread, &claimed);
+  assert((intptr_t)claimed == -1);
+  // Other threads without an instance share the default one
+  assert(pthread_create(&thread, NULL, default_scene, NULL) == 0);
+  pthread_join(thread, &claimed);
+  assert(claimed == scene);
+  assert(cncvisMakeCurrent(NULL) == 0);
+  assert(ucncGetScene() == scene && ucncGetFramebuffer() == framebuffer);
+
+  // Render one after the other on this thread...
+  for (int i = 0; i < COUNT; i++) {
+    render_instance(&jobs[i]);
+    assert(jobs[i].status == 0);
+    memcpy(references[i], jobs[i].image, bytes);
+  }
+  assert(count_scene_diffs(references[0], references[1], w, h) > 0);
+
+  // ...then all at once, each on its own thread, with the same result
+  pthread_t threads[COUNT];
+  double start = getCurrentTimeInMs();
+  for (int i = 0; i < COUNT; i++)
+    assert(pthread_create(&threads[i], NULL, render_instance, &jobs[i]) == 0);
+  for (int i = 0; i < COUNT; i++)
+    pthread_join(threads[i], NULL);
+  printf("instances: %d machines rendered concurrently in %.1f ms\n", COUNT,
+         getCurrentTimeInMs() - start);
+  for (int i = 0; i < COUNT; i++) {
+    assert(jobs[i].status == 0);
+    assert(count_scene_diffs(references[i], jobs[i].image, w, h) == 0);
+    cncvisInstanceFree(instances[i]);
+    free(references[i]);
+    free(jobs[i].image);
+  }
+
+  assert(globalScene == scene);
+  cncvis_render();
+  cncvis_cleanup();
+}
+
+// Whole file in a malloc'd buffer
+static unsigned char *read_file(const char *path, long *size) {
+  FILE *in = fopen(path, "rb");
+  assert(in);
+  fseek(in, 0, SEEK_END);
+  *size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  unsigned char *data = malloc(*size);
+  assert(data && fread(data, 1, *size, in) == (size_t)*size);
+  fclose(in);
+  return data;
+}
+
+// Differing pixels of two RGBA frames outside the OSD bands
+static int count_rgba_diffs(const unsigned char *a, const unsigned char *b,
+                            int w, int h) {
+  int diffs = 0;
+  for (int y = 40; y < h - 40; y++)
+    diffs += memcmp(a + (size_t)y * w * 4, b + (size_t)y * w * 4, w * 4) != 0;
+  return diffs;
+}
+
+static void test_batch(void) {
+  // Scripts: settings over the defaults, errors with their line
+  const char *path = "batch_orbit.txt";
+  FILE *out = fopen(path, "w");
+  assert(out);
+  fprintf(out, "# orbit while sweeping two axes\n"
+               "size 158 120\nframes 12\norbit 15\ntarget 0 0 150\n"
+               "axis base -30 30\naxis link1 0 90   # shoulder\n");
+  fclose(out);
+  ucncBatchJob job = {.config = "machines/meca500/config.xml",
+                      .output = "batch_orbit"};
+  ucncBatchScriptDefaults(&job.script);
+  assert(ucncBatchScriptLoad(path, &job.script) == 0);
+  assert(job.script.width == 158 && job.script.frames == 12);
+  assert(job.script.hasTarget && !job.script.hasCamera);
+  assert(job.script.axisCount == 2 && job.script.to[1] == 90.0f);
+  ucncBatchScript bad;
+  ucncBatchScriptDefaults(&bad);
+  out = fopen("batch_bad.txt", "w");
+  fprintf(out, "frames 4\nzoom 2\n");
+  fclose(out);
+  assert(ucncBatchScriptLoad("batch_bad.txt", &bad) == -1);
+  remove("batch_bad.txt");
+
+  // A sequence rendered raw by one worker, then split over several
+  int w = 160, h = 120; // Width rounded up to a multiple of 4
+  long frameBytes = (long)w * h * 4, size;
+  ucncBatchOptions options = {.format = UCNC_BATCH_RAW, .threads = 1};
+  double start = getCurrentTimeInMs();
+  assert(ucncBatchRun(&job, 1, &options) == 0);
+  double serial = getCurrentTimeInMs() - start;
+  unsigned char *reference = read_file("batch_orbit.rgba", &size);
+  assert(size == 12 * frameBytes);
+  assert(count_rgba_diffs(reference, reference + 11 * frameBytes, w, h) > 0);
+
+  options.threads = 4;
+  start = getCurrentTimeInMs();
+  assert(ucncBatchRun(&job, 1, &options) == 0);
+  double parallel = getCurrentTimeInMs() - start;
+  printf("batch: 12 frames in %.1f ms on one worker, %.1f ms on four\n",
+         serial, parallel);
+  unsigned char *frames = read_file("batch_orbit.rgba", &size);
+  assert(size == 12 * frameBytes);
+  for (int f = 0; f < 12; f++)
+    assert(count_rgba_diffs(reference + f * frameBytes,
+                            frames + f * frameBytes, w, h) == 0);
+  free(frames);
+
+  // Shards of separate processes fill in the same stream, even when each
+  // runs a different number of threads, and cut off a longer earlier run
+  assert(truncate("batch_orbit.rgba", 14 * frameBytes) == 0);
+  options.shardCount = 3;
+  for (options.shardIndex = 0; options.shardIndex < 3; options.shardIndex++) {
+    options.threads = 3 - options.shardIndex;
+    assert(ucncBatchRun(&job, 1, &options) == 0);
+  }
+  frames = read_file("batch_orbit.rgba", &size);
+  assert(size == 12 * frameBytes);
+  for (int f = 0; f < 12; f++)
+    assert(count_rgba_diffs(reference + f * frameBytes,
+                            frames + f * frameBytes, w, h) == 0);
+  free(frames);
+  free(reference);
+  remove("batch_orbit.rgba");
+
+  // Thumbnails of many configurations; failures are counted, not fatal
+  ucncBatchJob thumbs[3] = {
+      {.config = "machines/meca500/config.xml", .output = "batch_thumb"},
+      {.config = "machines/missing/config.xml", .output = "batch_missing"},
+      {.config = "machines/meca500/config.xml", .output = "batch_noaxis"}};
+  for (int i = 0; i < 3; i++)
+    ucncBatchScriptDefaults(&thumbs[i].script);
+  thumbs[2].script.axisCount = 1;
+  snprintf(thumbs[2].script.axes[0], 64, "spindle");
+  ucncBatchOptions png = {.format = UCNC_BATCH_PNG};
+  assert(ucncBatchRun(thumbs, 3, &png) == 2);
+  struct stat st;
+  assert(stat("batch_thumb.png", &st) == 0 && st.st_size > 0);
+  remove("batch_thumb.png");
+  remove(path);
+  assert(cncvisGetCurrent() == NULL && globalScene == NULL);
+}
+
+// Collect everything written to a pipe
+typedef struct {
+  int fd;
+  unsigned char *data;
+  size_t size;
+} PipeReader;
+
+static void *read_pipe(void *arg) {
+  PipeReader *reader = arg;
+  unsigned char chunk[65536];
+  ssize_t n;
+  while ((n = read(reader->fd, chunk, sizeof(chunk))) > 0) {
+    reader->data = realloc(reader->data, reader->size + n);
+    assert(reader->data);
+    memcpy(reader->data + reader->size, chunk, n);
+    reader->size += n;
+  }
+  return NULL;
+}
+
+static void test_frame_sink(void) {
+  // Known colors: Y4M planes and BGRA bytes
+  ZBuffer *zb = ZB_open(8, 4, ZB_MODE_NATIVE, 0);
+  assert(zb);
+  PIXEL *p = zb->pbuf;
+  for (int i = 0; i < 8 * 4; i++)
+    p[i] = i % 8 < 4 ? RGB_TO_PIXEL(0xff0000, 0, 0)
+                     : RGB_TO_PIXEL(0xff0000, 0xff00, 0xff); // Red, white
+  int fds[2];
+  assert(pipe(fds) == 0);
+  PipeReader reader = {fds[0], NULL, 0};
+  pthread_t thread;
+  assert(pthread_create(&thread, NULL, read_pipe, &reader) == 0);
+  ucncFrameSink *sink = ucncFrameSinkNew(fds[1], UCNC_SINK_Y4M, 8, 4, 30, 2);
+  assert(sink);
+  for (int f = 0; f < 3; f++)
+    assert(ucncFrameSinkWrite(sink, zb, 1) == 0);
+  assert(ucncFrameSinkClose(sink) == 0);
+  close(fds[1]);
+  pthread_join(thread, NULL);
+  close(fds[0]);
+  const char *header = "YUV4MPEG2 W8 H4 F30:1 Ip A1:1 C420jpeg\n";
+  size_t headerSize = strlen(header), frameSize = 6 + 32 + 2 * 8;
+  assert(reader.size == headerSize + 3 * frameSize);
+  assert(memcmp(reader.data, header, headerSize) == 0);
+  const unsigned char *frame = reader.data + headerSize + 2 * frameSize;
+  assert(memcmp(frame, "FRAME\n", 6) == 0);
+  const unsigned char *y = frame + 6, *u = y + 32, *v = u + 8;
+  assert(y[0] == 82 && y[7] == 235);  // BT.601 red and white
+  assert(u[0] == 90 && v[0] == 240);  // Red
+  assert(u[3] == 128 && v[3] == 128); // White
+  free(reader.data);
+
+  assert(pipe(fds) == 0);
+  reader = (PipeReader){fds[0], NULL, 0};
+  assert(pthread_create(&thread, NULL, read_pipe, &reader) == 0);
+  sink = ucncFrameSinkNew(fds[1], UCNC_SINK_BGRA, 8, 4, 30, 2);
+  assert(sink && ucncFrameSinkWrite(sink, zb, 1) == 0);
+  assert(ucncFrameSinkClose(sink) == 0);
+  close(fds[1]);
+  pthread_join(thread, NULL);
+  close(fds[0]);
+  assert(reader.size == 8 * 4 * 4);
+  const unsigned char red[4] = {0, 0, 255, 255}, white[4] = {255, 255, 255, 255};
+  assert(memcmp(reader.data, red, 4) == 0);
+  assert(memcmp(reader.data + 4 * 4, white, 4) == 0);
+  free(reader.data);
+  ZB_close(zb);
+
+  // A stalled consumer fills the queue: frames are dropped, not waited for
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  assert(pipe(fds) == 0);
+  sink = ucncFrameSinkNew(fds[1], UCNC_SINK_BGRA, w, h, 30, 3);
+  assert(sink);
+  assert(ucncFrameSinkWrite(sink, zb = ZB_open(w + 4, h, ZB_MODE_NATIVE, 0),
+                            0) == -1);
+  ZB_close(zb);
+  int queued = 0, dropped = 0;
+  double start = getCurrentTimeInMs();
+  for (int f = 0; f < 20; f++) {
+    orbit_camera_z(3.0f);
+    cncvis_render();
+    int result = ucncFrameSinkWrite(sink, globalFramebuffer, 0);
+    assert(result == 0 || result == 1);
+    queued += result == 0;
+    dropped += result == 1;
+  }
+  double elapsed = getCurrentTimeInMs() - start;
+  printf("frame sink: %d frames queued, %d dropped in %.1f ms\n", queued,
+         dropped, elapsed);
+  assert(dropped > 0 && queued >= 3);
+  reader = (PipeReader){fds[0], NULL, 0};
+  assert(pthread_create(&thread, NULL, read_pipe, &reader) == 0);
+  assert(ucncFrameSinkClose(sink) == 0);
+  close(fds[1]);
+  pthread_join(thread, NULL);
+  close(fds[0]);
+  assert(reader.size == (size_t)queued * w * h * 4);
+  free(reader.data);
+  cncvis_cleanup();
+}
+
+// Minimal QOI decoder to check the encoder against
+static unsigned char *decode_qoi(const unsigned char *data, long size,
+                                 int *w, int *h) {
+  assert(size >= 22 && memcmp(data, "qoif", 4) == 0 && data[12] == 3);
+  *w = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
+  *h = data[8] << 24 | data[9] << 16 | data[10] << 8 | data[11];
+  size_t count = (size_t)*w * *h;
+  unsigned char *rgb = malloc(3 * count), seen[64][4] = {{0}};
+  unsigned char px[4] = {0, 0, 0, 255};
+  long p = 14;
+  int run = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (run > 0) {
+      run--;
+    } else {
+      int op = data[p++];
+      if (op == 0xfe) {
+        memcpy(px, data + p, 3);
+        p += 3;
+      } else if ((op & 0xc0) == 0x00) {
+        memcpy(px, seen[op], 4);
+      } else if ((op & 0xc0) == 0x40) {
+        px[0] += ((op >> 4) & 3) - 2;
+        px[1] += ((op >> 2) & 3) - 2;
+        px[2] += (op & 3) - 2;
+      } else if ((op & 0xc0) == 0x80) {
+        int dg = (op & 0x3f) - 32, b2 = data[p++];
+        px[0] += dg - 8 + ((b2 >> 4) & 15);
+        px[1] += dg;
+        px[2] += dg - 8 + (b2 & 15);
+      } else {
+        run = op & 0x3f;
+      }
+      memcpy(seen[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px,
+             4);
+    }
+    memcpy(rgb + 3 * i, px, 3);
+  }
+  assert(p + 8 == size && data[size - 1] == 1);
+  return rgb;
+}
+
+static void test_image_export(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  cncvis_render();
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  unsigned char *expected = malloc((size_t)w * h * 3);
+  assert(expected);
+  ucncPixelsToRgb(globalFramebuffer->pbuf, (size_t)w * h, expected, 0);
+
+  // Every format decodes to the framebuffer, after this frame moved on
+  ucncImageExportOptions options = {2, 3, 1, UCNC_PNG_FILTER_UP};
+  ucncImageExport *exporter = ucncImageExportNew(&options);
+  assert(exporter);
+  const char *paths[3] = {"export.png", "export.qoi", "export.tga"};
+  for (int i = 0; i < 3; i++)
+    assert(ucncImageExportSave(exporter, globalFramebuffer, paths[i]) == 0);
+  assert(ucncImageExportSave(exporter, globalFramebuffer, "export.bmp") == -1);
+  orbit_camera_z(30.0f);
+  cncvis_render();
+  assert(ucncImageExportFlush(exporter) == 0);
+  for (int i = 0; i < 3; i++) {
+    int iw, ih, channels;
+    unsigned char *rgb;
+    if (i == 1) {
+      long size;
+      unsigned char *data = read_file(paths[i], &size);
+      rgb = decode_qoi(data, size, &iw, &ih);
+      free(data);
+    } else {
+      rgb = stbi_load(paths[i], &iw, &ih, &channels, 3);
+    }
+    assert(rgb && iw == w && ih == h);
+    assert(memcmp(rgb, expected, (size_t)w * h * 3) == 0);
+    free(rgb);
+    remove(paths[i]);
+  }
+
+  // Failed writes are counted per flush
+  assert(ucncImageExportSave(exporter, globalFramebuffer,
+                             "missing_dir/export.qoi") == 0);
+  assert(ucncImageExportFlush(exporter) == 1);
+  assert(ucncImageExportFlush(exporter) == 0);
+
+  // Saving only queues: rendering goes on while the workers encode
+  double start = getCurrentTimeInMs();
+  for (int i = 0; i < 12; i++) {
+    char path[64];
+    snprintf(path, sizeof(path), "export_%02d.png", i);
+    cncvis_render();
+    assert(ucncImageExportSave(exporter, globalFramebuffer, path) == 0);
+  }
+  double queued = getCurrentTimeInMs() - start;
+  assert(ucncImageExportFlush(exporter) == 0);
+  printf("image export: 12 PNG frames queued in %.1f ms, written after "
+         "%.1f ms\n", queued, getCurrentTimeInMs() - start);
+  for (int i = 0; i < 12; i++) {
+    char path[64];
+    snprintf(path, sizeof(path), "export_%02d.png", i);
+    assert(remove(path) == 0);
+  }
+  ucncImageExportFree(exporter);
+  free(expected);
+  cncvis_cleanup();
+}
+
+typedef struct {
+  ucncShmReader *reader;
+  unsigned seen;
+  int result;
+} ShmWaiter;
+
+static void *wait_shm(void *arg) {
+  ShmWaiter *waiter = arg;
+  waiter->result = ucncShmReaderWait(waiter->reader, waiter->seen, 5000);
+  return NULL;
+}
+
+static void test_shm_export(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  const char *name = "/cncvis_test";
+  assert(!ucncShmExportNew(name, w, h, 4, 0));
+  ucncShmExport *exporter = ucncShmExportNew(name, w, h, 3, 1);
+  assert(exporter);
+
+  // The reader maps the object on its own, as another process would
+  ucncShmReader *reader = ucncShmReaderOpen(name);
+  assert(reader);
+  const ucncShmHeader *header = ucncShmReaderHeader(reader);
+  assert(header->width == (uint32_t)w && header->height == (uint32_t)h);
+  assert(header->slotCount == 3 && header->hasDepth);
+  ucncShmFrame frame;
+  assert(ucncShmReaderAcquire(reader, &frame) == -1);
+  assert(ucncShmReaderWait(reader, 0, 20) == -1);
+
+  ZBuffer *other = ZB_open(w + 4, h, ZB_MODE_NATIVE, 0);
+  assert(ucncShmExportPublish(exporter, other) == -1);
+  ZB_close(other);
+
+  // Each acquire sees the frame just published, pixels and depth
+  size_t pixels = (size_t)w * h;
+  for (int f = 0; f < 4; f++) {
+    orbit_camera_z(10.0f);
+    cncvis_render();
+    assert(ucncShmExportPublish(exporter, globalFramebuffer) == 0);
+    assert(ucncShmReaderAcquire(reader, &frame) == 0);
+    assert(frame.frame == (uint64_t)f && frame.depth);
+    assert(memcmp(frame.pixels, globalFramebuffer->pbuf,
+                  pixels * sizeof(PIXEL)) == 0);
+    assert(memcmp(frame.depth, globalFramebuffer->zbuf,
+                  pixels * sizeof(uint16_t)) == 0);
+    assert(ucncShmReaderRelease(reader, &frame) == 0);
+  }
+
+  // A frame stays intact for two more publications, then is overwritten
+  assert(ucncShmReaderAcquire(reader, &frame) == 0);
+  assert(ucncShmExportPublish(exporter, globalFramebuffer) == 0);
+  assert(ucncShmExportPublish(exporter, globalFramebuffer) == 0);
+  assert(ucncShmReaderRelease(reader, &frame) == 0);
+  assert(ucncShmExportPublish(exporter, globalFramebuffer) == 0);
+  assert(ucncShmReaderRelease(reader, &frame) == -1);
+
+  // A waiting reader wakes on the next publication
+  assert(ucncShmReaderAcquire(reader, &frame) == 0);
+  ShmWaiter waiter = {reader, (unsigned)frame.frame + 1, -2};
+  pthread_t thread;
+  assert(pthread_create(&thread, NULL, wait_shm, &waiter) == 0);
+  double start = getCurrentTimeInMs();
+  for (int f = 0; f < 60; f++) {
+    orbit_camera_z(3.0f);
+    cncvis_render();
+    assert(ucncShmExportPublish(exporter, globalFramebuffer) == 0);
+  }
+  double elapsed = getCurrentTimeInMs() - start;
+  pthread_join(thread, NULL);
+  assert(waiter.result == 0);
+  printf("shm export: 60 frames rendered and published in %.1f ms\n",
+         elapsed);
+
+  // Readers keep their mapping after the renderer goes away
+  ucncShmExportFree(exporter);
+  assert(!ucncShmReaderOpen(name));
+  assert(ucncShmReaderAcquire(reader, &frame) == 0);
+
+  // A header whose slots cannot hold its frames is refused
+  const char *forgedName = "/cncvis_test_forged";
+  int fd = shm_open(forgedName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  assert(fd >= 0);
+  ucncShmHeader forged;
+  memcpy(&forged, header, sizeof(forged));
+  forged.slotBytes = 64;
+  assert(ftruncate(fd, forged.headerBytes + 3 * 64) == 0);
+  assert(write(fd, &forged, sizeof(forged)) == (ssize_t)sizeof(forged));
+  close(fd);
+  assert(!ucncShmReaderOpen(forgedName));
+  shm_unlink(forgedName);
+  ucncShmReaderClose(reader);
+  cncvis_cleanup();
+}
+
+// Write mesh as an ASCII STL; a non-zero badFacet gets a malformed vertex
+static void write_ascii_stl(const char *path, const ucncMesh *mesh,
+                            unsigned long badFacet) {
+  FILE *out = fopen(path, "w");
+  assert(out);
+  fprintf(out, "solid test\n");
+  for (unsigned long i = 0; i < mesh->triangleCount; i++) {
+    const float *n = &mesh->normals[i * 3];
+    const float *v = &mesh->vertices[i * 9];
+    fprintf(out, "  facet normal %.9g %.9g %.9g\n    outer loop\n", n[0],
+            n[1], n[2]);
+    for (int k = 0; k < 3; k++)
+      fprintf(out, "      vertex %.9g %.9g %.9g\n", v[k * 3], v[k * 3 + 1],
+              v[k * 3 + 2]);
+    if (badFacet && i == badFacet)
+      fprintf(out, "      vertex 1.2.3 0 0\n");
+    fprintf(out, "    endloop\n  endfacet\n");
+  }
+  fprintf(out, "endsolid test\n");
+  fclose(out);
+}
+
+static void test_mesh_cache(void) {
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  int cached = ucncMeshCacheSize();
+  assert(cached > 0);
+
+  // Actors referencing the same file share one mesh
+  ucncActor *a =
+      ucncActorNew("jaw_a", "link3.stl", 1.0f, 0.0f, 0.0f, "machines/meca500");
+  ucncActor *b =
+      ucncActorNew("jaw_b", "link3.stl", 0.0f, 1.0f, 0.0f, "machines/meca500");
+  assert(a && b && a->mesh == b->mesh);
+  assert(a->mesh == findAssemblyByName(globalScene, "link3")->actors[0]->mesh);
+  assert(a->mesh->refCount == 3);
+  assert(ucncMeshCacheSize() == cached);
+  ucncActorFree(a);
+  ucncActorFree(b);
+  assert(ucncMeshCachePurge() == 0); // Still used by the scene
+
+  // Reloading picks the already parsed meshes back up
+  ucncAssembly *link3 = findAssemblyByName(globalScene, "link3");
+  const ucncMesh *before = link3->actors[0]->mesh;
+  rc = ucncLoadNewConfiguration("machines/meca500/config.xml");
+  assert(rc == 0);
+  assert(findAssemblyByName(globalScene, "link3")->actors[0]->mesh == before);
+  assert(ucncMeshCacheSize() == cached);
+
+  cncvis_cleanup();
+  assert(ucncMeshCacheSize() == 0);
+
+  // Binary files whose header starts with "solid" load through the mapped
+  // reader instead of being mistaken for ASCII
+  ucncMesh *spindle = ucncMeshAcquire("machines/meca500/spindle_assy.stl");
+  assert(spindle && spindle->triangleCount == 44905);
+  assert(spindle->boundRadius > 0.0f);
+  ucncMeshRelease(spindle);
+  assert(ucncMeshCachePurge() == 1);
+
+  // An ASCII copy of a binary part (several parser chunks) loads identically
+  ucncMesh *binary = ucncMeshAcquire("machines/meca500/link3.stl");
+  assert(binary);
+  const char *ascii = "machines/meca500/link3_ascii.stl";
+  const char *broken = "machines/meca500/link3_broken.stl";
+  write_ascii_stl(ascii, binary, 0);
+  write_ascii_stl(broken, binary, binary->triangleCount - 10);
+  ucncMesh *text = ucncMeshAcquire(ascii);
+  assert(text && text->triangleCount == binary->triangleCount);
+  assert(memcmp(text->vertices, binary->vertices,
+                binary->triangleCount * 9 * sizeof(float)) == 0);
+  assert(memcmp(text->normals, binary->normals,
+                binary->triangleCount * 3 * sizeof(float)) == 0);
+  assert(text->boundRadius == binary->boundRadius);
+  assert(ucncMeshAcquire(broken) == NULL); // Reported with its line number
+  ucncMeshRelease(text);
+  ucncMeshRelease(binary);
+  assert(ucncMeshCachePurge() == 2);
+  remove(ascii);
+  remove(broken);
+}
+
+static void test_parallel_load(void) {
+  // Many actors on one assembly, one of them with a missing file
+  const char *config = "machines/meca500/parallel.xml";
+  const char *files[] = {"link6.stl", "base.stl",  "missing.stl",
+                         "link1.stl", "link6.stl", "link3.stl"};
+  int fileCount = (int)(sizeof(files) / sizeof(files[0]));
+  FILE *out = fopen(config, "w");
+  assert(out);
+  fputs("<config><assemblies><assembly name=\"root\" parent=\"NULL\"/>"
+        "</assemblies><actors>\n",
+        out);
+  for (int i = 0; i < fileCount; i++)
+    fprintf(out, "<actor name=\"part%d\" assembly=\"root\" stlFile=\"%s\"/>\n",
+            i, files[i]);
+  fputs("</actors></config>\n", out);
+  fclose(out);
+
+  ucncAssembly *root = NULL;
+  ucncLight **lights = NULL;
+  int lightCount = 0;
+  assert(loadConfiguration(config, &root, &lights, &lightCount) == 1);
+
+  // Attached in document order, without the one that failed
+  assert(root && root->actorCount == fileCount - 1);
+  const char *expected[] = {"part0", "part1", "part3", "part4", "part5"};
+  for (int i = 0; i < root->actorCount; i++)
+    assert(strcmp(root->actors[i]->name, expected[i]) == 0);
+  assert(root->actors[0]->mesh == root->actors[3]->mesh);
+  assert(ucncMeshCacheSize() == 4);
+
+  ucncAssemblyFree(root);
+  freeAllLights(&lights, lightCount);
+  ucncMeshCachePurge();
+  remove(config);
+}
+
+static void test_scene_bundle(void) {
+  const char *config = "machines/meca500/config.xml";
+  const char *bundle = "machines/meca500/config.xml.bundle";
+  remove(bundle);
+
+  // Reference frame from the XML path
+  int rc = cncvis_init(config);
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  PIXEL *reference = malloc(bytes);
+  assert(reference);
+  cncvis_render();
+  memcpy(reference, globalFramebuffer->pbuf, bytes);
+  unsigned long triangles =
+      findAssemblyByName(globalScene, "link3")->actors[0]->mesh->triangleCount;
+  cncvis_cleanup();
+
+  assert(ucncBundleWrite(config, bundle) == 1);
+  assert(ucncMeshCacheSize() == 0);
+
+  // Initialising again maps the bundle and draws the same picture
+  rc = cncvis_init(config);
+  assert(rc == 0);
+  ucncAssembly *link3 = findAssemblyByName(globalScene, "link3");
+  assert(link3 && link3->actorCount == 1);
+  const ucncMesh *mesh = link3->actors[0]->mesh;
+  assert(mesh->releaseData != NULL); // Borrowed from the mapping
+  assert(mesh->triangleCount == triangles);
+  ucncAssembly *base = findAssemblyByName(globalScene, "base");
+  assert(base && base->minRot == -45.0f && base->maxRot == 45.0f);
+  assert(globalLightCount == 2);
+  cncvis_render();
+  int diffs = count_scene_diffs(reference, globalFramebuffer->pbuf, w, h);
+  printf("scene bundle: %d differing pixels\n", diffs);
+  assert(diffs == 0);
+  cncvis_cleanup();
+
+  // A bundle built from another version of the configuration is ignored
+  FILE *in = fopen(config, "rb");
+  FILE *out = fopen("machines/meca500/stale.xml", "wb");
+  assert(in && out);
+  int c;
+  while ((c = fgetc(in)) != EOF)
+    fputc(c, out);
+  fputs("\n", out);
+  fclose(in);
+  fclose(out);
+  ucncAssembly *root = NULL;
+  ucncLight **lights = NULL;
+  int lightCount = 0;
+  assert(ucncBundleLoad(bundle, "machines/meca500/stale.xml", &root, &lights,
+                        &lightCount) == 0);
+  assert(root == NULL && ucncMeshCacheSize() == 0);
+
+  remove("machines/meca500/stale.xml");
+  remove(bundle);
+  free(reference);
+}
+
+static void *acquire_mesh(void *arg) {
+  return ucncMeshAcquire(arg);
+}
+
+static void test_async_load(void) {
+  const char *config = "machines/meca500/config.xml";
+  int rc = cncvis_init(config);
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  PIXEL *reference = malloc(bytes);
+  assert(reference);
+  cncvis_render();
+  memcpy(reference, globalFramebuffer->pbuf, bytes);
+  cncvis_cleanup();
+
+  // The tree and lights are there before any mesh is committed
+  ucncActorSetAsyncLoading(1);
+  rc = cncvis_init(config);
+  assert(rc == 0);
+  assert(globalLightCount == 2);
+  ucncAssembly *link3 = findAssemblyByName(globalScene, "link3");
+  assert(link3 && link3->actorCount == 1);
+  ucncMesh *mesh = link3->actors[0]->mesh;
+  assert(!atomic_load(&mesh->visible) && mesh->hasProxy);
+  assert(ucncMeshCachePending() > 0);
+  float proxyMin[3], proxyMax[3];
+  memcpy(proxyMin, mesh->proxyMin, sizeof(proxyMin));
+  memcpy(proxyMax, mesh->proxyMax, sizeof(proxyMax));
+
+  // Frames keep coming while the meshes load, then match the blocking load
+  int frames = 0;
+  while (ucncMeshCachePending() > 0) {
+    assert(cncvis_render() == UCNC_FRAME_RENDERED);
+    frames++;
+  }
+  cncvis_render();
+  printf("async load: %d frames before all meshes were committed\n", frames);
+  assert(atomic_load(&mesh->visible) && mesh->triangleCount > 0);
+  const float center[3] = {mesh->boundCenterX, mesh->boundCenterY,
+                           mesh->boundCenterZ};
+  for (int k = 0; k < 3; k++) {
+    // The sampled box lies within the real bounds
+    assert(proxyMin[k] >= center[k] - mesh->boundRadius - 1e-3f);
+    assert(proxyMax[k] <= center[k] + mesh->boundRadius + 1e-3f);
+  }
+  int diffs = count_scene_diffs(reference, globalFramebuffer->pbuf, w, h);
+  printf("async load: %d differing pixels\n", diffs);
+  assert(diffs == 0);
+  cncvis_cleanup();
+
+  // A file that fails to parse keeps its entry but drops the proxy
+  const char *broken = "machines/meca500/broken_async.stl";
+  FILE *out = fopen(broken, "w");
+  assert(out);
+  fputs("solid broken\nfacet normal 0 0 1\nouter loop\nvertex 0 0\n", out);
+  fclose(out);
+  mesh = ucncMeshAcquireAsync(broken, 0, NULL);
+  assert(mesh);
+  assert(ucncMeshWait(mesh) == 0 && !mesh->hasProxy);
+  assert(ucncMeshCachePending() == 0);
+  ucncMeshRelease(mesh);
+  assert(ucncMeshCachePurge() == 1);
+  remove(broken);
+
+  // A background acquire that lands on an entry a blocking acquire is still
+  // reading never exposes it half filled
+  const char *shared = "machines/meca500/link3.stl";
+  for (int i = 0; i < 20; i++) {
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, acquire_mesh, (void *)shared) == 0);
+    mesh = ucncMeshAcquireAsync(shared, 0, NULL);
+    assert(mesh);
+    if (atomic_load(&mesh->visible)) {
+      assert(mesh->vertices && mesh->triangleCount > 0);
+      assert(mesh->boundRadius > 0);
+    }
+    void *blocking;
+    assert(pthread_join(thread, &blocking) == 0);
+    assert(blocking == mesh);
+    assert(ucncMeshWait(mesh) == 1 && mesh->triangleCount > 0);
+    ucncMeshRelease(mesh);
+    ucncMeshRelease(mesh);
+    assert(ucncMeshCachePurge() == 1);
+  }
+
+  ucncActorSetAsyncLoading(0);
+  free(reference);
+}
+
+// Unit cube [0,1]^3 as 12 triangles
+static void cube_triangles(float *v) {
+  static const int quads[6][4] = {{0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4},
+                                  {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}};
+  static const int split[6] = {0, 1, 2, 0, 2, 3};
+  for (int f = 0; f < 6; f++) {
+    for (int i = 0; i < 6; i++) {
+      int corner = quads[f][split[i]];
+      float *p = &v[(f * 6 + i) * 3];
+      p[0] = (float)(corner & 1);
+      p[1] = (float)((corner >> 1) & 1);
+      p[2] = (float)((corner >> 2) & 1);
+    }
+  }
+}
+
+static void test_collision(void) {
+  // Two unit cubes against the exact answers
+  float cube[12 * 9];
+  cube_triangles(cube);
+  ucncBvh *bvh = ucncBvhBuild(cube, 12);
+  assert(bvh && bvh->triangleCount == 12);
+  float m[16];
+  ucncMatrixFromPose(m, 1.5f, 0.0f, 0.0f, 0, 0, 0, 0, 0, 0);
+  assert(!ucncBvhIntersect(bvh, bvh, m));
+  assert(fabsf(ucncBvhDistance(bvh, bvh, m, 1.0f) - 0.5f) < 1e-5f);
+  assert(ucncBvhDistance(bvh, bvh, m, 0.25f) == 0.25f);
+  ucncMatrixFromPose(m, 0.5f, 0.5f, 0.5f, 0, 0, 0, 0, 0, 0);
+  assert(ucncBvhIntersect(bvh, bvh, m));
+  assert(ucncBvhDistance(bvh, bvh, m, 1.0f) == 0.0f);
+  // Turned 45 degrees about z, an edge 0.2 away from the first cube's face
+  float edge = 0.5f * sqrtf(2.0f);
+  ucncMatrixFromPose(m, 0.7f + edge, 0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0, 0, 45);
+  assert(fabsf(ucncBvhDistance(bvh, bvh, m, 1.0f) - 0.2f) < 1e-4f);
+  ucncBvhFree(bvh);
+
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  ucncCollisionPair pairs[16];
+  assert(ucncCheckCollisions(0.0f, pairs, 16) == 0);
+  // The shoulder clears the base by about 11 mm at home
+  int n = ucncCheckCollisions(20.0f, pairs, 16);
+  assert(n == 1);
+  printf("collision: %s-%s %.2f mm apart\n", pairs[0].assemblyA->name,
+         pairs[0].assemblyB->name, pairs[0].distance);
+  assert(pairs[0].distance > 5.0f && pairs[0].distance < 20.0f);
+
+  // Folding link3 back into the base is rejected and leaves the pose alone
+  ucncAssembly *link3 = findAssemblyByName(globalScene, "link3");
+  link3->minRot = -180.0f;
+  link3->maxRot = 180.0f;
+  ucncSetCollisionChecking(1, 0.0f);
+  assert(ucncSetMotion(link3, 30.0f) == 0);
+  assert(ucncSetMotion(link3, 90.0f) == -1);
+  assert(link3->collisionTriggered == 1 && link3->limitTriggered == 0);
+  assert(link3->rotationY == 30.0f);
+  assert(ucncCheckCollisions(0.0f, pairs, 16) == 0);
+  // Backing off still works
+  assert(ucncUpdateMotion(link3, -10.0f) == 0);
+  assert(ucncClearLimitWarning("link3") == 0 && !link3->collisionTriggered);
+
+  // A batch is checked once in its final pose and taken back as a whole
+  ucncAssembly *link1 = findAssemblyByName(globalScene, "link1");
+  ucncAxisHandle axes[2] = {ucncGetAxisHandle("link1"),
+                            ucncGetAxisHandle("link3")};
+  float link1Before = link1->rotationZ, folded[2] = {10.0f, 90.0f};
+  assert(ucncSetAxesBatch(axes, folded, 2) == -1);
+  assert(link1->rotationZ == link1Before && link3->rotationY == 20.0f);
+  assert(link1->collisionTriggered && link3->collisionTriggered);
+  assert(ucncClearLimitWarning("link1") == 0);
+  assert(ucncClearLimitWarning("link3") == 0);
+  float clear[2] = {10.0f, 40.0f};
+  assert(ucncSetAxesBatch(axes, clear, 2) == 0);
+  assert(link3->rotationY == 40.0f && !link3->collisionTriggered);
+
+  double start = getCurrentTimeInMs();
+  int checks = 1000;
+  for (int i = 0; i < checks; i++)
+    ucncSetMotion(link3, (float)(i % 60));
+  printf("collision: %.1f us per checked move\n",
+         (getCurrentTimeInMs() - start) * 1000.0 / checks);
+  ucncSetCollisionChecking(0, 0.0f);
+
+  // Actors added later join the collision world: a copy of link1 left
+  // standing where link1 is
+  assert(ucncCheckCollisions(0.0f, pairs, 16) == 0);
+  ucncActor *ghost = ucncActorNew("ghost", "link1.stl", 1.0f, 0.0f, 0.0f,
+                                  "machines/meca500");
+  assert(ghost);
+  ghost->positionZ = 135.0f;
+  ucncActorUpdateTransform(ghost);
+  assert(ucncAssemblyAddActor(globalScene, ghost));
+  assert(ucncCheckCollisions(0.0f, pairs, 16) > 0);
+  cncvis_cleanup();
+}
+
+// Pixels set in a with nothing set in b within one pixel, outside the OSD
+static int unmatched_pixels(const unsigned char *a, const unsigned char *b,
+                            int w, int h) {
+  int unmatched = 0;
+  for (int y = 40; y < h - 40; y++) {
+    for (int x = 1; x < w - 1; x++) {
+      if (!a[y * w + x])
+        continue;
+      int found = 0;
+      for (int dy = -1; dy <= 1 && !found; dy++)
+        for (int dx = -1; dx <= 1 && !found; dx++)
+          found = b[(y + dy) * w + x + dx];
+      unmatched += !found;
+    }
+  }
+  return unmatched;
+}
+
+static void test_toolpath(void) {
+  // Chunked storage keeps polylines connected across chunk boundaries
+  ucncToolpath *toolpath = ucncToolpathNew();
+  assert(toolpath);
+  int turns = 3, steps = 4000;
+  float *helix = malloc((size_t)turns * steps * 3 * sizeof(float));
+  assert(helix);
+  for (int i = 0; i < turns * steps; i++) {
+    float a = 2.0f * (float)M_PI * i / steps;
+    helix[i * 3] = 250.0f * cosf(a);
+    helix[i * 3 + 1] = 250.0f * sinf(a);
+    helix[i * 3 + 2] = 50.0f + 40.0f * i / steps;
+  }
+  unsigned long generation = ucncToolpathGeneration(toolpath);
+  assert(ucncToolpathMoveTo(toolpath, 250.0f, 0.0f, 50.0f) == 0);
+  assert(ucncToolpathAppend(toolpath, helix + 3, turns * steps - 1, 0) == 0);
+  assert(ucncToolpathLineTo(toolpath, 0.0f, 0.0f, 300.0f, 1) == 0);
+  assert(ucncToolpathSegmentCount(toolpath) == (unsigned long)turns * steps);
+  assert(ucncToolpathGeneration(toolpath) != generation);
+
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  int w = globalFramebuffer->xsize, h = globalFramebuffer->ysize;
+  size_t bytes = (size_t)w * h * sizeof(PIXEL);
+  PIXEL *scene = malloc(bytes);
+  unsigned char *fast = calloc((size_t)w * h, 1);
+  unsigned char *lines = calloc((size_t)w * h, 1);
+  assert(scene && fast && lines);
+  ucncSetRenderOnChange(1);
+  cncvis_render();
+  memcpy(scene, globalFramebuffer->pbuf, bytes);
+
+  // Appending redraws the frame
+  ucncSetToolpath(toolpath, NULL);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  for (int i = 0; i < w * h; i++)
+    fast[i] = ((PIXEL *)globalFramebuffer->pbuf)[i] != scene[i];
+  assert(ucncToolpathLineTo(toolpath, 250.0f, 0.0f, 300.0f, 1) == 0);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  ucncSetRenderOnChange(0);
+
+  // Same picture as the TinyGL line path, give or take a pixel
+  ucncSetToolpath(NULL, NULL);
+  cncvis_render();
+  glDisable(GL_LIGHTING);
+  glColor3f(1.0f, 1.0f, 1.0f);
+  glBegin(GL_LINES);
+  glVertex3f(250.0f, 0.0f, 50.0f);
+  for (int i = 1; i < turns * steps; i++) {
+    glVertex3fv(&helix[i * 3]);
+    glVertex3fv(&helix[i * 3]);
+  }
+  glVertex3f(0.0f, 0.0f, 300.0f);
+  glEnd();
+  glEnable(GL_LIGHTING);
+  int drawn = 0;
+  for (int i = 40 * w; i < (h - 40) * w; i++) {
+    lines[i] = ((PIXEL *)globalFramebuffer->pbuf)[i] != scene[i];
+    drawn += fast[i];
+  }
+  int missing = unmatched_pixels(lines, fast, w, h);
+  int extra = unmatched_pixels(fast, lines, w, h);
+  printf("toolpath: %d pixels, %d missing, %d extra\n", drawn, missing, extra);
+  assert(drawn > 1000);
+  assert(missing < drawn / 50 && extra < drawn / 50);
+
+  // A dense raster pocket of a million segments
+  ucncToolpathClear(toolpath);
+  assert(ucncToolpathSegmentCount(toolpath) == 0);
+  ucncToolpathMoveTo(toolpath, -100.0f, -100.0f, 20.0f);
+  for (int row = 0; row < 1000; row++) {
+    float y = -100.0f + row * 0.2f;
+    for (int i = 0; i < 1000; i++) {
+      float x = (row & 1) ? 100.0f - i * 0.2f : -100.0f + i * 0.2f;
+      ucncToolpathLineTo(toolpath, x, y, 20.0f + 0.5f * sinf(x * 0.1f), 0);
+    }
+  }
+  assert(ucncToolpathSegmentCount(toolpath) == 1000000);
+  ucncSetToolpath(toolpath, "base");
+  cncvis_render();
+  double start = getCurrentTimeInMs();
+  int frames = 10;
+  for (int i = 0; i < frames; i++) {
+    orbit_camera_z(1.0f);
+    cncvis_render();
+  }
+  printf("toolpath: 1M segments in %.1f ms per frame\n",
+         (getCurrentTimeInMs() - start) / frames);
+
+  ucncSetToolpath(NULL, NULL);
+  free(scene);
+  free(fast);
+  free(lines);
+  free(helix);
+  cncvis_cleanup();
+  ucncToolpathFree(toolpath);
+}
+
+static void test_stock(void) {
+  // Flat end mill slot and ball end plunge against the exact profiles
+  ucncStock *stock = ucncStockNew(0.0f, 0.0f, 100.0f, 60.0f, 0.0f, 20.0f,
+                                  0.5f);
+  assert(stock);
+  ucncStockSetTool(stock, 5.0f, 0);
+  const float slotFrom[3] = {10.0f, 30.0f, 15.0f};
+  const float slotTo[3] = {90.0f, 30.0f, 15.0f};
+  assert(ucncStockCut(stock, slotFrom, slotTo) == 0);
+  ucncStockSetTool(stock, 5.0f, 1);
+  const float plunge[3] = {50.25f, 10.25f, 15.0f};
+  assert(ucncStockCut(stock, plunge, plunge) == 0);
+  const float through[3] = {20.25f, 50.25f, -5.0f};
+  assert(ucncStockCut(stock, through, through) == 0);
+  // Queries wait for the cuts still queued
+  assert(ucncStockHeight(stock, 50.0f, 30.0f) == 15.0f);
+  assert(ucncStockHeight(stock, 50.0f, 34.6f) == 15.0f);
+  assert(ucncStockHeight(stock, 50.0f, 35.6f) == 20.0f);
+  assert(ucncStockHeight(stock, 94.6f, 30.0f) == 15.0f);
+  assert(ucncStockHeight(stock, 95.6f, 30.0f) == 20.0f);
+  assert(ucncStockHeight(stock, 50.3f, 10.3f) == 15.0f);
+  assert(fabsf(ucncStockHeight(stock, 53.3f, 10.3f) - 16.0f) < 1e-4f);
+  assert(ucncStockHeight(stock, 20.3f, 50.3f) == 0.0f);
+  ucncStockFree(stock);
+
+  // Streamed 0.05 mm moves cost the same on a small and a large block
+  float sizes[2] = {50.0f, 500.0f};
+  for (int k = 0; k < 2; k++) {
+    stock = ucncStockNew(0.0f, 0.0f, sizes[k], sizes[k], 0.0f, 20.0f, 0.5f);
+    assert(stock);
+    float from[3] = {5.0f, 5.0f, 18.0f}, to[3] = {5.0f, 5.0f, 18.0f};
+    int updates = 1000;
+    double start = getCurrentTimeInMs();
+    for (int i = 0; i < updates; i++) {
+      to[0] = from[0] + 0.05f;
+      ucncStockCut(stock, from, to);
+      ucncStockSync(stock);
+      from[0] = to[0];
+    }
+    printf("stock: %.0f mm block, %.1f us per update\n", sizes[k],
+           (getCurrentTimeInMs() - start) * 1000.0 / updates);
+    assert(ucncStockHeight(stock, 40.0f, 5.0f) == 18.0f);
+    ucncStockFree(stock);
+  }
+
+  // Motion updates cut the stock along the tool tip's path
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  ucncAssembly *link6 = findAssemblyByName(globalScene, "link6");
+  const float origin[3] = {link6->originX, link6->originY, link6->originZ};
+  float tip[3];
+  ucncMatrixTransformPoint(ucncAssemblyGetWorldMatrix(link6), origin, tip);
+  stock = ucncStockNew(tip[0] - 50.0f, tip[1] - 50.0f, 100.0f, 100.0f,
+                       tip[2] - 20.0f, tip[2] + 5.0f, 0.5f);
+  assert(stock);
+  ucncSetRenderOnChange(1);
+  ucncSetStock(stock, "base", "link6");
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  assert(ucncUpdateMotionByName("link1", 5.0f) == 0);
+  ucncStockSync(stock);
+  assert(ucncStockHeight(stock, tip[0], tip[1]) <= tip[2] + 0.01f);
+  assert(ucncStockHeight(stock, tip[0] - 40.0f, tip[1] - 40.0f) ==
+         tip[2] + 5.0f);
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  ucncSetRenderOnChange(0);
+  ucncSetStock(NULL, NULL, NULL);
+  cncvis_cleanup();
+  ucncStockFree(stock);
+}
+
+static void test_voxel(void) {
+  // Flat end mill slot and a sideways ball end undercut
+  const float min[3] = {0.0f, 0.0f, 0.0f}, size[3] = {100.0f, 60.0f, 40.0f};
+  ucncVoxelStock *stock = ucncVoxelStockNew(min, size, 0.5f);
+  assert(stock);
+  const float down[3] = {0.0f, 0.0f, 1.0f}, side[3] = {-1.0f, 0.0f, 0.0f};
+  ucncVoxelStockSetTool(stock, 5.0f, 20.0f, 0);
+  const float slotFrom[3] = {10.0f, 30.0f, 30.0f};
+  const float slotTo[3] = {90.0f, 30.0f, 30.0f};
+  assert(ucncVoxelStockCut(stock, slotFrom, down, slotTo, down) == 0);
+  ucncVoxelStockSetTool(stock, 3.0f, 30.0f, 1);
+  const float enter[3] = {-20.0f, 15.0f, 10.0f};
+  const float reach[3] = {5.0f, 15.0f, 10.0f};
+  assert(ucncVoxelStockCut(stock, enter, side, reach, side) == 0);
+  const float probes[][4] = {
+      {50.0f, 30.0f, 35.0f, 0.0f}, {50.0f, 30.0f, 29.0f, 1.0f},
+      {50.0f, 34.6f, 35.0f, 0.0f}, {50.0f, 35.6f, 35.0f, 1.0f},
+      {94.6f, 30.0f, 35.0f, 0.0f}, {95.6f, 30.0f, 35.0f, 1.0f},
+      {2.0f, 15.0f, 10.0f, 0.0f},  {2.0f, 15.0f, 12.6f, 0.0f},
+      {2.0f, 15.0f, 14.0f, 1.0f},  {2.0f, 15.0f, 20.0f, 1.0f},
+      {7.0f, 15.0f, 10.0f, 1.0f},  {50.0f, 10.0f, 10.0f, 1.0f}};
+  for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++)
+    assert(ucncVoxelStockIsSolid(stock, probes[i]) == (int)probes[i][3]);
+  int mixed = ucncVoxelStockBrickCount(stock);
+  printf("voxel: %d of %d bricks hold voxels\n", mixed, 7 * 4 * 3);
+  assert(mixed > 0 && mixed < 7 * 4 * 3);
+  ucncVoxelStockFree(stock);
+
+  // Memory and time follow the bricks a move touches, not the block
+  const float bigSize[3] = {500.0f, 500.0f, 100.0f};
+  stock = ucncVoxelStockNew(min, bigSize, 0.5f);
+  assert(stock);
+  ucncVoxelStockSetTool(stock, 3.0f, 20.0f, 1);
+  float from[3] = {20.0f, 20.0f, 95.0f}, to[3] = {20.0f, 20.0f, 95.0f};
+  int updates = 1000;
+  double start = getCurrentTimeInMs();
+  for (int i = 0; i < updates; i++) {
+    to[0] = from[0] + 0.05f;
+    ucncVoxelStockCut(stock, from, down, to, down);
+    from[0] = to[0];
+  }
+  printf("voxel: %.1f us per update, %d bricks hold voxels\n",
+         (getCurrentTimeInMs() - start) * 1000.0 / updates,
+         ucncVoxelStockBrickCount(stock));
+  assert(ucncVoxelStockBrickCount(stock) <= 8);
+  ucncVoxelStockFree(stock);
+
+  // Attached to the workpiece, motion cuts it and redraws the frame
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  ucncAssembly *link6 = findAssemblyByName(globalScene, "link6");
+  const float origin[3] = {link6->originX, link6->originY, link6->originZ};
+  const float above[3] = {origin[0], origin[1], origin[2] + 1.0f};
+  float tip[3], inside[3];
+  ucncMatrixTransformPoint(ucncAssemblyGetWorldMatrix(link6), origin, tip);
+  ucncMatrixTransformPoint(ucncAssemblyGetWorldMatrix(link6), above, inside);
+  const float blockMin[3] = {tip[0] - 50.0f, tip[1] - 50.0f, tip[2] - 20.0f};
+  const float blockSize[3] = {100.0f, 100.0f, 25.0f};
+  stock = ucncVoxelStockNew(blockMin, blockSize, 0.5f);
+  assert(stock);
+  ucncActor *actor = ucncVoxelStockNewActor(stock, "stock", 0.7f, 0.7f, 0.75f);
+  assert(actor);
+  ucncAssembly *base = findAssemblyByName(globalScene, "base");
+  assert(ucncAssemblyAddActor(base, actor));
+  ucncSetRenderOnChange(1);
+  ucncSetVoxelStock(stock, "base", "link6");
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  assert(cncvis_render() == UCNC_FRAME_UNCHANGED);
+  assert(ucncUpdateMotionByName("link1", 5.0f) == 0);
+  assert(!ucncVoxelStockIsSolid(stock, inside));
+  const float corner[3] = {tip[0] - 40.0f, tip[1] - 40.0f, tip[2] - 10.0f};
+  assert(ucncVoxelStockIsSolid(stock, corner));
+  assert(cncvis_render() == UCNC_FRAME_RENDERED);
+  ucncSetRenderOnChange(0);
+  ucncSetVoxelStock(NULL, NULL, NULL);
+  cncvis_cleanup();
+  ucncVoxelStockFree(stock);
+}
+
+// Remove a flat directory of test output; returns the files it held whose
+// name ends in suffix
+static int remove_dir(const char *dir, const char *suffix) {
+  DIR *d = opendir(dir);
+  assert(d);
+  int matching = 0;
+  struct dirent *entry;
+  char path[1024];
+  while ((entry = readdir(d))) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+    size_t n = strlen(entry->d_name), s = strlen(suffix);
+    matching += n >= s && strcmp(entry->d_name + n - s, suffix) == 0;
+    snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+    remove(path);
+  }
+  closedir(d);
+  rmdir(dir);
+  return matching;
+}
+
+static void test_lod(void) {
+  char cacheDir[] = "/tmp/cncvis_lod_XXXXXX";
+  assert(mkdtemp(cacheDir));
+  ucncActorSetLodOptions(3, 0, cacheDir);
+  int rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+
+  ucncAssembly *link3 = findAssemblyByName(globalScene, "link3");
+  assert(link3 != NULL && link3->actorCount > 0);
+  ucncActor *actor = link3->actors[0];
+  const ucncMesh *mesh = actor->mesh;
+  int count = atomic_load(&mesh->lodCount);
+  assert(count > 0);
+  unsigned long prevTris = mesh->triangleCount;
+  float prevError = 0.0f;
+  for (int i = 0; i < count; i++) {
+    printf("LOD %d: %lu triangles, error %f\n", i + 1,
+           mesh->lods[i].triangleCount, mesh->lods[i].geometricError);
+    assert(mesh->lods[i].triangleCount < prevTris);
+    assert(mesh->lods[i].geometricError >= prevError);
+    prevTris = mesh->lods[i].triangleCount;
+    prevError = mesh->lods[i].geometricError;
+  }
+
+  // Close up the full mesh is used, far away a simplified one
+  cncvis_render();
+  int nearLevel = ucncActorSelectLod(actor);
+  globalCamera->positionX *= 4.0f;
+  globalCamera->positionY *= 4.0f;
+  globalCamera->positionZ *= 4.0f;
+  cncvis_render();
+  int farLevel = ucncActorSelectLod(actor);
+  printf("LOD near=%d far=%d\n", nearLevel, farLevel);
+  assert(farLevel > nearLevel);
+  cncvis_cleanup();
+
+  // The second load is served from the on-disk cache
+  rc = cncvis_init("machines/meca500/config.xml");
+  assert(rc == 0);
+  link3 = findAssemblyByName(globalScene, "link3");
+  assert(atomic_load(&link3->actors[0]->mesh->lodCount) == count);
+  cncvis_cleanup();
+  ucncActorSetLodOptions(0, 0, NULL);
+  assert(remove_dir(cacheDir, ".lod") > 0);
+}
+
 static void test_orbit_video(void) {
   int rc = cncvis_init("machines/meca500/config.xml");
   assert(rc == 0);
 
   ucncCameraSetTarget(globalCamera, 0.0f, 0.0f, 0.0f);
-  mkdir("frames", 0755);
 
   // Debug: Print framebuffer resolution
   printf("Framebuffer resolution: %d x %d\n", globalFramebuffer->xsize,
          globalFramebuffer->ysize);
 
+  // Stream the frames instead of writing a PNG each
+  int video = open("orbit.y4m", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  assert(video >= 0);
+  ucncFrameSink *sink =
+      ucncFrameSinkNew(video, UCNC_SINK_Y4M, globalFramebuffer->xsize,
+                       globalFramebuffer->ysize, 30, 4);
+  assert(sink);
   for (int i = 0; i < 60; ++i) {
     cncvis_render();
-    char fname[64];
-    snprintf(fname, sizeof(fname), "frames/frame%03d.png", i);
-    saveFramebufferAsImage(globalFramebuffer, fname, globalFramebuffer->xsize,
-                           globalFramebuffer->ysize);
+    assert(ucncFrameSinkWrite(sink, globalFramebuffer, 1) == 0);
     orbit_camera_z(6.0f);
   }
+  assert(ucncFrameSinkClose(sink) == 0);
+  close(video);
 
   cncvis_cleanup();
 
-  system("ffmpeg -y -framerate 30 -i frames/frame%03d.png -c:v libx264 -crf 15 "
-         "-preset veryslow -pix_fmt yuv444p orbit.mp4");
+  system("ffmpeg -y -i orbit.y4m -c:v libx264 -crf 15 -preset veryslow "
+         "-pix_fmt yuv420p orbit.mp4");
 }
 
 static void test_benchmark(void) {
@@ -120,6 +1793,9 @@ static void test_benchmark(void) {
   assert(globalCamera != NULL);
 
   ucncCameraSetTarget(globalCamera, 0.0f, 0.0f, 0.0f);
+  mkdir("bench_frames", 0755);
+  ucncImageExport *exporter = ucncImageExportNew(NULL);
+  assert(exporter);
 
   // Benchmark rendering loop
   for (int i = 0; i < num_frames; ++i) {
@@ -135,13 +1811,11 @@ static void test_benchmark(void) {
     cncvis_render();
     timing.sceneRenderTime = getCurrentTimeInMs() - start;
 
-    // Measure frame saving (optional, can skip to reduce I/O impact)
+    // Measure frame saving: queued here, encoded while the next renders
     start = getCurrentTimeInMs();
     char fname[64];
     snprintf(fname, sizeof(fname), "bench_frames/frame%03d.png", i);
-    mkdir("bench_frames", 0755);
-    saveFramebufferAsImage(globalFramebuffer, fname, globalFramebuffer->xsize,
-                           globalFramebuffer->ysize);
+    assert(ucncImageExportSave(exporter, globalFramebuffer, fname) == 0);
     timing.imageSaveTime = getCurrentTimeInMs() - start;
 
     // Total frame time
@@ -152,11 +1826,17 @@ static void test_benchmark(void) {
     updateProfilingStats(&stats, &timing);
   }
 
+  double flushStart = getCurrentTimeInMs();
+  assert(ucncImageExportFlush(exporter) == 0);
+  double flushTime = getCurrentTimeInMs() - flushStart;
+  ucncImageExportFree(exporter);
+
   // Clean up
   cncvis_cleanup();
 
   // Print results
   printf("\nBenchmark Results (%d frames):\n", num_frames);
+  printf("Image Export Drain: %.2f ms after the last frame\n", flushTime);
   printf("Initialization Time: %.2f ms\n", init_time);
   printProfilingStats(&stats, num_frames);
 }
@@ -165,6 +1845,28 @@ int main(void) {
   test_init_and_motion();
   test_reload_config();
   test_limits();
+  test_axis_handles();
+  test_transforms();
+  test_kinematics();
+  test_motion_ring();
+  test_instances();
+  test_batch();
+  test_frame_sink();
+  test_image_export();
+  test_shm_export();
+  test_static_layer();
+  test_dirty_regions();
+  test_dirty_tiles();
+  test_render_on_change();
+  test_mesh_cache();
+  test_parallel_load();
+  test_scene_bundle();
+  test_async_load();
+  test_collision();
+  test_toolpath();
+  test_stock();
+  test_voxel();
+  test_lod();
   test_orbit_video();
   test_benchmark();
   return 0;
@@ -0,0 +1,192 @@
+/* collision.c */
+
+#include "collision.h"
+
+// Broad phase: the world boxes of the actors (their hierarchy root boxes
+// moved into place) are swept along x, in an order kept from the previous
+// query which stays nearly sorted while the machine moves. Candidate pairs
+// are handed to the mesh hierarchies.
+
+typedef struct {
+  ucncActor *actor;
+  ucncAssembly *assembly;
+  const ucncAssembly *body;       // Nearest moving assembly, or the root
+  const ucncAssembly *parentBody; // Body the body hangs from, if any
+  const ucncBvh *bvh;             // NULL until the mesh is loaded
+  float world[16];
+  float min[3], max[3];
+  const ucncAssembly *movedBy; // Innermost moved assembly above, or NULL
+} CollisionEntry;
+
+struct ucncCollisionWorld {
+  ucncAssembly *root;
+  CollisionEntry *entries;
+  int count;
+  int *order; // Entries by ascending min[0]
+};
+
+static const ucncAssembly *bodyOf(const ucncAssembly *assembly) {
+  while (assembly->parent && assembly->motionType == UCNC_MOTION_NONE)
+    assembly = assembly->parent;
+  return assembly;
+}
+
+static int collectActors(ucncCollisionWorld *world, ucncAssembly *assembly) {
+  for (int i = 0; i < assembly->actorCount; i++) {
+    if (assembly->actors[i]->geometry.render)
+      continue; // No triangles to test
+    CollisionEntry *entries =
+        realloc(world->entries, (world->count + 1) * sizeof(*entries));
+    if (!entries)
+      return 0;
+    world->entries = entries;
+    CollisionEntry *entry = &entries[world->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->actor = assembly->actors[i];
+    entry->assembly = assembly;
+    entry->body = bodyOf(assembly);
+    entry->parentBody = entry->body->parent ? bodyOf(entry->body->parent) : NULL;
+    entry->bvh = ucncMeshGetBvh(entry->actor->mesh);
+  }
+  for (int i = 0; i < assembly->assemblyCount; i++) {
+    if (!collectActors(world, assembly->assemblies[i]))
+      return 0;
+  }
+  return 1;
+}
+
+ucncCollisionWorld *ucncCollisionWorldNew(ucncAssembly *root) {
+  if (!root)
+    return NULL;
+  ucncCollisionWorld *world = calloc(1, sizeof(ucncCollisionWorld));
+  if (world && collectActors(world, root))
+    world->order = malloc((world->count ? world->count : 1) * sizeof(int));
+  if (!world || !world->order) {
+    fprintf(stderr, "Memory allocation failed for collision world.\n");
+    ucncCollisionWorldFree(world);
+    return NULL;
+  }
+  world->root = root;
+  for (int i = 0; i < world->count; i++)
+    world->order[i] = i;
+  return world;
+}
+
+void ucncCollisionWorldFree(ucncCollisionWorld *world) {
+  if (!world)
+    return;
+  free(world->entries);
+  free(world->order);
+  free(world);
+}
+
+static const ucncAssembly *movedBy(const ucncAssembly *assembly,
+                                   const ucncAssembly *const *moved,
+                                   int movedCount) {
+  for (; assembly; assembly = assembly->parent) {
+    for (int i = 0; i < movedCount; i++)
+      if (assembly == moved[i])
+        return assembly;
+  }
+  return NULL;
+}
+
+// Actors whose relative pose never changes, or only through one joint
+static int alwaysTouching(const CollisionEntry *a, const CollisionEntry *b) {
+  return a->body == b->body || a->parentBody == b->body ||
+         b->parentBody == a->body;
+}
+
+static int boxesApart(const CollisionEntry *a, const CollisionEntry *b,
+                      float clearance) {
+  for (int k = 0; k < 3; k++) {
+    if (b->min[k] > a->max[k] + clearance || a->min[k] > b->max[k] + clearance)
+      return 1;
+  }
+  return 0;
+}
+
+// Distance between two actors if it is below the clearance (0 when they
+// intersect), -1 otherwise
+static float pairDistance(const CollisionEntry *a, const CollisionEntry *b,
+                          float clearance) {
+  float toA[16], bToA[16];
+  ucncMatrixInvertRigid(toA, a->world);
+  ucncMatrixMultiply(bToA, toA, b->world);
+  if (clearance <= 0.0f)
+    return ucncBvhIntersect(a->bvh, b->bvh, bToA) ? 0.0f : -1.0f;
+  float distance = ucncBvhDistance(a->bvh, b->bvh, bToA, clearance);
+  return distance < clearance ? distance : -1.0f;
+}
+
+int ucncCollisionCheck(ucncCollisionWorld *world, const ucncAssembly *moved,
+                       float clearance, ucncCollisionPair *pairs,
+                       int maxPairs) {
+  return ucncCollisionCheckMoves(world, &moved, moved ? 1 : 0, clearance,
+                                 pairs, maxPairs);
+}
+
+int ucncCollisionCheckMoves(ucncCollisionWorld *world,
+                            const ucncAssembly *const *moved, int movedCount,
+                            float clearance, ucncCollisionPair *pairs,
+                            int maxPairs) {
+  if (!world || !pairs || maxPairs <= 0)
+    return 0;
+  if (clearance < 0.0f)
+    clearance = 0.0f;
+
+  // Place every actor; meshes still loading in the background join later
+  for (int i = 0; i < world->count; i++) {
+    CollisionEntry *entry = &world->entries[i];
+    if (!entry->bvh)
+      entry->bvh = ucncMeshGetBvh(entry->actor->mesh);
+    if (!entry->bvh)
+      continue;
+    ucncMatrixMultiply(entry->world,
+                       ucncAssemblyGetWorldMatrix(entry->assembly),
+                       entry->actor->localMatrix);
+    ucncBvhBounds(entry->bvh, entry->world, entry->min, entry->max);
+    entry->movedBy = movedBy(entry->assembly, moved, movedCount);
+  }
+
+  // Insertion sort, close to linear for the previous query's order
+  int *order = world->order;
+  for (int i = 1; i < world->count; i++) {
+    int key = order[i], j = i - 1;
+    float x = world->entries[key].min[0];
+    while (j >= 0 && world->entries[order[j]].min[0] > x) {
+      order[j + 1] = order[j];
+      j--;
+    }
+    order[j + 1] = key;
+  }
+
+  int found = 0;
+  for (int i = 0; i < world->count; i++) {
+    const CollisionEntry *a = &world->entries[order[i]];
+    if (!a->bvh)
+      continue;
+    for (int j = i + 1; j < world->count; j++) {
+      const CollisionEntry *b = &world->entries[order[j]];
+      if (b->min[0] > a->max[0] + clearance)
+        break;
+      // Below the same innermost moved assembly, no moved joint lies
+      // between the two, so their relative pose did not change
+      if (!b->bvh || (movedCount > 0 && a->movedBy == b->movedBy) ||
+          alwaysTouching(a, b) || boxesApart(a, b, clearance))
+        continue;
+      float distance = pairDistance(a, b, clearance);
+      if (distance < 0.0f)
+        continue;
+      ucncCollisionPair *pair = &pairs[found];
+      pair->actorA = a->actor;
+      pair->actorB = b->actor;
+      pair->assemblyA = a->assembly;
+      pair->assemblyB = b->assembly;
+      pair->distance = distance;
+      if (++found == maxPairs)
+        return found;
+    }
+  }
+  return found;
+}
@@ -0,0 +1,45 @@
+/* collision.h */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "assembly.h"
+
+// Interference checking between the actors of an assembly tree. Every mesh
+// gets a bounding volume hierarchy in its own space, shared by the actors
+// using it; queries place them with the current assembly world transforms.
+//
+// Actors belong to the body of their nearest moving assembly (or the root).
+// Only actors of different bodies are tested, and neither are the two bodies
+// of a single joint, i.e. a moving assembly and the body it hangs from,
+// since those touch by design.
+
+typedef struct ucncCollisionPair {
+  ucncActor *actorA, *actorB;
+  ucncAssembly *assemblyA, *assemblyB;
+  float distance; // 0 when the meshes intersect
+} ucncCollisionPair;
+
+typedef struct ucncCollisionWorld ucncCollisionWorld;
+
+// Collect the actors below root and build the hierarchies of their meshes.
+// Rebuild the world after adding or removing actors.
+ucncCollisionWorld *ucncCollisionWorldNew(ucncAssembly *root);
+void ucncCollisionWorldFree(ucncCollisionWorld *world);
+
+// Find actor pairs that intersect or, with a positive clearance, come closer
+// than that. When moved is given, only pairs with one actor inside its
+// subtree and one outside are tested: that is everything a move of moved can
+// change. Stops after maxPairs pairs (pass 1 for a yes/no answer) and returns
+// the number stored in pairs.
+int ucncCollisionCheck(ucncCollisionWorld *world, const ucncAssembly *moved,
+                       float clearance, ucncCollisionPair *pairs,
+                       int maxPairs);
+// The same after several assemblies moved at once: only pairs whose
+// relative pose any of the moves can change are tested.
+int ucncCollisionCheckMoves(ucncCollisionWorld *world,
+                            const ucncAssembly *const *moved, int movedCount,
+                            float clearance, ucncCollisionPair *pairs,
+                            int maxPairs);
+
+#endif // COLLISION_H
@@ -1,7 +1,70 @@
 #include "config.h"
+#include "bundle.h"
+
+#include <stdatomic.h>
+
+// An <actor> element waiting for its mesh. The strings point into the XML
+// tree, which outlives the load.
+typedef struct {
+  const char *name;
+  const char *assemblyName;
+  const char *stlFile;
+  float colorR, colorG, colorB;
+  ucncActor *actor; // Result, NULL if the actor could not be created
+} ActorJob;
+
+typedef struct {
+  ActorJob *jobs;
+  int count;
+  atomic_int next; // Next job to hand out
+  const char *configDir;
+} ActorLoad;
+
+static void *actorLoadWorker(void *arg) {
+  ActorLoad *load = arg;
+  int i;
+  while ((i = atomic_fetch_add(&load->next, 1)) < load->count) {
+    ActorJob *job = &load->jobs[i];
+    job->actor = ucncActorNew(job->name, job->stlFile, job->colorR,
+                              job->colorG, job->colorB, load->configDir);
+  }
+  return NULL;
+}
+
+// Create every actor of the load, one STL file per worker at a time. The
+// calling thread works too, so a failed thread start only costs parallelism.
+static void loadActors(ActorLoad *load) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = cpus > 0 ? (int)cpus : 1;
+  if (threads > UCNC_MAX_LOAD_THREADS)
+    threads = UCNC_MAX_LOAD_THREADS;
+  if (threads > load->count)
+    threads = load->count;
+
+  pthread_t workers[UCNC_MAX_LOAD_THREADS];
+  int started = 0;
+  for (int i = 1; i < threads; i++) {
+    if (pthread_create(&workers[started], NULL, actorLoadWorker, load) != 0)
+      break;
+    started++;
+  }
+  actorLoadWorker(load);
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+}
 
 int loadConfiguration(const char *filename, ucncAssembly **rootAssembly,
                       ucncLight ***lights, int *lightCount) {
+  char bundleFile[1024];
+  if (ucncBundlePath(filename, bundleFile, sizeof(bundleFile)) &&
+      ucncBundleLoad(bundleFile, filename, rootAssembly, lights, lightCount)) {
+    return 1;
+  }
+  return loadConfigurationXml(filename, rootAssembly, lights, lightCount);
+}
+
+int loadConfigurationXml(const char *filename, ucncAssembly **rootAssembly,
+                         ucncLight ***lights, int *lightCount) {
   FILE *file = fopen(filename, "r");
   if (!file) {
     fprintf(stderr, "Failed to open configuration file '%s'.\n", filename);
@@ -175,7 +238,10 @@ int loadConfiguration(const char *filename, ucncAssembly **rootAssembly,
     }
   }
 
-  // Process actors
+  // Process actors. The STL files are read on a pool of workers; actors are
+  // attached afterwards in document order so the hierarchy does not depend
+  // on which file finished first.
+  ActorLoad load = {NULL, 0, 0, configDir};
   mxml_node_t *actorsNode =
       mxmlFindElement(tree, tree, "actors", NULL, NULL, MXML_DESCEND_ALL);
   if (actorsNode) {
@@ -204,39 +270,54 @@ int loadConfiguration(const char *filename, ucncAssembly **rootAssembly,
         colorB = atof(mxmlElementGetAttr(colorNode, "b"));
       }
 
-      // Create a new actor object
-      ucncActor *actor =
-          ucncActorNew(name, stlFile, colorR, colorG, colorB, configDir);
-      if (!actor) {
-        fprintf(stderr, "Failed to create actor '%s'.\n", name);
+      ActorJob *temp =
+          realloc(load.jobs, (load.count + 1) * sizeof(ActorJob));
+      if (!temp) {
+        fprintf(stderr, "Reallocation failed for actor '%s'.\n", name);
         continue;
       }
+      load.jobs = temp;
+      load.jobs[load.count++] = (ActorJob){name,   assemblyName, stlFile,
+                                           colorR, colorG,       colorB,
+                                           NULL};
+    }
+  }
 
-      // Find the parent assembly by name
-      ucncAssembly *parentAssembly = NULL;
-      for (int i = 0; i < assemblyCount; i++) {
-        if (strcmp(assemblies[i]->name, assemblyName) == 0) {
-          parentAssembly = assemblies[i];
-          break;
-        }
-      }
+  loadActors(&load);
 
-      if (!parentAssembly) {
-        fprintf(stderr, "Parent assembly '%s' not found for actor '%s'.\n",
-                assemblyName, name);
-        ucncActorFree(actor);
-        continue;
-      }
+  for (int j = 0; j < load.count; j++) {
+    ActorJob *job = &load.jobs[j];
+    ucncActor *actor = job->actor;
+    if (!actor) {
+      fprintf(stderr, "Failed to create actor '%s'.\n", job->name);
+      continue;
+    }
 
-      // Add actor to the parent assembly
-      if (!ucncAssemblyAddActor(parentAssembly, actor)) {
-        fprintf(stderr, "Failed to add actor '%s' to assembly '%s'.\n", name,
-                assemblyName);
-        ucncActorFree(actor);
-        continue;
+    // Find the parent assembly by name
+    ucncAssembly *parentAssembly = NULL;
+    for (int i = 0; i < assemblyCount; i++) {
+      if (strcmp(assemblies[i]->name, job->assemblyName) == 0) {
+        parentAssembly = assemblies[i];
+        break;
       }
     }
+
+    if (!parentAssembly) {
+      fprintf(stderr, "Parent assembly '%s' not found for actor '%s'.\n",
+              job->assemblyName, job->name);
+      ucncActorFree(actor);
+      continue;
+    }
+
+    // Add actor to the parent assembly
+    if (!ucncAssemblyAddActor(parentAssembly, actor)) {
+      fprintf(stderr, "Failed to add actor '%s' to assembly '%s'.\n",
+              job->name, job->assemblyName);
+      ucncActorFree(actor);
+      continue;
+    }
   }
+  free(load.jobs);
 
   // Process lights
   // Process <lights> node
@@ -503,5 +584,8 @@ int loadConfiguration(const char *filename, ucncAssembly **rootAssembly,
 
   free(assemblies); // Free the temporary assemblies array after setting the
                     // hierarchy
-  return 1;         // Success
+
+  // Index names and moving axes for fast lookups during motion updates
+  ucncAssemblyBuildIndex(*rootAssembly);
+  return 1; // Success
 }
@@ -11,7 +11,12 @@
 
 #include "mxml/mxml.h"
 
-// Function to load configuration from a tab-delimited file
+#define UCNC_MAX_LOAD_THREADS 8 // Workers reading STL files in parallel
+
+// Load a machine description. An up to date scene bundle next to the file
+// (see bundle.h) is used instead of parsing the XML and STL files.
 int loadConfiguration(const char *filename, ucncAssembly **rootAssembly, ucncLight ***lights, int *lightCount);
+// Always parse the XML file and its STL files
+int loadConfigurationXml(const char *filename, ucncAssembly **rootAssembly, ucncLight ***lights, int *lightCount);
 
 #endif // CONFIG_H
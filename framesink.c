@@ -0,0 +1,237 @@
+/* framesink.c */
+
+#include "framesink.h"
+
+#include <errno.h>
+
+struct ucncFrameSink {
+  int fd;
+  ucncFrameSinkFormat format;
+  int width, height, fps;
+
+  // Ring of frame buffers; count of them, starting at head, are queued
+  PIXEL **frames;
+  int depth, head, count;
+  int closing;
+  int failed;
+  pthread_mutex_t lock;
+  pthread_cond_t queued, freed;
+  pthread_t writer;
+
+  unsigned char *out; // Converted frame, owned by the writer
+  size_t outSize;
+};
+
+static int writeAll(int fd, const unsigned char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    data += written;
+    size -= written;
+  }
+  return 0;
+}
+
+// BT.601 studio range in 8.8 fixed point: luma per pixel, chroma from the
+// sum of each 2x2 block (hence the extra >> 2). An odd last row pairs with
+// itself.
+static void convertYuv420(const PIXEL *restrict src, int w, int h,
+                          unsigned char *restrict y, unsigned char *restrict u,
+                          unsigned char *restrict v) {
+  int cw = w / 2;
+  for (int row = 0; row < h; row++) {
+    const PIXEL *restrict p = src + (size_t)row * w;
+    unsigned char *restrict out = y + (size_t)row * w;
+    for (int x = 0; x < w; x++) {
+      int r = GET_RED(p[x]), g = GET_GREEN(p[x]), b = GET_BLUE(p[x]);
+      out[x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+  }
+
+  // Chroma from the average of each 2x2 block
+  for (int row = 0; row < h; row += 2) {
+    const PIXEL *restrict p0 = src + (size_t)row * w;
+    const PIXEL *restrict p1 = row + 1 < h ? p0 + w : p0;
+    unsigned char *restrict uOut = u + (size_t)(row / 2) * cw;
+    unsigned char *restrict vOut = v + (size_t)(row / 2) * cw;
+    for (int cx = 0; cx < w / 2; cx++) {
+      PIXEL a = p0[2 * cx], b = p0[2 * cx + 1];
+      PIXEL c = p1[2 * cx], d = p1[2 * cx + 1];
+      int r = GET_RED(a) + GET_RED(b) + GET_RED(c) + GET_RED(d);
+      int g = GET_GREEN(a) + GET_GREEN(b) + GET_GREEN(c) + GET_GREEN(d);
+      int bl = GET_BLUE(a) + GET_BLUE(b) + GET_BLUE(c) + GET_BLUE(d);
+      uOut[cx] =
+          (unsigned char)(((-38 * r - 74 * g + 112 * bl + 512) >> 10) + 128);
+      vOut[cx] =
+          (unsigned char)(((112 * r - 94 * g - 18 * bl + 512) >> 10) + 128);
+    }
+  }
+}
+
+static void convertBgra(const PIXEL *restrict src, size_t pixels,
+                        unsigned char *restrict out) {
+  for (size_t i = 0; i < pixels; i++) {
+    out[4 * i + 0] = GET_BLUE(src[i]);
+    out[4 * i + 1] = GET_GREEN(src[i]);
+    out[4 * i + 2] = GET_RED(src[i]);
+    out[4 * i + 3] = 255;
+  }
+}
+
+// Bytes of one converted frame, without the Y4M frame marker
+static size_t frameBytes(ucncFrameSinkFormat format, int w, int h) {
+  size_t pixels = (size_t)w * h;
+  if (format == UCNC_SINK_BGRA)
+    return pixels * 4;
+  return pixels + 2 * (size_t)(w / 2) * ((h + 1) / 2);
+}
+
+static void *sinkWriter(void *arg) {
+  ucncFrameSink *sink = arg;
+  int w = sink->width, h = sink->height;
+  int failed = 0;
+
+  if (sink->format == UCNC_SINK_Y4M) {
+    char header[128];
+    int length = snprintf(header, sizeof(header),
+                          "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h,
+                          sink->fps);
+    failed = writeAll(sink->fd, (const unsigned char *)header, length) != 0;
+  }
+
+  for (;;) {
+    pthread_mutex_lock(&sink->lock);
+    while (sink->count == 0 && !sink->closing)
+      pthread_cond_wait(&sink->queued, &sink->lock);
+    if (sink->count == 0) {
+      pthread_mutex_unlock(&sink->lock);
+      break;
+    }
+    const PIXEL *frame = sink->frames[sink->head];
+    pthread_mutex_unlock(&sink->lock);
+
+    if (!failed) {
+      unsigned char *out = sink->out;
+      if (sink->format == UCNC_SINK_Y4M) {
+        memcpy(out, "FRAME\n", 6);
+        out += 6;
+        size_t lumaSize = (size_t)w * h;
+        size_t chromaSize = (size_t)(w / 2) * ((h + 1) / 2);
+        convertYuv420(frame, w, h, out, out + lumaSize,
+                      out + lumaSize + chromaSize);
+      } else {
+        convertBgra(frame, (size_t)w * h, out);
+      }
+      failed = writeAll(sink->fd, sink->out, sink->outSize) != 0;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    sink->head = (sink->head + 1) % sink->depth;
+    sink->count--;
+    sink->failed = failed;
+    pthread_cond_signal(&sink->freed);
+    pthread_mutex_unlock(&sink->lock);
+  }
+
+  pthread_mutex_lock(&sink->lock);
+  sink->failed = failed;
+  pthread_mutex_unlock(&sink->lock);
+  return NULL;
+}
+
+static void sinkFree(ucncFrameSink *sink) {
+  for (int i = 0; i < sink->depth; i++)
+    free(sink->frames[i]);
+  free(sink->frames);
+  free(sink->out);
+  pthread_mutex_destroy(&sink->lock);
+  pthread_cond_destroy(&sink->queued);
+  pthread_cond_destroy(&sink->freed);
+  free(sink);
+}
+
+ucncFrameSink *ucncFrameSinkNew(int fd, ucncFrameSinkFormat format, int width,
+                                int height, int fps, int queueDepth) {
+  if (fd < 0 || width <= 0 || height <= 0 || fps <= 0 || queueDepth <= 0)
+    return NULL;
+  if (format == UCNC_SINK_Y4M && width % 2 != 0)
+    return NULL; // Chroma pairs columns; framebuffer widths are even anyway
+  ucncFrameSink *sink = calloc(1, sizeof(*sink));
+  if (!sink)
+    return NULL;
+  sink->fd = fd;
+  sink->format = format;
+  sink->width = width;
+  sink->height = height;
+  sink->fps = fps;
+  sink->depth = queueDepth;
+  pthread_mutex_init(&sink->lock, NULL);
+  pthread_cond_init(&sink->queued, NULL);
+  pthread_cond_init(&sink->freed, NULL);
+
+  sink->outSize = frameBytes(format, width, height);
+  if (format == UCNC_SINK_Y4M)
+    sink->outSize += 6; // "FRAME\n"
+  sink->out = malloc(sink->outSize);
+  sink->frames = calloc(queueDepth, sizeof(PIXEL *));
+  int ok = sink->out && sink->frames;
+  for (int i = 0; ok && i < queueDepth; i++) {
+    sink->frames[i] = malloc((size_t)width * height * sizeof(PIXEL));
+    ok = sink->frames[i] != NULL;
+  }
+  if (!ok || pthread_create(&sink->writer, NULL, sinkWriter, sink) != 0) {
+    if (!sink->frames)
+      sink->depth = 0;
+    sinkFree(sink);
+    return NULL;
+  }
+  return sink;
+}
+
+int ucncFrameSinkWrite(ucncFrameSink *sink, const ZBuffer *framebuffer,
+                       int wait) {
+  if (!sink || !framebuffer || framebuffer->xsize != sink->width ||
+      framebuffer->ysize != sink->height)
+    return -1;
+
+  pthread_mutex_lock(&sink->lock);
+  while (sink->count == sink->depth && !sink->failed && wait)
+    pthread_cond_wait(&sink->freed, &sink->lock);
+  int result = sink->failed ? -1 : sink->count == sink->depth ? 1 : 0;
+  PIXEL *frame = sink->frames[(sink->head + sink->count) % sink->depth];
+  pthread_mutex_unlock(&sink->lock);
+  if (result != 0)
+    return result;
+
+  // The writer does not look at this buffer until it is counted in
+  size_t rowBytes = (size_t)sink->width * sizeof(PIXEL);
+  for (int row = 0; row < sink->height; row++)
+    memcpy(frame + (size_t)row * sink->width,
+           (const unsigned char *)framebuffer->pbuf +
+               (size_t)row * framebuffer->linesize,
+           rowBytes);
+
+  pthread_mutex_lock(&sink->lock);
+  sink->count++;
+  pthread_cond_signal(&sink->queued);
+  pthread_mutex_unlock(&sink->lock);
+  return 0;
+}
+
+int ucncFrameSinkClose(ucncFrameSink *sink) {
+  if (!sink)
+    return -1;
+  pthread_mutex_lock(&sink->lock);
+  sink->closing = 1;
+  pthread_cond_signal(&sink->queued);
+  pthread_mutex_unlock(&sink->lock);
+  pthread_join(sink->writer, NULL);
+
+  int result = sink->failed ? -1 : 0;
+  sinkFree(sink);
+  return result;
+}
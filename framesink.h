@@ -0,0 +1,40 @@
+/* framesink.h */
+
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include "cncvis.h"
+
+// Streams rendered frames to a file descriptor (file, pipe or FIFO) for an
+// encoder to consume live, instead of a PNG per frame. A frame is copied
+// into one of a fixed set of preallocated buffers and the call returns; a
+// writer thread converts the buffers in order and writes them out, so
+// rendering never waits for conversion or I/O unless all buffers are
+// queued. Frames come from one thread at a time.
+//
+//   YUV4MPEG2 (4:2:0, BT.601 studio range): ffmpeg -i - / x264 --demuxer y4m
+//   BGRA: 4 bytes per pixel, ffmpeg -f rawvideo -pix_fmt bgra -s WxH -i -
+//
+// Writing to a pipe whose reader went away raises SIGPIPE; ignore it to
+// get an error from the sink instead.
+typedef enum { UCNC_SINK_Y4M, UCNC_SINK_BGRA } ucncFrameSinkFormat;
+
+typedef struct ucncFrameSink ucncFrameSink;
+
+// Frames of width x height at fps frames per second (for the Y4M header),
+// with queueDepth buffers. The descriptor stays open and owned by the
+// caller.
+ucncFrameSink *ucncFrameSinkNew(int fd, ucncFrameSinkFormat format, int width,
+                                int height, int fps, int queueDepth);
+
+// Queue the framebuffer's current image: 0 when queued, 1 when it was
+// dropped because every buffer is queued and wait is 0 (with wait set the
+// call blocks until one frees up), -1 after a write error or for a
+// framebuffer of another size
+int ucncFrameSinkWrite(ucncFrameSink *sink, const ZBuffer *framebuffer,
+                       int wait);
+
+// Write out the queued frames and free the sink; -1 if any write failed
+int ucncFrameSinkClose(ucncFrameSink *sink);
+
+#endif // FRAMESINK_H
@@ -0,0 +1,344 @@
+/* imageexport.c */
+
+#include "imageexport.h"
+
+#include "stb/stb_image_write.h"
+
+#define UCNC_EXPORT_MAX_THREADS 16
+
+typedef enum { IMAGE_PNG, IMAGE_QOI, IMAGE_TGA } ImageFormat;
+
+// One pooled image: pixels copied from the framebuffer, and where they go
+typedef struct {
+  PIXEL *pixels;
+  size_t capacity; // In pixels
+  int width, height;
+  ImageFormat format;
+  char path[1024];
+} ExportSlot;
+
+struct ucncImageExport {
+  ExportSlot *slots;
+  int slotCount;
+  int *freeSlots, freeCount; // Stack of slots available to Save
+  int *queue, head, queued;  // Ring of slots waiting for a worker
+  int busy;                  // Slots being encoded
+  int failed;                // Since the last flush
+  int closing;
+  pthread_mutex_t lock;
+  pthread_cond_t ready, freed, idle;
+  pthread_t threads[UCNC_EXPORT_MAX_THREADS];
+  int threadCount;
+};
+
+void ucncPixelsToRgb(const PIXEL *restrict pixels, size_t count,
+                     unsigned char *restrict rgb, int bgr) {
+  int r = bgr ? 2 : 0, b = bgr ? 0 : 2;
+  for (size_t i = 0; i < count; i++) {
+    rgb[3 * i + r] = GET_RED(pixels[i]);
+    rgb[3 * i + 1] = GET_GREEN(pixels[i]);
+    rgb[3 * i + b] = GET_BLUE(pixels[i]);
+  }
+}
+
+static int formatFromPath(const char *path, ImageFormat *format) {
+  const char *dot = strrchr(path, '.');
+  if (!dot)
+    return 0;
+  if (strcmp(dot, ".png") == 0)
+    *format = IMAGE_PNG;
+  else if (strcmp(dot, ".qoi") == 0)
+    *format = IMAGE_QOI;
+  else if (strcmp(dot, ".tga") == 0)
+    *format = IMAGE_TGA;
+  else
+    return 0;
+  return 1;
+}
+
+static void putBigEndian32(unsigned char *out, unsigned value) {
+  out[0] = value >> 24;
+  out[1] = value >> 16;
+  out[2] = value >> 8;
+  out[3] = value;
+}
+
+// QOI (qoiformat.org), 3 channels: runs, a 64-entry hash of recent colors,
+// and small deltas against the previous pixel. out needs 14 + 4 * count + 8
+// bytes at most; returns the bytes used.
+static size_t encodeQoi(const unsigned char *rgb, int w, int h,
+                        unsigned char *out) {
+  unsigned char seen[64][3], used[64] = {0}; // Decoders start with 0 alpha
+  unsigned char prev[3] = {0, 0, 0};
+  size_t n = 0, count = (size_t)w * h;
+  int run = 0;
+
+  memcpy(out, "qoif", 4);
+  putBigEndian32(out + 4, w);
+  putBigEndian32(out + 8, h);
+  out[12] = 3; // RGB
+  out[13] = 0; // sRGB with linear alpha
+  n = 14;
+
+  for (size_t i = 0; i < count; i++) {
+    const unsigned char *px = rgb + 3 * i;
+    if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2]) {
+      if (++run == 62 || i + 1 == count) {
+        out[n++] = 0xc0 | (run - 1);
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      out[n++] = 0xc0 | (run - 1);
+      run = 0;
+    }
+
+    int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+    if (used[hash] && seen[hash][0] == px[0] && seen[hash][1] == px[1] &&
+        seen[hash][2] == px[2]) {
+      out[n++] = hash;
+    } else {
+      memcpy(seen[hash], px, 3);
+      used[hash] = 1;
+      signed char dr = px[0] - prev[0], dg = px[1] - prev[1],
+                  db = px[2] - prev[2];
+      signed char drg = dr - dg, dbg = db - dg;
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+        out[n++] = 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+      } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 &&
+                 dbg >= -8 && dbg <= 7) {
+        out[n++] = 0x80 | (dg + 32);
+        out[n++] = (drg + 8) << 4 | (dbg + 8);
+      } else {
+        out[n++] = 0xfe;
+        memcpy(out + n, px, 3);
+        n += 3;
+      }
+    }
+    memcpy(prev, px, 3);
+  }
+
+  static const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  memcpy(out + n, end, sizeof(end));
+  return n + sizeof(end);
+}
+
+static int writeFile(const char *path, const unsigned char *data,
+                     size_t size) {
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return 0;
+  int ok = fwrite(data, 1, size, file) == size;
+  return fclose(file) == 0 && ok;
+}
+
+// Convert and write one slot; scratch grows as needed. 1 on success.
+static int encodeSlot(const ExportSlot *slot, unsigned char **scratch,
+                      size_t *scratchSize) {
+  int w = slot->width, h = slot->height;
+  size_t count = (size_t)w * h;
+  size_t header = 18;                             // TGA
+  size_t need = 3 * count + header;
+  if (slot->format == IMAGE_QOI)
+    need = 3 * count + 14 + 4 * count + 8; // RGB, then the encoded image
+  if (need > *scratchSize) {
+    unsigned char *grown = realloc(*scratch, need);
+    if (!grown)
+      return 0;
+    *scratch = grown;
+    *scratchSize = need;
+  }
+  unsigned char *buffer = *scratch;
+
+  switch (slot->format) {
+  case IMAGE_PNG:
+    ucncPixelsToRgb(slot->pixels, count, buffer, 0);
+    return stbi_write_png(slot->path, w, h, 3, buffer, w * 3);
+  case IMAGE_QOI: {
+    ucncPixelsToRgb(slot->pixels, count, buffer, 0);
+    unsigned char *out = buffer + 3 * count;
+    return writeFile(slot->path, out, encodeQoi(buffer, w, h, out));
+  }
+  case IMAGE_TGA:
+  default:
+    memset(buffer, 0, header);
+    buffer[2] = 2; // Uncompressed true color
+    buffer[12] = w & 0xff;
+    buffer[13] = w >> 8;
+    buffer[14] = h & 0xff;
+    buffer[15] = h >> 8;
+    buffer[16] = 24;   // Bits per pixel
+    buffer[17] = 0x20; // Top-left origin, as the framebuffer
+    ucncPixelsToRgb(slot->pixels, count, buffer + header, 1);
+    return writeFile(slot->path, buffer, header + 3 * count);
+  }
+}
+
+static void *exportWorker(void *arg) {
+  ucncImageExport *exporter = arg;
+  unsigned char *scratch = NULL;
+  size_t scratchSize = 0;
+
+  pthread_mutex_lock(&exporter->lock);
+  for (;;) {
+    while (exporter->queued == 0 && !exporter->closing)
+      pthread_cond_wait(&exporter->ready, &exporter->lock);
+    if (exporter->queued == 0)
+      break;
+    int s = exporter->queue[exporter->head];
+    exporter->head = (exporter->head + 1) % exporter->slotCount;
+    exporter->queued--;
+    exporter->busy++;
+    pthread_mutex_unlock(&exporter->lock);
+
+    int ok = encodeSlot(&exporter->slots[s], &scratch, &scratchSize);
+    if (!ok)
+      fprintf(stderr, "Failed to write image to %s\n",
+              exporter->slots[s].path);
+
+    pthread_mutex_lock(&exporter->lock);
+    exporter->failed += !ok;
+    exporter->busy--;
+    exporter->freeSlots[exporter->freeCount++] = s;
+    pthread_cond_signal(&exporter->freed);
+    if (exporter->queued == 0 && exporter->busy == 0)
+      pthread_cond_broadcast(&exporter->idle);
+  }
+  pthread_mutex_unlock(&exporter->lock);
+  free(scratch);
+  return NULL;
+}
+
+ucncImageExport *ucncImageExportNew(const ucncImageExportOptions *options) {
+  ucncImageExportOptions o = {0};
+  if (options)
+    o = *options;
+  if (o.threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    o.threads = cpus > 0 ? (int)cpus : 1;
+  }
+  if (o.threads > UCNC_EXPORT_MAX_THREADS)
+    o.threads = UCNC_EXPORT_MAX_THREADS;
+  if (o.buffers <= 0)
+    o.buffers = 2 * o.threads;
+  stbi_write_png_compression_level =
+      o.pngLevel > 0 ? (o.pngLevel < 9 ? o.pngLevel : 9) : 8;
+  stbi_write_force_png_filter =
+      o.pngFilter >= UCNC_PNG_FILTER_NONE && o.pngFilter <= UCNC_PNG_FILTER_PAETH
+          ? o.pngFilter - UCNC_PNG_FILTER_NONE
+          : -1;
+
+  ucncImageExport *exporter = calloc(1, sizeof(*exporter));
+  if (!exporter)
+    return NULL;
+  exporter->slots = calloc(o.buffers, sizeof(ExportSlot));
+  exporter->freeSlots = malloc(o.buffers * sizeof(int));
+  exporter->queue = malloc(o.buffers * sizeof(int));
+  if (!exporter->slots || !exporter->freeSlots || !exporter->queue) {
+    free(exporter->slots);
+    free(exporter->freeSlots);
+    free(exporter->queue);
+    free(exporter);
+    return NULL;
+  }
+  exporter->slotCount = o.buffers;
+  for (int i = 0; i < o.buffers; i++)
+    exporter->freeSlots[exporter->freeCount++] = i;
+  pthread_mutex_init(&exporter->lock, NULL);
+  pthread_cond_init(&exporter->ready, NULL);
+  pthread_cond_init(&exporter->freed, NULL);
+  pthread_cond_init(&exporter->idle, NULL);
+
+  for (int i = 0; i < o.threads; i++) {
+    if (pthread_create(&exporter->threads[exporter->threadCount], NULL,
+                       exportWorker, exporter) != 0)
+      break;
+    exporter->threadCount++;
+  }
+  if (exporter->threadCount == 0) {
+    ucncImageExportFree(exporter);
+    return NULL;
+  }
+  return exporter;
+}
+
+void ucncImageExportFree(ucncImageExport *exporter) {
+  if (!exporter)
+    return;
+  pthread_mutex_lock(&exporter->lock);
+  exporter->closing = 1; // Workers drain the queue before they leave
+  pthread_cond_broadcast(&exporter->ready);
+  pthread_mutex_unlock(&exporter->lock);
+  for (int i = 0; i < exporter->threadCount; i++)
+    pthread_join(exporter->threads[i], NULL);
+
+  for (int i = 0; i < exporter->slotCount; i++)
+    free(exporter->slots[i].pixels);
+  free(exporter->slots);
+  free(exporter->freeSlots);
+  free(exporter->queue);
+  pthread_mutex_destroy(&exporter->lock);
+  pthread_cond_destroy(&exporter->ready);
+  pthread_cond_destroy(&exporter->freed);
+  pthread_cond_destroy(&exporter->idle);
+  free(exporter);
+}
+
+int ucncImageExportSave(ucncImageExport *exporter, const ZBuffer *framebuffer,
+                        const char *path) {
+  ImageFormat format;
+  if (!exporter || !framebuffer || !path || !formatFromPath(path, &format) ||
+      strlen(path) >= sizeof(((ExportSlot *)0)->path))
+    return -1;
+
+  pthread_mutex_lock(&exporter->lock);
+  while (exporter->freeCount == 0)
+    pthread_cond_wait(&exporter->freed, &exporter->lock);
+  int s = exporter->freeSlots[--exporter->freeCount];
+  pthread_mutex_unlock(&exporter->lock);
+
+  // The slot is ours until it is queued
+  ExportSlot *slot = &exporter->slots[s];
+  int w = framebuffer->xsize, h = framebuffer->ysize;
+  if ((size_t)w * h > slot->capacity) {
+    PIXEL *grown = realloc(slot->pixels, (size_t)w * h * sizeof(PIXEL));
+    if (!grown) {
+      pthread_mutex_lock(&exporter->lock);
+      exporter->freeSlots[exporter->freeCount++] = s;
+      pthread_mutex_unlock(&exporter->lock);
+      return -1;
+    }
+    slot->pixels = grown;
+    slot->capacity = (size_t)w * h;
+  }
+  for (int y = 0; y < h; y++)
+    memcpy(slot->pixels + (size_t)y * w,
+           (const unsigned char *)framebuffer->pbuf +
+               (size_t)y * framebuffer->linesize,
+           w * sizeof(PIXEL));
+  slot->width = w;
+  slot->height = h;
+  slot->format = format;
+  snprintf(slot->path, sizeof(slot->path), "%s", path);
+
+  pthread_mutex_lock(&exporter->lock);
+  exporter->queue[(exporter->head + exporter->queued) % exporter->slotCount] =
+      s;
+  exporter->queued++;
+  pthread_cond_signal(&exporter->ready);
+  pthread_mutex_unlock(&exporter->lock);
+  return 0;
+}
+
+int ucncImageExportFlush(ucncImageExport *exporter) {
+  if (!exporter)
+    return 0;
+  pthread_mutex_lock(&exporter->lock);
+  while (exporter->queued > 0 || exporter->busy > 0)
+    pthread_cond_wait(&exporter->idle, &exporter->lock);
+  int failed = exporter->failed;
+  exporter->failed = 0;
+  pthread_mutex_unlock(&exporter->lock);
+  return failed;
+}
@@ -0,0 +1,52 @@
+/* imageexport.h */
+
+#ifndef IMAGEEXPORT_H
+#define IMAGEEXPORT_H
+
+#include "cncvis.h"
+
+// Saves framebuffer images on worker threads while the next frame renders.
+// A save copies the framebuffer into one of a pool of buffers, reused from
+// image to image, and queues it; the workers convert and encode. The format
+// follows the file extension:
+//
+//   .png  zlib compressed, level and filter as configured
+//   .qoi  "Quite OK Image" format, lossless and several times faster
+//   .tga  uncompressed, for capture where only write speed matters
+typedef struct ucncImageExport ucncImageExport;
+
+// PNG row filters to force instead of trying all five on every row
+#define UCNC_PNG_FILTER_NONE 1
+#define UCNC_PNG_FILTER_SUB 2
+#define UCNC_PNG_FILTER_UP 3
+#define UCNC_PNG_FILTER_AVERAGE 4
+#define UCNC_PNG_FILTER_PAETH 5
+
+// Zero fields take the defaults
+typedef struct {
+  int threads;   // Encoder threads; 0 for one per core
+  int buffers;   // Images queued at most; 0 for two per thread
+  int pngLevel;  // zlib level 1 (fastest) to 9; 0 for 8
+  int pngFilter; // UCNC_PNG_FILTER_*; 0 to choose per row
+} ucncImageExportOptions;
+
+// The PNG settings are process-wide, as stb_image_write keeps them: they
+// also apply to saveFramebufferAsImage and other exporters.
+ucncImageExport *ucncImageExportNew(const ucncImageExportOptions *options);
+// Waits for the queued images first
+void ucncImageExportFree(ucncImageExport *exporter);
+
+// Queue the framebuffer's current image for path. Blocks only while every
+// buffer is queued. -1 for an unknown extension.
+int ucncImageExportSave(ucncImageExport *exporter, const ZBuffer *framebuffer,
+                        const char *path);
+// Wait until every queued image is written; returns the number of images
+// that failed since the last flush
+int ucncImageExportFlush(ucncImageExport *exporter);
+
+// 8-bit RGB (or BGR) bytes of count pixels, 3 * count bytes; in RGB565 each
+// channel's top bits are repeated so full intensity becomes 255
+void ucncPixelsToRgb(const PIXEL *restrict pixels, size_t count,
+                     unsigned char *restrict rgb, int bgr);
+
+#endif // IMAGEEXPORT_H
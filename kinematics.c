@@ -0,0 +1,377 @@
+/* kinematics.c */
+
+#include "kinematics.h"
+
+#define LANES UCNC_KINEMATICS_LANES
+
+// A node's world transform is parent * pre * R(joint) * post for rotational
+// joints, parent * T(joint along the axis) * pre for linear ones, and
+// parent * pre for fixed assemblies. Matrices on lanes are 3x4 affine,
+// stored column by column, one array of LANES values per element.
+enum { NODE_FIXED, NODE_LINEAR, NODE_ROTATIONAL };
+
+typedef struct {
+  ucncAssembly *assembly;
+  int parent; // Node index, -1 for the root
+  int joint;  // Index into the joint vector, -1 if not driven
+  int kind;
+  int axis;   // 0..2 for X..Z
+  int varies; // Differs between joint vectors (driven or below a driven node)
+  float pre[16], post[16];
+  int postIdentity;
+} KinematicsNode;
+
+struct ucncKinematics {
+  KinematicsNode *nodes;
+  int nodeCount;
+  int *targets; // Node of each target
+  int targetCount;
+  int axisCount;
+  float *lanes; // 12 * LANES values per node
+};
+
+static float *nodeLanes(ucncKinematics *kinematics, int node) {
+  return kinematics->lanes + (size_t)node * 12 * LANES;
+}
+
+// === Compilation ===
+
+static int axisIndex(char axis) {
+  switch (axis) {
+  case AXIS_X:
+    return 0;
+  case AXIS_Y:
+    return 1;
+  case AXIS_Z:
+    return 2;
+  default:
+    return -1;
+  }
+}
+
+// Node for the assembly, adding it and its ancestors as needed
+static int addChain(ucncKinematics *kinematics, ucncAssembly *root,
+                    ucncAssembly *assembly) {
+  for (int i = 0; i < kinematics->nodeCount; i++) {
+    if (kinematics->nodes[i].assembly == assembly)
+      return i;
+  }
+  int parent = -1;
+  if (assembly != root) {
+    if (!assembly->parent)
+      return -1; // Not below the root
+    parent = addChain(kinematics, root, assembly->parent);
+    if (parent < 0)
+      return -1;
+  }
+  KinematicsNode *nodes =
+      realloc(kinematics->nodes,
+              (kinematics->nodeCount + 1) * sizeof(KinematicsNode));
+  if (!nodes)
+    return -1;
+  kinematics->nodes = nodes;
+  KinematicsNode *node = &nodes[kinematics->nodeCount];
+  memset(node, 0, sizeof(*node));
+  node->assembly = assembly;
+  node->parent = parent;
+  node->joint = -1;
+  return kinematics->nodeCount++;
+}
+
+ucncKinematics *ucncKinematicsNew(ucncAssembly *root,
+                                  const char *const *axisNames, int axisCount,
+                                  const char *const *targetNames,
+                                  int targetCount) {
+  if (!root || axisCount < 0 || (axisCount > 0 && !axisNames) ||
+      targetCount <= 0 || !targetNames)
+    return NULL;
+  ucncKinematics *kinematics = calloc(1, sizeof(ucncKinematics));
+  if (!kinematics ||
+      !(kinematics->targets = malloc(targetCount * sizeof(int)))) {
+    fprintf(stderr, "Memory allocation failed for kinematics.\n");
+    free(kinematics);
+    return NULL;
+  }
+  kinematics->targetCount = targetCount;
+  kinematics->axisCount = axisCount;
+
+  for (int t = 0; t < targetCount; t++) {
+    ucncAssembly *target = findAssemblyByName(root, targetNames[t]);
+    kinematics->targets[t] =
+        target ? addChain(kinematics, root, target) : -1;
+    if (kinematics->targets[t] < 0) {
+      fprintf(stderr, "Kinematics target '%s' not found.\n", targetNames[t]);
+      ucncKinematicsFree(kinematics);
+      return NULL;
+    }
+  }
+
+  for (int a = 0; a < axisCount; a++) {
+    ucncAssembly *axis = findAssemblyByName(root, axisNames[a]);
+    if (!axis || axis->motionType == UCNC_MOTION_NONE ||
+        axisIndex(axis->motionAxis) < 0) {
+      fprintf(stderr, "Assembly '%s' is not a motion axis.\n", axisNames[a]);
+      ucncKinematicsFree(kinematics);
+      return NULL;
+    }
+    for (int i = 0; i < kinematics->nodeCount; i++) {
+      KinematicsNode *node = &kinematics->nodes[i];
+      if (node->assembly != axis)
+        continue;
+      node->joint = a;
+      node->axis = axisIndex(axis->motionAxis);
+      node->kind = axis->motionType == UCNC_MOTION_LINEAR ? NODE_LINEAR
+                                                          : NODE_ROTATIONAL;
+    }
+  }
+  for (int i = 0; i < kinematics->nodeCount; i++) {
+    KinematicsNode *node = &kinematics->nodes[i];
+    node->varies = node->joint >= 0 ||
+                   (node->parent >= 0 && kinematics->nodes[node->parent].varies);
+  }
+
+  kinematics->lanes =
+      malloc((size_t)kinematics->nodeCount * 12 * LANES * sizeof(float));
+  if (!kinematics->lanes) {
+    fprintf(stderr, "Memory allocation failed for kinematics.\n");
+    ucncKinematicsFree(kinematics);
+    return NULL;
+  }
+  return kinematics;
+}
+
+void ucncKinematicsFree(ucncKinematics *kinematics) {
+  if (!kinematics)
+    return;
+  free(kinematics->nodes);
+  free(kinematics->targets);
+  free(kinematics->lanes);
+  free(kinematics);
+}
+
+// === Evaluation ===
+
+// Split each node's current pose around its joint, and broadcast the world
+// transforms that do not depend on the joints
+static void prepare(ucncKinematics *kinematics) {
+  float m[16];
+  for (int i = 0; i < kinematics->nodeCount; i++) {
+    KinematicsNode *node = &kinematics->nodes[i];
+    const ucncAssembly *a = node->assembly;
+    float p[3] = {a->positionX, a->positionY, a->positionZ};
+    float o[3] = {a->originX, a->originY, a->originZ};
+    float r[3] = {a->rotationX, a->rotationY, a->rotationZ};
+    ucncMatrixIdentity(node->post);
+    node->postIdentity = 1;
+    if (node->kind == NODE_LINEAR) {
+      p[node->axis] = 0.0f;
+      ucncMatrixFromPose(node->pre, p[0], p[1], p[2], o[0], o[1], o[2], r[0],
+                         r[1], r[2]);
+    } else if (node->kind == NODE_ROTATIONAL) {
+      // R = Rx * Ry * Rz: the rotations before the joint's go to pre, those
+      // after it to post
+      float before[3] = {0.0f, 0.0f, 0.0f}, after[3] = {0.0f, 0.0f, 0.0f};
+      for (int k = 0; k < 3; k++) {
+        if (k < node->axis)
+          before[k] = r[k];
+        else if (k > node->axis)
+          after[k] = r[k];
+      }
+      ucncMatrixFromPose(node->pre, p[0] + o[0], p[1] + o[1], p[2] + o[2],
+                         0.0f, 0.0f, 0.0f, before[0], before[1], before[2]);
+      ucncMatrixFromPose(node->post, -o[0], -o[1], -o[2], o[0], o[1], o[2],
+                         after[0], after[1], after[2]);
+      node->postIdentity = ucncMatrixIsIdentity(node->post);
+    } else {
+      ucncMatrixFromPose(node->pre, p[0], p[1], p[2], o[0], o[1], o[2], r[0],
+                         r[1], r[2]);
+    }
+
+    if (node->varies)
+      continue;
+    if (node->parent >= 0) {
+      // Read the parent's transform back from its lanes
+      const float *parent = nodeLanes(kinematics, node->parent);
+      float pm[16];
+      ucncMatrixIdentity(pm);
+      for (int c = 0; c < 4; c++) {
+        for (int row = 0; row < 3; row++)
+          pm[c * 4 + row] = parent[(c * 3 + row) * LANES];
+      }
+      ucncMatrixMultiply(m, pm, node->pre);
+    } else {
+      memcpy(m, node->pre, sizeof(node->pre));
+    }
+    float *lanes = nodeLanes(kinematics, i);
+    for (int c = 0; c < 4; c++) {
+      for (int row = 0; row < 3; row++) {
+        for (int l = 0; l < LANES; l++)
+          lanes[(c * 3 + row) * LANES + l] = m[c * 4 + row];
+      }
+    }
+  }
+}
+
+// Sine and cosine of angles in degrees, reduced to a quarter turn exactly in
+// degrees. The quadrant picks and negates through selects rather than
+// branches, so each lane runs the same instructions and the loop over LANES
+// vectorises; the other per-lane loops here rely on the same rule.
+static void sinCosDegrees(const float *degrees, float *s, float *c) {
+  const float toRad = (float)M_PI / 180.0f;
+  for (int l = 0; l < LANES; l++) {
+    float d = degrees[l];
+    int q = (int)(d * (1.0f / 90.0f) + (d >= 0.0f ? 0.5f : -0.5f));
+    float x = (d - (float)q * 90.0f) * toRad, x2 = x * x;
+    float sx = x * (1.0f + x2 * (-1.0f / 6.0f +
+                                 x2 * (1.0f / 120.0f +
+                                       x2 * (-1.0f / 5040.0f +
+                                             x2 * (1.0f / 362880.0f)))));
+    float cx = 1.0f + x2 * (-0.5f +
+                            x2 * (1.0f / 24.0f +
+                                  x2 * (-1.0f / 720.0f +
+                                        x2 * (1.0f / 40320.0f))));
+    float sv = (q & 1) ? cx : sx, cv = (q & 1) ? sx : cx;
+    s[l] = (q & 2) ? -sv : sv;
+    c[l] = ((q + 1) & 2) ? -cv : cv;
+  }
+}
+
+// out = m * k for lanes m and a constant affine k (out must not alias m)
+static void mulConst(float *restrict out, const float *restrict m,
+                     const float *k) {
+  for (int c = 0; c < 4; c++) {
+    for (int row = 0; row < 3; row++) {
+      float *restrict o = &out[(c * 3 + row) * LANES];
+      const float *m0 = &m[row * LANES], *m1 = &m[(3 + row) * LANES];
+      const float *m2 = &m[(6 + row) * LANES];
+      float k0 = k[c * 4], k1 = k[c * 4 + 1], k2 = k[c * 4 + 2];
+      if (c < 3) {
+        for (int l = 0; l < LANES; l++)
+          o[l] = m0[l] * k0 + m1[l] * k1 + m2[l] * k2;
+      } else {
+        const float *m3 = &m[(9 + row) * LANES];
+        for (int l = 0; l < LANES; l++)
+          o[l] = m0[l] * k0 + m1[l] * k1 + m2[l] * k2 + m3[l];
+      }
+    }
+  }
+}
+
+// Columns (a, b) become (c a + s b, c b - s a)
+static void mixColumns(float *restrict a, float *restrict b,
+                       const float *restrict s, const float *restrict c,
+                       float sign) {
+  for (int l = 0; l < LANES; l++) {
+    float va = a[l], vb = b[l], sl = sign * s[l];
+    a[l] = c[l] * va + sl * vb;
+    b[l] = c[l] * vb - sl * va;
+  }
+}
+
+// m = m * R(axis, angle): mixes two of the rotation columns, with the sine
+// negated for Ry, whose sine sits below the diagonal in the first column
+static void rotate(float *m, int axis, const float *s, const float *c) {
+  int a = axis == 0 ? 1 : 0, b = axis == 2 ? 1 : 2;
+  float sign = axis == 1 ? -1.0f : 1.0f;
+  for (int row = 0; row < 3; row++)
+    mixColumns(&m[(a * 3 + row) * LANES], &m[(b * 3 + row) * LANES], s, c,
+               sign);
+}
+
+// World transforms of the driven nodes for joint vectors first..first+LANES
+static void solveBlock(ucncKinematics *kinematics, const float *joints,
+                       int count, int first) {
+  static const float identity[12] = {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0};
+  float scratch[12 * LANES], theta[LANES], s[LANES], c[LANES];
+  int n = count - first < LANES ? count - first : LANES;
+  for (int i = 0; i < kinematics->nodeCount; i++) {
+    const KinematicsNode *node = &kinematics->nodes[i];
+    if (!node->varies)
+      continue;
+    float *w = nodeLanes(kinematics, i);
+    if (node->parent >= 0) {
+      memcpy(w, nodeLanes(kinematics, node->parent),
+             12 * LANES * sizeof(float));
+    } else {
+      for (int e = 0; e < 12; e++) {
+        for (int l = 0; l < LANES; l++)
+          w[e * LANES + l] = identity[e];
+      }
+    }
+
+    if (node->joint >= 0) {
+      const float *values = &joints[(size_t)node->joint * count + first];
+      float sign = node->assembly->invertMotion ? -1.0f : 1.0f;
+      memset(theta, 0, sizeof(theta));
+      for (int l = 0; l < n; l++)
+        theta[l] = sign * values[l];
+    }
+    if (node->kind == NODE_LINEAR) {
+      for (int row = 0; row < 3; row++) {
+        float *t = &w[(9 + row) * LANES];
+        const float *dir = &w[(node->axis * 3 + row) * LANES];
+        for (int l = 0; l < LANES; l++)
+          t[l] += theta[l] * dir[l];
+      }
+    }
+    mulConst(scratch, w, node->pre);
+    memcpy(w, scratch, sizeof(scratch));
+    if (node->kind == NODE_ROTATIONAL) {
+      sinCosDegrees(theta, s, c);
+      rotate(w, node->axis, s, c);
+      if (!node->postIdentity) {
+        mulConst(scratch, w, node->post);
+        memcpy(w, scratch, sizeof(scratch));
+      }
+    }
+  }
+}
+
+int ucncKinematicsSolve(ucncKinematics *kinematics, const float *joints,
+                        float (*worldMatrices)[16]) {
+  if (!kinematics || (!joints && kinematics->axisCount > 0) || !worldMatrices)
+    return -1;
+  prepare(kinematics);
+  solveBlock(kinematics, joints, 1, 0);
+  for (int t = 0; t < kinematics->targetCount; t++) {
+    const float *w = nodeLanes(kinematics, kinematics->targets[t]);
+    float *m = worldMatrices[t];
+    for (int col = 0; col < 4; col++) {
+      for (int row = 0; row < 3; row++)
+        m[col * 4 + row] = w[(col * 3 + row) * LANES];
+      m[col * 4 + 3] = col == 3 ? 1.0f : 0.0f;
+    }
+  }
+  return 0;
+}
+
+int ucncKinematicsSolveBatch(ucncKinematics *kinematics, const float *joints,
+                             int count, float *tcp, float *axes) {
+  if (!kinematics || (!joints && kinematics->axisCount > 0) || count < 0 ||
+      !tcp)
+    return -1;
+  prepare(kinematics);
+  float out[3][LANES];
+  for (int first = 0; first < count; first += LANES) {
+    solveBlock(kinematics, joints, count, first);
+    int n = count - first < LANES ? count - first : LANES;
+    for (int t = 0; t < kinematics->targetCount; t++) {
+      int node = kinematics->targets[t];
+      const ucncAssembly *a = kinematics->nodes[node].assembly;
+      const float *w = nodeLanes(kinematics, node);
+      for (int row = 0; row < 3; row++) {
+        const float *c0 = &w[row * LANES], *c1 = &w[(3 + row) * LANES];
+        const float *c2 = &w[(6 + row) * LANES], *c3 = &w[(9 + row) * LANES];
+        for (int l = 0; l < LANES; l++)
+          out[row][l] = c0[l] * a->originX + c1[l] * a->originY +
+                        c2[l] * a->originZ + c3[l];
+        memcpy(&tcp[(size_t)(t * 3 + row) * count + first], out[row],
+               n * sizeof(float));
+        if (axes)
+          memcpy(&axes[(size_t)(t * 3 + row) * count + first], c2,
+                 n * sizeof(float));
+      }
+    }
+  }
+  return 0;
+}
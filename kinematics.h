@@ -0,0 +1,42 @@
+/* kinematics.h */
+
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include "assembly.h"
+
+#define UCNC_KINEMATICS_LANES 16 // Joint vectors evaluated side by side
+
+// Forward kinematics over the assembly tree, without the GL matrix stack or
+// the assemblies' cached matrices. A solver is compiled for a list of axes
+// (the joint vector) and a list of target assemblies, keeping only the
+// chains from the root to the targets. Joint values are absolute axis
+// positions as taken by ucncSetMotion; every other pose field is read from
+// the assemblies at each solve, so jogging an axis that is not in the joint
+// vector is picked up without recompiling.
+//
+// A target's tool center point is its origin (the pivot it rotates about),
+// the same point stock simulation follows; its tool axis is its +z.
+typedef struct ucncKinematics ucncKinematics;
+
+// NULL if an axis or target is not found or an axis does not move. The
+// solver keeps pointers into the tree: free it before the scene.
+ucncKinematics *ucncKinematicsNew(ucncAssembly *root,
+                                  const char *const *axisNames, int axisCount,
+                                  const char *const *targetNames,
+                                  int targetCount);
+void ucncKinematicsFree(ucncKinematics *kinematics);
+
+// World matrices (column-major, as ucncAssemblyGetWorldMatrix) of every
+// target for one joint vector
+int ucncKinematicsSolve(ucncKinematics *kinematics, const float *joints,
+                        float (*worldMatrices)[16]);
+
+// Tool center points of every target for count joint vectors, structure of
+// arrays: joint a of vector i is joints[a * count + i], and coordinate k of
+// target t is tcp[(t * 3 + k) * count + i]. axes, laid out like tcp, receives
+// the unit tool axes when not NULL.
+int ucncKinematicsSolveBatch(ucncKinematics *kinematics, const float *joints,
+                             int count, float *tcp, float *axes);
+
+#endif // KINEMATICS_H
@@ -370,6 +370,110 @@ enum stlioError stlioReadFileMem(
 
 
 
+/*
+	=============================
+	Mapped binary reader (float)
+	=============================
+
+	Zero copy path for binary STL files. stlioMapBinaryFile
+	maps the file read-only and validates the header: the
+	file has to be exactly 84 bytes plus 50 bytes per
+	triangle announced in the header, and must not read as
+	ASCII ("solid" followed by a "facet" line, as the
+	streaming reader checks). No triangle is
+	decoded at this point, so the caller can size its own
+	buffers from dwTriangleCount.
+
+	stlioDecodeBinaryFloat then converts a range of the
+	mapped triangles into caller provided arrays - 9 floats
+	per triangle (three vertices) into lpVertices and 3
+	floats per triangle (the surface normal) into lpNormals.
+	Disjoint ranges can be decoded by several threads at
+	once. Attribute bytes are skipped and normals are taken
+	as stored (no validation as done by the streaming
+	parser).
+
+	ASCII files as well as pipes and other unmappable
+	sources are rejected (stlioE_InvalidFormat or an I/O
+	error) - use the streaming functions above for them.
+*/
+struct stlioMappedFile {
+	const unsigned char*		lpData;				/* Whole file */
+	unsigned long int			dwSize;				/* Size of the mapping in bytes */
+	unsigned long int			dwTriangleCount;	/* Triangles announced (and present) in the file */
+};
+
+enum stlioError stlioMapBinaryFile(
+	const char*					lpFilename,
+	struct stlioMappedFile*		lpOut
+);
+enum stlioError stlioDecodeBinaryFloat(
+	const struct stlioMappedFile*	lpFile,
+	unsigned long int			dwFirstTriangle,
+	unsigned long int			dwTriangleCount,
+	float*						lpVertices,
+	float*						lpNormals
+);
+void stlioUnmapFile(
+	struct stlioMappedFile*		lpFile
+);
+
+/*
+	=============================
+	Chunked ASCII reader (float)
+	=============================
+
+	Fast path for large ASCII STL files. stlioMapFile maps
+	any regular file without looking at its contents
+	(dwTriangleCount stays 0). stlioSplitASCII divides the
+	mapping into at most dwMaxChunks byte ranges that each
+	start at a "facet" keyword (the first one starts at the
+	beginning of the file and also covers "solid"), so the
+	chunks can be parsed independently - for example one
+	per thread - with stlioParseASCIIChunk. Concatenating
+	the chunk results in order yields the triangles of the
+	whole file.
+
+	stlioParseASCIIChunk allocates the chunk's float arrays
+	(9 vertex and 3 normal floats per triangle) and uses a
+	locale independent number parser. On failure eError,
+	dwErrorLine and dwErrorChar describe the first problem
+	(line numbers relative to the whole file, starting
+	at 1). Vertex normals and triangle shapes are not
+	validated as done by the streaming parser.
+*/
+struct stlioASCIIChunk {
+	unsigned long int			dwBegin;			/* Byte range inside the mapping */
+	unsigned long int			dwEnd;
+
+	float*						lpVertices;			/* Results of stlioParseASCIIChunk */
+	float*						lpNormals;
+	unsigned long int			dwTriangleCount;
+
+	enum stlioError				eError;
+	unsigned long int			dwErrorLine;
+	unsigned long int			dwErrorChar;
+};
+
+enum stlioError stlioMapFile(
+	const char*					lpFilename,
+	struct stlioMappedFile*		lpOut
+);
+unsigned long int stlioSplitASCII(
+	const struct stlioMappedFile*	lpFile,
+	unsigned long int			dwMaxChunks,
+	struct stlioASCIIChunk*		lpChunks
+);
+enum stlioError stlioParseASCIIChunk(
+	const struct stlioMappedFile*	lpFile,
+	struct stlioASCIIChunk*		lpChunk
+);
+void stlioFreeASCIIChunk(
+	struct stlioASCIIChunk*		lpChunk
+);
+
+
+
 
 /*
 	=============
@@ -0,0 +1,518 @@
+/*
+	Readers working on mapped files
+
+	Binary files are decoded from the packed 50 byte triangle
+	records straight into float arrays; ASCII files are split
+	at facet boundaries so the pieces can be parsed in
+	parallel. Kept apart from stlio.c because it needs POSIX
+	mmap; on Windows the file is read into a heap buffer
+	instead.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+#include "../include/stlio.h"
+
+#define STLIO_BINARY_HEADER_SIZE		84		/* 80 bytes comment, 4 bytes triangle count */
+#define STLIO_BINARY_RECORD_SIZE		50		/* 12 floats, 2 bytes attribute count */
+#define STLIO_ASCII_BYTES_PER_FACET		256		/* Rough size of one facet, used to size buffers */
+
+typedef char stlioMapped__FloatIsBinary32[(sizeof(float) == 4) ? 1 : -1];
+
+static int stlioMapped__HostIsLittleEndian(void) {
+	const uint32_t dwProbe = 1;
+	return (*((const unsigned char*)&dwProbe) == 1) ? 1 : 0;
+}
+
+static uint32_t stlioMapped__ReadU32LE(const unsigned char* lpData) {
+	return ((uint32_t)lpData[0]) | (((uint32_t)lpData[1]) << 8) | (((uint32_t)lpData[2]) << 16) | (((uint32_t)lpData[3]) << 24);
+}
+
+static enum stlioError stlioMapped__ErrnoToError(int iErrno) {
+	switch(iErrno) {
+		case EACCES:		return stlioE_PermissionDenied;
+		case ENOMEM:		return stlioE_OutOfMemory;
+		case ENOENT:		return stlioE_FileNotfound;
+		default:			return stlioE_IOError;
+	}
+}
+
+#ifndef _WIN32
+	static enum stlioError stlioMapped__Map(const char* lpFilename, void** lpMappingOut, struct stat* lpStat) {
+		int hFile;
+		void* lpMapping;
+
+		hFile = open(lpFilename, O_RDONLY);
+		if(hFile < 0) { return stlioMapped__ErrnoToError(errno); }
+		if(fstat(hFile, lpStat) != 0) { close(hFile); return stlioE_IOError; }
+		if(!S_ISREG(lpStat->st_mode) || (lpStat->st_size < STLIO_BINARY_HEADER_SIZE)) { close(hFile); return stlioE_InvalidFormat; }
+
+		lpMapping = mmap(NULL, (size_t)lpStat->st_size, PROT_READ, MAP_PRIVATE, hFile, 0);
+		close(hFile);
+		if(lpMapping == MAP_FAILED) { return stlioMapped__ErrnoToError(errno); }
+		(*lpMappingOut) = lpMapping;
+		return stlioE_Ok;
+	}
+	static void stlioMapped__Unmap(void* lpMapping, size_t dwSize) {
+		munmap(lpMapping, dwSize);
+	}
+#else
+	static enum stlioError stlioMapped__Map(const char* lpFilename, void** lpMappingOut, struct stat* lpStat) {
+		FILE* fHandle;
+		void* lpBuffer;
+
+		if(stat(lpFilename, lpStat) != 0) { return stlioMapped__ErrnoToError(errno); }
+		if(!S_ISREG(lpStat->st_mode) || (lpStat->st_size < STLIO_BINARY_HEADER_SIZE)) { return stlioE_InvalidFormat; }
+
+		fHandle = fopen(lpFilename, "rb");
+		if(!fHandle) { return stlioMapped__ErrnoToError(errno); }
+		lpBuffer = malloc((size_t)lpStat->st_size);
+		if(lpBuffer == NULL) { fclose(fHandle); return stlioE_OutOfMemory; }
+		if(fread(lpBuffer, (size_t)lpStat->st_size, 1, fHandle) != 1) { free(lpBuffer); fclose(fHandle); return stlioE_IOError; }
+		fclose(fHandle);
+		(*lpMappingOut) = lpBuffer;
+		return stlioE_Ok;
+	}
+	static void stlioMapped__Unmap(void* lpMapping, size_t dwSize) {
+		(void)dwSize;
+		free(lpMapping);
+	}
+#endif
+
+/*
+	Binary headers may start with "solid" as well; an ASCII file also
+	has a "facet" (or, when empty, "endsolid") line after it
+*/
+static int stlioMapped__LooksASCII(const unsigned char* lpData, size_t dwSize) {
+	size_t i;
+
+	if((dwSize < 5) || (memcmp(lpData, "solid", 5) != 0)) { return 0; }
+	for(i = 5; (i < dwSize) && (lpData[i] != '\n'); i=i+1) { }
+	while((i < dwSize) && ((lpData[i] == ' ') || (lpData[i] == '\t') || (lpData[i] == '\r') || (lpData[i] == '\n'))) { i = i + 1; }
+	if((i + 5 <= dwSize) && (memcmp(lpData + i, "facet", 5) == 0)) { return 1; }
+	if((i + 8 <= dwSize) && (memcmp(lpData + i, "endsolid", 8) == 0)) { return 1; }
+	return 0;
+}
+
+enum stlioError stlioMapBinaryFile(
+	const char*					lpFilename,
+	struct stlioMappedFile*		lpOut
+) {
+	enum stlioError e;
+	struct stat sStat;
+	void* lpMapping;
+	uint32_t dwCount;
+
+	if((lpFilename == NULL) || (lpOut == NULL)) { return stlioE_InvalidParam; }
+	lpOut->lpData = NULL;
+	lpOut->dwSize = 0;
+	lpOut->dwTriangleCount = 0;
+
+	lpMapping = NULL;
+	e = stlioMapped__Map(lpFilename, &lpMapping, &sStat);
+	if(e != stlioE_Ok) { return e; }
+
+	/*
+		The announced count has to match the file size exactly, which
+		nearly always rejects ASCII files already. One that matches by
+		chance is still caught by its "solid" and "facet" lines, like the
+		streaming reader does
+	*/
+	dwCount = stlioMapped__ReadU32LE((const unsigned char*)lpMapping + 80);
+	if((((uint64_t)sStat.st_size - STLIO_BINARY_HEADER_SIZE) != ((uint64_t)dwCount * STLIO_BINARY_RECORD_SIZE))
+		|| stlioMapped__LooksASCII((const unsigned char*)lpMapping, (size_t)sStat.st_size)) {
+		stlioMapped__Unmap(lpMapping, (size_t)sStat.st_size);
+		return stlioE_InvalidFormat;
+	}
+
+	/* Triangles are read front to back exactly once */
+	#if !defined(_WIN32) && defined(POSIX_MADV_SEQUENTIAL)
+		posix_madvise(lpMapping, (size_t)sStat.st_size, POSIX_MADV_SEQUENTIAL);
+	#endif
+
+	lpOut->lpData = (const unsigned char*)lpMapping;
+	lpOut->dwSize = (unsigned long int)sStat.st_size;
+	lpOut->dwTriangleCount = (unsigned long int)dwCount;
+	return stlioE_Ok;
+}
+
+enum stlioError stlioDecodeBinaryFloat(
+	const struct stlioMappedFile*	lpFile,
+	unsigned long int			dwFirstTriangle,
+	unsigned long int			dwTriangleCount,
+	float*						lpVertices,
+	float*						lpNormals
+) {
+	const unsigned char* lpRecord;
+	unsigned long int i;
+	unsigned long int j;
+	uint32_t dwWord;
+
+	if((lpFile == NULL) || (lpFile->lpData == NULL) || (lpVertices == NULL) || (lpNormals == NULL)) { return stlioE_InvalidParam; }
+	if((dwFirstTriangle > lpFile->dwTriangleCount) || (dwTriangleCount > lpFile->dwTriangleCount - dwFirstTriangle)) { return stlioE_InvalidParam; }
+
+	lpRecord = lpFile->lpData + STLIO_BINARY_HEADER_SIZE + (size_t)dwFirstTriangle * STLIO_BINARY_RECORD_SIZE;
+
+	if(stlioMapped__HostIsLittleEndian()) {
+		/*
+			Records are packed IEEE 754 little endian floats; fixed size
+			copies let the compiler turn this into a few vector moves
+			per triangle without any alignment requirement
+		*/
+		for(i = 0; i < dwTriangleCount; i=i+1) {
+			memcpy(&(lpNormals[i*3]), lpRecord, 3 * sizeof(float));
+			memcpy(&(lpVertices[i*9]), lpRecord + 3 * sizeof(float), 9 * sizeof(float));
+			lpRecord = lpRecord + STLIO_BINARY_RECORD_SIZE;
+		}
+	} else {
+		for(i = 0; i < dwTriangleCount; i=i+1) {
+			for(j = 0; j < 12; j=j+1) {
+				dwWord = stlioMapped__ReadU32LE(lpRecord + j * 4);
+				if(j < 3) {
+					memcpy(&(lpNormals[i*3+j]), &dwWord, sizeof(float));
+				} else {
+					memcpy(&(lpVertices[i*9+j-3]), &dwWord, sizeof(float));
+				}
+			}
+			lpRecord = lpRecord + STLIO_BINARY_RECORD_SIZE;
+		}
+	}
+	return stlioE_Ok;
+}
+
+void stlioUnmapFile(
+	struct stlioMappedFile*		lpFile
+) {
+	if((lpFile == NULL) || (lpFile->lpData == NULL)) { return; }
+	stlioMapped__Unmap((void*)(lpFile->lpData), (size_t)lpFile->dwSize);
+	lpFile->lpData = NULL;
+	lpFile->dwSize = 0;
+	lpFile->dwTriangleCount = 0;
+}
+
+/*
+	==================
+	Chunked ASCII path
+	==================
+*/
+
+enum stlioError stlioMapFile(
+	const char*					lpFilename,
+	struct stlioMappedFile*		lpOut
+) {
+	enum stlioError e;
+	struct stat sStat;
+	void* lpMapping;
+
+	if((lpFilename == NULL) || (lpOut == NULL)) { return stlioE_InvalidParam; }
+	lpOut->lpData = NULL;
+	lpOut->dwSize = 0;
+	lpOut->dwTriangleCount = 0;
+
+	lpMapping = NULL;
+	e = stlioMapped__Map(lpFilename, &lpMapping, &sStat);
+	if(e != stlioE_Ok) { return e; }
+
+	lpOut->lpData = (const unsigned char*)lpMapping;
+	lpOut->dwSize = (unsigned long int)sStat.st_size;
+	return stlioE_Ok;
+}
+
+static int stlioASCIIFast__IsSpace(unsigned char c) {
+	return ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '\f') || (c == '\v')) ? 1 : 0;
+}
+
+/* Position of the next "facet" keyword at or after dwFrom (not "endfacet"), dwSize if there is none */
+static unsigned long int stlioASCIIFast__FindFacet(
+	const unsigned char*		lpData,
+	unsigned long int			dwSize,
+	unsigned long int			dwFrom
+) {
+	const unsigned char* lpHit;
+
+	while(dwFrom + 5 <= dwSize) {
+		lpHit = (const unsigned char*)memchr(lpData + dwFrom, 'f', dwSize - dwFrom);
+		if(lpHit == NULL) { break; }
+		dwFrom = (unsigned long int)(lpHit - lpData);
+		if((dwFrom + 5 <= dwSize) && (memcmp(lpHit, "facet", 5) == 0)
+			&& ((dwFrom == 0) || stlioASCIIFast__IsSpace(lpHit[-1]))
+			&& ((dwFrom + 5 == dwSize) || stlioASCIIFast__IsSpace(lpHit[5]))) {
+			return dwFrom;
+		}
+		dwFrom = dwFrom + 1;
+	}
+	return dwSize;
+}
+
+unsigned long int stlioSplitASCII(
+	const struct stlioMappedFile*	lpFile,
+	unsigned long int			dwMaxChunks,
+	struct stlioASCIIChunk*		lpChunks
+) {
+	unsigned long int dwCount;
+	unsigned long int dwFirstLineEnd;
+	unsigned long int dwTarget;
+	unsigned long int dwSplit;
+	unsigned long int i;
+	const unsigned char* lpNewline;
+
+	if((lpFile == NULL) || (lpFile->lpData == NULL) || (lpChunks == NULL) || (dwMaxChunks == 0)) { return 0; }
+
+	memset(lpChunks, 0, sizeof(struct stlioASCIIChunk) * dwMaxChunks);
+
+	/* Never split inside the "solid" line - its name may contain anything */
+	lpNewline = (const unsigned char*)memchr(lpFile->lpData, '\n', lpFile->dwSize);
+	dwFirstLineEnd = (lpNewline == NULL) ? lpFile->dwSize : (unsigned long int)(lpNewline - lpFile->lpData);
+
+	dwCount = 1;
+	lpChunks[0].dwBegin = 0;
+	for(i = 1; i < dwMaxChunks; i=i+1) {
+		dwTarget = (unsigned long int)(((uint64_t)lpFile->dwSize * i) / dwMaxChunks);
+		if(dwTarget < dwFirstLineEnd) { dwTarget = dwFirstLineEnd; }
+		if(dwTarget <= lpChunks[dwCount-1].dwBegin) { continue; }
+
+		dwSplit = stlioASCIIFast__FindFacet(lpFile->lpData, lpFile->dwSize, dwTarget);
+		if(dwSplit >= lpFile->dwSize) { break; }
+
+		lpChunks[dwCount-1].dwEnd = dwSplit;
+		lpChunks[dwCount].dwBegin = dwSplit;
+		dwCount = dwCount + 1;
+	}
+	lpChunks[dwCount-1].dwEnd = lpFile->dwSize;
+	return dwCount;
+}
+
+struct stlioASCIIFast__Cursor {
+	const unsigned char*		lpPos;
+	const unsigned char*		lpEnd;
+};
+
+static void stlioASCIIFast__SkipSpace(struct stlioASCIIFast__Cursor* lpCur) {
+	while((lpCur->lpPos < lpCur->lpEnd) && stlioASCIIFast__IsSpace(*(lpCur->lpPos))) { lpCur->lpPos = lpCur->lpPos + 1; }
+}
+
+static void stlioASCIIFast__SkipLine(struct stlioASCIIFast__Cursor* lpCur) {
+	while((lpCur->lpPos < lpCur->lpEnd) && (*(lpCur->lpPos) != '\n')) { lpCur->lpPos = lpCur->lpPos + 1; }
+}
+
+/* Consume the keyword if it is the next token */
+static int stlioASCIIFast__Keyword(struct stlioASCIIFast__Cursor* lpCur, const char* lpKeyword) {
+	size_t dwLen;
+
+	stlioASCIIFast__SkipSpace(lpCur);
+	dwLen = strlen(lpKeyword);
+	if((size_t)(lpCur->lpEnd - lpCur->lpPos) < dwLen) { return 0; }
+	if(memcmp(lpCur->lpPos, lpKeyword, dwLen) != 0) { return 0; }
+	if((lpCur->lpPos + dwLen < lpCur->lpEnd) && !stlioASCIIFast__IsSpace(lpCur->lpPos[dwLen])) { return 0; }
+	lpCur->lpPos = lpCur->lpPos + dwLen;
+	return 1;
+}
+
+/*
+	Decimal number parser. Up to 18 significant digits are
+	collected into an integer and scaled by an exact power of
+	ten in double precision, which is correctly rounded for
+	all numbers CAD exporters produce and far more precise
+	than the float result. Does not depend on the locale.
+*/
+static const double stlioASCIIFast__Pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int stlioASCIIFast__Float(struct stlioASCIIFast__Cursor* lpCur, float* lpOut) {
+	const unsigned char* p;
+	const unsigned char* lpEnd;
+	uint64_t qwMantissa;
+	int iExp10;
+	int iExponent;
+	int bNegative;
+	int bNegativeExponent;
+	int bDigits;
+	double dValue;
+
+	stlioASCIIFast__SkipSpace(lpCur);
+	p = lpCur->lpPos;
+	lpEnd = lpCur->lpEnd;
+
+	bNegative = 0;
+	if((p < lpEnd) && ((*p == '-') || (*p == '+'))) { bNegative = (*p == '-'); p = p + 1; }
+
+	qwMantissa = 0;
+	iExp10 = 0;
+	bDigits = 0;
+	while((p < lpEnd) && (*p >= '0') && (*p <= '9')) {
+		if(qwMantissa < 100000000000000000ull) { qwMantissa = qwMantissa * 10 + (uint64_t)(*p - '0'); } else { iExp10 = iExp10 + 1; }
+		bDigits = 1;
+		p = p + 1;
+	}
+	if((p < lpEnd) && (*p == '.')) {
+		p = p + 1;
+		while((p < lpEnd) && (*p >= '0') && (*p <= '9')) {
+			if(qwMantissa < 100000000000000000ull) { qwMantissa = qwMantissa * 10 + (uint64_t)(*p - '0'); iExp10 = iExp10 - 1; }
+			bDigits = 1;
+			p = p + 1;
+		}
+	}
+	if(!bDigits) { return 0; }
+
+	if((p < lpEnd) && ((*p == 'e') || (*p == 'E'))) {
+		p = p + 1;
+		bNegativeExponent = 0;
+		if((p < lpEnd) && ((*p == '-') || (*p == '+'))) { bNegativeExponent = (*p == '-'); p = p + 1; }
+		if((p >= lpEnd) || (*p < '0') || (*p > '9')) { return 0; }
+		iExponent = 0;
+		while((p < lpEnd) && (*p >= '0') && (*p <= '9')) {
+			if(iExponent < 10000) { iExponent = iExponent * 10 + (*p - '0'); }
+			p = p + 1;
+		}
+		iExp10 = bNegativeExponent ? (iExp10 - iExponent) : (iExp10 + iExponent);
+	}
+	if((p < lpEnd) && !stlioASCIIFast__IsSpace(*p)) { return 0; }
+
+	dValue = (double)qwMantissa;
+	if(qwMantissa != 0) {
+		if((iExp10 >= 0) && (iExp10 <= 22)) {
+			dValue = dValue * stlioASCIIFast__Pow10[iExp10];
+		} else if((iExp10 < 0) && (iExp10 >= -22)) {
+			dValue = dValue / stlioASCIIFast__Pow10[-iExp10];
+		} else {
+			dValue = dValue * pow(10.0, (double)iExp10);
+		}
+	}
+
+	(*lpOut) = (float)(bNegative ? -dValue : dValue);
+	lpCur->lpPos = p;
+	return 1;
+}
+
+static enum stlioError stlioASCIIFast__Grow(struct stlioASCIIChunk* lpChunk, unsigned long int* lpCapacity) {
+	unsigned long int dwCapacity;
+	float* lpVertices;
+	float* lpNormals;
+
+	dwCapacity = (*lpCapacity) * 2 + 16;
+	lpVertices = (float*)realloc(lpChunk->lpVertices, sizeof(float) * 9 * dwCapacity);
+	if(lpVertices == NULL) { return stlioE_OutOfMemory; }
+	lpChunk->lpVertices = lpVertices;
+	lpNormals = (float*)realloc(lpChunk->lpNormals, sizeof(float) * 3 * dwCapacity);
+	if(lpNormals == NULL) { return stlioE_OutOfMemory; }
+	lpChunk->lpNormals = lpNormals;
+	(*lpCapacity) = dwCapacity;
+	return stlioE_Ok;
+}
+
+static enum stlioError stlioASCIIFast__Fail(
+	const struct stlioMappedFile*	lpFile,
+	struct stlioASCIIChunk*		lpChunk,
+	const unsigned char*		lpPos,
+	enum stlioError				eCode
+) {
+	const unsigned char* lpLineStart;
+	const unsigned char* p;
+	unsigned long int dwLine;
+
+	/* Line numbers are only needed here, so count them on demand */
+	dwLine = 1;
+	lpLineStart = lpFile->lpData;
+	for(p = lpFile->lpData; p < lpPos; p = p + 1) {
+		if(*p == '\n') { dwLine = dwLine + 1; lpLineStart = p + 1; }
+	}
+
+	lpChunk->eError = eCode;
+	lpChunk->dwErrorLine = dwLine;
+	lpChunk->dwErrorChar = (unsigned long int)(lpPos - lpLineStart) + 1;
+	return eCode;
+}
+
+enum stlioError stlioParseASCIIChunk(
+	const struct stlioMappedFile*	lpFile,
+	struct stlioASCIIChunk*		lpChunk
+) {
+	struct stlioASCIIFast__Cursor cur;
+	unsigned long int dwCapacity;
+	unsigned long int i;
+	float* lpV;
+	float* lpN;
+	enum stlioError e;
+
+	if((lpFile == NULL) || (lpFile->lpData == NULL) || (lpChunk == NULL)) { return stlioE_InvalidParam; }
+	if((lpChunk->dwBegin > lpChunk->dwEnd) || (lpChunk->dwEnd > lpFile->dwSize)) { return stlioE_InvalidParam; }
+
+	lpChunk->lpVertices = NULL;
+	lpChunk->lpNormals = NULL;
+	lpChunk->dwTriangleCount = 0;
+	lpChunk->eError = stlioE_Ok;
+	lpChunk->dwErrorLine = 0;
+	lpChunk->dwErrorChar = 0;
+
+	cur.lpPos = lpFile->lpData + lpChunk->dwBegin;
+	cur.lpEnd = lpFile->lpData + lpChunk->dwEnd;
+
+	/* Start with room for about the expected number of facets */
+	dwCapacity = (lpChunk->dwEnd - lpChunk->dwBegin) / (2 * STLIO_ASCII_BYTES_PER_FACET);
+	e = stlioASCIIFast__Grow(lpChunk, &dwCapacity);
+	if(e != stlioE_Ok) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, e); }
+
+	if(lpChunk->dwBegin == 0) {
+		if(!stlioASCIIFast__Keyword(&cur, "solid")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Solid); }
+		stlioASCIIFast__SkipLine(&cur);
+	}
+
+	for(;;) {
+		stlioASCIIFast__SkipSpace(&cur);
+		if(cur.lpPos >= cur.lpEnd) { break; }
+
+		/* Files may hold several solids */
+		if(stlioASCIIFast__Keyword(&cur, "endsolid") || stlioASCIIFast__Keyword(&cur, "solid")) {
+			stlioASCIIFast__SkipLine(&cur);
+			continue;
+		}
+		if(!stlioASCIIFast__Keyword(&cur, "facet")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Facet); }
+
+		if(lpChunk->dwTriangleCount == dwCapacity) {
+			e = stlioASCIIFast__Grow(lpChunk, &dwCapacity);
+			if(e != stlioE_Ok) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, e); }
+		}
+		lpV = &(lpChunk->lpVertices[lpChunk->dwTriangleCount * 9]);
+		lpN = &(lpChunk->lpNormals[lpChunk->dwTriangleCount * 3]);
+
+		if(!stlioASCIIFast__Keyword(&cur, "normal")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Normal); }
+		for(i = 0; i < 3; i=i+1) {
+			if(!stlioASCIIFast__Float(&cur, &(lpN[i]))) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_NotAFloat); }
+		}
+		if(!stlioASCIIFast__Keyword(&cur, "outer")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Outer); }
+		if(!stlioASCIIFast__Keyword(&cur, "loop")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Loop); }
+		for(i = 0; i < 9; i=i+1) {
+			if(((i % 3) == 0) && !stlioASCIIFast__Keyword(&cur, "vertex")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Vertex); }
+			if(!stlioASCIIFast__Float(&cur, &(lpV[i]))) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_NotAFloat); }
+		}
+		if(!stlioASCIIFast__Keyword(&cur, "endloop")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Endloop); }
+		if(!stlioASCIIFast__Keyword(&cur, "endfacet")) { return stlioASCIIFast__Fail(lpFile, lpChunk, cur.lpPos, stlioE_InvalidFormat_Expect_Endfacet); }
+
+		lpChunk->dwTriangleCount = lpChunk->dwTriangleCount + 1;
+	}
+	return stlioE_Ok;
+}
+
+void stlioFreeASCIIChunk(
+	struct stlioASCIIChunk*		lpChunk
+) {
+	if(lpChunk == NULL) { return; }
+	free(lpChunk->lpVertices);
+	free(lpChunk->lpNormals);
+	lpChunk->lpVertices = NULL;
+	lpChunk->lpNormals = NULL;
+	lpChunk->dwTriangleCount = 0;
+}
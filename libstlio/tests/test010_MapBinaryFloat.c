@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/stlio.h"
+
+/*
+	An ASCII file whose size happens to match the triangle count
+	its bytes 80..83 announce has to be rejected all the same, while
+	a binary header that merely starts with "solid" is fine
+*/
+static int checkSolidHeaders(void) {
+	static const char lpASCII[] = "solid fake\nfacet normal 0 0 1\n";
+	static const char lpBinary[] = "solid exported as binary";
+	const char* lpFilename = "test010_solid.stl";
+	unsigned char bFile[84 + 50];
+	struct stlioMappedFile mapped;
+	enum stlioError eASCII;
+	enum stlioError eBinary;
+	FILE* fHandle;
+
+	memset(bFile, ' ', sizeof(bFile));
+	memcpy(bFile, lpASCII, sizeof(lpASCII) - 1);
+	bFile[80] = 1; bFile[81] = 0; bFile[82] = 0; bFile[83] = 0;
+	if((fHandle = fopen(lpFilename, "wb")) == NULL) { return 1; }
+	fwrite(bFile, 1, sizeof(bFile), fHandle);
+	fclose(fHandle);
+	eASCII = stlioMapBinaryFile(lpFilename, &mapped);
+	if(eASCII == stlioE_Ok) { stlioUnmapFile(&mapped); }
+
+	memset(bFile, 0, sizeof(bFile));
+	memcpy(bFile, lpBinary, sizeof(lpBinary) - 1);
+	bFile[80] = 1;
+	if((fHandle = fopen(lpFilename, "wb")) == NULL) { return 1; }
+	fwrite(bFile, 1, sizeof(bFile), fHandle);
+	fclose(fHandle);
+	eBinary = stlioMapBinaryFile(lpFilename, &mapped);
+	if(eBinary == stlioE_Ok) { stlioUnmapFile(&mapped); }
+	remove(lpFilename);
+
+	printf("ASCII look-alike: %s, solid binary header: %s\n", stlioErrorStringC(eASCII), stlioErrorStringC(eBinary));
+	return ((eASCII == stlioE_InvalidFormat) && (eBinary == stlioE_Ok)) ? 0 : 1;
+}
+
+/*
+	Decodes a binary STL file through the mapped float reader
+	and compares every triangle against the streaming reader
+*/
+int main(int argc, char* argv[]) {
+	union {
+		struct stlTriangle* lpTri;
+		unsigned char* lpBuff;
+	} buf;
+	struct stlTriangle* lpTriangle;
+	struct stlioMappedFile mapped;
+	unsigned long int dwTriCount;
+	unsigned long int dwStride;
+	unsigned long int dwMismatches;
+	unsigned long int i;
+	unsigned long int j;
+	float* lpVertices;
+	float* lpNormals;
+	enum stlioError e;
+	enum stlFileType fType;
+
+	if(argc < 2) {
+		printf("Missing filename\n");
+		return -1;
+	}
+	if(checkSolidHeaders() != 0) { return 1; }
+
+	e = stlioMapBinaryFile(argv[1], &mapped);
+	printf("Map returned %s (%u)\n", stlioErrorStringC(e), e);
+	if(e != stlioE_Ok) { return 1; }
+	printf("Mapped %lu bytes, %lu triangles\n", mapped.dwSize, mapped.dwTriangleCount);
+
+	lpVertices = (float*)malloc(sizeof(float) * 9 * (mapped.dwTriangleCount + 1));
+	lpNormals = (float*)malloc(sizeof(float) * 3 * (mapped.dwTriangleCount + 1));
+	if((lpVertices == NULL) || (lpNormals == NULL)) { printf("Out of memory\n"); return 1; }
+
+	/* Decode in two halves to exercise ranges */
+	e = stlioDecodeBinaryFloat(&mapped, 0, mapped.dwTriangleCount / 2, lpVertices, lpNormals);
+	if(e == stlioE_Ok) {
+		e = stlioDecodeBinaryFloat(&mapped, mapped.dwTriangleCount / 2, mapped.dwTriangleCount - mapped.dwTriangleCount / 2, &(lpVertices[(mapped.dwTriangleCount / 2) * 9]), &(lpNormals[(mapped.dwTriangleCount / 2) * 3]));
+	}
+	printf("Decode returned %s (%u)\n", stlioErrorStringC(e), e);
+	if(e != stlioE_Ok) { return 1; }
+	if(stlioDecodeBinaryFloat(&mapped, 1, mapped.dwTriangleCount, lpVertices, lpNormals) != stlioE_InvalidParam) {
+		printf("Out of range decode has not been rejected\n");
+		return 1;
+	}
+
+	e = stlioReadFileMem(argv[1], &(buf.lpTri), &dwTriCount, &dwStride, NULL, NULL, &fType);
+	if((e != stlioE_Ok) || (dwTriCount != mapped.dwTriangleCount)) {
+		printf("Streaming reader disagrees: %s, %lu triangles\n", stlioErrorStringC(e), dwTriCount);
+		return 1;
+	}
+
+	dwMismatches = 0;
+	for(i = 0; i < dwTriCount; i=i+1) {
+		lpTriangle = (struct stlTriangle*)((uintptr_t)(buf.lpBuff) + dwStride*i);
+		for(j = 0; j < 9; j=j+1) {
+			if(lpVertices[i*9+j] != (float)lpTriangle->vertices[j/3][j%3]) { dwMismatches = dwMismatches + 1; }
+		}
+		for(j = 0; j < 3; j=j+1) {
+			if(lpNormals[i*3+j] != (float)lpTriangle->surfaceNormal[j]) { dwMismatches = dwMismatches + 1; }
+		}
+	}
+	printf("%lu mismatching values\n", dwMismatches);
+
+	free(buf.lpBuff);
+	free(lpVertices);
+	free(lpNormals);
+	stlioUnmapFile(&mapped);
+	return (dwMismatches == 0) ? 0 : 1;
+}
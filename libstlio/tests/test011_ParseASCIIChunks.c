@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../include/stlio.h"
+
+#define MAX_CHUNKS 8
+
+/*
+	Parses an ASCII STL file in chunks and compares every
+	triangle against the streaming reader
+*/
+int main(int argc, char* argv[]) {
+	union {
+		struct stlTriangle* lpTri;
+		unsigned char* lpBuff;
+	} buf;
+	struct stlTriangle* lpTriangle;
+	struct stlioMappedFile mapped;
+	struct stlioASCIIChunk chunks[MAX_CHUNKS];
+	unsigned long int dwChunks;
+	unsigned long int dwTriCount;
+	unsigned long int dwStride;
+	unsigned long int dwMismatches;
+	unsigned long int dwIndex;
+	unsigned long int c;
+	unsigned long int i;
+	unsigned long int j;
+	enum stlioError e;
+	enum stlFileType fType;
+
+	if(argc < 2) {
+		printf("Missing filename\n");
+		return -1;
+	}
+
+	e = stlioMapFile(argv[1], &mapped);
+	printf("Map returned %s (%u)\n", stlioErrorStringC(e), e);
+	if(e != stlioE_Ok) { return 1; }
+
+	dwChunks = stlioSplitASCII(&mapped, MAX_CHUNKS, chunks);
+	printf("Split %lu bytes into %lu chunks\n", mapped.dwSize, dwChunks);
+	for(c = 0; c < dwChunks; c=c+1) {
+		e = stlioParseASCIIChunk(&mapped, &(chunks[c]));
+		printf("Chunk %lu [%lu, %lu): %s, %lu triangles\n", c, chunks[c].dwBegin, chunks[c].dwEnd, stlioErrorStringC(e), chunks[c].dwTriangleCount);
+		if(e != stlioE_Ok) {
+			printf("Error at line %lu:%lu\n", chunks[c].dwErrorLine, chunks[c].dwErrorChar);
+			return 1;
+		}
+	}
+
+	e = stlioReadFileMem(argv[1], &(buf.lpTri), &dwTriCount, &dwStride, NULL, NULL, &fType);
+	if(e != stlioE_Ok) {
+		printf("Streaming reader failed: %s\n", stlioErrorStringC(e));
+		return 1;
+	}
+
+	dwMismatches = 0;
+	dwIndex = 0;
+	for(c = 0; c < dwChunks; c=c+1) {
+		for(i = 0; (i < chunks[c].dwTriangleCount) && (dwIndex < dwTriCount); i=i+1, dwIndex=dwIndex+1) {
+			lpTriangle = (struct stlTriangle*)((uintptr_t)(buf.lpBuff) + dwStride*dwIndex);
+			for(j = 0; j < 9; j=j+1) {
+				if(chunks[c].lpVertices[i*9+j] != (float)lpTriangle->vertices[j/3][j%3]) { dwMismatches = dwMismatches + 1; }
+			}
+			for(j = 0; j < 3; j=j+1) {
+				if(chunks[c].lpNormals[i*3+j] != (float)lpTriangle->surfaceNormal[j]) { dwMismatches = dwMismatches + 1; }
+			}
+		}
+		stlioFreeASCIIChunk(&(chunks[c]));
+	}
+	printf("%lu of %lu triangles compared, %lu mismatching values\n", dwIndex, dwTriCount, dwMismatches);
+
+	free(buf.lpBuff);
+	stlioUnmapFile(&mapped);
+	return ((dwMismatches == 0) && (dwIndex == dwTriCount)) ? 0 : 1;
+}
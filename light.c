@@ -2,6 +2,8 @@
 
 #include "light.h"
 
+#include <stdatomic.h>
+
 // Implementation of ucncLightNew, ucncLightAdd, ucncLightSet, ucncLightFree
 
 // Function to create a new light
@@ -56,9 +58,16 @@ ucncLight* ucncLightNew(GLenum lightId, float posX, float posY, float posZ,
     return light;
 }
 
+static atomic_ulong gLightGeneration; // Shared by every instance
+
+unsigned long ucncLightGeneration(void) {
+    return gLightGeneration;
+}
+
 // Function to add (enable and set) a light in OpenGL
 void ucncLightAdd(ucncLight *light) {
     if (!light) return;
+    gLightGeneration++;
 
     // Enable the specific light
     glEnable(light->lightId);
@@ -85,6 +94,7 @@ void ucncLightAdd(ucncLight *light) {
 // Function to set/update a light's parameters
 void ucncLightSet(ucncLight *light) {
     if (!light) return;
+    gLightGeneration++;
 
     // Update light parameters
     glLightfv(light->lightId, GL_POSITION, light->position);
@@ -109,6 +119,7 @@ void ucncLightSet(ucncLight *light) {
 // Function to free a light
 void ucncLightFree(ucncLight *light) {
     if (light) {
+        gLightGeneration++;
         free(light);
     }
 }
@@ -47,4 +47,8 @@ void freeAllLights(ucncLight ***lights, int lightCount);
 
 void printLightHierarchy(ucncLight **lights, int lightCount, int level);
 
+// Incremented whenever light parameters are pushed to GL or lights are freed,
+// so cached renders can tell that lighting changed
+unsigned long ucncLightGeneration(void);
+
 #endif // LIGHT_H
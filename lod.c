@@ -0,0 +1,684 @@
+/* lod.c */
+
+#define _DEFAULT_SOURCE // mkstemp and fdopen with -std=c11
+
+#include "lod.h"
+
+#include <float.h>
+#include <sys/stat.h>
+
+// Mesh simplification by greedy quadric error metric (Garland & Heckbert)
+// edge collapse. STL files are triangle soups, so vertices are welded by
+// exact position first; every level is a snapshot of the same collapse run.
+
+#define LOD_BOUNDARY_WEIGHT 100.0   // Penalty for moving vertices off open borders
+#define LOD_CACHE_MAGIC "UCNCLOD1"
+
+typedef struct {
+    double q[10];                   // Symmetric 4x4: aa ab ac ad bb bc bd cc cd dd
+} LodQuadric;
+
+typedef struct {
+    double cost;
+    float target[3];
+    int v0, v1;
+    unsigned int stamp0, stamp1;
+} LodEdge;
+
+typedef struct {
+    int *faces;
+    int count, capacity;
+} LodAdjacency;
+
+typedef struct {
+    int vertexCount;
+    float (*positions)[3];
+    LodQuadric *quadrics;
+    unsigned int *stamps;
+    unsigned char *vertexAlive;
+    int *marks;
+    LodAdjacency *adjacency;
+
+    int faceCount;
+    int aliveFaces;
+    int (*faces)[3];
+    unsigned char *faceAlive;
+
+    LodEdge *heap;
+    int heapCount, heapCapacity;
+    double maxCost;
+} LodMesh;
+
+static uint32_t hashFloat3(const float *p) {
+    uint32_t bits[3];
+    memcpy(bits, p, sizeof(bits));
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 3; i++) {
+        h = (h ^ bits[i]) * 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+static uint32_t hashEdge(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+static size_t tableSizeFor(size_t count) {
+    size_t size = 16;
+    while (size < count * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+static void quadricAddPlane(LodQuadric *Q, double a, double b, double c, double d, double w) {
+    Q->q[0] += w * a * a; Q->q[1] += w * a * b; Q->q[2] += w * a * c; Q->q[3] += w * a * d;
+    Q->q[4] += w * b * b; Q->q[5] += w * b * c; Q->q[6] += w * b * d;
+    Q->q[7] += w * c * c; Q->q[8] += w * c * d;
+    Q->q[9] += w * d * d;
+}
+
+static double quadricEval(const LodQuadric *Q, double x, double y, double z) {
+    const double *q = Q->q;
+    double v = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+             + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+             + q[7] * z * z + 2 * q[8] * z
+             + q[9];
+    return v > 0.0 ? v : 0.0;
+}
+
+// Solve for the position minimizing Q; returns 0 if the system is singular
+static int quadricOptimum(const LodQuadric *Q, double out[3]) {
+    const double *q = Q->q;
+    double a = q[0], b = q[1], c = q[2], e = q[4], f = q[5], i = q[7];
+    double det = a * (e * i - f * f) - b * (b * i - f * c) + c * (b * f - e * c);
+    if (fabs(det) < 1e-12) {
+        return 0;
+    }
+    double r0 = -q[3], r1 = -q[6], r2 = -q[8];
+    out[0] = (r0 * (e * i - f * f) - b * (r1 * i - f * r2) + c * (r1 * f - e * r2)) / det;
+    out[1] = (a * (r1 * i - f * r2) - r0 * (b * i - f * c) + c * (b * r2 - r1 * c)) / det;
+    out[2] = (a * (e * r2 - r1 * f) - b * (b * r2 - r1 * c) + r0 * (b * f - e * c)) / det;
+    return 1;
+}
+
+static void faceNormal(const float *a, const float *b, const float *c, double n[3]) {
+    double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static int adjacencyPush(LodAdjacency *adj, int face) {
+    if (adj->count == adj->capacity) {
+        int capacity = adj->capacity ? adj->capacity * 2 : 8;
+        int *faces = realloc(adj->faces, capacity * sizeof(int));
+        if (!faces) {
+            return 0;
+        }
+        adj->faces = faces;
+        adj->capacity = capacity;
+    }
+    adj->faces[adj->count++] = face;
+    return 1;
+}
+
+static int heapPush(LodMesh *m, const LodEdge *edge) {
+    if (m->heapCount == m->heapCapacity) {
+        int capacity = m->heapCapacity ? m->heapCapacity * 2 : 1024;
+        LodEdge *heap = realloc(m->heap, capacity * sizeof(LodEdge));
+        if (!heap) {
+            return 0;
+        }
+        m->heap = heap;
+        m->heapCapacity = capacity;
+    }
+    int i = m->heapCount++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (m->heap[parent].cost <= edge->cost) {
+            break;
+        }
+        m->heap[i] = m->heap[parent];
+        i = parent;
+    }
+    m->heap[i] = *edge;
+    return 1;
+}
+
+static LodEdge heapPop(LodMesh *m) {
+    LodEdge top = m->heap[0];
+    LodEdge last = m->heap[--m->heapCount];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= m->heapCount) {
+            break;
+        }
+        if (child + 1 < m->heapCount && m->heap[child + 1].cost < m->heap[child].cost) {
+            child++;
+        }
+        if (last.cost <= m->heap[child].cost) {
+            break;
+        }
+        m->heap[i] = m->heap[child];
+        i = child;
+    }
+    if (m->heapCount > 0) {
+        m->heap[i] = last;
+    }
+    return top;
+}
+
+// Evaluate the cheapest collapse target for edge (v0, v1) and queue it
+static int queueEdge(LodMesh *m, int v0, int v1) {
+    LodQuadric Q;
+    for (int k = 0; k < 10; k++) {
+        Q.q[k] = m->quadrics[v0].q[k] + m->quadrics[v1].q[k];
+    }
+
+    const float *p0 = m->positions[v0];
+    const float *p1 = m->positions[v1];
+    double candidates[4][3] = {
+        { p0[0], p0[1], p0[2] },
+        { p1[0], p1[1], p1[2] },
+        { 0.5 * (p0[0] + p1[0]), 0.5 * (p0[1] + p1[1]), 0.5 * (p0[2] + p1[2]) },
+    };
+    int candidateCount = 3;
+    if (quadricOptimum(&Q, candidates[3])) {
+        // Only trust the optimum when it stays near the edge
+        double len2 = 0.0, dist2 = 0.0;
+        for (int k = 0; k < 3; k++) {
+            double e = p1[k] - p0[k];
+            double d = candidates[3][k] - candidates[2][k];
+            len2 += e * e;
+            dist2 += d * d;
+        }
+        if (dist2 <= len2) {
+            candidateCount = 4;
+        }
+    }
+
+    LodEdge edge;
+    edge.cost = DBL_MAX;
+    for (int c = 0; c < candidateCount; c++) {
+        double cost = quadricEval(&Q, candidates[c][0], candidates[c][1], candidates[c][2]);
+        if (cost < edge.cost) {
+            edge.cost = cost;
+            edge.target[0] = (float)candidates[c][0];
+            edge.target[1] = (float)candidates[c][1];
+            edge.target[2] = (float)candidates[c][2];
+        }
+    }
+    edge.v0 = v0;
+    edge.v1 = v1;
+    edge.stamp0 = m->stamps[v0];
+    edge.stamp1 = m->stamps[v1];
+    return heapPush(m, &edge);
+}
+
+// Reject collapses that would flip or degenerate a surviving face
+static int collapseFlipsFaces(const LodMesh *m, int moved, int other, const float *target) {
+    const LodAdjacency *adj = &m->adjacency[moved];
+    for (int i = 0; i < adj->count; i++) {
+        int f = adj->faces[i];
+        if (!m->faceAlive[f]) {
+            continue;
+        }
+        const int *tri = m->faces[f];
+        if (tri[0] == other || tri[1] == other || tri[2] == other) {
+            continue;   // Removed by the collapse
+        }
+        const float *p[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = m->positions[tri[k]];
+        }
+        double before[3], after[3];
+        faceNormal(p[0], p[1], p[2], before);
+        for (int k = 0; k < 3; k++) {
+            if (tri[k] == moved) {
+                p[k] = target;
+            }
+        }
+        faceNormal(p[0], p[1], p[2], after);
+        double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        double lenB = sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+        double lenA = sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+        if (lenA <= 1e-12 || dot < 0.2 * lenA * lenB) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void lodMeshFree(LodMesh *m) {
+    if (m->adjacency) {
+        for (int i = 0; i < m->vertexCount; i++) {
+            free(m->adjacency[i].faces);
+        }
+    }
+    free(m->positions);
+    free(m->quadrics);
+    free(m->stamps);
+    free(m->vertexAlive);
+    free(m->marks);
+    free(m->adjacency);
+    free(m->faces);
+    free(m->faceAlive);
+    free(m->heap);
+}
+
+// Weld the soup into an indexed mesh and seed quadrics and the edge heap
+static int lodMeshInit(LodMesh *m, const float *vertices, unsigned long triangleCount) {
+    memset(m, 0, sizeof(*m));
+
+    size_t cornerCount = (size_t)triangleCount * 3;
+    size_t tableSize = tableSizeFor(cornerCount);
+    int *table = malloc(tableSize * sizeof(int));
+    int *corners = malloc(cornerCount * sizeof(int));
+    m->positions = malloc(cornerCount * sizeof(*m->positions));
+    if (!table || !corners || !m->positions) {
+        free(table);
+        free(corners);
+        return 0;
+    }
+    memset(table, 0xff, tableSize * sizeof(int));
+
+    for (size_t i = 0; i < cornerCount; i++) {
+        const float *p = &vertices[i * 3];
+        size_t slot = hashFloat3(p) & (tableSize - 1);
+        while (table[slot] >= 0 && memcmp(m->positions[table[slot]], p, sizeof(float) * 3) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] < 0) {
+            table[slot] = m->vertexCount;
+            memcpy(m->positions[m->vertexCount], p, sizeof(float) * 3);
+            m->vertexCount++;
+        }
+        corners[i] = table[slot];
+    }
+    free(table);
+
+    m->faces = malloc(triangleCount * sizeof(*m->faces));
+    m->faceAlive = malloc(triangleCount);
+    m->quadrics = calloc(m->vertexCount, sizeof(LodQuadric));
+    m->stamps = calloc(m->vertexCount, sizeof(unsigned int));
+    m->vertexAlive = malloc(m->vertexCount);
+    m->marks = malloc(m->vertexCount * sizeof(int));
+    m->adjacency = calloc(m->vertexCount, sizeof(LodAdjacency));
+    if (!m->faces || !m->faceAlive || !m->quadrics || !m->stamps || !m->vertexAlive || !m->marks || !m->adjacency) {
+        free(corners);
+        return 0;
+    }
+    memset(m->vertexAlive, 1, m->vertexCount);
+    memset(m->marks, 0xff, m->vertexCount * sizeof(int));
+
+    // Drop degenerate triangles and accumulate plane quadrics
+    for (unsigned long t = 0; t < triangleCount; t++) {
+        int a = corners[t * 3], b = corners[t * 3 + 1], c = corners[t * 3 + 2];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        double n[3];
+        faceNormal(m->positions[a], m->positions[b], m->positions[c], n);
+        double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0.0) {
+            continue;
+        }
+        n[0] /= len; n[1] /= len; n[2] /= len;
+        const float *p = m->positions[a];
+        double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+
+        int f = m->faceCount++;
+        m->faces[f][0] = a;
+        m->faces[f][1] = b;
+        m->faces[f][2] = c;
+        m->faceAlive[f] = 1;
+        for (int k = 0; k < 3; k++) {
+            quadricAddPlane(&m->quadrics[m->faces[f][k]], n[0], n[1], n[2], d, 1.0);
+            if (!adjacencyPush(&m->adjacency[m->faces[f][k]], f)) {
+                free(corners);
+                return 0;
+            }
+        }
+    }
+    free(corners);
+    m->aliveFaces = m->faceCount;
+
+    // Count face uses per edge: open borders get an extra constraint plane
+    // and every unique edge becomes a collapse candidate
+    size_t edgeTableSize = tableSizeFor((size_t)m->faceCount * 3);
+    uint64_t *edgeKeys = malloc(edgeTableSize * sizeof(uint64_t));
+    int *edgeUses = calloc(edgeTableSize, sizeof(int));
+    int *edgeFace = malloc(edgeTableSize * sizeof(int));
+    if (!edgeKeys || !edgeUses || !edgeFace) {
+        free(edgeKeys);
+        free(edgeUses);
+        free(edgeFace);
+        return 0;
+    }
+    memset(edgeKeys, 0xff, edgeTableSize * sizeof(uint64_t));
+
+    for (int f = 0; f < m->faceCount; f++) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = (uint32_t)m->faces[f][k], b = (uint32_t)m->faces[f][(k + 1) % 3];
+            uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+            size_t slot = hashEdge(key) & (edgeTableSize - 1);
+            while (edgeKeys[slot] != UINT64_MAX && edgeKeys[slot] != key) {
+                slot = (slot + 1) & (edgeTableSize - 1);
+            }
+            edgeKeys[slot] = key;
+            edgeUses[slot]++;
+            edgeFace[slot] = f;
+        }
+    }
+
+    for (size_t slot = 0; slot < edgeTableSize; slot++) {
+        if (edgeKeys[slot] == UINT64_MAX || edgeUses[slot] != 1) {
+            continue;
+        }
+        int a = (int)(edgeKeys[slot] >> 32), b = (int)(edgeKeys[slot] & 0xffffffffu);
+        const int *tri = m->faces[edgeFace[slot]];
+        double n[3], e[3], p[3];
+        faceNormal(m->positions[tri[0]], m->positions[tri[1]], m->positions[tri[2]], n);
+        for (int k = 0; k < 3; k++) {
+            e[k] = m->positions[b][k] - m->positions[a][k];
+        }
+        p[0] = e[1] * n[2] - e[2] * n[1];
+        p[1] = e[2] * n[0] - e[0] * n[2];
+        p[2] = e[0] * n[1] - e[1] * n[0];
+        double len = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (len <= 0.0) {
+            continue;
+        }
+        p[0] /= len; p[1] /= len; p[2] /= len;
+        const float *pa = m->positions[a];
+        double d = -(p[0] * pa[0] + p[1] * pa[1] + p[2] * pa[2]);
+        quadricAddPlane(&m->quadrics[a], p[0], p[1], p[2], d, LOD_BOUNDARY_WEIGHT);
+        quadricAddPlane(&m->quadrics[b], p[0], p[1], p[2], d, LOD_BOUNDARY_WEIGHT);
+    }
+
+    int ok = 1;
+    for (size_t slot = 0; slot < edgeTableSize && ok; slot++) {
+        if (edgeKeys[slot] != UINT64_MAX) {
+            ok = queueEdge(m, (int)(edgeKeys[slot] >> 32), (int)(edgeKeys[slot] & 0xffffffffu));
+        }
+    }
+    free(edgeKeys);
+    free(edgeUses);
+    free(edgeFace);
+    return ok;
+}
+
+// Collapse v1 into v0 at the given target position
+static int collapseEdge(LodMesh *m, int v0, int v1, const float *target, int collapseId) {
+    memcpy(m->positions[v0], target, sizeof(float) * 3);
+    for (int k = 0; k < 10; k++) {
+        m->quadrics[v0].q[k] += m->quadrics[v1].q[k];
+    }
+    m->vertexAlive[v1] = 0;
+    m->stamps[v0]++;
+
+    LodAdjacency *adj1 = &m->adjacency[v1];
+    for (int i = 0; i < adj1->count; i++) {
+        int f = adj1->faces[i];
+        if (!m->faceAlive[f]) {
+            continue;
+        }
+        int *tri = m->faces[f];
+        if (tri[0] == v0 || tri[1] == v0 || tri[2] == v0) {
+            m->faceAlive[f] = 0;
+            m->aliveFaces--;
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            if (tri[k] == v1) {
+                tri[k] = v0;
+            }
+        }
+        if (!adjacencyPush(&m->adjacency[v0], f)) {
+            return 0;
+        }
+    }
+    free(adj1->faces);
+    adj1->faces = NULL;
+    adj1->count = adj1->capacity = 0;
+
+    // Compact the surviving vertex's face list and requeue its edges
+    LodAdjacency *adj0 = &m->adjacency[v0];
+    int kept = 0;
+    for (int i = 0; i < adj0->count; i++) {
+        int f = adj0->faces[i];
+        if (!m->faceAlive[f]) {
+            continue;
+        }
+        adj0->faces[kept++] = f;
+        for (int k = 0; k < 3; k++) {
+            int w = m->faces[f][k];
+            if (w == v0 || m->marks[w] == collapseId) {
+                continue;
+            }
+            m->marks[w] = collapseId;
+            if (!queueEdge(m, v0, w)) {
+                return 0;
+            }
+        }
+    }
+    adj0->count = kept;
+    return 1;
+}
+
+static int snapshotLevel(const LodMesh *m, ucncLodMesh *out) {
+    out->triangleCount = (unsigned long)m->aliveFaces;
+    out->vertices = malloc((size_t)m->aliveFaces * 9 * sizeof(float));
+    out->normals = malloc((size_t)m->aliveFaces * 3 * sizeof(float));
+    out->geometricError = (float)sqrt(m->maxCost);
+    if (!out->vertices || !out->normals) {
+        ucncLodMeshFree(out);
+        return 0;
+    }
+
+    float *v = out->vertices;
+    float *n = out->normals;
+    for (int f = 0; f < m->faceCount; f++) {
+        if (!m->faceAlive[f]) {
+            continue;
+        }
+        const int *tri = m->faces[f];
+        double normal[3];
+        faceNormal(m->positions[tri[0]], m->positions[tri[1]], m->positions[tri[2]], normal);
+        double len = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (len <= 0.0) {
+            len = 1.0;
+        }
+        for (int k = 0; k < 3; k++) {
+            memcpy(v, m->positions[tri[k]], sizeof(float) * 3);
+            v += 3;
+            *n++ = (float)(normal[k] / len);
+        }
+    }
+    return 1;
+}
+
+int ucncLodBuild(const float *vertices, unsigned long triangleCount, int maxLevels, ucncLodMesh *levels) {
+    if (!vertices || !levels || maxLevels <= 0) {
+        return 0;
+    }
+    if (maxLevels > UCNC_LOD_MAX_LEVELS) {
+        maxLevels = UCNC_LOD_MAX_LEVELS;
+    }
+    if (triangleCount / UCNC_LOD_REDUCTION < UCNC_LOD_MIN_TRIANGLES || triangleCount > INT32_MAX / 3) {
+        return 0;
+    }
+
+    LodMesh m;
+    if (!lodMeshInit(&m, vertices, triangleCount)) {
+        fprintf(stderr, "Failed to prepare mesh for LOD generation.\n");
+        lodMeshFree(&m);
+        return 0;
+    }
+
+    int levelCount = 0;
+    unsigned long target = (unsigned long)m.faceCount / UCNC_LOD_REDUCTION;
+    int collapseId = 0;
+
+    while (levelCount < maxLevels && target >= UCNC_LOD_MIN_TRIANGLES) {
+        while ((unsigned long)m.aliveFaces > target && m.heapCount > 0) {
+            LodEdge edge = heapPop(&m);
+            int v0 = edge.v0, v1 = edge.v1;
+            if (!m.vertexAlive[v0] || !m.vertexAlive[v1] ||
+                m.stamps[v0] != edge.stamp0 || m.stamps[v1] != edge.stamp1) {
+                continue;   // Stale entry
+            }
+            if (collapseFlipsFaces(&m, v0, v1, edge.target) ||
+                collapseFlipsFaces(&m, v1, v0, edge.target)) {
+                continue;
+            }
+            if (edge.cost > m.maxCost) {
+                m.maxCost = edge.cost;
+            }
+            if (!collapseEdge(&m, v0, v1, edge.target, collapseId++)) {
+                fprintf(stderr, "Out of memory during LOD generation.\n");
+                m.heapCount = 0;
+                break;
+            }
+        }
+
+        // Stop once collapses no longer make meaningful progress
+        if (levelCount > 0 && (unsigned long)m.aliveFaces * 2 > levels[levelCount - 1].triangleCount) {
+            break;
+        }
+        if (levelCount == 0 && (unsigned long)m.aliveFaces * 2 > (unsigned long)m.faceCount) {
+            break;
+        }
+        if (!snapshotLevel(&m, &levels[levelCount])) {
+            break;
+        }
+        levelCount++;
+        target /= UCNC_LOD_REDUCTION;
+    }
+
+    lodMeshFree(&m);
+    return levelCount;
+}
+
+void ucncLodMeshFree(ucncLodMesh *mesh) {
+    if (mesh) {
+        free(mesh->vertices);
+        free(mesh->normals);
+        mesh->vertices = NULL;
+        mesh->normals = NULL;
+        mesh->triangleCount = 0;
+    }
+}
+
+int ucncLodCacheLoad(const char *cachePath, const char *sourcePath, int maxLevels, ucncLodMesh *levels) {
+    struct stat st;
+    if (!cachePath || !sourcePath || stat(sourcePath, &st) != 0) {
+        return 0;
+    }
+
+    FILE *fp = fopen(cachePath, "rb");
+    if (!fp) {
+        return 0;
+    }
+
+    char magic[8];
+    int64_t size, mtime;
+    int32_t count;
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, LOD_CACHE_MAGIC, sizeof(magic)) != 0 ||
+        fread(&size, sizeof(size), 1, fp) != 1 || fread(&mtime, sizeof(mtime), 1, fp) != 1 ||
+        fread(&count, sizeof(count), 1, fp) != 1 ||
+        size != (int64_t)st.st_size || mtime != (int64_t)st.st_mtime || count <= 0) {
+        fclose(fp);
+        return 0;
+    }
+    if (count > maxLevels) {
+        count = maxLevels;
+    }
+
+    int loaded = 0;
+    for (; loaded < count; loaded++) {
+        ucncLodMesh *level = &levels[loaded];
+        uint32_t triangles;
+        float error;
+        if (fread(&triangles, sizeof(triangles), 1, fp) != 1 || fread(&error, sizeof(error), 1, fp) != 1) {
+            break;
+        }
+        level->triangleCount = triangles;
+        level->geometricError = error;
+        level->vertices = malloc((size_t)triangles * 9 * sizeof(float));
+        level->normals = malloc((size_t)triangles * 3 * sizeof(float));
+        if (!level->vertices || !level->normals ||
+            fread(level->vertices, sizeof(float) * 9, triangles, fp) != triangles ||
+            fread(level->normals, sizeof(float) * 3, triangles, fp) != triangles) {
+            ucncLodMeshFree(level);
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (loaded != count) {
+        for (int i = 0; i < loaded; i++) {
+            ucncLodMeshFree(&levels[i]);
+        }
+        return 0;
+    }
+    return loaded;
+}
+
+int ucncLodCacheStore(const char *cachePath, const char *sourcePath, int levelCount, const ucncLodMesh *levels) {
+    struct stat st;
+    if (!cachePath || !sourcePath || levelCount <= 0 || stat(sourcePath, &st) != 0) {
+        return 0;
+    }
+
+    // Write to a temporary name so concurrent readers never see a partial
+    // file; it is unique, so processes storing the same mesh do not collide
+    char tmpPath[1024];
+    int ret = snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", cachePath);
+    if (ret < 0 || ret >= (int)sizeof(tmpPath)) {
+        return 0;
+    }
+
+    int fd = mkstemp(tmpPath);
+    FILE *fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!fp) {
+        fprintf(stderr, "Unable to write LOD cache '%s'.\n", tmpPath);
+        if (fd >= 0) {
+            close(fd);
+            remove(tmpPath);
+        }
+        return 0;
+    }
+
+    int64_t size = (int64_t)st.st_size;
+    int64_t mtime = (int64_t)st.st_mtime;
+    int32_t count = levelCount;
+    int ok = fwrite(LOD_CACHE_MAGIC, 1, 8, fp) == 8 &&
+             fwrite(&size, sizeof(size), 1, fp) == 1 &&
+             fwrite(&mtime, sizeof(mtime), 1, fp) == 1 &&
+             fwrite(&count, sizeof(count), 1, fp) == 1;
+    for (int i = 0; i < levelCount && ok; i++) {
+        uint32_t triangles = (uint32_t)levels[i].triangleCount;
+        ok = fwrite(&triangles, sizeof(triangles), 1, fp) == 1 &&
+             fwrite(&levels[i].geometricError, sizeof(float), 1, fp) == 1 &&
+             fwrite(levels[i].vertices, sizeof(float) * 9, triangles, fp) == triangles &&
+             fwrite(levels[i].normals, sizeof(float) * 3, triangles, fp) == triangles;
+    }
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        fprintf(stderr, "Unable to write LOD cache '%s'.\n", cachePath);
+        remove(tmpPath);
+        return 0;
+    }
+    return 1;
+}
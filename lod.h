@@ -0,0 +1,34 @@
+/* lod.h */
+
+#ifndef LOD_H
+#define LOD_H
+
+#include "cncvis.h"
+
+#define UCNC_LOD_MAX_LEVELS 4        // Simplified levels kept per actor (full mesh excluded)
+#define UCNC_LOD_MIN_TRIANGLES 32    // Do not simplify below this many triangles
+#define UCNC_LOD_REDUCTION 4         // Triangle count divisor between levels
+
+// A simplified copy of an actor mesh, stored as a flat triangle soup
+typedef struct ucncLodMesh {
+    float *vertices;                 // 9 floats per triangle
+    float *normals;                  // 3 floats per triangle (face normal)
+    unsigned long triangleCount;     // Number of triangles
+    float geometricError;            // Estimated deviation from the source mesh (model units): the
+                                     // root of the largest quadric collapse cost, not a bound
+} ucncLodMesh;
+
+// Simplify a triangle soup (9 floats per triangle) with quadric error metric
+// edge collapses. Fills up to maxLevels entries of levels, each one roughly
+// UCNC_LOD_REDUCTION times smaller than the previous. Returns the number of
+// levels produced (0 if the mesh is too small to be worth simplifying).
+int ucncLodBuild(const float *vertices, unsigned long triangleCount, int maxLevels, ucncLodMesh *levels);
+void ucncLodMeshFree(ucncLodMesh *mesh);
+
+// On-disk cache of generated levels, keyed by the source file size and mtime.
+// Load returns the number of levels read (0 when missing or stale),
+// store returns 1 on success.
+int ucncLodCacheLoad(const char *cachePath, const char *sourcePath, int maxLevels, ucncLodMesh *levels);
+int ucncLodCacheStore(const char *cachePath, const char *sourcePath, int levelCount, const ucncLodMesh *levels);
+
+#endif // LOD_H
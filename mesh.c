@@ -0,0 +1,764 @@
+/* mesh.c */
+
+#define _DEFAULT_SOURCE // realpath with -std=c11
+
+#include "mesh.h"
+
+#include <sys/stat.h>
+
+#define UCNC_MESH_ASCII_CHUNK_BYTES (1024 * 1024) // ASCII text per parser thread
+#define UCNC_MESH_MAX_PARSE_THREADS 8
+#define UCNC_MESH_PROXY_SAMPLES 1024             // Triangles read for a proxy box
+
+// Process-wide mesh cache. Lookups are by path; an entry only matches while
+// the file still has the size and mtime it was loaded with. Readers of the
+// same path wait for the first one to finish loading instead of parsing the
+// file again.
+static pthread_mutex_t gCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCacheLoaded = PTHREAD_COND_INITIALIZER;
+static ucncMesh *gCache = NULL;
+static atomic_ulong gLodGeneration; // Bumped whenever a mesh publishes levels
+static atomic_int gPending;         // Background loads not committed yet
+
+typedef struct {
+    ucncMesh *mesh;
+    int levels;
+    char cacheDir[1024];
+} LodJob;
+
+static int meshBuildLods(ucncMesh *mesh, int levels, const char *cacheDir);
+
+static void meshFree(ucncMesh *mesh) {
+    if (mesh->loadThreadActive) {
+        pthread_join(mesh->loadThread, NULL);
+    }
+    if (mesh->lodThreadActive) {
+        pthread_join(mesh->lodThread, NULL);
+    }
+    int count = atomic_load(&mesh->lodCount);
+    for (int i = 0; i < count; i++) {
+        ucncLodMeshFree(&mesh->lods[i]);
+    }
+    ucncBvhFree(atomic_load(&mesh->bvh));
+    pthread_mutex_destroy(&mesh->lodLock);
+    if (mesh->releaseData) {
+        mesh->releaseData(mesh->releaseContext);
+    } else {
+        free((void *)mesh->vertices);  // Normals share the allocation
+    }
+    free(mesh);
+}
+
+static void unlinkMesh(ucncMesh *mesh) {
+    for (ucncMesh **link = &gCache; *link; link = &(*link)->next) {
+        if (*link == mesh) {
+            *link = mesh->next;
+            return;
+        }
+    }
+}
+
+// Bounding sphere around the bounding box center
+static void meshComputeBounds(const ucncMesh *mesh, float bound[4]) {
+    const float *v = mesh->vertices;
+    unsigned long count = mesh->triangleCount * 3;
+    float lo[3] = { 0.0f, 0.0f, 0.0f }, hi[3] = { 0.0f, 0.0f, 0.0f };
+    if (count > 0) {
+        memcpy(lo, v, sizeof(lo));
+        memcpy(hi, v, sizeof(hi));
+    }
+    for (unsigned long i = 0; i < count; i++, v += 3) {
+        for (int k = 0; k < 3; k++) {
+            if (v[k] < lo[k]) lo[k] = v[k];
+            if (v[k] > hi[k]) hi[k] = v[k];
+        }
+    }
+    bound[0] = 0.5f * (lo[0] + hi[0]);
+    bound[1] = 0.5f * (lo[1] + hi[1]);
+    bound[2] = 0.5f * (lo[2] + hi[2]);
+    bound[3] = 0.5f * sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) +
+                                     (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                                     (hi[2] - lo[2]) * (hi[2] - lo[2]));
+}
+
+static void meshSetBounds(ucncMesh *mesh, const float bound[4]) {
+    mesh->boundCenterX = bound[0];
+    mesh->boundCenterY = bound[1];
+    mesh->boundCenterZ = bound[2];
+    mesh->boundRadius = bound[3];
+}
+
+// Box around an evenly spread sample of a binary file's triangles, cheap
+// enough to compute before the file is loaded. Returns 0 for ASCII files.
+static int meshSampleBox(const char *path, float lo[3], float hi[3]) {
+    struct stlioMappedFile mapped;
+    if (stlioMapBinaryFile(path, &mapped) != stlioE_Ok) {
+        return 0;
+    }
+    unsigned long count = mapped.dwTriangleCount;
+    unsigned long samples = count < UCNC_MESH_PROXY_SAMPLES ? count : UCNC_MESH_PROXY_SAMPLES;
+    unsigned long found = 0;
+    for (unsigned long i = 0; i < samples; i++) {
+        float v[9], n[3];
+        unsigned long first = (unsigned long)((unsigned long long)i * count / samples);
+        if (stlioDecodeBinaryFloat(&mapped, first, 1, v, n) != stlioE_Ok) {
+            break;
+        }
+        for (int k = 0; k < 9; k++) {
+            if (found == 0 && k < 3) {
+                lo[k] = hi[k] = v[k];
+            }
+            if (v[k] < lo[k % 3]) lo[k % 3] = v[k];
+            if (v[k] > hi[k % 3]) hi[k % 3] = v[k];
+        }
+        found++;
+    }
+    stlioUnmapFile(&mapped);
+    return found > 0;
+}
+
+// Allocate vertices and normals as one block: all vertices, then all normals
+static float *meshAllocate(ucncMesh *mesh, unsigned long triangleCount) {
+    float *vertices = malloc((triangleCount ? triangleCount : 1) * 12 * sizeof(float));
+    if (!vertices) {
+        fprintf(stderr, "Memory allocation failed for mesh '%s'.\n", mesh->path);
+        return NULL;
+    }
+    mesh->vertices = vertices;
+    mesh->normals = vertices + triangleCount * 9;
+    mesh->triangleCount = triangleCount;
+    return vertices;
+}
+
+// Binary files are mapped and decoded straight into the float arrays. Returns
+// stlioE_InvalidFormat for anything that is not a well-formed binary STL.
+static enum stlioError meshLoadBinary(ucncMesh *mesh) {
+    struct stlioMappedFile mapped;
+    enum stlioError e = stlioMapBinaryFile(mesh->path, &mapped);
+    if (e != stlioE_Ok) {
+        return e;
+    }
+    float *vertices = meshAllocate(mesh, mapped.dwTriangleCount);
+    if (!vertices) {
+        stlioUnmapFile(&mapped);
+        return stlioE_OutOfMemory;
+    }
+    e = stlioDecodeBinaryFloat(&mapped, 0, mapped.dwTriangleCount, vertices, (float *)mesh->normals);
+    stlioUnmapFile(&mapped);
+    if (e != stlioE_Ok) {
+        free(vertices);
+        mesh->vertices = mesh->normals = NULL;
+    }
+    return e;
+}
+
+typedef struct {
+    const struct stlioMappedFile *file;
+    struct stlioASCIIChunk *chunk;
+} AsciiJob;
+
+static void *asciiChunkThread(void *arg) {
+    AsciiJob *job = arg;
+    stlioParseASCIIChunk(job->file, job->chunk);
+    return NULL;
+}
+
+// ASCII files are split at facet boundaries and the pieces parsed in
+// parallel, one thread per UCNC_MESH_ASCII_CHUNK_BYTES of text. Returns
+// stlioE_InvalidFormat if the file is not ASCII.
+static enum stlioError meshLoadAscii(ucncMesh *mesh) {
+    struct stlioMappedFile mapped;
+    enum stlioError e = stlioMapFile(mesh->path, &mapped);
+    if (e != stlioE_Ok) {
+        return e;
+    }
+    if (mapped.dwSize < 5 || memcmp(mapped.lpData, "solid", 5) != 0) {
+        stlioUnmapFile(&mapped);
+        return stlioE_InvalidFormat;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long maxChunks = mapped.dwSize / UCNC_MESH_ASCII_CHUNK_BYTES + 1;
+    if (maxChunks > (unsigned long)(cpus > 0 ? cpus : 1)) maxChunks = (unsigned long)(cpus > 0 ? cpus : 1);
+    if (maxChunks > UCNC_MESH_MAX_PARSE_THREADS) maxChunks = UCNC_MESH_MAX_PARSE_THREADS;
+
+    struct stlioASCIIChunk chunks[UCNC_MESH_MAX_PARSE_THREADS];
+    AsciiJob jobs[UCNC_MESH_MAX_PARSE_THREADS];
+    pthread_t threads[UCNC_MESH_MAX_PARSE_THREADS];
+    int started[UCNC_MESH_MAX_PARSE_THREADS] = { 0 };
+    unsigned long count = stlioSplitASCII(&mapped, maxChunks, chunks);
+
+    // The calling thread takes the first chunk and any that failed to start
+    for (unsigned long i = 1; i < count; i++) {
+        jobs[i].file = &mapped;
+        jobs[i].chunk = &chunks[i];
+        started[i] = pthread_create(&threads[i], NULL, asciiChunkThread, &jobs[i]) == 0;
+    }
+    for (unsigned long i = 0; i < count; i++) {
+        if (!started[i]) {
+            stlioParseASCIIChunk(&mapped, &chunks[i]);
+        }
+    }
+    unsigned long total = 0;
+    for (unsigned long i = 0; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        total += chunks[i].dwTriangleCount;
+    }
+
+    // Report the first error in file order
+    for (unsigned long i = 0; i < count && e == stlioE_Ok; i++) {
+        if (chunks[i].eError != stlioE_Ok) {
+            e = chunks[i].eError;
+            fprintf(stderr, "%s:%lu:%lu: %s\n", mesh->path, chunks[i].dwErrorLine,
+                    chunks[i].dwErrorChar, stlioErrorStringC(e));
+        }
+    }
+
+    float *vertices = e == stlioE_Ok ? meshAllocate(mesh, total) : NULL;
+    if (e == stlioE_Ok && !vertices) {
+        e = stlioE_OutOfMemory;
+    }
+    unsigned long offset = 0;
+    for (unsigned long i = 0; i < count; i++) {
+        if (vertices) {
+            memcpy(vertices + offset * 9, chunks[i].lpVertices, chunks[i].dwTriangleCount * 9 * sizeof(float));
+            memcpy((float *)mesh->normals + offset * 3, chunks[i].lpNormals, chunks[i].dwTriangleCount * 3 * sizeof(float));
+            offset += chunks[i].dwTriangleCount;
+        }
+        stlioFreeASCIIChunk(&chunks[i]);
+    }
+    stlioUnmapFile(&mapped);
+    return e;
+}
+
+// Anything the mapped readers cannot handle goes through the streaming parser
+static enum stlioError meshLoadStream(ucncMesh *mesh) {
+    union {
+        struct stlTriangle* lpTri;
+        unsigned char* lpBuff;
+    } buf;
+    unsigned long int dwTriCount;
+    unsigned long int dwStride;
+    enum stlFileType fType;
+
+    enum stlioError e = stlioReadFileMem(mesh->path, &(buf.lpTri), &dwTriCount, &dwStride, NULL, NULL, &fType);
+    if (e != stlioE_Ok) {
+        return e;
+    }
+
+    float *vertices = meshAllocate(mesh, dwTriCount);
+    if (!vertices) {
+        free(buf.lpBuff);
+        return stlioE_OutOfMemory;
+    }
+    float *normals = vertices + dwTriCount * 9;
+    for (unsigned long i = 0; i < dwTriCount; i++) {
+        struct stlTriangle* lpTriangle = (struct stlTriangle*)(buf.lpBuff + dwStride * i);
+        for (int k = 0; k < 3; k++) {
+            normals[i * 3 + k] = (float)lpTriangle->surfaceNormal[k];
+        }
+        for (int v = 0; v < 3; v++) {
+            for (int k = 0; k < 3; k++) {
+                vertices[i * 9 + v * 3 + k] = (float)lpTriangle->vertices[v][k];
+            }
+        }
+    }
+    free(buf.lpBuff);
+    return stlioE_Ok;
+}
+
+// Read the STL file into float arrays and compute its bounds. Runs without
+// the cache lock held.
+static int meshLoad(ucncMesh *mesh, float bound[4]) {
+    enum stlioError e = meshLoadBinary(mesh);
+    if (e == stlioE_InvalidFormat) {
+        e = meshLoadAscii(mesh);
+    }
+    if (e == stlioE_InvalidFormat) {
+        e = meshLoadStream(mesh);
+    }
+    if (e != stlioE_Ok) {
+        fprintf(stderr, "Failed to load STL file '%s': %s\n", mesh->path, stlioErrorStringC(e));
+        return 0;
+    }
+    meshComputeBounds(mesh, bound);
+    return 1;
+}
+
+// Entry for this file version, loaded or not. Called with the cache lock held.
+static ucncMesh *findLocked(const char *path, int64_t fileSize, int64_t fileMtime) {
+    for (ucncMesh *mesh = gCache; mesh; mesh = mesh->next) {
+        if (!mesh->failed && strcmp(mesh->path, path) == 0 && mesh->fileSize == fileSize &&
+            mesh->fileMtime == fileMtime) {
+            return mesh;
+        }
+    }
+    return NULL;
+}
+
+// Find the entry for this file version and take a reference, waiting for it
+// to finish loading. Called with the cache lock held. *failed is set when the
+// entry matched but its load failed.
+static ucncMesh *lookupLocked(const char *path, int64_t fileSize, int64_t fileMtime, int *failed) {
+    *failed = 0;
+    ucncMesh *mesh = findLocked(path, fileSize, fileMtime);
+    if (!mesh) {
+        return NULL;
+    }
+    mesh->refCount++;
+    while (mesh->loading) {
+        pthread_cond_wait(&gCacheLoaded, &gCacheLock);
+    }
+    if (mesh->failed) {
+        // Freed by its creator or the next purge once unreferenced
+        mesh->refCount--;
+        *failed = 1;
+        return NULL;
+    }
+    return mesh;
+}
+
+// New entry with one reference, linked into the cache and hidden until its
+// creator has filled it in. Called with the cache lock held.
+static ucncMesh *insertLocked(const char *path, int64_t fileSize, int64_t fileMtime) {
+    ucncMesh *mesh = calloc(1, sizeof(ucncMesh));
+    if (!mesh) {
+        fprintf(stderr, "Memory allocation failed for mesh '%s'.\n", path);
+        return NULL;
+    }
+    snprintf(mesh->path, sizeof(mesh->path), "%s", path);
+    mesh->fileSize = fileSize;
+    mesh->fileMtime = fileMtime;
+    atomic_init(&mesh->lodCount, 0);
+    atomic_init(&mesh->visible, 0);
+    atomic_init(&mesh->bvh, NULL);
+    pthread_mutex_init(&mesh->lodLock, NULL);
+    mesh->refCount = 1;
+    mesh->next = gCache;
+    gCache = mesh;
+    return mesh;
+}
+
+ucncMesh *ucncMeshAcquire(const char *path) {
+    struct stat st;
+    if (!path || stat(path, &st) != 0) {
+        fprintf(stderr, "Cannot stat STL file '%s'.\n", path ? path : "(null)");
+        return NULL;
+    }
+
+    int failed;
+    pthread_mutex_lock(&gCacheLock);
+    ucncMesh *mesh = lookupLocked(path, (int64_t)st.st_size, (int64_t)st.st_mtime, &failed);
+    if (mesh || failed) {
+        pthread_mutex_unlock(&gCacheLock);
+        return mesh;
+    }
+    mesh = insertLocked(path, (int64_t)st.st_size, (int64_t)st.st_mtime);
+    if (!mesh) {
+        pthread_mutex_unlock(&gCacheLock);
+        return NULL;
+    }
+    mesh->loading = 1;
+    pthread_mutex_unlock(&gCacheLock);
+
+    float bound[4];
+    int ok = meshLoad(mesh, bound);
+
+    // Background acquirers may already hold the entry; renderers only see the
+    // geometry from here on
+    pthread_mutex_lock(&gCacheLock);
+    if (ok) {
+        meshSetBounds(mesh, bound);
+        atomic_store_explicit(&mesh->visible, 1, memory_order_release);
+    }
+    mesh->loading = 0;
+    mesh->failed = !ok;
+    pthread_cond_broadcast(&gCacheLoaded);
+    if (!ok) {
+        // Background acquirers may still hold it; then the purge frees it
+        int unused = --mesh->refCount == 0;
+        if (unused) {
+            unlinkMesh(mesh);
+        }
+        pthread_mutex_unlock(&gCacheLock);
+        if (unused) {
+            meshFree(mesh);
+        }
+        return NULL;
+    }
+    pthread_mutex_unlock(&gCacheLock);
+    return mesh;
+}
+
+static void *meshLoadThread(void *arg) {
+    LodJob *job = arg;
+    ucncMesh *mesh = job->mesh;
+    float bound[4];
+    int ok = meshLoad(mesh, bound);
+
+    pthread_mutex_lock(&gCacheLock);
+    if (ok) {
+        memcpy(mesh->loadedBound, bound, sizeof(bound));
+    }
+    mesh->loading = 0;
+    mesh->failed = !ok;
+    pthread_cond_broadcast(&gCacheLoaded);
+    pthread_mutex_unlock(&gCacheLock);
+
+    // Levels do not need the commit; renderers ignore them until then
+    if (ok && job->levels > 0) {
+        meshBuildLods(mesh, job->levels, job->cacheDir);
+    }
+    free(job);
+    return NULL;
+}
+
+ucncMesh *ucncMeshAcquireAsync(const char *path, int lodLevels, const char *lodCacheDir) {
+    struct stat st;
+    if (!path || stat(path, &st) != 0) {
+        fprintf(stderr, "Cannot stat STL file '%s'.\n", path ? path : "(null)");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&gCacheLock);
+    ucncMesh *mesh = findLocked(path, (int64_t)st.st_size, (int64_t)st.st_mtime);
+    if (mesh) {
+        mesh->refCount++;
+        pthread_mutex_unlock(&gCacheLock);
+        return mesh;
+    }
+    pthread_mutex_unlock(&gCacheLock);
+
+    // Sample outside the lock, then check again in case another thread won
+    float lo[3], hi[3];
+    int hasProxy = meshSampleBox(path, lo, hi);
+    LodJob *job = malloc(sizeof(LodJob));
+    if (!job) {
+        return ucncMeshAcquire(path);
+    }
+
+    pthread_mutex_lock(&gCacheLock);
+    mesh = findLocked(path, (int64_t)st.st_size, (int64_t)st.st_mtime);
+    if (mesh) {
+        mesh->refCount++;
+        pthread_mutex_unlock(&gCacheLock);
+        free(job);
+        return mesh;
+    }
+    mesh = insertLocked(path, (int64_t)st.st_size, (int64_t)st.st_mtime);
+    if (!mesh) {
+        pthread_mutex_unlock(&gCacheLock);
+        free(job);
+        return NULL;
+    }
+    mesh->hasProxy = hasProxy;
+    if (hasProxy) {
+        memcpy(mesh->proxyMin, lo, sizeof(lo));
+        memcpy(mesh->proxyMax, hi, sizeof(hi));
+        float bound[4] = {
+            0.5f * (lo[0] + hi[0]), 0.5f * (lo[1] + hi[1]), 0.5f * (lo[2] + hi[2]),
+            0.5f * sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                         (hi[2] - lo[2]) * (hi[2] - lo[2]))
+        };
+        meshSetBounds(mesh, bound);
+    }
+    mesh->loading = 1;
+    mesh->pending = 1;
+    atomic_fetch_add(&gPending, 1);
+
+    job->mesh = mesh;
+    job->levels = lodLevels;
+    snprintf(job->cacheDir, sizeof(job->cacheDir), "%s", lodCacheDir ? lodCacheDir : "");
+    int started = pthread_create(&mesh->loadThread, NULL, meshLoadThread, job) == 0;
+    mesh->loadThreadActive = started;
+    pthread_mutex_unlock(&gCacheLock);
+
+    // No thread available: load in place
+    if (!started) {
+        meshLoadThread(job);
+    }
+    return mesh;
+}
+
+// Swap in the geometry of a finished background load, or drop the proxy of a
+// failed one. Called with the cache lock held.
+static int commitLocked(ucncMesh *mesh) {
+    if (!mesh->pending || mesh->loading) {
+        return 0;
+    }
+    if (mesh->failed) {
+        mesh->hasProxy = 0;
+    } else {
+        meshSetBounds(mesh, mesh->loadedBound);
+        atomic_store_explicit(&mesh->visible, 1, memory_order_release);
+    }
+    mesh->pending = 0;
+    atomic_fetch_sub(&gPending, 1);
+    return 1;
+}
+
+int ucncMeshCacheCommit(void) {
+    if (atomic_load(&gPending) == 0) {
+        return 0;
+    }
+    int committed = 0;
+    pthread_mutex_lock(&gCacheLock);
+    for (ucncMesh *mesh = gCache; mesh; mesh = mesh->next) {
+        committed += commitLocked(mesh);
+    }
+    pthread_mutex_unlock(&gCacheLock);
+    if (committed > 0) {
+        atomic_fetch_add(&gLodGeneration, 1);  // Cached frames must redraw
+    }
+    return committed;
+}
+
+int ucncMeshCachePending(void) {
+    return atomic_load(&gPending);
+}
+
+int ucncMeshWait(ucncMesh *mesh) {
+    if (!mesh) {
+        return 0;
+    }
+    pthread_mutex_lock(&gCacheLock);
+    while (mesh->loading) {
+        pthread_cond_wait(&gCacheLoaded, &gCacheLock);
+    }
+    int committed = commitLocked(mesh);
+    pthread_mutex_unlock(&gCacheLock);
+    if (committed) {
+        atomic_fetch_add(&gLodGeneration, 1);
+    }
+    return atomic_load(&mesh->visible);
+}
+
+ucncMesh *ucncMeshAcquireSource(const char *path, int64_t fileSize, int64_t fileMtime,
+                                const ucncMeshSource *source) {
+    if (!path || !source || !source->vertices || !source->normals) {
+        return NULL;
+    }
+
+    int failed;
+    pthread_mutex_lock(&gCacheLock);
+    ucncMesh *mesh = lookupLocked(path, fileSize, fileMtime, &failed);
+    if (!mesh) {
+        mesh = insertLocked(path, fileSize, fileMtime);
+        if (mesh) {
+            mesh->vertices = source->vertices;
+            mesh->normals = source->normals;
+            mesh->triangleCount = source->triangleCount;
+            mesh->boundCenterX = source->boundCenter[0];
+            mesh->boundCenterY = source->boundCenter[1];
+            mesh->boundCenterZ = source->boundCenter[2];
+            mesh->boundRadius = source->boundRadius;
+            mesh->releaseData = source->release;
+            mesh->releaseContext = source->context;
+            if (source->retain) {
+                source->retain(source->context);
+            }
+            atomic_store_explicit(&mesh->visible, 1, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&gCacheLock);
+    return mesh;
+}
+
+ucncMesh *ucncMeshNewBounds(const float min[3], const float max[3]) {
+    ucncMesh *mesh = calloc(1, sizeof(ucncMesh));
+    if (!mesh) {
+        fprintf(stderr, "Memory allocation failed for mesh bounds.\n");
+        return NULL;
+    }
+    float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+    mesh->boundCenterX = 0.5f * (min[0] + max[0]);
+    mesh->boundCenterY = 0.5f * (min[1] + max[1]);
+    mesh->boundCenterZ = 0.5f * (min[2] + max[2]);
+    mesh->boundRadius = 0.5f * sqrtf(dx * dx + dy * dy + dz * dz);
+    atomic_init(&mesh->lodCount, 0);
+    atomic_init(&mesh->visible, 1);
+    atomic_init(&mesh->bvh, NULL);
+    pthread_mutex_init(&mesh->lodLock, NULL);
+    mesh->refCount = 1;
+    return mesh;
+}
+
+void ucncMeshDestroy(ucncMesh *mesh) {
+    if (mesh) {
+        meshFree(mesh);
+    }
+}
+
+void ucncMeshRelease(ucncMesh *mesh) {
+    if (!mesh) {
+        return;
+    }
+    pthread_mutex_lock(&gCacheLock);
+    if (mesh->refCount > 0) {
+        mesh->refCount--;
+    }
+    pthread_mutex_unlock(&gCacheLock);
+}
+
+int ucncMeshCachePurge(void) {
+    ucncMesh *unused = NULL;
+
+    pthread_mutex_lock(&gCacheLock);
+    ucncMesh **link = &gCache;
+    while (*link) {
+        ucncMesh *mesh = *link;
+        if (mesh->refCount == 0 && !mesh->loading) {
+            if (mesh->pending) {
+                atomic_fetch_sub(&gPending, 1);
+            }
+            *link = mesh->next;
+            mesh->next = unused;
+            unused = mesh;
+        } else {
+            link = &mesh->next;
+        }
+    }
+    pthread_mutex_unlock(&gCacheLock);
+
+    // Joining LOD threads can take a while, so free outside the lock
+    int freed = 0;
+    while (unused) {
+        ucncMesh *next = unused->next;
+        meshFree(unused);
+        unused = next;
+        freed++;
+    }
+    return freed;
+}
+
+int ucncMeshCacheSize(void) {
+    int count = 0;
+    pthread_mutex_lock(&gCacheLock);
+    for (ucncMesh *mesh = gCache; mesh; mesh = mesh->next) {
+        count++;
+    }
+    pthread_mutex_unlock(&gCacheLock);
+    return count;
+}
+
+// Cache file of a mesh: the STL name for readability, plus an FNV-1a hash of
+// its resolved path so equally named files in different directories differ
+static int lodCachePath(char *out, size_t size, const char *cacheDir, const char *path) {
+    char *resolved = realpath(path, NULL);
+    const char *key = resolved ? resolved : path;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const unsigned char *c = (const unsigned char *)key; *c; c++) {
+        h ^= *c;
+        h *= 0x100000001b3ull;
+    }
+    free(resolved);
+
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    int ret = snprintf(out, size, "%s/%s.%016llx.lod", cacheDir, base, (unsigned long long)h);
+    return ret >= 0 && ret < (int)size;
+}
+
+// Build or load levels for a mesh whose geometry is loaded
+static int meshBuildLods(ucncMesh *mesh, int levels, const char *cacheDir) {
+    if (levels > UCNC_LOD_MAX_LEVELS) {
+        levels = UCNC_LOD_MAX_LEVELS;
+    }
+
+    pthread_mutex_lock(&mesh->lodLock);
+    int existing = atomic_load_explicit(&mesh->lodCount, memory_order_acquire);
+    if (existing > 0) {
+        pthread_mutex_unlock(&mesh->lodLock);
+        return existing;
+    }
+
+    ucncLodMesh built[UCNC_LOD_MAX_LEVELS];
+    memset(built, 0, sizeof(built));
+
+    char cachePath[1024] = "";
+    if (cacheDir && cacheDir[0] && !lodCachePath(cachePath, sizeof(cachePath), cacheDir, mesh->path)) {
+        cachePath[0] = '\0';
+    }
+
+    int count = cachePath[0] ? ucncLodCacheLoad(cachePath, mesh->path, levels, built) : 0;
+    if (count == 0) {
+        count = ucncLodBuild(mesh->vertices, mesh->triangleCount, levels, built);
+
+        if (count > 0 && cachePath[0]) {
+            ucncLodCacheStore(cachePath, mesh->path, count, built);
+        }
+    }
+
+    // Publish: renderers only look at entries below lodCount
+    memcpy(mesh->lods, built, sizeof(built));
+    atomic_store_explicit(&mesh->lodCount, count, memory_order_release);
+    atomic_fetch_add(&gLodGeneration, 1);
+    pthread_mutex_unlock(&mesh->lodLock);
+    return count;
+}
+
+int ucncMeshBuildLods(ucncMesh *mesh, int levels, const char *cacheDir) {
+    if (!mesh || !atomic_load_explicit(&mesh->visible, memory_order_acquire) || !mesh->vertices ||
+        levels <= 0) {
+        return 0;
+    }
+    return meshBuildLods(mesh, levels, cacheDir);
+}
+
+const ucncBvh *ucncMeshGetBvh(ucncMesh *mesh) {
+    if (!mesh || !atomic_load_explicit(&mesh->visible, memory_order_acquire)) {
+        return NULL;
+    }
+    ucncBvh *bvh = atomic_load_explicit(&mesh->bvh, memory_order_acquire);
+    if (bvh) {
+        return bvh;
+    }
+    pthread_mutex_lock(&mesh->lodLock);
+    bvh = atomic_load_explicit(&mesh->bvh, memory_order_acquire);
+    if (!bvh) {
+        bvh = ucncBvhBuild(mesh->vertices, mesh->triangleCount);
+        atomic_store_explicit(&mesh->bvh, bvh, memory_order_release);
+    }
+    pthread_mutex_unlock(&mesh->lodLock);
+    return bvh;
+}
+
+unsigned long ucncMeshLodGeneration(void) {
+    return atomic_load(&gLodGeneration);
+}
+
+static void *lodBuildThread(void *arg) {
+    LodJob *job = arg;
+    ucncMeshBuildLods(job->mesh, job->levels, job->cacheDir);
+    free(job);
+    return NULL;
+}
+
+void ucncMeshBuildLodsAsync(ucncMesh *mesh, int levels, const char *cacheDir) {
+    if (!mesh || levels <= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&gCacheLock);
+    int started = mesh->lodThreadActive;
+    LodJob *job = started ? NULL : malloc(sizeof(LodJob));
+    if (job) {
+        job->mesh = mesh;
+        job->levels = levels;
+        snprintf(job->cacheDir, sizeof(job->cacheDir), "%s", cacheDir ? cacheDir : "");
+        if (pthread_create(&mesh->lodThread, NULL, lodBuildThread, job) == 0) {
+            mesh->lodThreadActive = 1;
+            started = 1;
+        } else {
+            free(job);
+        }
+    }
+    pthread_mutex_unlock(&gCacheLock);
+
+    // No thread available: build in place
+    if (!started) {
+        ucncMeshBuildLods(mesh, levels, cacheDir);
+    }
+}
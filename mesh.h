@@ -0,0 +1,117 @@
+/* mesh.h */
+
+#ifndef MESH_H
+#define MESH_H
+
+#include "cncvis.h"
+
+#include "libstlio/include/stlio.h"
+#include "bvh.h"
+#include "lod.h"
+
+#include <stdatomic.h>
+
+// STL geometry shared by every actor that references the same file. Meshes
+// live in a process-wide cache keyed by path, file size and mtime, so repeated
+// fixtures load once and configuration reloads reuse what is already parsed.
+typedef struct ucncMesh {
+    char path[1024];                          // Source STL path (cache key)
+    int64_t fileSize;                         // Source size and mtime at load time
+    int64_t fileMtime;
+    const float *vertices;                    // 9 floats per triangle
+    const float *normals;                     // 3 floats per triangle (face normal)
+    unsigned long triangleCount;              // Number of triangles
+    float boundCenterX, boundCenterY, boundCenterZ; // Bounding sphere
+    float boundRadius;
+    void (*releaseData)(void *context);       // Frees borrowed geometry; NULL when
+    void *releaseContext;                     // vertices is our own allocation
+
+    // Level of detail, shared by all users of the mesh
+    ucncLodMesh lods[UCNC_LOD_MAX_LEVELS];    // Simplified meshes, coarsest last
+    atomic_int lodCount;                      // Published number of valid lods
+    pthread_mutex_t lodLock;                  // Serialises level and BVH generation
+    pthread_t lodThread;                      // Background builder, if any
+    int lodThreadActive;
+
+    // Collision hierarchy in mesh-local space, built on first use
+    _Atomic(ucncBvh *) bvh;
+
+    // Background loading (ucncMeshAcquireAsync). Until a commit makes the
+    // geometry visible, renderers draw the proxy box instead.
+    atomic_int visible;                       // Geometry and bounds may be drawn
+    int hasProxy;                             // proxyMin/proxyMax are valid
+    float proxyMin[3], proxyMax[3];           // Box around a sample of the file
+    float loadedBound[4];                     // Loader's bounds, applied on commit
+    pthread_t loadThread;
+    int loadThreadActive;
+
+    // Cache bookkeeping, guarded by the cache lock
+    int refCount;                             // Actors holding the mesh
+    int loading;                              // Still being read by its creator
+    int failed;                               // Loading failed; freed once unreferenced
+    int pending;                              // Async load not committed yet
+    struct ucncMesh *next;
+} ucncMesh;
+
+// Return the cached mesh for path, loading it if it is not cached yet or the
+// file changed since. Each successful call must be paired with
+// ucncMeshRelease. Returns NULL if the file cannot be read.
+ucncMesh *ucncMeshAcquire(const char *path);
+// Geometry that lives outside the cache, e.g. in a mapped scene bundle
+typedef struct {
+    const float *vertices;                    // 9 floats per triangle
+    const float *normals;                     // 3 floats per triangle
+    unsigned long triangleCount;
+    float boundCenter[3];
+    float boundRadius;
+    void (*retain)(void *context);            // Called when the cache adopts the data
+    void (*release)(void *context);           // Called when the adopting mesh is freed
+    void *context;
+} ucncMeshSource;
+
+// Like ucncMeshAcquire, but instead of reading path the mesh is created from
+// source, which must hold the geometry of the file as it was at fileSize and
+// fileMtime. A cached mesh for the same file version takes precedence, in
+// which case source is left alone.
+ucncMesh *ucncMeshAcquireSource(const char *path, int64_t fileSize, int64_t fileMtime,
+                                const ucncMeshSource *source);
+// Like ucncMeshAcquire, but returns without reading the file. A mesh that is
+// not cached yet is loaded on a background thread, which then builds up to
+// lodLevels levels. Its bounds and proxy box come from a sample of the
+// triangles (binary files only) until ucncMeshCacheCommit swaps the real
+// geometry in. Returns NULL only if the file does not exist.
+ucncMesh *ucncMeshAcquireAsync(const char *path, int lodLevels, const char *lodCacheDir);
+// Make the geometry of every finished background load visible; meant to be
+// called between frames. Returns how many meshes changed.
+int ucncMeshCacheCommit(void);
+// Number of background loads that were not committed yet
+int ucncMeshCachePending(void);
+// Wait for a background load of mesh and commit it right away. Returns 1 if
+// the mesh has geometry.
+int ucncMeshWait(ucncMesh *mesh);
+// Drop a reference. Unreferenced meshes stay cached until the next purge so a
+// reload can pick them up again.
+void ucncMeshRelease(ucncMesh *mesh);
+// Free every unreferenced mesh; returns how many were freed
+int ucncMeshCachePurge(void);
+// Number of cached meshes (referenced or not)
+int ucncMeshCacheSize(void);
+
+// Mesh outside the cache with bounds but no triangles, for actors that draw
+// their own geometry. Free it with ucncMeshDestroy.
+ucncMesh *ucncMeshNewBounds(const float min[3], const float max[3]);
+void ucncMeshDestroy(ucncMesh *mesh);
+
+// Generate simplified levels unless they exist; returns the level count.
+// Safe to call from several threads, only one of them does the work.
+int ucncMeshBuildLods(ucncMesh *mesh, int levels, const char *cacheDir);
+// Start ucncMeshBuildLods on a background thread if none was started yet
+void ucncMeshBuildLodsAsync(ucncMesh *mesh, int levels, const char *cacheDir);
+// Bounding volume hierarchy of the mesh, built on the first call. Returns
+// NULL while a background load is not committed.
+const ucncBvh *ucncMeshGetBvh(ucncMesh *mesh);
+
+// Changes whenever any mesh publishes new levels or commits its geometry
+unsigned long ucncMeshLodGeneration(void);
+
+#endif // MESH_H
@@ -0,0 +1,132 @@
+/* motion.c */
+
+#include "motion.h"
+#include <stdatomic.h>
+
+typedef struct {
+  // 2 * index + 1 while sample index is written, 2 * index + 2 once done
+  atomic_ulong sequence;
+  double time;
+  float values[];
+} MotionSlot;
+
+struct ucncMotionRing {
+  int axisCount;
+  unsigned long capacity; // Power of two
+  size_t stride;          // Bytes per slot
+  unsigned char *slots;
+  atomic_ulong head; // Samples pushed so far
+  double lastTime;   // Producer only
+};
+
+static MotionSlot *slotAt(const ucncMotionRing *ring, unsigned long index) {
+  return (MotionSlot *)(ring->slots +
+                        (index & (ring->capacity - 1)) * ring->stride);
+}
+
+ucncMotionRing *ucncMotionRingNew(int axisCount, int capacity) {
+  if (axisCount <= 0 || axisCount > UCNC_MOTION_MAX_AXES || capacity <= 0)
+    return NULL;
+  ucncMotionRing *ring = calloc(1, sizeof(ucncMotionRing));
+  if (!ring) {
+    fprintf(stderr, "Memory allocation failed for motion ring.\n");
+    return NULL;
+  }
+  ring->axisCount = axisCount;
+  ring->capacity = 1;
+  while (ring->capacity < (unsigned long)capacity)
+    ring->capacity <<= 1;
+  ring->stride =
+      (sizeof(MotionSlot) + axisCount * sizeof(float) + 7) & ~(size_t)7;
+  ring->slots = calloc(ring->capacity, ring->stride);
+  if (!ring->slots) {
+    fprintf(stderr, "Memory allocation failed for motion ring.\n");
+    free(ring);
+    return NULL;
+  }
+  for (unsigned long i = 0; i < ring->capacity; i++)
+    atomic_init(&slotAt(ring, i)->sequence, 0);
+  atomic_init(&ring->head, 0);
+  return ring;
+}
+
+void ucncMotionRingFree(ucncMotionRing *ring) {
+  if (!ring)
+    return;
+  free(ring->slots);
+  free(ring);
+}
+
+int ucncMotionRingAxisCount(const ucncMotionRing *ring) {
+  return ring ? ring->axisCount : 0;
+}
+
+int ucncMotionRingPush(ucncMotionRing *ring, double time,
+                       const float *values) {
+  if (!ring || !values)
+    return -1;
+  unsigned long index = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (index > 0 && time < ring->lastTime)
+    return -1;
+  MotionSlot *slot = slotAt(ring, index);
+  atomic_store_explicit(&slot->sequence, 2 * index + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->time = time;
+  memcpy(slot->values, values, ring->axisCount * sizeof(float));
+  atomic_store_explicit(&slot->sequence, 2 * index + 2, memory_order_release);
+  atomic_store_explicit(&ring->head, index + 1, memory_order_release);
+  ring->lastTime = time;
+  return 0;
+}
+
+// Copy sample index out of its slot; 0 if the producer has moved past it
+static int readSample(const ucncMotionRing *ring, unsigned long index,
+                      double *time, float *values) {
+  MotionSlot *slot = slotAt(ring, index);
+  unsigned long sequence =
+      atomic_load_explicit(&slot->sequence, memory_order_acquire);
+  if (sequence != 2 * index + 2)
+    return 0;
+  *time = slot->time;
+  memcpy(values, slot->values, ring->axisCount * sizeof(float));
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&slot->sequence, memory_order_relaxed) ==
+         sequence;
+}
+
+int ucncMotionRingSample(ucncMotionRing *ring, double time, float *values) {
+  if (!ring || !values)
+    return -1;
+  float later[UCNC_MOTION_MAX_AXES], earlier[UCNC_MOTION_MAX_AXES];
+  double laterTime, earlierTime;
+  size_t bytes = ring->axisCount * sizeof(float);
+  for (;;) {
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == 0)
+      return -1;
+    if (!readSample(ring, head - 1, &laterTime, later))
+      continue; // Lapped by the producer since loading head
+    if (time >= laterTime) {
+      memcpy(values, later, bytes);
+      return 0;
+    }
+
+    // Walk back to the sample at or before the requested time
+    unsigned long oldest = head > ring->capacity ? head - ring->capacity : 0;
+    for (unsigned long i = head - 1; i-- > oldest;) {
+      if (!readSample(ring, i, &earlierTime, earlier))
+        break; // Overwritten: hold the oldest sample read
+      if (earlierTime <= time) {
+        float span = (float)(laterTime - earlierTime);
+        float t = span > 0.0f ? (float)(time - earlierTime) / span : 1.0f;
+        for (int k = 0; k < ring->axisCount; k++)
+          values[k] = earlier[k] + t * (later[k] - earlier[k]);
+        return 0;
+      }
+      laterTime = earlierTime;
+      memcpy(later, earlier, bytes);
+    }
+    memcpy(values, later, bytes);
+    return 0;
+  }
+}
@@ -0,0 +1,35 @@
+/* motion.h */
+
+#ifndef MOTION_H
+#define MOTION_H
+
+#include "cncvis.h"
+
+#define UCNC_MOTION_MAX_AXES 32 // Values per sample at most
+
+// Ring of timestamped joint vectors between a controller thread and the
+// renderer. One producer pushes samples at servo rate and never blocks or
+// waits for readers: once the ring is full the oldest samples are
+// overwritten. Readers (any number, on any thread) get a consistent joint
+// vector interpolated to a given time. Each slot carries a sequence number
+// written before and after its data, so a reader that raced with the
+// producer notices and retries instead of returning a torn pose.
+typedef struct ucncMotionRing ucncMotionRing;
+
+// capacity samples of axisCount values; capacity is rounded up to a power
+// of two
+ucncMotionRing *ucncMotionRingNew(int axisCount, int capacity);
+void ucncMotionRingFree(ucncMotionRing *ring);
+int ucncMotionRingAxisCount(const ucncMotionRing *ring);
+
+// Producer side: append a sample. Times (in ms, e.g. getCurrentTimeInMs)
+// must not decrease; -1 if this one does.
+int ucncMotionRingPush(ucncMotionRing *ring, double time,
+                       const float *values);
+
+// Reader side: joint vector at the given time, interpolated between the two
+// samples around it and held at the newest (or oldest still in the ring)
+// outside them. -1 while the ring is empty.
+int ucncMotionRingSample(ucncMotionRing *ring, double time, float *values);
+
+#endif // MOTION_H
@@ -2,21 +2,30 @@
 #include <stdarg.h>
 
 // Global variables
-static ZBuffer* gFrameBuffer = NULL;
-static OSDStyle gDefaultStyle = {1.0f, 1.0f, 1.0f, 1.0f, 1}; // White, normal scale, normal spacing
+static OSDContext gSharedContext = OSD_CONTEXT_INIT;
+static _Thread_local OSDContext* gContext = NULL; // NULL: gSharedContext
+
+static OSDContext* currentContext(void) {
+    return gContext ? gContext : &gSharedContext;
+}
+
+void osdMakeCurrent(OSDContext* context) {
+    gContext = context;
+}
 
 // Initialize the OSD system
 void osdInit(ZBuffer* frameBuffer) {
-    gFrameBuffer = frameBuffer;
+    currentContext()->frameBuffer = frameBuffer;
 }
 
 // Set default style
 void osdSetDefaultStyle(float r, float g, float b, float scale, int spacing) {
-    gDefaultStyle.r = r;
-    gDefaultStyle.g = g;
-    gDefaultStyle.b = b;
-    gDefaultStyle.scale = scale;
-    gDefaultStyle.spacing = spacing;
+    OSDStyle* style = &currentContext()->defaultStyle;
+    style->r = r;
+    style->g = g;
+    style->b = b;
+    style->scale = scale;
+    style->spacing = spacing;
 }
 
 // Calculate text width in pixels
@@ -28,7 +37,7 @@ int calculateTextWidth(const char* text, float scale, int spacing) {
 
 // Draw text with the given style
 void osdDrawTextStyled(const char* text, int x, int y, OSDTextAlign align, const OSDStyle* style) {
-    if (!gFrameBuffer || !text || !style)
+    if (!currentContext()->frameBuffer || !text || !style)
         return;
     
     // Set the text size based on our scale
@@ -62,7 +71,7 @@ void osdDrawTextStyled(const char* text, int x, int y, OSDTextAlign align, const
 
 // Draw text with default style
 void osdDrawText(const char* text, int x, int y, OSDTextAlign align) {
-    osdDrawTextStyled(text, x, y, align, &gDefaultStyle);
+    osdDrawTextStyled(text, x, y, align, &currentContext()->defaultStyle);
 }
 
 // Format and draw text (printf style)
@@ -79,7 +88,8 @@ void osdDrawTextf(int x, int y, OSDTextAlign align, const char* format, ...) {
 
 // Draw a rectangle background (for text highlighting)
 void osdDrawRect(int x, int y, int width, int height, float r, float g, float b, float alpha) {
-    if (!gFrameBuffer)
+    ZBuffer* frameBuffer = currentContext()->frameBuffer;
+    if (!frameBuffer)
         return;
     
     // Convert RGB to pixel format
@@ -89,29 +99,24 @@ void osdDrawRect(int x, int y, int width, int height, float r, float g, float b,
     uint32_t color = (ri << 16) | (gi << 8) | bi;
     
     // Clamp coordinates to screen bounds
-    int x1 = (x < 0) ? 0 : (x >= gFrameBuffer->xsize) ? gFrameBuffer->xsize - 1 : x;
-    int y1 = (y < 0) ? 0 : (y >= gFrameBuffer->ysize) ? gFrameBuffer->ysize - 1 : y;
-    int x2 = (x + width < 0) ? 0 : (x + width >= gFrameBuffer->xsize) ? gFrameBuffer->xsize - 1 : x + width;
-    int y2 = (y + height < 0) ? 0 : (y + height >= gFrameBuffer->ysize) ? gFrameBuffer->ysize - 1 : y + height;
+    int x1 = (x < 0) ? 0 : (x >= frameBuffer->xsize) ? frameBuffer->xsize - 1 : x;
+    int y1 = (y < 0) ? 0 : (y >= frameBuffer->ysize) ? frameBuffer->ysize - 1 : y;
+    int x2 = (x + width < 0) ? 0 : (x + width >= frameBuffer->xsize) ? frameBuffer->xsize - 1 : x + width;
+    int y2 = (y + height < 0) ? 0 : (y + height >= frameBuffer->ysize) ? frameBuffer->ysize - 1 : y + height;
     
     // Draw filled rectangle
     for (int py = y1; py <= y2; py++) {
+        const PIXEL *row = (const PIXEL *)((const GLbyte *)frameBuffer->pbuf +
+                                           py * frameBuffer->linesize);
         for (int px = x1; px <= x2; px++) {
-            // If alpha is less than 1, blend with existing pixel
+            // If alpha is less than 1, blend with existing pixel (32-bit or
+            // RGB565, whichever TinyGL renders)
             if (alpha < 1.0f) {
-                // Get existing pixel - we'll use direct buffer access
-                int offset = py * gFrameBuffer->linesize / 4 + px;
-                uint32_t *framebuf = (uint32_t*)gFrameBuffer->pbuf;
-                uint32_t existing = framebuf[offset];
-                
-                uint8_t er = (existing >> 16) & 0xFF;
-                uint8_t eg = (existing >> 8) & 0xFF;
-                uint8_t eb = existing & 0xFF;
-                
-                ri = (uint8_t)(er * (1.0f - alpha) + ri * alpha);
-                gi = (uint8_t)(eg * (1.0f - alpha) + gi * alpha);
-                bi = (uint8_t)(eb * (1.0f - alpha) + bi * alpha);
-                color = (ri << 16) | (gi << 8) | bi;
+                PIXEL existing = row[px];
+                uint8_t br = (uint8_t)(GET_RED(existing) * (1.0f - alpha) + ri * alpha);
+                uint8_t bg = (uint8_t)(GET_GREEN(existing) * (1.0f - alpha) + gi * alpha);
+                uint8_t bb = (uint8_t)(GET_BLUE(existing) * (1.0f - alpha) + bi * alpha);
+                color = (br << 16) | (bg << 8) | bb;
             }
             
             // Plot the pixel using TinyGL's function
@@ -24,9 +24,21 @@ typedef struct {
     int spacing;       // Character spacing
 } OSDStyle;
 
+// What osdInit and osdSetDefaultStyle set up
+typedef struct {
+    ZBuffer* frameBuffer;
+    OSDStyle defaultStyle;
+} OSDContext;
+
+#define OSD_CONTEXT_INIT {NULL, {1.0f, 1.0f, 1.0f, 1.0f, 1}} // White, normal scale, normal spacing
+
 // Initialize the OSD system
 void osdInit(ZBuffer* frameBuffer);
 
+// Draw through context on the calling thread, e.g. one per cncvis instance;
+// NULL returns to the context shared by all other threads
+void osdMakeCurrent(OSDContext* context);
+
 // Set default style
 void osdSetDefaultStyle(float r, float g, float b, float scale, int spacing);
 
@@ -0,0 +1,264 @@
+/* shmexport.c */
+
+#define _DEFAULT_SOURCE // ftruncate and syscall with -std=c11
+
+#include "shmexport.h"
+#include "utils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+struct ucncShmExport {
+  char name[256];
+  ucncShmHeader *header;
+  size_t size;
+  uint64_t frames; // Published so far
+};
+
+struct ucncShmReader {
+  const ucncShmHeader *header;
+  size_t size;
+};
+
+static size_t slotBytes(int width, int height, int withDepth) {
+  size_t pixels = (size_t)width * height;
+  size_t bytes = sizeof(ucncShmSlot) + pixels * sizeof(PIXEL);
+  if (withDepth)
+    bytes += pixels * sizeof(uint16_t);
+  return (bytes + 63) & ~(size_t)63;
+}
+
+static ucncShmSlot *slotAt(const ucncShmHeader *header, unsigned index) {
+  return (ucncShmSlot *)((unsigned char *)header + header->headerBytes +
+                         index * header->slotBytes);
+}
+
+static void wakeReaders(atomic_uint *word) {
+#ifdef __linux__
+  syscall(SYS_futex, word, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+#else
+  (void)word; // Readers poll
+#endif
+}
+
+ucncShmExport *ucncShmExportNew(const char *name, int width, int height,
+                                int slotCount, int withDepth) {
+  if (!name || strlen(name) >= sizeof(((ucncShmExport *)0)->name) ||
+      width <= 0 || height <= 0 || slotCount < 2 ||
+      slotCount > UCNC_SHM_MAX_SLOTS)
+    return NULL;
+  ucncShmExport *exporter = calloc(1, sizeof(*exporter));
+  if (!exporter)
+    return NULL;
+  snprintf(exporter->name, sizeof(exporter->name), "%s", name);
+
+  size_t headerBytes = (sizeof(ucncShmHeader) + 63) & ~(size_t)63;
+  size_t bytes = slotBytes(width, height, withDepth);
+  exporter->size = headerBytes + slotCount * bytes;
+  shm_unlink(name); // Readers of an old object keep their mapping
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0 || ftruncate(fd, exporter->size) != 0) {
+    fprintf(stderr, "Failed to create shared memory '%s'.\n", name);
+    if (fd >= 0) {
+      close(fd);
+      shm_unlink(name);
+    }
+    free(exporter);
+    return NULL;
+  }
+  void *map =
+      mmap(NULL, exporter->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    shm_unlink(name);
+    free(exporter);
+    return NULL;
+  }
+
+  // The object starts zeroed; fill in the layout, magic last
+  ucncShmHeader *header = map;
+  header->version = UCNC_SHM_VERSION;
+  header->slotCount = slotCount;
+  header->width = width;
+  header->height = height;
+  header->pixelBytes = sizeof(PIXEL);
+  header->hasDepth = withDepth != 0;
+  header->headerBytes = headerBytes;
+  header->slotBytes = bytes;
+  atomic_init(&header->latest, 0);
+  atomic_init(&header->published, 0);
+  for (int i = 0; i < slotCount; i++)
+    atomic_init(&slotAt(header, i)->sequence, 0);
+  atomic_thread_fence(memory_order_release);
+  memcpy(header->magic, UCNC_SHM_MAGIC, sizeof(UCNC_SHM_MAGIC));
+  exporter->header = header;
+  return exporter;
+}
+
+void ucncShmExportFree(ucncShmExport *exporter) {
+  if (!exporter)
+    return;
+  munmap(exporter->header, exporter->size);
+  shm_unlink(exporter->name);
+  free(exporter);
+}
+
+int ucncShmExportPublish(ucncShmExport *exporter,
+                         const ZBuffer *framebuffer) {
+  if (!exporter || !framebuffer)
+    return -1;
+  ucncShmHeader *header = exporter->header;
+  int w = framebuffer->xsize, h = framebuffer->ysize;
+  if ((uint32_t)w != header->width || (uint32_t)h != header->height)
+    return -1;
+
+  // Never the slot readers are told to use
+  unsigned index =
+      exporter->frames == 0
+          ? 0
+          : (atomic_load_explicit(&header->latest, memory_order_relaxed) + 1) %
+                header->slotCount;
+  ucncShmSlot *slot = slotAt(header, index);
+  uint64_t frame = exporter->frames;
+  atomic_store_explicit(&slot->sequence, 2 * frame + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  slot->time = getCurrentTimeInMs();
+  PIXEL *pixels = (PIXEL *)(slot + 1);
+  for (int y = 0; y < h; y++)
+    memcpy(pixels + (size_t)y * w,
+           (const unsigned char *)framebuffer->pbuf +
+               (size_t)y * framebuffer->linesize,
+           w * sizeof(PIXEL));
+  if (header->hasDepth)
+    memcpy(pixels + (size_t)w * h, framebuffer->zbuf,
+           (size_t)w * h * sizeof(uint16_t));
+
+  atomic_store_explicit(&slot->sequence, 2 * frame + 2, memory_order_release);
+  atomic_store_explicit(&header->latest, index, memory_order_release);
+  atomic_store_explicit(&header->published, (unsigned)(frame + 1),
+                        memory_order_release);
+  exporter->frames++;
+  wakeReaders(&header->published);
+  return 0;
+}
+
+// Whether the header describes slots that hold its frames and fit in size
+// bytes, so every slot, pixel and depth value the reader hands out is mapped
+static int headerValid(const ucncShmHeader *header, size_t size) {
+  if (memcmp(header->magic, UCNC_SHM_MAGIC, sizeof(UCNC_SHM_MAGIC)) != 0 ||
+      header->version != UCNC_SHM_VERSION ||
+      header->pixelBytes != sizeof(PIXEL) || header->slotCount == 0 ||
+      header->width == 0 || header->height == 0 ||
+      header->width > UINT16_MAX || header->height > UINT16_MAX ||
+      header->headerBytes < sizeof(ucncShmHeader) ||
+      header->headerBytes % 8 != 0 || header->slotBytes % 8 != 0 ||
+      header->headerBytes > size)
+    return 0;
+  if (header->slotBytes < slotBytes((int)header->width, (int)header->height,
+                                    header->hasDepth != 0))
+    return 0;
+  return header->slotBytes <= (size - header->headerBytes) / header->slotCount;
+}
+
+ucncShmReader *ucncShmReaderOpen(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ucncShmHeader))
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const ucncShmHeader *header = map;
+  if (!headerValid(header, st.st_size)) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  ucncShmReader *reader = calloc(1, sizeof(*reader));
+  if (!reader) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  reader->header = header;
+  reader->size = st.st_size;
+  return reader;
+}
+
+void ucncShmReaderClose(ucncShmReader *reader) {
+  if (!reader)
+    return;
+  munmap((void *)reader->header, reader->size);
+  free(reader);
+}
+
+const ucncShmHeader *ucncShmReaderHeader(const ucncShmReader *reader) {
+  return reader ? reader->header : NULL;
+}
+
+int ucncShmReaderAcquire(ucncShmReader *reader, ucncShmFrame *frame) {
+  if (!reader || !frame)
+    return -1;
+  const ucncShmHeader *header = reader->header;
+  for (;;) {
+    if (atomic_load_explicit((atomic_uint *)&header->published,
+                             memory_order_acquire) == 0)
+      return -1;
+    unsigned index = atomic_load_explicit((atomic_uint *)&header->latest,
+                                          memory_order_acquire);
+    ucncShmSlot *slot = slotAt(header, index % header->slotCount);
+    unsigned long long sequence =
+        atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence == 0 || sequence & 1)
+      continue; // The renderer moved on to this slot already; look again
+
+    size_t pixels = (size_t)header->width * header->height;
+    frame->pixels = slot + 1;
+    frame->depth = header->hasDepth
+                       ? (const uint16_t *)((const PIXEL *)(slot + 1) + pixels)
+                       : NULL;
+    frame->frame = sequence / 2 - 1;
+    frame->time = slot->time;
+    frame->slot = slot;
+    frame->sequence = sequence;
+    return 0;
+  }
+}
+
+int ucncShmReaderRelease(ucncShmReader *reader, const ucncShmFrame *frame) {
+  if (!reader || !frame || !frame->slot)
+    return -1;
+  atomic_thread_fence(memory_order_acquire);
+  unsigned long long sequence = atomic_load_explicit(
+      (atomic_ullong *)&frame->slot->sequence, memory_order_relaxed);
+  return sequence == frame->sequence ? 0 : -1;
+}
+
+int ucncShmReaderWait(ucncShmReader *reader, unsigned seen, int timeoutMs) {
+  if (!reader)
+    return -1;
+  atomic_uint *word = (atomic_uint *)&reader->header->published;
+  double deadline = getCurrentTimeInMs() + timeoutMs;
+  for (;;) {
+    if (atomic_load_explicit(word, memory_order_acquire) != seen)
+      return 0;
+    double left = deadline - getCurrentTimeInMs();
+    if (left <= 0.0)
+      return -1;
+#ifdef __linux__
+    struct timespec timeout = {(time_t)(left / 1000.0),
+                               (long)(fmod(left, 1000.0) * 1e6)};
+    syscall(SYS_futex, word, FUTEX_WAIT, seen, &timeout, NULL, 0);
+#else
+    usleep(1000); // No futex: poll each millisecond
+#endif
+  }
+}
@@ -0,0 +1,83 @@
+/* shmexport.h */
+
+#ifndef SHMEXPORT_H
+#define SHMEXPORT_H
+
+#include "cncvis.h"
+#include <stdatomic.h>
+
+#define UCNC_SHM_MAGIC "UCNCSHM" // Followed by a zero byte
+#define UCNC_SHM_VERSION 1
+#define UCNC_SHM_MAX_SLOTS 3
+
+// Finished frames published to another process (an HMI, a recorder)
+// through a POSIX shared-memory object with two or three frame slots. The
+// renderer copies each frame into the slot after the newest one and never
+// waits for readers. Readers map the object and use the newest frame in
+// place; a per-slot sequence number, odd while the slot is written, tells
+// them afterwards whether the renderer came round to the slot meanwhile.
+// With three slots that takes two more frames, so a reader has about two
+// frame times to consume one. Readers can sleep on the published counter
+// (a futex on Linux) instead of polling.
+//
+// Layout, in the writer's native byte order: the header below, then slotCount
+// slots of slotBytes each at headerBytes. A slot is its ucncShmSlot header,
+// the frame's PIXELs (width * height * pixelBytes) and, with depth, its
+// 16-bit depth values (width * height * 2).
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t width, height;
+  uint32_t pixelBytes; // 4 for 32-bit 0x00RRGGBB, 2 for RGB565
+  uint32_t hasDepth;
+  uint64_t headerBytes;
+  uint64_t slotBytes;
+  atomic_uint latest;    // Slot of the newest complete frame
+  atomic_uint published; // Frames published so far (wraps); futex word
+} ucncShmHeader;
+
+typedef struct {
+  // 2 * frame + 1 while that frame is written, 2 * frame + 2 once done;
+  // frames count from 0
+  atomic_ullong sequence;
+  double time; // getCurrentTimeInMs at publication
+  uint64_t pad[6]; // Pixels start on a cache line
+} ucncShmSlot;
+
+// Renderer side. name is a shm_open name such as "/cncvis"; an existing
+// object of that name is replaced. The object is unlinked on free.
+typedef struct ucncShmExport ucncShmExport;
+ucncShmExport *ucncShmExportNew(const char *name, int width, int height,
+                                int slotCount, int withDepth);
+void ucncShmExportFree(ucncShmExport *exporter);
+// Copy the framebuffer into the next slot and wake waiting readers; -1 for
+// a framebuffer of another size
+int ucncShmExportPublish(ucncShmExport *exporter, const ZBuffer *framebuffer);
+
+// Reader side
+typedef struct ucncShmReader ucncShmReader;
+ucncShmReader *ucncShmReaderOpen(const char *name);
+void ucncShmReaderClose(ucncShmReader *reader);
+const ucncShmHeader *ucncShmReaderHeader(const ucncShmReader *reader);
+
+// A frame in the shared mapping, read in place
+typedef struct {
+  const void *pixels;           // width * height PIXELs
+  const uint16_t *depth;        // NULL without depth
+  uint64_t frame;               // Index of the frame, from 0
+  double time;
+  const ucncShmSlot *slot;
+  unsigned long long sequence;
+} ucncShmFrame;
+
+// The newest complete frame; -1 if none was published yet
+int ucncShmReaderAcquire(ucncShmReader *reader, ucncShmFrame *frame);
+// After using an acquired frame: 0 if it stayed intact, -1 if the renderer
+// overwrote it meanwhile and what was read must be discarded
+int ucncShmReaderRelease(ucncShmReader *reader, const ucncShmFrame *frame);
+// Sleep until the published counter differs from seen (e.g. the frame of
+// the last acquire plus one) or timeoutMs passes; 0 if it did
+int ucncShmReaderWait(ucncShmReader *reader, unsigned seen, int timeoutMs);
+
+#endif // SHMEXPORT_H
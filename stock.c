@@ -0,0 +1,505 @@
+/* stock.c */
+
+#include "stock.h"
+
+#include <float.h>
+#include <stdatomic.h>
+
+// A queued cut carries the tool it was made with
+typedef struct {
+  float from[3], to[3];
+  float radius;
+  int ballEnd;
+} StockCut;
+
+// Surface patch of UCNC_STOCK_TILE x UCNC_STOCK_TILE quads between cell
+// centers. Neighbouring tiles share their edge vertices. Vertices hold the
+// height and the normal; the worker fills back while front is drawn.
+typedef struct {
+  int i0, j0; // First cell
+  int w, h;   // Quads in x and y
+  float *front, *back;
+  int dirty;
+} StockTile;
+
+struct ucncStock {
+  float x0, y0, cell;
+  float bottom, top;
+  int nx, ny;
+  float *heights; // nx * ny, written by the worker only
+  StockTile *tiles;
+  int tilesX, tilesY;
+  int *dirtyTiles; // Worker only
+  int dirtyCount;
+  float color[3];
+
+  pthread_mutex_t lock; // Guards the queue and the tool
+  pthread_cond_t work, idle;
+  StockCut *queue, *spare;
+  int queueCount, queueCapacity, spareCapacity;
+  unsigned long queued, applied;
+  float radius;
+  int ballEnd;
+  int quit;
+  pthread_t worker;
+  int workerStarted;
+
+  pthread_mutex_t meshLock; // Held while drawing and swapping tile buffers
+  atomic_ulong generation;
+};
+
+#define VERTEX_FLOATS 4 // Height, normal
+
+static float cellHeight(const ucncStock *stock, int i, int j) {
+  i = i < 0 ? 0 : (i >= stock->nx ? stock->nx - 1 : i);
+  j = j < 0 ? 0 : (j >= stock->ny ? stock->ny - 1 : j);
+  return stock->heights[j * stock->nx + i];
+}
+
+// Rebuild a tile's vertices from the heights and publish them
+static int remeshTile(ucncStock *stock, StockTile *tile) {
+  size_t count = (size_t)(tile->w + 1) * (tile->h + 1);
+  if (!tile->back && !(tile->back = malloc(count * VERTEX_FLOATS *
+                                           sizeof(float))))
+    return 0;
+  float *v = tile->back;
+  float scale = 0.5f / stock->cell;
+  for (int b = 0; b <= tile->h; b++) {
+    int j = tile->j0 + b;
+    for (int a = 0; a <= tile->w; a++) {
+      int i = tile->i0 + a;
+      float dx = (cellHeight(stock, i + 1, j) - cellHeight(stock, i - 1, j)) *
+                 scale;
+      float dy = (cellHeight(stock, i, j + 1) - cellHeight(stock, i, j - 1)) *
+                 scale;
+      float len = sqrtf(dx * dx + dy * dy + 1.0f);
+      v[0] = stock->heights[j * stock->nx + i];
+      v[1] = -dx / len;
+      v[2] = -dy / len;
+      v[3] = 1.0f / len;
+      v += VERTEX_FLOATS;
+    }
+  }
+  pthread_mutex_lock(&stock->meshLock);
+  float *swap = tile->front;
+  tile->front = tile->back;
+  tile->back = swap;
+  pthread_mutex_unlock(&stock->meshLock);
+  return 1;
+}
+
+// Queue the tiles whose vertices or normals use cells i0..i1 x j0..j1
+static void markDirty(ucncStock *stock, int i0, int j0, int i1, int j1) {
+  i0 = i0 > 1 ? i0 - 1 : 0;
+  j0 = j0 > 1 ? j0 - 1 : 0;
+  int tx0 = i0 > 0 ? (i0 - 1) / UCNC_STOCK_TILE : 0;
+  int ty0 = j0 > 0 ? (j0 - 1) / UCNC_STOCK_TILE : 0;
+  int tx1 = (i1 + 1) / UCNC_STOCK_TILE, ty1 = (j1 + 1) / UCNC_STOCK_TILE;
+  if (tx1 >= stock->tilesX)
+    tx1 = stock->tilesX - 1;
+  if (ty1 >= stock->tilesY)
+    ty1 = stock->tilesY - 1;
+  for (int ty = ty0; ty <= ty1; ty++) {
+    for (int tx = tx0; tx <= tx1; tx++) {
+      int index = ty * stock->tilesX + tx;
+      if (!stock->tiles[index].dirty) {
+        stock->tiles[index].dirty = 1;
+        stock->dirtyTiles[stock->dirtyCount++] = index;
+      }
+    }
+  }
+}
+
+// Lowest point of the tool over the cell centered at (cx, cy) during the
+// move, or FLT_MAX if it never covers it
+static float toolBottom(const StockCut *cut, float cx, float cy, float cell) {
+  float fx = cut->from[0], fy = cut->from[1], fz = cut->from[2];
+  float dx = cut->to[0] - fx, dy = cut->to[1] - fy, dz = cut->to[2] - fz;
+  float px = cx - fx, py = cy - fy;
+  float r2 = cut->radius * cut->radius;
+
+  // Part of the move where the tool axis is within the radius
+  float a = dx * dx + dy * dy, b = px * dx + py * dy;
+  float c = px * px + py * py - r2;
+  float t0 = 0.0f, t1 = 1.0f;
+  if (a > 1e-12f) {
+    float disc = b * b - a * c;
+    if (disc < 0.0f)
+      return FLT_MAX;
+    float root = sqrtf(disc);
+    t0 = (b - root) / a;
+    t1 = (b + root) / a;
+    t0 = t0 < 0.0f ? 0.0f : t0;
+    t1 = t1 > 1.0f ? 1.0f : t1;
+    if (t0 > t1)
+      return FLT_MAX;
+  } else if (c > 0.0f) {
+    return FLT_MAX;
+  }
+
+  if (!cut->ballEnd) {
+    // The flat bottom is lowest at one end of that part
+    float z0 = fz + t0 * dz, z1 = fz + t1 * dz;
+    return z0 < z1 ? z0 : z1;
+  }
+
+  // Ball end: sample the part at half-cell steps plus the closest approach
+  float length = sqrtf(a) * (t1 - t0);
+  int steps = (int)(length * 2.0f / cell) + 1;
+  float closest = a > 1e-12f ? b / a : 0.0f;
+  closest = closest < t0 ? t0 : (closest > t1 ? t1 : closest);
+  float lowest = FLT_MAX;
+  for (int s = 0; s <= steps + 1; s++) {
+    float t = s <= steps ? t0 + (t1 - t0) * s / steps : closest;
+    float ex = px - t * dx, ey = py - t * dy;
+    float d2 = ex * ex + ey * ey;
+    if (d2 > r2)
+      continue;
+    float z = fz + t * dz + cut->radius - sqrtf(r2 - d2);
+    if (z < lowest)
+      lowest = z;
+  }
+  return lowest;
+}
+
+// Lower the cells under the swept footprint of a cut
+static void applyCut(ucncStock *stock, const StockCut *cut) {
+  float r = cut->radius;
+  float lo[2], hi[2];
+  for (int k = 0; k < 2; k++) {
+    lo[k] = (cut->from[k] < cut->to[k] ? cut->from[k] : cut->to[k]) - r;
+    hi[k] = (cut->from[k] < cut->to[k] ? cut->to[k] : cut->from[k]) + r;
+  }
+  if ((cut->from[2] < cut->to[2] ? cut->from[2] : cut->to[2]) >= stock->top)
+    return; // Entirely above the stock
+  int i0 = (int)floorf((lo[0] - stock->x0) / stock->cell - 0.5f) + 1;
+  int i1 = (int)floorf((hi[0] - stock->x0) / stock->cell - 0.5f);
+  int j0 = (int)floorf((lo[1] - stock->y0) / stock->cell - 0.5f) + 1;
+  int j1 = (int)floorf((hi[1] - stock->y0) / stock->cell - 0.5f);
+  i0 = i0 < 0 ? 0 : i0;
+  j0 = j0 < 0 ? 0 : j0;
+  i1 = i1 >= stock->nx ? stock->nx - 1 : i1;
+  j1 = j1 >= stock->ny ? stock->ny - 1 : j1;
+
+  int ci0 = stock->nx, cj0 = stock->ny, ci1 = -1, cj1 = -1;
+  for (int j = j0; j <= j1; j++) {
+    float cy = stock->y0 + (j + 0.5f) * stock->cell;
+    float *row = &stock->heights[j * stock->nx];
+    for (int i = i0; i <= i1; i++) {
+      float cx = stock->x0 + (i + 0.5f) * stock->cell;
+      float z = toolBottom(cut, cx, cy, stock->cell);
+      if (z < stock->bottom)
+        z = stock->bottom;
+      if (z >= row[i])
+        continue;
+      row[i] = z;
+      ci0 = i < ci0 ? i : ci0;
+      ci1 = i > ci1 ? i : ci1;
+      cj0 = j < cj0 ? j : cj0;
+      cj1 = j > cj1 ? j : cj1;
+    }
+  }
+  if (ci1 >= 0)
+    markDirty(stock, ci0, cj0, ci1, cj1);
+}
+
+static void *stockWorker(void *arg) {
+  ucncStock *stock = arg;
+  pthread_mutex_lock(&stock->lock);
+  for (;;) {
+    while (!stock->quit && stock->queueCount == 0)
+      pthread_cond_wait(&stock->work, &stock->lock);
+    if (stock->quit)
+      break;
+
+    // Take the whole queue; the producer continues in the spare array
+    StockCut *cuts = stock->queue;
+    int count = stock->queueCount, capacity = stock->queueCapacity;
+    stock->queue = stock->spare;
+    stock->queueCapacity = stock->spareCapacity;
+    stock->queueCount = 0;
+    pthread_mutex_unlock(&stock->lock);
+
+    for (int i = 0; i < count; i++)
+      applyCut(stock, &cuts[i]);
+    for (int i = 0; i < stock->dirtyCount; i++) {
+      StockTile *tile = &stock->tiles[stock->dirtyTiles[i]];
+      if (!remeshTile(stock, tile))
+        fprintf(stderr, "Memory allocation failed for stock tile.\n");
+      tile->dirty = 0;
+    }
+    if (stock->dirtyCount > 0)
+      atomic_fetch_add(&stock->generation, 1);
+    stock->dirtyCount = 0;
+
+    pthread_mutex_lock(&stock->lock);
+    stock->spare = cuts;
+    stock->spareCapacity = capacity;
+    stock->applied += count;
+    pthread_cond_broadcast(&stock->idle);
+  }
+  pthread_mutex_unlock(&stock->lock);
+  return NULL;
+}
+
+ucncStock *ucncStockNew(float x0, float y0, float sizeX, float sizeY,
+                        float bottom, float top, float cellSize) {
+  if (cellSize <= 0.0f || sizeX < 2.0f * cellSize ||
+      sizeY < 2.0f * cellSize || top < bottom) {
+    fprintf(stderr, "Invalid stock dimensions.\n");
+    return NULL;
+  }
+  ucncStock *stock = calloc(1, sizeof(ucncStock));
+  if (!stock) {
+    fprintf(stderr, "Memory allocation failed for stock.\n");
+    return NULL;
+  }
+  stock->x0 = x0;
+  stock->y0 = y0;
+  stock->cell = cellSize;
+  stock->bottom = bottom;
+  stock->top = top;
+  stock->nx = (int)ceilf(sizeX / cellSize);
+  stock->ny = (int)ceilf(sizeY / cellSize);
+  stock->tilesX = (stock->nx - 2) / UCNC_STOCK_TILE + 1;
+  stock->tilesY = (stock->ny - 2) / UCNC_STOCK_TILE + 1;
+  stock->color[0] = 0.75f;
+  stock->color[1] = 0.75f;
+  stock->color[2] = 0.8f;
+  stock->radius = 3.0f;
+  pthread_mutex_init(&stock->lock, NULL);
+  pthread_mutex_init(&stock->meshLock, NULL);
+  pthread_cond_init(&stock->work, NULL);
+  pthread_cond_init(&stock->idle, NULL);
+  atomic_init(&stock->generation, 0);
+
+  int tileCount = stock->tilesX * stock->tilesY;
+  size_t cells = (size_t)stock->nx * stock->ny;
+  stock->heights = malloc(cells * sizeof(float));
+  stock->tiles = calloc(tileCount, sizeof(StockTile));
+  stock->dirtyTiles = malloc(tileCount * sizeof(int));
+  if (!stock->heights || !stock->tiles || !stock->dirtyTiles) {
+    fprintf(stderr, "Memory allocation failed for stock.\n");
+    ucncStockFree(stock);
+    return NULL;
+  }
+  for (size_t i = 0; i < cells; i++)
+    stock->heights[i] = top;
+  for (int ty = 0; ty < stock->tilesY; ty++) {
+    for (int tx = 0; tx < stock->tilesX; tx++) {
+      StockTile *tile = &stock->tiles[ty * stock->tilesX + tx];
+      tile->i0 = tx * UCNC_STOCK_TILE;
+      tile->j0 = ty * UCNC_STOCK_TILE;
+      tile->w = stock->nx - 1 - tile->i0;
+      tile->h = stock->ny - 1 - tile->j0;
+      tile->w = tile->w > UCNC_STOCK_TILE ? UCNC_STOCK_TILE : tile->w;
+      tile->h = tile->h > UCNC_STOCK_TILE ? UCNC_STOCK_TILE : tile->h;
+      if (!remeshTile(stock, tile)) {
+        fprintf(stderr, "Memory allocation failed for stock tile.\n");
+        ucncStockFree(stock);
+        return NULL;
+      }
+    }
+  }
+
+  if (pthread_create(&stock->worker, NULL, stockWorker, stock) != 0) {
+    fprintf(stderr, "Failed to start stock worker thread.\n");
+    ucncStockFree(stock);
+    return NULL;
+  }
+  stock->workerStarted = 1;
+  return stock;
+}
+
+void ucncStockFree(ucncStock *stock) {
+  if (!stock)
+    return;
+  if (stock->workerStarted) {
+    pthread_mutex_lock(&stock->lock);
+    stock->quit = 1;
+    pthread_cond_signal(&stock->work);
+    pthread_mutex_unlock(&stock->lock);
+    pthread_join(stock->worker, NULL);
+  }
+  if (stock->tiles) {
+    for (int i = 0; i < stock->tilesX * stock->tilesY; i++) {
+      free(stock->tiles[i].front);
+      free(stock->tiles[i].back);
+    }
+  }
+  free(stock->tiles);
+  free(stock->dirtyTiles);
+  free(stock->heights);
+  free(stock->queue);
+  free(stock->spare);
+  pthread_cond_destroy(&stock->work);
+  pthread_cond_destroy(&stock->idle);
+  pthread_mutex_destroy(&stock->lock);
+  pthread_mutex_destroy(&stock->meshLock);
+  free(stock);
+}
+
+void ucncStockSetTool(ucncStock *stock, float radius, int ballEnd) {
+  if (!stock || radius <= 0.0f)
+    return;
+  pthread_mutex_lock(&stock->lock);
+  stock->radius = radius;
+  stock->ballEnd = ballEnd;
+  pthread_mutex_unlock(&stock->lock);
+}
+
+void ucncStockSetColor(ucncStock *stock, float r, float g, float b) {
+  if (!stock)
+    return;
+  stock->color[0] = r;
+  stock->color[1] = g;
+  stock->color[2] = b;
+  atomic_fetch_add(&stock->generation, 1);
+}
+
+int ucncStockCut(ucncStock *stock, const float from[3], const float to[3]) {
+  if (!stock || !from || !to)
+    return -1;
+  pthread_mutex_lock(&stock->lock);
+  if (stock->queueCount == stock->queueCapacity) {
+    int capacity = stock->queueCapacity ? stock->queueCapacity * 2 : 256;
+    StockCut *queue = realloc(stock->queue, capacity * sizeof(StockCut));
+    if (!queue) {
+      pthread_mutex_unlock(&stock->lock);
+      fprintf(stderr, "Memory allocation failed for stock cut.\n");
+      return -1;
+    }
+    stock->queue = queue;
+    stock->queueCapacity = capacity;
+  }
+  StockCut *cut = &stock->queue[stock->queueCount++];
+  memcpy(cut->from, from, sizeof(cut->from));
+  memcpy(cut->to, to, sizeof(cut->to));
+  cut->radius = stock->radius;
+  cut->ballEnd = stock->ballEnd;
+  stock->queued++;
+  pthread_cond_signal(&stock->work);
+  pthread_mutex_unlock(&stock->lock);
+  return 0;
+}
+
+void ucncStockSync(ucncStock *stock) {
+  if (!stock)
+    return;
+  pthread_mutex_lock(&stock->lock);
+  while (stock->applied != stock->queued)
+    pthread_cond_wait(&stock->idle, &stock->lock);
+  pthread_mutex_unlock(&stock->lock);
+}
+
+float ucncStockHeight(ucncStock *stock, float x, float y) {
+  if (!stock)
+    return 0.0f;
+  ucncStockSync(stock); // The worker writes heights without the lock
+  int i = (int)floorf((x - stock->x0) / stock->cell);
+  int j = (int)floorf((y - stock->y0) / stock->cell);
+  if (i < 0 || j < 0 || i >= stock->nx || j >= stock->ny)
+    return stock->bottom;
+  return stock->heights[j * stock->nx + i];
+}
+
+unsigned long ucncStockGeneration(const ucncStock *stock) {
+  return stock ? atomic_load(&stock->generation) : 0;
+}
+
+// Side quad from a to b along the stock edge, walked counter-clockwise
+// seen from above so the face points outwards
+static void wallQuad(const ucncStock *stock, float ax, float ay, float ah,
+                     float bx, float by, float bh) {
+  glVertex3f(ax, ay, stock->bottom);
+  glVertex3f(bx, by, stock->bottom);
+  glVertex3f(bx, by, bh);
+  glVertex3f(ax, ay, ah);
+}
+
+static void renderWalls(const ucncStock *stock, const StockTile *tile) {
+  const float *v = tile->front;
+  int stride = tile->w + 1;
+  float cell = stock->cell;
+  float xa = stock->x0 + (tile->i0 + 0.5f) * cell;
+  float ya = stock->y0 + (tile->j0 + 0.5f) * cell;
+  float xb = xa + tile->w * cell, yb = ya + tile->h * cell;
+  int tx = tile->i0 / UCNC_STOCK_TILE, ty = tile->j0 / UCNC_STOCK_TILE;
+
+  glBegin(GL_QUADS);
+  if (ty == 0) {
+    glNormal3f(0.0f, -1.0f, 0.0f);
+    for (int a = 0; a < tile->w; a++)
+      wallQuad(stock, xa + a * cell, ya, v[a * VERTEX_FLOATS],
+               xa + (a + 1) * cell, ya, v[(a + 1) * VERTEX_FLOATS]);
+  }
+  if (ty == stock->tilesY - 1) {
+    const float *row = &v[tile->h * stride * VERTEX_FLOATS];
+    glNormal3f(0.0f, 1.0f, 0.0f);
+    for (int a = tile->w; a > 0; a--)
+      wallQuad(stock, xa + a * cell, yb, row[a * VERTEX_FLOATS],
+               xa + (a - 1) * cell, yb, row[(a - 1) * VERTEX_FLOATS]);
+  }
+  if (tx == stock->tilesX - 1) {
+    glNormal3f(1.0f, 0.0f, 0.0f);
+    for (int b = 0; b < tile->h; b++)
+      wallQuad(stock, xb, ya + b * cell,
+               v[(b * stride + tile->w) * VERTEX_FLOATS], xb,
+               ya + (b + 1) * cell,
+               v[((b + 1) * stride + tile->w) * VERTEX_FLOATS]);
+  }
+  if (tx == 0) {
+    glNormal3f(-1.0f, 0.0f, 0.0f);
+    for (int b = tile->h; b > 0; b--)
+      wallQuad(stock, xa, ya + b * cell, v[b * stride * VERTEX_FLOATS], xa,
+               ya + (b - 1) * cell, v[(b - 1) * stride * VERTEX_FLOATS]);
+  }
+  glEnd();
+}
+
+void ucncStockRender(ucncStock *stock) {
+  if (!stock)
+    return;
+  GLfloat matSpecular[] = {0.3f, 0.3f, 0.3f, 1.0f};
+  GLfloat matShininess[] = {30.0f};
+  glMaterialfv(GL_FRONT, GL_SPECULAR, matSpecular);
+  glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
+  glColor3f(stock->color[0], stock->color[1], stock->color[2]);
+
+  float cell = stock->cell;
+  pthread_mutex_lock(&stock->meshLock);
+  for (int t = 0; t < stock->tilesX * stock->tilesY; t++) {
+    const StockTile *tile = &stock->tiles[t];
+    int stride = tile->w + 1;
+    for (int b = 0; b < tile->h; b++) {
+      float y = stock->y0 + (tile->j0 + b + 0.5f) * cell;
+      const float *lower = &tile->front[b * stride * VERTEX_FLOATS];
+      const float *upper = lower + stride * VERTEX_FLOATS;
+      glBegin(GL_TRIANGLE_STRIP);
+      for (int a = 0; a <= tile->w; a++) {
+        float x = stock->x0 + (tile->i0 + a + 0.5f) * cell;
+        const float *v = &upper[a * VERTEX_FLOATS];
+        glNormal3f(v[1], v[2], v[3]);
+        glVertex3f(x, y + cell, v[0]);
+        v = &lower[a * VERTEX_FLOATS];
+        glNormal3f(v[1], v[2], v[3]);
+        glVertex3f(x, y, v[0]);
+      }
+      glEnd();
+    }
+    renderWalls(stock, tile);
+  }
+  pthread_mutex_unlock(&stock->meshLock);
+
+  // Bottom face, facing down
+  float xa = stock->x0 + 0.5f * cell, ya = stock->y0 + 0.5f * cell;
+  float xb = stock->x0 + (stock->nx - 0.5f) * cell;
+  float yb = stock->y0 + (stock->ny - 0.5f) * cell;
+  glBegin(GL_QUADS);
+  glNormal3f(0.0f, 0.0f, -1.0f);
+  glVertex3f(xa, ya, stock->bottom);
+  glVertex3f(xa, yb, stock->bottom);
+  glVertex3f(xb, yb, stock->bottom);
+  glVertex3f(xb, ya, stock->bottom);
+  glEnd();
+}
@@ -0,0 +1,42 @@
+/* stock.h */
+
+#ifndef STOCK_H
+#define STOCK_H
+
+#include "cncvis.h"
+
+#define UCNC_STOCK_TILE 32 // Cells per tile side
+
+// Heightfield (Z-map) stock for 3-axis material removal. The block spans
+// sizeX x sizeY from (x0, y0) in its own space, top to bottom along z, with
+// one height per cell. Cuts are straight moves of a flat or ball end mill
+// pointing down -z, queued to a worker thread which lowers the cells under
+// the swept footprint and rebuilds the surface of the tiles they belong to.
+// A cut therefore costs in proportion to the area it touches, not the size
+// of the stock.
+typedef struct ucncStock ucncStock;
+
+ucncStock *ucncStockNew(float x0, float y0, float sizeX, float sizeY,
+                        float bottom, float top, float cellSize);
+void ucncStockFree(ucncStock *stock);
+
+// Tool used by the following cuts (flat end mill unless ballEnd is set)
+void ucncStockSetTool(ucncStock *stock, float radius, int ballEnd);
+void ucncStockSetColor(ucncStock *stock, float r, float g, float b);
+
+// Queue a move of the tool tip from one point to another, in stock space.
+// Returns without waiting for the worker.
+int ucncStockCut(ucncStock *stock, const float from[3], const float to[3]);
+// Wait until every queued cut is applied and its tiles rebuilt
+void ucncStockSync(ucncStock *stock);
+
+// Height of the cell under (x, y) once every queued cut is applied; waits
+// like ucncStockSync. Returns the bottom outside the stock.
+float ucncStockHeight(ucncStock *stock, float x, float y);
+// Changes whenever rebuilt tiles are published
+unsigned long ucncStockGeneration(const ucncStock *stock);
+
+// Draw with the current TinyGL state, in stock space
+void ucncStockRender(ucncStock *stock);
+
+#endif // STOCK_H
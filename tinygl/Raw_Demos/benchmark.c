@@ -657,7 +657,7 @@ int main(int argc, char **argv) {
     fprintf(stderr, "Failed to open benchmark.log\n");
     return 1;
   }
-  ZBuffer *zb = ZB_open(WIN_X, WIN_Y, ZB_MODE_RGBA, 0);
+  ZBuffer *zb = ZB_open(WIN_X, WIN_Y, ZB_MODE_NATIVE, 0);
   if (!zb) {
     fprintf(stderr, "ZB_open failed\n");
     return 1;
@@ -668,7 +668,7 @@ int main(int argc, char **argv) {
 
   pixel_buf = malloc(WIN_X * WIN_Y * sizeof(PIXEL));
   for (int i = 0; i < WIN_X * WIN_Y; ++i)
-    pixel_buf[i] = 0xffffffffu;
+    pixel_buf[i] = (PIXEL)~0;
   texbuf = malloc(TGL_FEATURE_TEXTURE_DIM * TGL_FEATURE_TEXTURE_DIM * 3);
   texbuf_small = malloc(32 * 32 * 3);
   memset(texbuf, 0xff, TGL_FEATURE_TEXTURE_DIM * TGL_FEATURE_TEXTURE_DIM * 3);
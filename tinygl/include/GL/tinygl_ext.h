@@ -12,6 +12,16 @@ void glDrawText(const GLubyte *text, GLint x, GLint y, GLuint pixel);
 void glTextSize(GLTEXTSIZE mode);
 void glPlotPixel(GLint x, GLint y, GLuint pixel);
 
+/* Rendering contexts. GL calls act on the calling thread's current context,
+   the built-in default one until another is made current, so threads with
+   their own contexts and framebuffers can render concurrently. Make a new
+   context current, then glInit() it; glClose() it before deleting it. A
+   context is current on at most one thread at a time. */
+void *glCreateContext(void);
+void glDeleteContext(void *context);
+void glMakeCurrent(void *context); /* NULL selects the default context */
+void *glGetCurrentContext(void);
+
 #ifdef __cplusplus
 }
 #endif
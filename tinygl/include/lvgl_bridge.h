@@ -8,13 +8,38 @@ extern "C" {
 #endif
 
 /*
- * Convert TinyGL's PixelQuad buffer (ARGB8888) to LVGL's native color format.
+ * Convert TinyGL's PixelQuad buffer (32-bit 0x00RRGGBB, or RGB565 with
+ * TINYGL_RGB565) to LVGL's native color format. RGB565 into a 16-bit LVGL
+ * without LV_COLOR_16_SWAP is a plain copy.
  * @param src         Source PixelQuad buffer
  * @param dst         Destination buffer (lv_color_t array)
  * @param pixel_count Number of pixels to convert
  */
 void tgl_to_lvgl(const PixelQuad *src, void *dst, unsigned pixel_count);
 
+/*
+ * Convert a rectangle of the frame buffer to LVGL's color format, packed
+ * into dst row after row (w pixels per row).
+ */
+void tgl_to_lvgl_rect(const ZBuffer *zb, GLint x, GLint y, GLint w, GLint h,
+                      void *dst);
+
+/*
+ * Receives one converted area, e.g. to pass to the panel driver as an
+ * lv_area_t {x, y, x + w - 1, y + h - 1}.
+ */
+typedef void (*tgl_lvgl_flush_cb)(GLint x, GLint y, GLint w, GLint h,
+                                  const void *pixels, void *user);
+
+/*
+ * Convert and flush only what was drawn since the last call (see
+ * ZB_dirtyRects), then reset the dirty tiles. Areas larger than buf, which
+ * holds buf_pixels LVGL pixels, are sent in bands; flush must be done with
+ * buf when it returns. Returns the number of pixels flushed.
+ */
+unsigned tgl_lvgl_flush_dirty(ZBuffer *zb, void *buf, unsigned buf_pixels,
+                              tgl_lvgl_flush_cb flush, void *user);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,9 @@ struct GLTexture;
 
 #define ZB_POINT_Z_FRAC_BITS 14
 
+/* frame buffer writes are tracked per ZB_DIRTY_TILE x ZB_DIRTY_TILE tile */
+#define ZB_DIRTY_TILE 16
+
 #define ZB_POINT_S_MIN ((1 << ZB_POINT_S_FRAC_BITS))
 #define ZB_POINT_S_MAX                                                         \
   ((1 << (1 + TGL_FEATURE_TEXTURE_POW2 + ZB_POINT_S_FRAC_BITS)) -              \
@@ -42,14 +45,29 @@ struct GLTexture;
 #define COLOR_G_GET32(g) ((g) & 0x00ff00)
 #define COLOR_B_GET32(b) ((b) & 0x0000ff)
 
-#define RGB_TO_PIXEL(r, g, b) ((r) | (g) | (b))
+/* pack channels given at 0xff0000 (r), 0xff00 (g) and 0xff (b); bits below
+   a channel, e.g. from interpolation, are dropped */
+#if TGL_FEATURE_RENDER_BITS == 16
+#define RGB_TO_PIXEL(r, g, b)                                                  \
+  ((((r) >> 8) & 0xF800) | (((g) >> 5) & 0x07E0) | (((b) >> 3) & 0x001F))
+#else
+#define RGB_TO_PIXEL(r, g, b)                                                  \
+  (((r) & 0xff0000) | ((g) & 0xff00) | ((b) & 0xff))
+#endif
 /*This is how textures are sampled. if you want to do some sort of fancy texture
  * filtering,*/
 /*you do it here.*/
 #define TEXTURE_SAMPLE(texture, s, t)                                          \
   (*(PIXEL *)((GLbyte *)texture + ST_TO_TEXTURE_BYTE_OFFSET(s, t)))
 /* display mode */
-#define ZB_MODE_RGBA 3 /* 32 bit ARGB mode */
+#define ZB_MODE_5R6G5B 1 /* 16 bit RGB565 mode */
+#define ZB_MODE_RGBA 3   /* 32 bit ARGB mode */
+/* the mode of the pixels this build renders */
+#if TGL_FEATURE_RENDER_BITS == 16
+#define ZB_MODE_NATIVE ZB_MODE_5R6G5B
+#else
+#define ZB_MODE_NATIVE ZB_MODE_RGBA
+#endif
 
 #define TGL_CLAMPI(imp)                                                        \
   ((imp > 0) ? ((imp > COLOR_MASK) ? COLOR_MASK : imp) : 0)
@@ -68,15 +86,6 @@ struct GLTexture;
 typedef GLuint PIXEL;
 #define PSZB 4
 #define PSZSH 5
-#if TGL_FEATURE_ALIGNAS == 1
-typedef struct {
-  PIXEL px[4];
-} PixelQuad TGL_ALIGN;
-#else
-typedef struct {
-  PIXEL px[4];
-} PixelQuad;
-#endif
 
 #elif TGL_FEATURE_RENDER_BITS == 16
 
@@ -85,9 +94,10 @@ typedef struct {
 #define GET_GREENER(p) ((p & 0x07E0) << 13)
 #define GET_BLUEER(p) ((p & 31) << 19)
 /*DO NOT CHANGE THESE BASED ON COLOR INTERP BITDEPTH*/
-#define GET_RED(p) ((p & 0xF800) >> 8)
-#define GET_GREEN(p) ((p & 0x07E0) >> 3)
-#define GET_BLUE(p) ((p & 31) << 3)
+/*The top bits are repeated below so full intensity reads back as 255*/
+#define GET_RED(p) (((p & 0xF800) >> 8) | ((p & 0xF800) >> 13))
+#define GET_GREEN(p) (((p & 0x07E0) >> 3) | ((p & 0x07E0) >> 9))
+#define GET_BLUE(p) (((p & 31) << 3) | ((p & 31) >> 2))
 
 typedef GLushort PIXEL;
 #define PSZB 2
@@ -97,6 +107,16 @@ typedef GLushort PIXEL;
 #error "wrong TGL_FEATURE_RENDER_BITS"
 #endif
 
+#if TGL_FEATURE_ALIGNAS == 1
+typedef struct {
+  PIXEL px[4];
+} PixelQuad TGL_ALIGN;
+#else
+typedef struct {
+  PIXEL px[4];
+} PixelQuad;
+#endif
+
 #if TGL_FEATURE_LIT_TEXTURES == 1
 #define RGB_MIX_FUNC(rr, gg, bb, tpix)                                         \
   RGB_TO_PIXEL(((rr * GET_RED(tpix)) >> 8), ((gg * GET_GREEN(tpix)) >> 8),     \
@@ -122,6 +142,9 @@ typedef GLushort PIXEL;
 
 /*SORCERY to achieve 32 bit signed integer clamping*/
 
+/* blending works on every channel at the red position (<< 16) */
+#define TGL_BLEND_PACK(sr, sg, sb) RGB_TO_PIXEL((sr), (sg) >> 8, (sb) >> 16)
+
 #define TGL_BLEND_SWITCH_CASE(sr, sg, sb, dr, dg, db, dest)                    \
   switch (zbblendeq) {                                                         \
   case GL_FUNC_ADD:                                                            \
@@ -132,7 +155,7 @@ typedef GLushort PIXEL;
     sr = TGL_CLAMPI(sr);                                                       \
     sg = TGL_CLAMPI(sg);                                                       \
     sb = TGL_CLAMPI(sb);                                                       \
-    dest = RGB_TO_PIXEL(sr, sg, sb);                                           \
+    dest = TGL_BLEND_PACK(sr, sg, sb);                                         \
     break;                                                                     \
   case GL_FUNC_SUBTRACT:                                                       \
     sr -= dr;                                                                  \
@@ -141,7 +164,7 @@ typedef GLushort PIXEL;
     sr = TGL_CLAMPI(sr);                                                       \
     sg = TGL_CLAMPI(sg);                                                       \
     sb = TGL_CLAMPI(sb);                                                       \
-    dest = RGB_TO_PIXEL(sr, sg, sb);                                           \
+    dest = TGL_BLEND_PACK(sr, sg, sb);                                         \
     break;                                                                     \
   case GL_FUNC_REVERSE_SUBTRACT:                                               \
     sr = dr - sr;                                                              \
@@ -150,7 +173,7 @@ typedef GLushort PIXEL;
     sr = TGL_CLAMPI(sr);                                                       \
     sg = TGL_CLAMPI(sg);                                                       \
     sb = TGL_CLAMPI(sb);                                                       \
-    dest = RGB_TO_PIXEL(sr, sg, sb);                                           \
+    dest = TGL_BLEND_PACK(sr, sg, sb);                                         \
     break;                                                                     \
   }
 
@@ -204,7 +227,8 @@ typedef GLushort PIXEL;
   }
 
 #define TGL_BLEND_FUNC_RGB(rr, gg, bb, dest)                                   \
-  {{GLint sr = rr & COLOR_MASK, sg = gg & COLOR_MASK, sb = bb & COLOR_MASK,    \
+  {{GLint sr = rr & COLOR_MASK, sg = (gg << 8) & COLOR_MASK,                  \
+    sb = (bb << 16) & COLOR_MASK,                                              \
     dr, dg, db;                                                                \
   {                                                                            \
     GLuint temp = dest;                                                        \
@@ -289,8 +313,17 @@ typedef struct __attribute__((aligned(16))) {
   /* raster options */
   GLfloat line_width;
   GLubyte frame_buffer_allocated;
+  struct ZBWorkers *workers; /* copy and clear helper threads */
+  /* tiles written since ZB_clearDirty, one byte each, row by row */
+  GLubyte *dirty;
+  GLint dirty_cols, dirty_rows;
 } ZBuffer;
 
+/* a rectangle of the frame buffer, in pixels */
+typedef struct {
+  GLint x, y, w, h;
+} ZBRect;
+
 static inline int ZB_depth_test(const ZBuffer *zb, GLuint z, GLuint zpix) {
   switch (zb->depth_func) {
   case GL_NEVER:
@@ -332,6 +365,16 @@ void ZB_close(ZBuffer *zb);
 void ZB_resize(ZBuffer *zb, void *frame_buffer, GLint xsize, GLint ysize);
 void ZB_clear(ZBuffer *restrict zb, GLint clear_z, GLint z, GLint clear_color,
               GLint r, GLint g, GLint b);
+void ZB_clearRect(ZBuffer *restrict zb, GLint clear_z, GLint z,
+                  GLint clear_color, GLint r, GLint g, GLint b, GLint x,
+                  GLint y, GLint w, GLint h);
+/* Dirty tracking: rasterization, clears, lines, points, glPlotPixel and
+ * glDrawPixels mark the tiles they touch. A new or resized buffer starts all
+ * dirty. ZB_dirtyRects covers the dirty tiles with at most max rectangles,
+ * clipped to the buffer, and returns how many it wrote. */
+void ZB_markDirty(ZBuffer *zb, GLint x, GLint y, GLint w, GLint h);
+void ZB_clearDirty(ZBuffer *zb);
+GLint ZB_dirtyRects(const ZBuffer *zb, ZBRect *rects, GLint max);
 /* linesize is in BYTES */
 void ZB_copyFrameBuffer(ZBuffer *restrict zb, void *restrict buf,
                         GLint linesize);
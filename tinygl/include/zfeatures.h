@@ -123,8 +123,16 @@ work best on this setting.
 #define TGL_ALIGN /*a comment*/
 #endif
 
+/*Render into RGB565 instead of 32-bit 0x00RRGGBB pixels, halving frame
+buffer and texture memory; set by the TINYGL_RGB565 CMake option.*/
+#ifndef TGL_FEATURE_16_BITS
 #define TGL_FEATURE_16_BITS 0
+#endif
+#if TGL_FEATURE_16_BITS == 1
+#define TGL_FEATURE_32_BITS 0
+#else
 #define TGL_FEATURE_32_BITS 1
+#endif
 
 #if TGL_FEATURE_32_BITS == 1
 #define TGL_FEATURE_RENDER_BITS 32
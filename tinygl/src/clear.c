@@ -16,11 +16,17 @@ void glopClear(GLParam* p) {
 	GLContext* c = gl_get_context();
 	GLint mask = p[1].i;
 	GLint z = 0;
-	GLint r = (GLint)(c->clear_color.v[0] * 255.0f + 0.5f);
-	GLint g = (GLint)(c->clear_color.v[1] * 255.0f + 0.5f);
+	/* channels where RGB_TO_PIXEL takes them, as for vertex colors */
+	GLint r = (GLint)(c->clear_color.v[0] * 255.0f + 0.5f) << 16;
+	GLint g = (GLint)(c->clear_color.v[1] * 255.0f + 0.5f) << 8;
 	GLint b = (GLint)(c->clear_color.v[2] * 255.0f + 0.5f);
 
 	/* TODO : correct value of Z */
 
+	if (c->scissor_enabled) {
+		ZB_clearRect(c->zb, mask & GL_DEPTH_BUFFER_BIT, z, mask & GL_COLOR_BUFFER_BIT, r, g, b, c->scissor_x, c->scissor_y, c->scissor_width,
+					 c->scissor_height);
+		return;
+	}
 	ZB_clear(c->zb, mask & GL_DEPTH_BUFFER_BIT, z, mask & GL_COLOR_BUFFER_BIT, r, g, b);
 }
@@ -41,6 +41,7 @@ void glopPlotPixel(GLParam* p) {
 	GLint x = p[1].i;
 	PIXEL pix = p[2].ui;
 	c->zb->pbuf[x] = pix;
+	ZB_markDirty(c->zb, x % c->zb->xsize, x / c->zb->xsize, 1, 1);
 }
 
 void glPlotPixel(GLint x, GLint y, GLuint pix) {
@@ -52,9 +53,12 @@ void glPlotPixel(GLint x, GLint y, GLuint pix) {
 	GLint h = c->zb->ysize;
 	p[0].op = OP_PlotPixel;
 
+	if (c->scissor_enabled &&
+		(x < c->scissor_x || x >= c->scissor_x + c->scissor_width || y < c->scissor_y || y >= c->scissor_y + c->scissor_height))
+		return;
 	if (x > -1 && x < w && y > -1 && y < h) {
 #if TGL_FEATURE_RENDER_BITS == 16
-		pix = RGB_TO_PIXEL((pix & COLOR_MULT_MASK), ((pix & 0xFF00) << (COLOR_SHIFT - 8)), ((pix & 255) << COLOR_SHIFT));
+		pix = RGB_TO_PIXEL(pix & 0xFF0000, pix & 0xFF00, pix & 0xFF);
 #endif
 		p[1].i = x + y * w;
 		p[2].ui = pix;
@@ -89,6 +93,7 @@ void glDrawText(const GLubyte* text, GLint x, GLint y, GLuint p) {
 
 void glPostProcess(GLuint (*postprocess)(GLint x, GLint y, GLuint pixel, GLushort z)) {
 	GLContext* c = gl_get_context();
+	ZB_markDirty(c->zb, 0, 0, c->zb->xsize, c->zb->ysize);
 	for (int j = 0; j < c->zb->ysize; j++)
 		for (int i = 0; i < c->zb->xsize; i++)
 			c->zb->pbuf[i + j * (c->zb->xsize)] = postprocess(i, j, c->zb->pbuf[i + j * (c->zb->xsize)], c->zb->zbuf[i + j * (c->zb->xsize)]);
@@ -4,6 +4,7 @@
 #include "zgl.h"
 #include <stdlib.h>
 GLContext gl_ctx;
+_Thread_local GLContext* gl_current_ctx = &gl_ctx;
 int tgl_threads_enabled = TGL_ENABLE_THREADS;
 static const GLContext empty_gl_ctx = {0};
 
@@ -163,8 +164,8 @@ void glInit(void* zbuffer1) {
 	if (TinyGLRuntimeCompatibilityTest())
 		gl_fatal_error("TINYGL_FAILED_RUNTIME_COMPAT_TEST");
 #endif
-	gl_ctx = empty_gl_ctx;
-	c = &gl_ctx;
+	c = gl_get_context();
+	*c = empty_gl_ctx;
 	if (!c)
 		gl_fatal_error("TINYGL_CANNOT_INIT_OOM");
 #if TGL_FEATURE_PROFILING
@@ -402,6 +403,8 @@ void glClose(void) {
 
 	GLuint i;
 	GLContext* c = gl_get_context();
+	if (!c->zb)
+		return; /* Never initialized */
 	for (i = 0; i < 3; i++) {
 		gl_free(c->matrix_stack[i]);
 	}
@@ -419,5 +422,18 @@ void glClose(void) {
 	end_raster_threads();
 	glEndTextures();
 	endSharedState(c);
-	gl_ctx = empty_gl_ctx;
+	*c = empty_gl_ctx;
 }
+
+void* glCreateContext(void) { return gl_zalloc(sizeof(GLContext)); }
+
+void glDeleteContext(void* context) {
+	if (gl_current_ctx == context)
+		gl_current_ctx = &gl_ctx;
+	if (context != &gl_ctx)
+		gl_free(context);
+}
+
+void glMakeCurrent(void* context) { gl_current_ctx = context ? (GLContext*)context : &gl_ctx; }
+
+void* glGetCurrentContext(void) { return gl_current_ctx; }
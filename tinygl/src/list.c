@@ -183,7 +183,6 @@ void glopEndList(GLParam* p) { exit(1); }
 /* this opcode is never called directly */
 void glopNextBuffer(GLParam* p) { exit(1); }
 
-static int call_depth = 0;
 #define MAX_CALL_DEPTH 32
 
 void glopCallList(GLParam* p) {
@@ -201,9 +200,10 @@ void glopCallList(GLParam* p) {
 #else
 
 #endif
-	if (call_depth >= MAX_CALL_DEPTH)
+	GLContext* ctx = gl_get_context();
+	if (ctx->call_depth >= MAX_CALL_DEPTH)
 		return;
-	call_depth++;
+	ctx->call_depth++;
 	p = l->first_op_buffer->ops;
 
 	while (1) {
@@ -224,7 +224,7 @@ void glopCallList(GLParam* p) {
 			p += op_table_size[op];
 		}
 	}
-	call_depth--;
+	ctx->call_depth--;
 }
 
 void glNewList(GLuint list, GLint mode) {
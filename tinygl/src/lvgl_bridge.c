@@ -1,32 +1,92 @@
 #include "lvgl_bridge.h"
+#include <stdint.h>
+#include <string.h>
 
 #if defined(TINYGL_WITH_LVGL)
 #include <lvgl.h>
 #endif
 
-void tgl_to_lvgl(const PixelQuad* src, void* dst, unsigned pixel_count) {
-	const PIXEL* s = (const PIXEL*)src;
+#define TGL_LVGL_MAX_RECTS 16
+
 #if LV_COLOR_DEPTH == 16
-	uint16_t* d = (uint16_t*)dst;
-	for (unsigned i = 0; i < pixel_count; ++i) {
-		uint32_t v = s[i];
-		d[i] = ((v >> 8) & 0xf800) | ((v >> 5) & 0x07e0) | ((v >> 3) & 0x001f);
-	}
+#define LV_PIXEL_BYTES 2
 #elif LV_COLOR_DEPTH == 24
-	uint8_t* d = (uint8_t*)dst;
-	for (unsigned i = 0; i < pixel_count; ++i) {
-		uint32_t v = s[i];
-		d[3 * i + 0] = v & 0xff;
-		d[3 * i + 1] = (v >> 8) & 0xff;
-		d[3 * i + 2] = (v >> 16) & 0xff;
-	}
+#define LV_PIXEL_BYTES 3
 #elif LV_COLOR_DEPTH == 32
-	uint32_t* d = (uint32_t*)dst;
-	for (unsigned i = 0; i < pixel_count; ++i) {
+#define LV_PIXEL_BYTES 4
+#else
+#error "Unsupported LV_COLOR_DEPTH"
+#endif
+
+/* one run of pixels; the color depths are fixed at build time, so this is a
+   single copy, byte swap or channel repack with no per-pixel decisions */
+static void convert_pixels(const PIXEL* restrict s, unsigned char* restrict dst, unsigned n) {
+#if TGL_FEATURE_RENDER_BITS == 16 && LV_COLOR_DEPTH == 16
+#if defined(LV_COLOR_16_SWAP) && LV_COLOR_16_SWAP
+	uint16_t* restrict d = (uint16_t*)dst;
+	for (unsigned i = 0; i < n; ++i)
+		d[i] = (uint16_t)((s[i] << 8) | (s[i] >> 8)); /* byte order of SPI panels */
+#else
+	memcpy(dst, s, (size_t)n * sizeof(PIXEL)); /* already LVGL's format */
+#endif
+#elif LV_COLOR_DEPTH == 16
+	uint16_t* restrict d = (uint16_t*)dst;
+	for (unsigned i = 0; i < n; ++i) {
 		uint32_t v = s[i];
-		d[i] = 0xff000000u | (v & 0x00ffffffu);
+		uint16_t c = ((v >> 8) & 0xf800) | ((v >> 5) & 0x07e0) | ((v >> 3) & 0x001f);
+#if defined(LV_COLOR_16_SWAP) && LV_COLOR_16_SWAP
+		c = (uint16_t)((c << 8) | (c >> 8)); /* byte order of SPI panels */
+#endif
+		d[i] = c;
+	}
+#elif LV_COLOR_DEPTH == 24
+	for (unsigned i = 0; i < n; ++i) {
+		PIXEL v = s[i];
+		dst[3 * i + 0] = GET_BLUE(v);
+		dst[3 * i + 1] = GET_GREEN(v);
+		dst[3 * i + 2] = GET_RED(v);
 	}
 #else
-#error "Unsupported LV_COLOR_DEPTH"
+	uint32_t* restrict d = (uint32_t*)dst;
+	for (unsigned i = 0; i < n; ++i) {
+		PIXEL v = s[i];
+		d[i] = 0xff000000u | ((uint32_t)GET_RED(v) << 16) | ((uint32_t)GET_GREEN(v) << 8) | GET_BLUE(v);
+	}
 #endif
 }
+
+void tgl_to_lvgl(const PixelQuad* src, void* dst, unsigned pixel_count) { convert_pixels((const PIXEL*)src, dst, pixel_count); }
+
+void tgl_to_lvgl_rect(const ZBuffer* zb, GLint x, GLint y, GLint w, GLint h, void* dst) {
+	unsigned char* d = dst;
+	for (GLint row = 0; row < h; ++row) {
+		const PIXEL* s = (const PIXEL*)((const GLbyte*)zb->pbuf + (y + row) * zb->linesize) + x;
+		convert_pixels(s, d, w);
+		d += (size_t)w * LV_PIXEL_BYTES;
+	}
+}
+
+unsigned tgl_lvgl_flush_dirty(ZBuffer* zb, void* buf, unsigned buf_pixels, tgl_lvgl_flush_cb flush, void* user) {
+	ZBRect rects[TGL_LVGL_MAX_RECTS];
+	GLint count = ZB_dirtyRects(zb, rects, TGL_LVGL_MAX_RECTS);
+	unsigned flushed = 0;
+	if (buf_pixels == 0)
+		return 0;
+	for (GLint i = 0; i < count; ++i) {
+		const ZBRect* r = &rects[i];
+		/* the widest slice of rows buf can hold, at least one row */
+		GLint cw = (unsigned)r->w < buf_pixels ? r->w : (GLint)buf_pixels;
+		GLint rows = (GLint)(buf_pixels / cw);
+		for (GLint x = r->x; x < r->x + r->w; x += cw) {
+			GLint w = r->x + r->w - x < cw ? r->x + r->w - x : cw;
+			for (GLint y = r->y; y < r->y + r->h; y += rows) {
+				GLint h = r->y + r->h - y < rows ? r->y + r->h - y : rows;
+				tgl_to_lvgl_rect(zb, x, y, w, h, buf);
+				flush(x, y, w, h, buf, user);
+				flushed += (unsigned)(w * h);
+			}
+		}
+	}
+	ZB_clearDirty(zb);
+	return flushed;
+}
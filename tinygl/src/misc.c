@@ -268,13 +268,12 @@ void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format
 	GLContext* c = gl_get_context();
 #include "error_check.h"
 	if (c->readbuffer != GL_FRONT || (format != GL_RGBA && format != GL_RGB && format != GL_BGR && format != GL_BGRA && format != GL_DEPTH_COMPONENT) ||
-#if TGL_FEATURE_RENDER_BITS == 32
-		(type != GL_UNSIGNED_INT && type != GL_UNSIGNED_INT_8_8_8_8)
-#elif TGL_FEATURE_RENDER_BITS == 16
-		(type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_SHORT_5_6_5)
-#else
-#error "Unsupported TGL_FEATURE_RENDER_BITS"
+		/* pixels come back as 8-bit components in either render mode */
+		(type != GL_UNSIGNED_INT && type != GL_UNSIGNED_INT_8_8_8_8
+#if TGL_FEATURE_RENDER_BITS == 16
+		 && type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_SHORT_5_6_5
 #endif
+		 )
 
 	) {
 #if TGL_FEATURE_ERROR_CHECK
@@ -306,9 +305,9 @@ void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format
 			GLubyte g = (p >> 8) & 0xff;
 			GLubyte b = p & 0xff;
 #elif TGL_FEATURE_RENDER_BITS == 16
-			GLubyte r = (p >> 8) & 0xf8;
-			GLubyte g = (p >> 3) & 0xfc;
-			GLubyte b = (p << 3) & 0xf8;
+			GLubyte r = GET_RED(p);
+			GLubyte g = GET_GREEN(p);
+			GLubyte b = GET_BLUE(p);
 #endif
 			GLubyte* out = dst + components * (j * width + i);
 			if (format == GL_BGR || format == GL_BGRA) {
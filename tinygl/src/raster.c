@@ -128,6 +128,15 @@ void glopDrawPixels(GLParam* p) {
 
 	GLint zz = c->rasterpos_zz;
 
+	/* bounds of the zoomed image, a pixel wider on each side for rounding */
+	GLfloat ex = rastpos.v[0] + (GLfloat)w * pzoomx;
+	GLfloat ey = rastpos.v[1] - (GLfloat)h * pzoomy;
+	GLint bx = (GLint)floorf(rastpos.v[0] < ex ? rastpos.v[0] : ex) - 1;
+	GLint by = (GLint)floorf(rastpos.v[1] < ey ? rastpos.v[1] : ey) - 1;
+	GLint bw = (GLint)ceilf(fabsf(ex - rastpos.v[0])) + 3;
+	GLint bh = (GLint)ceilf(fabsf(ey - rastpos.v[1])) + 3;
+	ZB_markDirty(zb, bx, by, bw, bh);
+
 	/* fast path when pixel zoom is 1:1 */
 	if (pzoomx == 1.0f && pzoomy == 1.0f) {
 		for (sy = 0; sy < h; ++sy) {
@@ -17,8 +17,10 @@ typedef struct {
 	GLint lines;
 	RowFunc fn;
 } TexJob;
-static c11_lsthread tex_threads[NUM_TEX_THREADS];
-static TexJob tex_jobs[NUM_TEX_THREADS];
+typedef struct TGLTexWorkers {
+	c11_lsthread threads[NUM_TEX_THREADS];
+	TexJob jobs[NUM_TEX_THREADS];
+} TexWorkers;
 
 static inline void row_copy_pixels(const void* restrict src, void* restrict dst, GLint w) { memcpy(dst, src, (size_t)w * sizeof(PIXEL)); }
 #if TGL_FEATURE_NO_COPY_COLOR == 1
@@ -214,19 +216,29 @@ void glInitTextures() {
 	c->texture_2d_enabled = 0;
 	c->texture_env_mode = GL_MODULATE;
 	c->current_texture = find_texture(0);
+	TexWorkers* w = gl_zalloc(sizeof(TexWorkers));
+	if (!w)
+		gl_fatal_error("TINYGL_CANNOT_INIT_OOM");
+	c->tex_workers = w;
 	for (int i = 0; i < NUM_TEX_THREADS; ++i) {
-		init_c11_lsthread(&tex_threads[i]);
-		tex_threads[i].execute = tex_job_func;
-		tex_threads[i].argument = &tex_jobs[i];
-		start_c11_lsthread(&tex_threads[i]);
+		init_c11_lsthread(&w->threads[i]);
+		w->threads[i].execute = tex_job_func;
+		w->threads[i].argument = &w->jobs[i];
+		start_c11_lsthread(&w->threads[i]);
 	}
 }
 
 void glEndTextures() {
+	GLContext* c = gl_get_context();
+	TexWorkers* w = c->tex_workers;
+	if (!w)
+		return;
 	for (int i = 0; i < NUM_TEX_THREADS; ++i) {
-		kill_c11_lsthread(&tex_threads[i]);
-		destroy_c11_lsthread(&tex_threads[i]);
+		kill_c11_lsthread(&w->threads[i]);
+		destroy_c11_lsthread(&w->threads[i]);
 	}
+	gl_free(w);
+	c->tex_workers = NULL;
 }
 
 void glGenTextures(GLint n, GLuint* textures) {
@@ -442,18 +454,18 @@ void glopCopyTexImage2D(GLParam* p) {
 			GLint strip = h / total;
 			for (int t = 0; t < NUM_TEX_THREADS; ++t) {
 				GLint start = t * strip;
-				tex_jobs[t].src = src + start * c->zb->xsize;
-				tex_jobs[t].dst = data + start * w;
-				tex_jobs[t].src_stride = c->zb->xsize * sizeof(PIXEL);
-				tex_jobs[t].dst_stride = w * sizeof(PIXEL);
-				tex_jobs[t].width = w;
-				tex_jobs[t].lines = strip;
+				c->tex_workers->jobs[t].src = src + start * c->zb->xsize;
+				c->tex_workers->jobs[t].dst = data + start * w;
+				c->tex_workers->jobs[t].src_stride = c->zb->xsize * sizeof(PIXEL);
+				c->tex_workers->jobs[t].dst_stride = w * sizeof(PIXEL);
+				c->tex_workers->jobs[t].width = w;
+				c->tex_workers->jobs[t].lines = strip;
 #if TGL_FEATURE_NO_COPY_COLOR == 1
-				tex_jobs[t].fn = row_copy_pixels_ncc;
+				c->tex_workers->jobs[t].fn = row_copy_pixels_ncc;
 #else
-				tex_jobs[t].fn = row_copy_pixels;
+				c->tex_workers->jobs[t].fn = row_copy_pixels;
 #endif
-				step_c11_lsthread(&tex_threads[t]);
+				step_c11_lsthread(&c->tex_workers->threads[t]);
 			}
 			GLint start = NUM_TEX_THREADS * strip;
 			for (j = start; j < h; ++j) {
@@ -464,7 +476,7 @@ void glopCopyTexImage2D(GLParam* p) {
 #endif
 			}
 			for (int t = 0; t < NUM_TEX_THREADS; ++t)
-				lock_c11_lsthread(&tex_threads[t]);
+				lock_c11_lsthread(&c->tex_workers->threads[t]);
 		} else {
 			for (j = 0; j < h; ++j) {
 #if TGL_FEATURE_NO_COPY_COLOR == 1
@@ -610,19 +622,19 @@ void glopTexImage2D(GLParam* p) {
 		GLint strip = height / total;
 		for (int t = 0; t < NUM_TEX_THREADS; ++t) {
 			GLint start = t * strip;
-			tex_jobs[t].src = pixels1 + start * width * comps;
-			tex_jobs[t].dst = im->pixmap + start * width;
-			tex_jobs[t].src_stride = width * comps;
-			tex_jobs[t].dst_stride = width * sizeof(PIXEL);
-			tex_jobs[t].width = width;
-			tex_jobs[t].lines = strip;
+			c->tex_workers->jobs[t].src = pixels1 + start * width * comps;
+			c->tex_workers->jobs[t].dst = im->pixmap + start * width;
+			c->tex_workers->jobs[t].src_stride = width * comps;
+			c->tex_workers->jobs[t].dst_stride = width * sizeof(PIXEL);
+			c->tex_workers->jobs[t].width = width;
+			c->tex_workers->jobs[t].lines = strip;
 			if (format == GL_BGR)
-				tex_jobs[t].fn = row_convert_bgr;
+				c->tex_workers->jobs[t].fn = row_convert_bgr;
 			else if (format == GL_BGRA)
-				tex_jobs[t].fn = row_convert_bgra;
+				c->tex_workers->jobs[t].fn = row_convert_bgra;
 			else
-				tex_jobs[t].fn = row_convert_rgb;
-			step_c11_lsthread(&tex_threads[t]);
+				c->tex_workers->jobs[t].fn = row_convert_rgb;
+			step_c11_lsthread(&c->tex_workers->threads[t]);
 		}
 		GLint start = NUM_TEX_THREADS * strip;
 		for (GLint y = start; y < height; ++y)
@@ -633,7 +645,7 @@ void glopTexImage2D(GLParam* p) {
 			else
 				row_convert_rgb(pixels1 + y * width * comps, im->pixmap + y * width, width);
 		for (int t = 0; t < NUM_TEX_THREADS; ++t)
-			lock_c11_lsthread(&tex_threads[t]);
+			lock_c11_lsthread(&c->tex_workers->threads[t]);
 	} else {
 		for (GLint y = 0; y < height; ++y) {
 			const GLubyte* s = pixels1 + y * width * comps;
@@ -742,26 +754,27 @@ void glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffse
 }
 
 static void copy_subimage(GLImage* im, GLint xoff, GLint yoff, GLint w, GLint h, const PIXEL* src, GLint src_stride) {
+	TexWorkers* workers = gl_get_context()->tex_workers;
 	PIXEL* dst = im->pixmap + yoff * im->xsize + xoff;
 	if (tgl_threads_enabled && w * h >= 4096) {
 		int total = NUM_TEX_THREADS + 1;
 		GLint strip = h / total;
 		for (int t = 0; t < NUM_TEX_THREADS; ++t) {
 			GLint start = t * strip;
-			tex_jobs[t].src = src + start * src_stride / sizeof(PIXEL);
-			tex_jobs[t].dst = dst + start * im->xsize;
-			tex_jobs[t].src_stride = src_stride;
-			tex_jobs[t].dst_stride = im->xsize * sizeof(PIXEL);
-			tex_jobs[t].width = w;
-			tex_jobs[t].lines = strip;
-			tex_jobs[t].fn = row_copy_pixels;
-			step_c11_lsthread(&tex_threads[t]);
+			workers->jobs[t].src = src + start * src_stride / sizeof(PIXEL);
+			workers->jobs[t].dst = dst + start * im->xsize;
+			workers->jobs[t].src_stride = src_stride;
+			workers->jobs[t].dst_stride = im->xsize * sizeof(PIXEL);
+			workers->jobs[t].width = w;
+			workers->jobs[t].lines = strip;
+			workers->jobs[t].fn = row_copy_pixels;
+			step_c11_lsthread(&workers->threads[t]);
 		}
 		GLint start = NUM_TEX_THREADS * strip;
 		for (GLint j = start; j < h; ++j)
 			row_copy_pixels(src + j * (src_stride / sizeof(PIXEL)), dst + j * im->xsize, w);
 		for (int t = 0; t < NUM_TEX_THREADS; ++t)
-			lock_c11_lsthread(&tex_threads[t]);
+			lock_c11_lsthread(&workers->threads[t]);
 	} else {
 		for (GLint j = 0; j < h; ++j)
 			memcpy(dst + j * im->xsize, src + j * (src_stride / sizeof(PIXEL)), (size_t)w * sizeof(PIXEL));
@@ -14,8 +14,6 @@
 #include "lockstepthread.h"
 #include "zgl.h"
 
-static c11_lsthread copy_thread;
-static c11_lsthread clear_thread;
 typedef struct {
 	PIXEL* src;
 	PIXEL* dst;
@@ -23,7 +21,6 @@ typedef struct {
 	GLint stride;
 	GLint lines;
 } CopyJob;
-static CopyJob copy_job;
 typedef struct {
 	PIXEL* dst;
 	GLushort* zbuf;
@@ -35,7 +32,14 @@ typedef struct {
 	GLint clear_color;
 	GLuint color;
 } ClearJob;
-static ClearJob clear_job;
+
+/* per-framebuffer helper threads, each doing half of a copy or clear */
+typedef struct ZBWorkers {
+	c11_lsthread copy_thread;
+	c11_lsthread clear_thread;
+	CopyJob copy_job;
+	ClearJob clear_job;
+} ZBWorkers;
 
 static inline void memset_custom_s(void* restrict adr, GLint val, GLint count);
 static inline void memset_l(void* restrict adr, GLint val, GLint count);
@@ -66,6 +70,18 @@ static void clear_job_func(void* arg) {
 		}
 	}
 }
+/* (re)allocate the dirty tile map, everything dirty */
+static GLint alloc_dirty(ZBuffer* zb) {
+	gl_free(zb->dirty);
+	zb->dirty_cols = (zb->xsize + ZB_DIRTY_TILE - 1) / ZB_DIRTY_TILE;
+	zb->dirty_rows = (zb->ysize + ZB_DIRTY_TILE - 1) / ZB_DIRTY_TILE;
+	zb->dirty = gl_malloc(zb->dirty_cols * zb->dirty_rows);
+	if (zb->dirty == NULL)
+		return -1;
+	memset(zb->dirty, 1, zb->dirty_cols * zb->dirty_rows);
+	return 0;
+}
+
 ZBuffer* ZB_open(GLint xsize, GLint ysize, GLint mode,
 
 				 void* frame_buffer) {
@@ -116,14 +132,25 @@ ZBuffer* ZB_open(GLint xsize, GLint ysize, GLint mode,
 	zb->current_texture = NULL;
 	zb->wrap_s = GL_REPEAT;
 	zb->wrap_t = GL_REPEAT;
-	init_c11_lsthread(&copy_thread);
-	copy_thread.execute = copy_job_func;
-	copy_thread.argument = &copy_job;
-	start_c11_lsthread(&copy_thread);
-	init_c11_lsthread(&clear_thread);
-	clear_thread.execute = clear_job_func;
-	clear_thread.argument = &clear_job;
-	start_c11_lsthread(&clear_thread);
+	zb->dirty = NULL;
+	zb->workers = gl_zalloc(sizeof(ZBWorkers));
+	if (zb->workers == NULL || alloc_dirty(zb) != 0) {
+		gl_free(zb->workers);
+		gl_free(zb->dirty);
+		if (zb->frame_buffer_allocated)
+			gl_free(zb->pbuf);
+		gl_free(zb->zbuf);
+		goto error;
+	}
+	ZBWorkers* w = zb->workers;
+	init_c11_lsthread(&w->copy_thread);
+	w->copy_thread.execute = copy_job_func;
+	w->copy_thread.argument = &w->copy_job;
+	start_c11_lsthread(&w->copy_thread);
+	init_c11_lsthread(&w->clear_thread);
+	w->clear_thread.execute = clear_job_func;
+	w->clear_thread.argument = &w->clear_job;
+	start_c11_lsthread(&w->clear_thread);
 
 	return zb;
 error:
@@ -136,11 +163,13 @@ void ZB_close(ZBuffer* zb) {
 	if (zb->frame_buffer_allocated)
 		gl_free(zb->pbuf);
 
-	kill_c11_lsthread(&copy_thread);
-	destroy_c11_lsthread(&copy_thread);
-	kill_c11_lsthread(&clear_thread);
-	destroy_c11_lsthread(&clear_thread);
+	kill_c11_lsthread(&zb->workers->copy_thread);
+	destroy_c11_lsthread(&zb->workers->copy_thread);
+	kill_c11_lsthread(&zb->workers->clear_thread);
+	destroy_c11_lsthread(&zb->workers->clear_thread);
+	gl_free(zb->workers);
 
+	gl_free(zb->dirty);
 	gl_free(zb->zbuf);
 	gl_free(zb);
 }
@@ -173,6 +202,90 @@ void ZB_resize(ZBuffer* zb, void* frame_buffer, GLint xsize, GLint ysize) {
 		zb->pbuf = frame_buffer;
 		zb->frame_buffer_allocated = 0;
 	}
+	if (alloc_dirty(zb) != 0)
+		exit(1);
+}
+
+void ZB_markDirty(ZBuffer* zb, GLint x, GLint y, GLint w, GLint h) {
+	GLint x1 = x + w, y1 = y + h;
+	if (x < 0)
+		x = 0;
+	if (y < 0)
+		y = 0;
+	if (x1 > zb->xsize)
+		x1 = zb->xsize;
+	if (y1 > zb->ysize)
+		y1 = zb->ysize;
+	if (x >= x1 || y >= y1)
+		return;
+	GLint c0 = x / ZB_DIRTY_TILE, c1 = (x1 - 1) / ZB_DIRTY_TILE;
+	for (GLint row = y / ZB_DIRTY_TILE; row <= (y1 - 1) / ZB_DIRTY_TILE; row++)
+		memset(zb->dirty + row * zb->dirty_cols + c0, 1, c1 - c0 + 1);
+}
+
+void ZB_clearDirty(ZBuffer* zb) { memset(zb->dirty, 0, zb->dirty_cols * zb->dirty_rows); }
+
+static inline long rect_area(const ZBRect* r) { return (long)r->w * r->h; }
+
+static ZBRect rect_union(const ZBRect* a, const ZBRect* b) {
+	GLint x0 = a->x < b->x ? a->x : b->x, y0 = a->y < b->y ? a->y : b->y;
+	GLint x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+	GLint y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+	ZBRect r = {x0, y0, x1 - x0, y1 - y0};
+	return r;
+}
+
+/* runs of dirty tiles on a tile row extend the rectangle of the same
+   columns ending just above them, or start a new one */
+GLint ZB_dirtyRects(const ZBuffer* zb, ZBRect* rects, GLint max) {
+	GLint count = 0;
+	if (max <= 0)
+		return 0;
+	for (GLint ty = 0; ty < zb->dirty_rows; ty++) {
+		const GLubyte* row = zb->dirty + ty * zb->dirty_cols;
+		GLint tx = 0;
+		while (tx < zb->dirty_cols) {
+			if (!row[tx]) {
+				tx++;
+				continue;
+			}
+			GLint end = tx;
+			while (end < zb->dirty_cols && row[end])
+				end++;
+			ZBRect run = {tx * ZB_DIRTY_TILE, ty * ZB_DIRTY_TILE, (end - tx) * ZB_DIRTY_TILE, ZB_DIRTY_TILE};
+			tx = end;
+
+			GLint i;
+			for (i = 0; i < count; i++)
+				if (rects[i].x == run.x && rects[i].w == run.w && rects[i].y + rects[i].h == run.y)
+					break;
+			if (i < count) {
+				rects[i].h += run.h;
+			} else if (count < max) {
+				rects[count++] = run;
+			} else {
+				/* out of rectangles: the one growing least takes the run */
+				GLint best = 0;
+				long best_growth = -1;
+				for (i = 0; i < count; i++) {
+					ZBRect u = rect_union(&rects[i], &run);
+					long growth = rect_area(&u) - rect_area(&rects[i]);
+					if (best_growth < 0 || growth < best_growth) {
+						best = i;
+						best_growth = growth;
+					}
+				}
+				rects[best] = rect_union(&rects[best], &run);
+			}
+		}
+	}
+	for (GLint i = 0; i < count; i++) {
+		if (rects[i].x + rects[i].w > zb->xsize)
+			rects[i].w = zb->xsize - rects[i].x;
+		if (rects[i].y + rects[i].h > zb->ysize)
+			rects[i].h = zb->ysize - rects[i].y;
+	}
+	return count;
 }
 
 #if TGL_FEATURE_32_BITS == 1
@@ -208,19 +321,20 @@ static inline void copy_rows(PIXEL* restrict src, PIXEL* restrict dst, GLint lin
 }
 
 static void ZB_copyBuffer(ZBuffer* restrict zb, void* restrict buf, GLint linesize) {
+	ZBWorkers* w = zb->workers;
 	GLint half = zb->ysize;
 	if (tgl_threads_enabled) {
 		half = zb->ysize / 2;
-		copy_job.src = zb->pbuf + half * zb->xsize;
-		copy_job.dst = (PIXEL*)((GLbyte*)buf + half * linesize);
-		copy_job.width = zb->xsize;
-		copy_job.stride = linesize;
-		copy_job.lines = zb->ysize - half;
-		step_c11_lsthread(&copy_thread);
+		w->copy_job.src = zb->pbuf + half * zb->xsize;
+		w->copy_job.dst = (PIXEL*)((GLbyte*)buf + half * linesize);
+		w->copy_job.width = zb->xsize;
+		w->copy_job.stride = linesize;
+		w->copy_job.lines = zb->ysize - half;
+		step_c11_lsthread(&w->copy_thread);
 	}
 	copy_rows(zb->pbuf, buf, half, zb->xsize, linesize);
 	if (tgl_threads_enabled)
-		lock_c11_lsthread(&copy_thread);
+		lock_c11_lsthread(&w->copy_thread);
 }
 
 #if TGL_FEATURE_RENDER_BITS == 16
@@ -412,26 +526,27 @@ static inline void memset_l(void* restrict adr, GLint val, GLint count) {
 }
 
 void ZB_clear(ZBuffer* restrict zb, GLint clear_z, GLint z, GLint clear_color, GLint r, GLint g, GLint b) {
+	ZBWorkers* w = zb->workers;
 	GLuint color;
 	GLint y;
 	PIXEL* pp;
 	GLint half = zb->ysize;
 	if (tgl_threads_enabled && zb->ysize >= 64) {
 		half = zb->ysize / 2;
-		clear_job.dst = zb->pbuf + half * zb->xsize;
-		clear_job.zbuf = zb->zbuf + half * zb->xsize;
-		clear_job.width = zb->xsize;
-		clear_job.stride = zb->linesize;
-		clear_job.lines = zb->ysize - half;
-		clear_job.clear_z = clear_z;
-		clear_job.zval = z;
-		clear_job.clear_color = clear_color;
+		w->clear_job.dst = zb->pbuf + half * zb->xsize;
+		w->clear_job.zbuf = zb->zbuf + half * zb->xsize;
+		w->clear_job.width = zb->xsize;
+		w->clear_job.stride = zb->linesize;
+		w->clear_job.lines = zb->ysize - half;
+		w->clear_job.clear_z = clear_z;
+		w->clear_job.zval = z;
+		w->clear_job.clear_color = clear_color;
 #if TGL_FEATURE_FORCE_CLEAR_NO_COPY_COLOR
-		clear_job.color = TGL_NO_COPY_COLOR;
+		w->clear_job.color = TGL_NO_COPY_COLOR;
 #else
-		clear_job.color = RGB_TO_PIXEL(r, g, b);
+		w->clear_job.color = RGB_TO_PIXEL(r, g, b);
 #endif
-		step_c11_lsthread(&clear_thread);
+		step_c11_lsthread(&w->clear_thread);
 	}
 
 	if (clear_z) {
@@ -462,5 +577,47 @@ void ZB_clear(ZBuffer* restrict zb, GLint clear_z, GLint z, GLint clear_color, G
 		}
 	}
 	if (tgl_threads_enabled && zb->ysize >= 64)
-		lock_c11_lsthread(&clear_thread);
+		lock_c11_lsthread(&w->clear_thread);
+	if (clear_color)
+		ZB_markDirty(zb, 0, 0, zb->xsize, zb->ysize);
+}
+
+/* clear only the given rectangle (frame buffer coordinates) */
+void ZB_clearRect(ZBuffer* restrict zb, GLint clear_z, GLint z, GLint clear_color, GLint r, GLint g, GLint b, GLint x, GLint y, GLint w, GLint h) {
+	GLint x1 = x + w, y1 = y + h;
+	if (x < 0)
+		x = 0;
+	if (y < 0)
+		y = 0;
+	if (x1 > zb->xsize)
+		x1 = zb->xsize;
+	if (y1 > zb->ysize)
+		y1 = zb->ysize;
+	if (x >= x1 || y >= y1)
+		return;
+	if (x == 0 && y == 0 && x1 == zb->xsize && y1 == zb->ysize) {
+		ZB_clear(zb, clear_z, z, clear_color, r, g, b);
+		return;
+	}
+
+#if TGL_FEATURE_FORCE_CLEAR_NO_COPY_COLOR
+	PIXEL color = TGL_NO_COPY_COLOR;
+#else
+	PIXEL color = RGB_TO_PIXEL(r, g, b);
+#endif
+	if (clear_color)
+		ZB_markDirty(zb, x, y, x1 - x, y1 - y);
+	/* The word/quad fill helpers assume aligned rows, which x breaks */
+	for (GLint row = y; row < y1; row++) {
+		if (clear_z) {
+			GLushort* zp = zb->zbuf + row * zb->xsize;
+			for (GLint col = x; col < x1; col++)
+				zp[col] = z;
+		}
+		if (clear_color) {
+			PIXEL* pp = (PIXEL*)((GLbyte*)zb->pbuf + row * zb->linesize);
+			for (GLint col = x; col < x1; col++)
+				pp[col] = color;
+		}
+	}
 }
@@ -361,11 +361,17 @@ typedef struct GLContext {
 #if TGL_FEATURE_ERROR_CHECK == 1
 	GLenum error_flag;
 #endif
+	/* worker threads owned by this context */
+	struct TGLRasterWorkers* raster_workers;
+	struct TGLTexWorkers* tex_workers;
+	GLint call_depth; /* glCallList nesting */
 } GLContext;
 
+/* gl_ctx is the default context; each thread draws into its current one */
 extern GLContext gl_ctx;
+extern _Thread_local GLContext* gl_current_ctx;
 extern int tgl_threads_enabled;
-static GLContext* gl_get_context(void) { return &gl_ctx; }
+static GLContext* gl_get_context(void) { return gl_current_ctx; }
 
 extern void (*op_table_func[])(GLParam*);
 extern GLint op_table_size[];
@@ -4,6 +4,14 @@
 
 #define ZCMP(z, zpix) (!(zbdt) || ZB_depth_test(zb, z, zpix))
 
+/* recover the pixel position from the frame buffer pointer */
+static inline GLint zline_in_scissor(ZBuffer* zb, PIXEL* pp, GLint x0, GLint y0, GLint x1, GLint y1) {
+	GLint off = (GLint)((GLbyte*)pp - (GLbyte*)zb->pbuf);
+	GLint y = off / zb->linesize;
+	GLint x = (off - y * zb->linesize) / PSZB;
+	return x >= x0 && x < x1 && y >= y0 && y < y1;
+}
+
 /* TODO: Implement point size. */
 /* TODO: Implement blending for lines and points. */
 
@@ -25,6 +33,7 @@ void ZB_plot(ZBuffer* zb, ZBufferPoint* p) {
 			return;
 		pz = zb->zbuf + (p->y * zb->xsize + p->x);
 		pp = (PIXEL*)((GLbyte*)zb->pbuf + zb->linesize * p->y + p->x * PSZB);
+		ZB_markDirty(zb, p->x, p->y, 1, 1);
 
 		if (ZCMP(zz, *pz)) {
 #if TGL_FEATURE_BLEND == 1
@@ -68,6 +77,7 @@ void ZB_plot(ZBuffer* zb, ZBufferPoint* p) {
 			if (ey > zb->ysize)
 				ey = zb->ysize;
 		}
+		ZB_markDirty(zb, bx, by, ex - bx, ey - by);
 		for (y = by; y < ey; y++)
 			for (x = bx; x < ex; x++) {
 				GLushort* pz = zb->zbuf + (y * zb->xsize + x);
@@ -120,9 +130,17 @@ static void ZB_line_interp(ZBuffer* zb, ZBufferPoint* p1, ZBufferPoint* p2) {
 #include "zline.h"
 }
 
+static void mark_line(ZBuffer* zb, ZBufferPoint* p1, ZBufferPoint* p2) {
+	GLint x0 = p1->x < p2->x ? p1->x : p2->x, x1 = p1->x < p2->x ? p2->x : p1->x;
+	GLint y0 = p1->y < p2->y ? p1->y : p2->y, y1 = p1->y < p2->y ? p2->y : p1->y;
+	ZB_markDirty(zb, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
 void ZB_line_z(ZBuffer* zb, ZBufferPoint* p1, ZBufferPoint* p2) {
 	GLint color1, color2;
 
+	mark_line(zb, p1, p2);
+
 	color1 = RGB_TO_PIXEL(p1->r, p1->g, p1->b);
 	color2 = RGB_TO_PIXEL(p2->r, p2->g, p2->b);
 
@@ -137,6 +155,8 @@ void ZB_line_z(ZBuffer* zb, ZBufferPoint* p1, ZBufferPoint* p2) {
 void ZB_line(ZBuffer* zb, ZBufferPoint* p1, ZBufferPoint* p2) {
 	GLint color1, color2;
 
+	mark_line(zb, p1, p2);
+
 	color1 = RGB_TO_PIXEL(p1->r, p1->g, p1->b);
 	color2 = RGB_TO_PIXEL(p2->r, p2->g, p2->b);
 
@@ -15,6 +15,23 @@
 	register GLint z, zz;
 #endif
 
+	/* scissor: reject lines outside the box, test pixels of lines crossing it */
+	GLint sc_clip = 0, sc_x0 = 0, sc_y0 = 0, sc_x1 = 0, sc_y1 = 0;
+	{
+		GLContext* sc = gl_get_context();
+		if (sc->scissor_enabled) {
+			sc_x0 = sc->scissor_x;
+			sc_y0 = sc->scissor_y;
+			sc_x1 = sc->scissor_x + sc->scissor_width;
+			sc_y1 = sc->scissor_y + sc->scissor_height;
+			GLint lx0 = p1->x < p2->x ? p1->x : p2->x, lx1 = p1->x < p2->x ? p2->x : p1->x;
+			GLint ly0 = p1->y < p2->y ? p1->y : p2->y, ly1 = p1->y < p2->y ? p2->y : p1->y;
+			if (lx1 < sc_x0 || lx0 >= sc_x1 || ly1 < sc_y0 || ly0 >= sc_y1)
+				return;
+			sc_clip = lx0 < sc_x0 || lx1 >= sc_x1 || ly0 < sc_y0 || ly1 >= sc_y1;
+		}
+	}
+
 	if (p1->y > p2->y || (p1->y == p2->y && p1->x > p2->x)) {
 		ZBufferPoint* tmp;
 		tmp = p1;
@@ -54,7 +71,7 @@
 #ifdef INTERP_Z
 #define ZZ(x) x
 #define PUTPIXEL()                                                                                                                                             \
-	{                                                                                                                                                          \
+	if (!sc_clip || zline_in_scissor(zb, pp, sc_x0, sc_y0, sc_x1, sc_y1)) {                                                                                    \
 		zz = z >> ZB_POINT_Z_FRAC_BITS;                                                                                                                        \
 		if (ZCMP(zz, *pz)) {                                                                                                                                   \
 			RGBPIXEL;                                                                                                                                          \
@@ -65,7 +82,10 @@
 	}
 #else /* INTERP_Z */
 #define ZZ(x)
-#define PUTPIXEL() RGBPIXEL
+#define PUTPIXEL()                                                                                                                                             \
+	if (!sc_clip || zline_in_scissor(zb, pp, sc_x0, sc_y0, sc_x1, sc_y1)) {                                                                                    \
+		RGBPIXEL;                                                                                                                                              \
+	}
 #endif /* INTERP_Z */
 
 #define DRAWLINE(dx, dy, inc_1, inc_2)                                                                                                                         \
@@ -18,6 +18,8 @@ typedef struct {
 	ZBufferPoint* p0;
 	ZBufferPoint* p1;
 	ZBufferPoint* p2;
+	int x_start; /* clip rectangle, end exclusive */
+	int x_end;
 	int y_start;
 	int y_end;
 	int mode; /*0 flat,1 smooth,2 textured*/
@@ -27,8 +29,10 @@ typedef struct {
 #ifndef NUM_RASTER_THREADS
 #define NUM_RASTER_THREADS TGL_NUM_THREADS
 #endif
-static c11_lsthread raster_threads[NUM_RASTER_THREADS];
-static RasterJob raster_jobs[NUM_RASTER_THREADS];
+typedef struct TGLRasterWorkers {
+	c11_lsthread threads[NUM_RASTER_THREADS];
+	RasterJob jobs[NUM_RASTER_THREADS];
+} RasterWorkers;
 
 static inline float edgef(float ax, float ay, float bx, float by, float cx, float cy) { return (cx - ax) * (by - ay) - (cy - ay) * (bx - ax); }
 
@@ -63,8 +67,8 @@ static void raster_job(void* arg) {
 		return;
 	float inv_area = 1.0f / area;
 
-	int xmin = (int)fmaxf(floorf(fminf(x0, fminf(x1, x2))), 0);
-	int xmax = (int)fminf(ceilf(fmaxf(x0, fmaxf(x1, x2))), zb->xsize - 1);
+	int xmin = (int)fmaxf(floorf(fminf(x0, fminf(x1, x2))), job->x_start);
+	int xmax = (int)fminf(ceilf(fmaxf(x0, fmaxf(x1, x2))), job->x_end - 1);
 	int ymin = (int)fmaxf(floorf(fminf(y0, fminf(y1, y2))), job->y_start);
 	int ymax = (int)fminf(ceilf(fmaxf(y0, fmaxf(y1, y2))), job->y_end - 1);
 
@@ -125,30 +129,45 @@ static void raster_job(void* arg) {
 	}
 }
 
-static void start_raster_jobs(RasterJob base) {
-	int h = (base.zb->ysize + NUM_RASTER_THREADS - 1) / NUM_RASTER_THREADS;
+/* split the job's rows into one band per worker */
+static void start_raster_jobs(RasterWorkers* w, RasterJob base) {
+	int rows = base.y_end - base.y_start;
+	int h = (rows + NUM_RASTER_THREADS - 1) / NUM_RASTER_THREADS;
 	for (int i = 0; i < NUM_RASTER_THREADS; i++) {
-		raster_jobs[i] = base;
-		raster_jobs[i].y_start = i * h;
-		raster_jobs[i].y_end = (i == NUM_RASTER_THREADS - 1) ? base.zb->ysize : (i + 1) * h;
-		step_c11_lsthread(&raster_threads[i]);
+		w->jobs[i] = base;
+		w->jobs[i].y_start = base.y_start + i * h;
+		w->jobs[i].y_end = (i == NUM_RASTER_THREADS - 1) ? base.y_end : base.y_start + (i + 1) * h;
+		if (w->jobs[i].y_end > base.y_end)
+			w->jobs[i].y_end = base.y_end;
+		step_c11_lsthread(&w->threads[i]);
 	}
 	for (int i = 0; i < NUM_RASTER_THREADS; i++)
-		lock_c11_lsthread(&raster_threads[i]);
+		lock_c11_lsthread(&w->threads[i]);
 }
 void init_raster_threads(void) {
+	GLContext* c = gl_get_context();
+	RasterWorkers* w = gl_zalloc(sizeof(RasterWorkers));
+	if (!w)
+		gl_fatal_error("TINYGL_CANNOT_INIT_OOM");
+	c->raster_workers = w;
 	for (int i = 0; i < NUM_RASTER_THREADS; i++) {
-		init_c11_lsthread(&raster_threads[i]);
-		raster_threads[i].execute = raster_job;
-		raster_threads[i].argument = &raster_jobs[i];
-		start_c11_lsthread(&raster_threads[i]);
+		init_c11_lsthread(&w->threads[i]);
+		w->threads[i].execute = raster_job;
+		w->threads[i].argument = &w->jobs[i];
+		start_c11_lsthread(&w->threads[i]);
 	}
 }
 void end_raster_threads(void) {
+	GLContext* c = gl_get_context();
+	RasterWorkers* w = c->raster_workers;
+	if (!w)
+		return;
 	for (int i = 0; i < NUM_RASTER_THREADS; i++) {
-		kill_c11_lsthread(&raster_threads[i]);
-		destroy_c11_lsthread(&raster_threads[i]);
+		kill_c11_lsthread(&w->threads[i]);
+		destroy_c11_lsthread(&w->threads[i]);
 	}
+	gl_free(w);
+	c->raster_workers = NULL;
 }
 
 void ZB_setTexture(ZBuffer* zb, GLTexture* tex) {
@@ -158,12 +177,40 @@ void ZB_setTexture(ZBuffer* zb, GLTexture* tex) {
 }
 
 static void draw_triangle(ZBuffer* zb, ZBufferPoint* p0, ZBufferPoint* p1, ZBufferPoint* p2, int mode, PIXEL flat) {
-	if (tgl_threads_enabled && zb->ysize > 64) {
-		RasterJob base = {zb, p0, p1, p2, 0, zb->ysize, mode, flat};
-		start_raster_jobs(base);
+	GLContext* c = gl_get_context();
+	RasterJob job = {zb, p0, p1, p2, 0, zb->xsize, 0, zb->ysize, mode, flat};
+
+	/* restrict the job to the scissor box */
+	if (c->scissor_enabled) {
+		if (c->scissor_x > job.x_start)
+			job.x_start = c->scissor_x;
+		if (c->scissor_y > job.y_start)
+			job.y_start = c->scissor_y;
+		if (c->scissor_x + c->scissor_width < job.x_end)
+			job.x_end = c->scissor_x + c->scissor_width;
+		if (c->scissor_y + c->scissor_height < job.y_end)
+			job.y_end = c->scissor_y + c->scissor_height;
+	}
+
+	/* and to the triangle's rows, rejecting it when nothing is left */
+	GLint ymin = p0->y < p1->y ? (p0->y < p2->y ? p0->y : p2->y) : (p1->y < p2->y ? p1->y : p2->y);
+	GLint ymax = p0->y > p1->y ? (p0->y > p2->y ? p0->y : p2->y) : (p1->y > p2->y ? p1->y : p2->y);
+	GLint xmin = p0->x < p1->x ? (p0->x < p2->x ? p0->x : p2->x) : (p1->x < p2->x ? p1->x : p2->x);
+	GLint xmax = p0->x > p1->x ? (p0->x > p2->x ? p0->x : p2->x) : (p1->x > p2->x ? p1->x : p2->x);
+	if (ymin > job.y_start)
+		job.y_start = ymin;
+	if (ymax + 1 < job.y_end)
+		job.y_end = ymax + 1;
+	if (job.y_start >= job.y_end || xmin >= job.x_end || xmax < job.x_start)
+		return;
+	GLint x0 = xmin > job.x_start ? xmin : job.x_start;
+	GLint x1 = xmax + 1 < job.x_end ? xmax + 1 : job.x_end;
+	ZB_markDirty(zb, x0, job.y_start, x1 - x0, job.y_end - job.y_start);
+
+	if (tgl_threads_enabled && job.y_end - job.y_start > 64) {
+		start_raster_jobs(c->raster_workers, job);
 		return;
 	}
-	RasterJob job = {zb, p0, p1, p2, 0, zb->ysize, mode, flat};
 	raster_job(&job);
 }
 
@@ -4,7 +4,7 @@
 #include <stdio.h>
 
 int main(void) {
-  ZBuffer *zb = ZB_open(16, 16, ZB_MODE_RGBA, 0);
+  ZBuffer *zb = ZB_open(16, 16, ZB_MODE_NATIVE, 0);
   if (!zb)
     return 1;
   glInit(zb);
@@ -52,7 +52,7 @@ int main(void) {
     rot[i] = (rand() & 0x7fff) / 16384.0f * 360.0f;
   }
 
-  ZBuffer *zb = ZB_open(WIN_X, WIN_Y, ZB_MODE_RGBA, 0);
+  ZBuffer *zb = ZB_open(WIN_X, WIN_Y, ZB_MODE_NATIVE, 0);
   if (!zb)
     return 1;
   glInit(zb);
@@ -0,0 +1,91 @@
+#include "../include/zbuffer.h"
+#include "../src/gl_init.h"
+#include "../src/gl_state.h"
+#include "../src/gl_utils.h"
+#include "../src/gl_vertex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FB_W 64
+#define FB_H 64
+
+/* one RGB565 step of red or blue, plus interpolation rounding */
+#if TGL_FEATURE_RENDER_BITS == 16
+#define TOLERANCE 9
+#else
+#define TOLERANCE 2
+#endif
+
+static void fill(GLfloat r, GLfloat g, GLfloat b) {
+  glColor3f(r, g, b);
+  glBegin(GL_TRIANGLES);
+  glVertex3f(-1.f, -1.f, 0.f);
+  glVertex3f(1.f, -1.f, 0.f);
+  glVertex3f(1.f, 1.f, 0.f);
+  glVertex3f(-1.f, -1.f, 0.f);
+  glVertex3f(1.f, 1.f, 0.f);
+  glVertex3f(-1.f, 1.f, 0.f);
+  glEnd();
+}
+
+/* read back the middle of the frame through glReadPixels */
+static int expect(const char *what, int r, int g, int b) {
+  static GLubyte rgb[FB_W * FB_H * 3];
+  glReadPixels(0, FB_H, FB_W, FB_H, GL_RGB, GL_UNSIGNED_INT, rgb);
+  const GLubyte *p = rgb + ((FB_H / 2) * FB_W + FB_W / 2) * 3;
+  if (abs(p[0] - r) > TOLERANCE || abs(p[1] - g) > TOLERANCE ||
+      abs(p[2] - b) > TOLERANCE) {
+    printf("%s: got %d %d %d, expected %d %d %d\n", what, p[0], p[1], p[2], r,
+           g, b);
+    return 1;
+  }
+  return 0;
+}
+
+int main(void) {
+  ZBuffer *zb = ZB_open(FB_W, FB_H, ZB_MODE_NATIVE, 0);
+  if (!zb)
+    return 1;
+  glInit(zb);
+  glViewport(0, 0, FB_W, FB_H);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glDisable(GL_DEPTH_TEST);
+  glShadeModel(GL_FLAT);
+
+  int failed = 0;
+
+  /* every channel lands in its own place */
+  glClearColor(1.f, 0.5f, 0.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  failed |= expect("clear", 255, 128, 0);
+  fill(0.f, 0.25f, 1.f);
+  failed |= expect("fill", 0, 64, 255);
+
+  /* additive: each source channel adds to the same destination channel */
+  glClearColor(0.25f, 0.5f, 0.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  fill(0.5f, 0.25f, 0.75f);
+  failed |= expect("add", 191, 191, 191);
+  /* and saturates instead of carrying into the next channel */
+  fill(0.5f, 0.5f, 0.5f);
+  failed |= expect("saturate", 255, 255, 255);
+
+  /* inverting the destination */
+  glClearColor(0.25f, 0.5f, 1.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glBlendFunc(GL_ZERO, GL_ONE_MINUS_DST_COLOR);
+  fill(1.f, 1.f, 1.f);
+  failed |= expect("invert", 191, 127, 0);
+  glDisable(GL_BLEND);
+
+  GLenum err = glGetError();
+  glClose();
+  ZB_close(zb);
+  return failed || err != GL_NO_ERROR;
+}
@@ -0,0 +1,105 @@
+#include "../include/zbuffer.h"
+#include "../src/gl_init.h"
+#include "../src/gl_state.h"
+#include "../src/gl_utils.h"
+#include "../src/gl_vertex.h"
+
+#define FB_W 128
+#define FB_H 128
+
+static int dirty_area(ZBuffer *zb) {
+  ZBRect rects[8];
+  int n = ZB_dirtyRects(zb, rects, 8), area = 0;
+  for (int i = 0; i < n; i++)
+    area += rects[i].w * rects[i].h;
+  return area;
+}
+
+static int is_dirty(ZBuffer *zb, int x, int y) {
+  return zb->dirty[(y / ZB_DIRTY_TILE) * zb->dirty_cols + x / ZB_DIRTY_TILE];
+}
+
+int main(void) {
+  ZBuffer *zb = ZB_open(FB_W, FB_H, ZB_MODE_NATIVE, 0);
+  if (!zb)
+    return 1;
+  glInit(zb);
+  glViewport(0, 0, FB_W, FB_H);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glDisable(GL_DEPTH_TEST);
+
+  /* a new buffer and a full clear are all dirty */
+  int failed = dirty_area(zb) != FB_W * FB_H;
+  ZB_clearDirty(zb);
+  failed |= dirty_area(zb) != 0;
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  failed |= dirty_area(zb) != FB_W * FB_H;
+
+  /* a depth-only clear changes no pixels */
+  ZB_clearDirty(zb);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  failed |= dirty_area(zb) != 0;
+
+  /* a small triangle in the lower left marks only the tiles it covers */
+  PIXEL before[FB_W * FB_H];
+  for (int y = 0; y < FB_H; y++)
+    memcpy(before + y * FB_W, (GLbyte *)zb->pbuf + y * zb->linesize,
+           FB_W * sizeof(PIXEL));
+  glColor3f(0.f, 1.f, 0.f);
+  glBegin(GL_TRIANGLES);
+  glVertex3f(-0.9f, -0.9f, 0.f);
+  glVertex3f(-0.6f, -0.9f, 0.f);
+  glVertex3f(-0.9f, -0.6f, 0.f);
+  glEnd();
+  glBegin(GL_LINES);
+  glVertex3f(0.5f, 0.5f, 0.f);
+  glVertex3f(0.7f, 0.5f, 0.f);
+  glEnd();
+  glPlotPixel(100, 10, 0xffffff);
+  glFlush();
+  int changed = 0;
+  for (int y = 0; y < FB_H; y++)
+    for (int x = 0; x < FB_W; x++) {
+      PIXEL p = *(PIXEL *)((GLbyte *)zb->pbuf + y * zb->linesize + x * PSZB);
+      if (p != before[y * FB_W + x]) {
+        changed++;
+        failed |= !is_dirty(zb, x, y);
+      }
+    }
+  int area = dirty_area(zb);
+  failed |= changed == 0 || area == 0 || area > FB_W * FB_H / 4;
+
+  /* rectangles cover every dirty tile, within the budget given */
+  ZBRect rects[2];
+  int n = ZB_dirtyRects(zb, rects, 2);
+  failed |= n != 2;
+  for (int ty = 0; ty < zb->dirty_rows; ty++)
+    for (int tx = 0; tx < zb->dirty_cols; tx++) {
+      if (!zb->dirty[ty * zb->dirty_cols + tx])
+        continue;
+      int covered = 0;
+      for (int i = 0; i < n; i++)
+        covered |= tx * ZB_DIRTY_TILE >= rects[i].x &&
+                   tx * ZB_DIRTY_TILE < rects[i].x + rects[i].w &&
+                   ty * ZB_DIRTY_TILE >= rects[i].y &&
+                   ty * ZB_DIRTY_TILE < rects[i].y + rects[i].h;
+      failed |= !covered;
+    }
+
+  /* scissored clears mark the scissor box */
+  ZB_clearDirty(zb);
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(40, 40, 32, 32);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glDisable(GL_SCISSOR_TEST);
+  failed |= dirty_area(zb) != 48 * 48 || !is_dirty(zb, 40, 40) ||
+            is_dirty(zb, 80, 40);
+
+  GLenum err = glGetError();
+  glClose();
+  ZB_close(zb);
+  return failed || err != GL_NO_ERROR;
+}
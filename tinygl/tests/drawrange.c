@@ -5,7 +5,7 @@
 #include "../src/gl_vertex.h"
 
 int main(void) {
-  ZBuffer *zb = ZB_open(16, 16, ZB_MODE_RGBA, 0);
+  ZBuffer *zb = ZB_open(16, 16, ZB_MODE_NATIVE, 0);
   if (!zb)
     return 1;
   glInit(zb);
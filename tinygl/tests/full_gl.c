@@ -28,7 +28,7 @@ static int run_case(const char *logpath, int threads) {
     return 1;
   tgl_threads_enabled = threads;
 
-  ZBuffer *zb = ZB_open(32, 32, ZB_MODE_RGBA, 0);
+  ZBuffer *zb = ZB_open(32, 32, ZB_MODE_NATIVE, 0);
   if (!zb) {
     fprintf(log_file, "ZB_open failed\n");
     fclose(log_file);
@@ -414,9 +414,9 @@ int main(int argc, char **argv) {
   // int mode;
   ZBuffer *frameBuffer = NULL;
   if (TGL_FEATURE_RENDER_BITS == 32)
-    frameBuffer = ZB_open(winSizeX, winSizeY, ZB_MODE_RGBA, 0);
+    frameBuffer = ZB_open(winSizeX, winSizeY, ZB_MODE_NATIVE, 0);
   else
-    frameBuffer = ZB_open(winSizeX, winSizeY, ZB_MODE_RGBA, 0);
+    frameBuffer = ZB_open(winSizeX, winSizeY, ZB_MODE_NATIVE, 0);
   if (!frameBuffer) {
     printf("\nZB_open failed!");
     exit(1);
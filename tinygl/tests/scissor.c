@@ -0,0 +1,67 @@
+#include "../include/zbuffer.h"
+#include "../src/gl_init.h"
+#include "../src/gl_state.h"
+#include "../src/gl_utils.h"
+#include "../src/gl_vertex.h"
+
+#define FB_W 128
+#define FB_H 128
+
+static PIXEL pixel(ZBuffer *zb, int x, int y) {
+  return *(PIXEL *)((GLbyte *)zb->pbuf + y * zb->linesize + x * PSZB);
+}
+
+int main(void) {
+  ZBuffer *zb = ZB_open(FB_W, FB_H, ZB_MODE_NATIVE, 0);
+  if (!zb)
+    return 1;
+  glInit(zb);
+  glViewport(0, 0, FB_W, FB_H);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glDisable(GL_DEPTH_TEST);
+
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  PIXEL outer = pixel(zb, 0, 0);
+
+  /* clear, fill and draw lines inside a scissor box */
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(40, 40, 32, 32);
+  glClearColor(1.f, 1.f, 1.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  PIXEL inner = pixel(zb, 50, 50);
+
+  glColor3f(0.f, 1.f, 0.f);
+  glBegin(GL_TRIANGLES);
+  glVertex3f(-1.f, -1.f, 0.f);
+  glVertex3f(1.f, -1.f, 0.f);
+  glVertex3f(-1.f, 1.f, 0.f);
+  glEnd();
+  glBegin(GL_LINES);
+  glVertex3f(-1.f, 0.95f, 0.f);
+  glVertex3f(1.f, -0.95f, 0.f);
+  glEnd();
+  glDisable(GL_SCISSOR_TEST);
+  glFlush();
+
+  int failed = inner == outer;
+  for (int y = 0; y < FB_H; y++) {
+    for (int x = 0; x < FB_W; x++) {
+      int inside = x >= 40 && x < 72 && y >= 40 && y < 72;
+      PIXEL p = pixel(zb, x, y);
+      if (!inside && p != outer)
+        failed = 1;
+    }
+  }
+  /* the triangle covers the upper-left part of the box */
+  if (pixel(zb, 42, 42) == inner || pixel(zb, 42, 42) == outer)
+    failed = 1;
+
+  GLenum err = glGetError();
+  glClose();
+  ZB_close(zb);
+  return failed || err != GL_NO_ERROR;
+}
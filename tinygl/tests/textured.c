@@ -6,7 +6,7 @@
 #include "../src/gl_vertex.h"
 
 int main(void) {
-  ZBuffer *zb = ZB_open(32, 32, ZB_MODE_RGBA, 0);
+  ZBuffer *zb = ZB_open(32, 32, ZB_MODE_NATIVE, 0);
   if (!zb)
     return 1;
   glInit(zb);
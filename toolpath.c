@@ -0,0 +1,601 @@
+/* toolpath.c */
+
+#include "toolpath.h"
+
+#include <float.h>
+#include <stdatomic.h>
+
+#define TOOLPATH_SEGMENT 1 // A segment from the previous point ends here
+#define TOOLPATH_RAPID 2   // ... and it is a rapid move
+
+typedef struct {
+  float points[UCNC_TOOLPATH_CHUNK_POINTS * 3];
+  unsigned char flags[UCNC_TOOLPATH_CHUNK_POINTS];
+  int count;
+  float min[3], max[3];
+} ToolpathChunk;
+
+// Screen-space line from the projection pass; z is in depth buffer units
+typedef struct {
+  float x0, y0, z0;
+  float x1, y1, z1;
+  int rapid;
+} ToolpathLine;
+
+// Per-chunk render scratch, reused across frames
+typedef struct {
+  const ToolpathChunk *chunk;
+  int points; // Points of the chunk at snapshot time
+  float min[3], max[3]; // Its bounds then; the last chunk keeps growing
+  ToolpathLine *lines;
+  int count, capacity;
+  float xmin, xmax, ymin, ymax;
+} ToolpathBatch;
+
+struct ucncToolpath {
+  pthread_mutex_t lock; // Guards chunks, segmentCount and the pen
+  ToolpathChunk **chunks;
+  int chunkCount, chunkCapacity;
+  unsigned long segmentCount;
+  int hasPoint;
+  float feedColor[3], rapidColor[3];
+  atomic_ulong generation;
+
+  ToolpathBatch *batches; // Only touched by the renderer
+  int batchCapacity;
+};
+
+typedef struct {
+  ZBuffer *zb;
+  float mvp[16]; // Projection * modelview, row major
+  float scale[3], trans[3];
+  int clipX0, clipY0, clipX1, clipY1;
+  PIXEL feed, rapid;
+  ToolpathBatch *batches;
+  int batchCount;
+  int bandRows, bandCount;
+  atomic_int next;
+  void (*work)(void *job, int item);
+  int items;
+} RenderJob;
+
+ucncToolpath *ucncToolpathNew(void) {
+  ucncToolpath *toolpath = calloc(1, sizeof(ucncToolpath));
+  if (!toolpath) {
+    fprintf(stderr, "Memory allocation failed for toolpath.\n");
+    return NULL;
+  }
+  pthread_mutex_init(&toolpath->lock, NULL);
+  const float feed[3] = {0.1f, 0.9f, 0.2f}, rapid[3] = {0.9f, 0.2f, 0.1f};
+  memcpy(toolpath->feedColor, feed, sizeof(feed));
+  memcpy(toolpath->rapidColor, rapid, sizeof(rapid));
+  atomic_init(&toolpath->generation, 0);
+  return toolpath;
+}
+
+void ucncToolpathClear(ucncToolpath *toolpath) {
+  if (!toolpath)
+    return;
+  pthread_mutex_lock(&toolpath->lock);
+  for (int i = 0; i < toolpath->chunkCount; i++)
+    free(toolpath->chunks[i]);
+  toolpath->chunkCount = 0;
+  toolpath->segmentCount = 0;
+  toolpath->hasPoint = 0;
+  pthread_mutex_unlock(&toolpath->lock);
+  atomic_fetch_add(&toolpath->generation, 1);
+}
+
+void ucncToolpathFree(ucncToolpath *toolpath) {
+  if (!toolpath)
+    return;
+  ucncToolpathClear(toolpath);
+  free(toolpath->chunks);
+  for (int i = 0; i < toolpath->batchCapacity; i++)
+    free(toolpath->batches[i].lines);
+  free(toolpath->batches);
+  pthread_mutex_destroy(&toolpath->lock);
+  free(toolpath);
+}
+
+static ToolpathChunk *newChunkLocked(ucncToolpath *toolpath) {
+  if (toolpath->chunkCount == toolpath->chunkCapacity) {
+    int capacity = toolpath->chunkCapacity ? toolpath->chunkCapacity * 2 : 16;
+    ToolpathChunk **chunks =
+        realloc(toolpath->chunks, capacity * sizeof(ToolpathChunk *));
+    if (!chunks)
+      return NULL;
+    toolpath->chunks = chunks;
+    toolpath->chunkCapacity = capacity;
+  }
+  ToolpathChunk *chunk = malloc(sizeof(ToolpathChunk));
+  if (!chunk)
+    return NULL;
+  chunk->count = 0;
+  for (int k = 0; k < 3; k++) {
+    chunk->min[k] = FLT_MAX;
+    chunk->max[k] = -FLT_MAX;
+  }
+  toolpath->chunks[toolpath->chunkCount++] = chunk;
+  return chunk;
+}
+
+static void addPoint(ToolpathChunk *chunk, const float *p, unsigned char flags) {
+  float *dst = &chunk->points[chunk->count * 3];
+  for (int k = 0; k < 3; k++) {
+    dst[k] = p[k];
+    if (p[k] < chunk->min[k])
+      chunk->min[k] = p[k];
+    if (p[k] > chunk->max[k])
+      chunk->max[k] = p[k];
+  }
+  chunk->flags[chunk->count++] = flags;
+}
+
+// Append a point; segments crossing into a new chunk start it with a copy
+// of the previous point so every chunk can be drawn on its own
+static int appendLocked(ucncToolpath *toolpath, const float *p,
+                        unsigned char flags) {
+  if (!toolpath->hasPoint)
+    flags = 0;
+  ToolpathChunk *chunk =
+      toolpath->chunkCount ? toolpath->chunks[toolpath->chunkCount - 1] : NULL;
+  if (!chunk || chunk->count == UCNC_TOOLPATH_CHUNK_POINTS) {
+    ToolpathChunk *next = newChunkLocked(toolpath);
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for toolpath chunk.\n");
+      return -1;
+    }
+    if (chunk && (flags & TOOLPATH_SEGMENT))
+      addPoint(next, &chunk->points[(chunk->count - 1) * 3], 0);
+    chunk = next;
+  }
+  addPoint(chunk, p, flags);
+  if (flags & TOOLPATH_SEGMENT)
+    toolpath->segmentCount++;
+  toolpath->hasPoint = 1;
+  return 0;
+}
+
+int ucncToolpathMoveTo(ucncToolpath *toolpath, float x, float y, float z) {
+  if (!toolpath)
+    return -1;
+  const float p[3] = {x, y, z};
+  pthread_mutex_lock(&toolpath->lock);
+  int result = appendLocked(toolpath, p, 0);
+  pthread_mutex_unlock(&toolpath->lock);
+  atomic_fetch_add(&toolpath->generation, 1);
+  return result;
+}
+
+int ucncToolpathLineTo(ucncToolpath *toolpath, float x, float y, float z,
+                       int rapid) {
+  const float p[3] = {x, y, z};
+  return ucncToolpathAppend(toolpath, p, 1, rapid);
+}
+
+int ucncToolpathAppend(ucncToolpath *toolpath, const float *points,
+                       unsigned long count, int rapid) {
+  if (!toolpath || (!points && count > 0))
+    return -1;
+  unsigned char flags = TOOLPATH_SEGMENT | (rapid ? TOOLPATH_RAPID : 0);
+  int result = 0;
+  pthread_mutex_lock(&toolpath->lock);
+  for (unsigned long i = 0; i < count && result == 0; i++)
+    result = appendLocked(toolpath, &points[i * 3], flags);
+  pthread_mutex_unlock(&toolpath->lock);
+  atomic_fetch_add(&toolpath->generation, 1);
+  return result;
+}
+
+unsigned long ucncToolpathSegmentCount(ucncToolpath *toolpath) {
+  if (!toolpath)
+    return 0;
+  pthread_mutex_lock(&toolpath->lock);
+  unsigned long count = toolpath->segmentCount;
+  pthread_mutex_unlock(&toolpath->lock);
+  return count;
+}
+
+void ucncToolpathSetColors(ucncToolpath *toolpath, const float feed[3],
+                           const float rapid[3]) {
+  if (!toolpath)
+    return;
+  if (feed)
+    memcpy(toolpath->feedColor, feed, sizeof(toolpath->feedColor));
+  if (rapid)
+    memcpy(toolpath->rapidColor, rapid, sizeof(toolpath->rapidColor));
+  atomic_fetch_add(&toolpath->generation, 1);
+}
+
+unsigned long ucncToolpathGeneration(const ucncToolpath *toolpath) {
+  return toolpath ? atomic_load(&toolpath->generation) : 0;
+}
+
+// === Projection pass ===
+
+static void clipPoint(const RenderJob *job, const float *p, float *out) {
+  for (int i = 0; i < 4; i++) {
+    const float *row = &job->mvp[i * 4];
+    out[i] = row[0] * p[0] + row[1] * p[1] + row[2] * p[2] + row[3];
+  }
+}
+
+// Outcode of a clip-space point against the six frustum planes
+static int outcode(const float *c) {
+  return (c[0] < -c[3]) | (c[0] > c[3]) << 1 | (c[1] < -c[3]) << 2 |
+         (c[1] > c[3]) << 3 | (c[2] < -c[3]) << 4 | (c[2] > c[3]) << 5;
+}
+
+static int boxOutside(const RenderJob *job, const float *min,
+                      const float *max) {
+  int all = 0x3f;
+  for (int corner = 0; corner < 8 && all; corner++) {
+    const float p[3] = {(corner & 1) ? max[0] : min[0],
+                        (corner & 2) ? max[1] : min[1],
+                        (corner & 4) ? max[2] : min[2]};
+    float c[4];
+    clipPoint(job, p, c);
+    all &= outcode(c);
+  }
+  return all != 0;
+}
+
+// Liang-Barsky step, as TinyGL clips lines
+static int clipLine1(float denom, float num, float *tmin, float *tmax) {
+  if (denom > 0.0f) {
+    float t = num / denom;
+    if (t > *tmax)
+      return 0;
+    if (t > *tmin)
+      *tmin = t;
+  } else if (denom < 0.0f) {
+    float t = num / denom;
+    if (t < *tmin)
+      return 0;
+    if (t < *tmax)
+      *tmax = t;
+  } else if (num > 0.0f) {
+    return 0;
+  }
+  return 1;
+}
+
+static int clipSegment(const float *a, const float *b, float *tmin,
+                       float *tmax) {
+  float d[4];
+  for (int i = 0; i < 4; i++)
+    d[i] = b[i] - a[i];
+  *tmin = 0.0f;
+  *tmax = 1.0f;
+  for (int i = 0; i < 3; i++) {
+    if (!clipLine1(d[i] + d[3], -a[i] - a[3], tmin, tmax) ||
+        !clipLine1(-d[i] + d[3], a[i] - a[3], tmin, tmax))
+      return 0;
+  }
+  return 1;
+}
+
+// Viewport transform of a clip-space point, matching TinyGL's
+static void toScreen(const RenderJob *job, const float *c, float *out) {
+  float winv = 1.0f / c[3];
+  out[0] = c[0] * winv * job->scale[0] + job->trans[0];
+  out[1] = c[1] * winv * job->scale[1] + job->trans[1];
+  out[2] = (c[2] * winv * job->scale[2] + job->trans[2]) *
+           (1.0f / (1 << ZB_POINT_Z_FRAC_BITS));
+}
+
+static void toScreenAt(const RenderJob *job, const float *a, const float *b,
+                       float t, float *out) {
+  float c[4];
+  for (int i = 0; i < 4; i++)
+    c[i] = a[i] + t * (b[i] - a[i]);
+  toScreen(job, c, out);
+}
+
+static void emitLine(ToolpathBatch *batch, const float *s, const float *e,
+                     int rapid) {
+  if (batch->count == batch->capacity) {
+    int capacity = batch->capacity ? batch->capacity * 2 : 256;
+    ToolpathLine *lines = realloc(batch->lines, capacity * sizeof(*lines));
+    if (!lines)
+      return;
+    batch->lines = lines;
+    batch->capacity = capacity;
+  }
+  ToolpathLine *line = &batch->lines[batch->count++];
+  line->x0 = s[0];
+  line->y0 = s[1];
+  line->z0 = s[2];
+  line->x1 = e[0];
+  line->y1 = e[1];
+  line->z1 = e[2];
+  line->rapid = rapid;
+  float left = s[0] < e[0] ? s[0] : e[0], right = s[0] < e[0] ? e[0] : s[0];
+  if (left < batch->xmin)
+    batch->xmin = left;
+  if (right > batch->xmax)
+    batch->xmax = right;
+  float lo = s[1] < e[1] ? s[1] : e[1], hi = s[1] < e[1] ? e[1] : s[1];
+  if (lo < batch->ymin)
+    batch->ymin = lo;
+  if (hi > batch->ymax)
+    batch->ymax = hi;
+}
+
+// Project a chunk into screen lines. Consecutive segments of one kind are
+// merged until they reach a pixel; the rest of a run is flushed when the
+// polyline breaks or leaves the view. Points inside the frustum are only
+// projected once, the clipper only sees segments crossing its planes.
+static void projectBatch(void *arg, int item) {
+  const RenderJob *job = arg;
+  ToolpathBatch *batch = &job->batches[item];
+  const ToolpathChunk *chunk = batch->chunk;
+  batch->count = 0;
+  batch->xmin = batch->ymin = FLT_MAX;
+  batch->xmax = -FLT_MAX;
+  batch->ymax = -FLT_MAX;
+  if (boxOutside(job, batch->min, batch->max))
+    return;
+
+  float prev[4], cur[4], prevScreen[3], curScreen[3];
+  float start[3], end[3]; // Open run: last emitted point, pending end
+  int prevCode = 0x3f, open = 0, pending = 0, runRapid = 0;
+  for (int i = 0; i < batch->points; i++) {
+    clipPoint(job, &chunk->points[i * 3], cur);
+    int code = outcode(cur);
+    if (code == 0)
+      toScreen(job, cur, curScreen);
+
+    unsigned char flags = chunk->flags[i];
+    int visible = i > 0 && (flags & TOOLPATH_SEGMENT) && !(code & prevCode);
+    float clipped[2][3];
+    const float *a = prevScreen, *b = curScreen;
+    if (visible && (code | prevCode)) {
+      float tmin, tmax;
+      visible = clipSegment(prev, cur, &tmin, &tmax);
+      if (visible && prevCode) {
+        toScreenAt(job, prev, cur, tmin, clipped[0]);
+        a = clipped[0];
+      }
+      if (visible && code) {
+        toScreenAt(job, prev, cur, tmax, clipped[1]);
+        b = clipped[1];
+      }
+    }
+
+    if (visible) {
+      int rapid = (flags & TOOLPATH_RAPID) != 0;
+      if (!open || prevCode || rapid != runRapid) {
+        if (pending)
+          emitLine(batch, start, end, runRapid);
+        memcpy(start, a, sizeof(start));
+        open = 1;
+        pending = 0;
+        runRapid = rapid;
+      }
+      if (fabsf(b[0] - start[0]) >= 1.0f || fabsf(b[1] - start[1]) >= 1.0f) {
+        emitLine(batch, start, b, rapid);
+        memcpy(start, b, sizeof(start));
+        pending = 0;
+      } else {
+        memcpy(end, b, sizeof(end));
+        pending = 1;
+      }
+    }
+    if (!visible || code) {
+      if (pending)
+        emitLine(batch, start, end, runRapid);
+      open = pending = 0;
+    }
+    memcpy(prev, cur, sizeof(prev));
+    memcpy(prevScreen, curScreen, sizeof(prevScreen));
+    prevCode = code;
+  }
+  if (pending)
+    emitLine(batch, start, end, runRapid);
+}
+
+// === Raster pass ===
+
+static void rasterLine(const RenderJob *job, const ToolpathLine *line, int y0,
+                       int y1) {
+  ZBuffer *zb = job->zb;
+  float dx = line->x1 - line->x0, dy = line->y1 - line->y0;
+  float length = fabsf(dx) > fabsf(dy) ? fabsf(dx) : fabsf(dy);
+  int steps = (int)ceilf(length);
+  float inv = steps > 0 ? 1.0f / steps : 0.0f;
+  float sx = dx * inv, sy = dy * inv, sz = (line->z1 - line->z0) * inv;
+
+  // Only the steps whose row falls into this band
+  int first = 0, last = steps;
+  if (sy != 0.0f) {
+    float a = (y0 - 0.5f - line->y0) / sy, b = (y1 - 0.5f - line->y0) / sy;
+    if (a > b) {
+      float swap = a;
+      a = b;
+      b = swap;
+    }
+    if (a > first)
+      first = (int)floorf(a);
+    if (b < last)
+      last = (int)ceilf(b);
+  }
+
+  PIXEL color = line->rapid ? job->rapid : job->feed;
+  for (int i = first; i <= last; i++) {
+    int x = (int)floorf(line->x0 + i * sx + 0.5f);
+    int y = (int)floorf(line->y0 + i * sy + 0.5f);
+    if (y < y0 || y >= y1 || x < job->clipX0 || x >= job->clipX1)
+      continue;
+    GLuint z = (GLuint)(line->z0 + i * sz);
+    GLushort *pz = zb->zbuf + (y * zb->xsize + x);
+    if (zb->depth_test && !ZB_depth_test(zb, z, *pz))
+      continue;
+    *(PIXEL *)((GLbyte *)zb->pbuf + zb->linesize * y + x * PSZB) = color;
+    if (zb->depth_write)
+      *pz = (GLushort)z;
+  }
+}
+
+static void rasterBand(void *arg, int item) {
+  const RenderJob *job = arg;
+  int y0 = job->clipY0 + item * job->bandRows;
+  int y1 = y0 + job->bandRows < job->clipY1 ? y0 + job->bandRows : job->clipY1;
+  for (int b = 0; b < job->batchCount; b++) {
+    const ToolpathBatch *batch = &job->batches[b];
+    if (batch->count == 0 || batch->ymax < y0 - 1 || batch->ymin > y1)
+      continue;
+    for (int i = 0; i < batch->count; i++) {
+      const ToolpathLine *line = &batch->lines[i];
+      float lo = line->y0 < line->y1 ? line->y0 : line->y1;
+      float hi = line->y0 < line->y1 ? line->y1 : line->y0;
+      if (hi >= y0 - 1 && lo <= y1)
+        rasterLine(job, line, y0, y1);
+    }
+  }
+}
+
+static void *renderWorker(void *arg) {
+  RenderJob *job = arg;
+  int item;
+  while ((item = atomic_fetch_add(&job->next, 1)) < job->items)
+    job->work(job, item);
+  return NULL;
+}
+
+// Run work over items on up to threadCount threads, the caller included
+static void runParallel(RenderJob *job, void (*work)(void *, int), int items,
+                        int threadCount) {
+  pthread_t threads[UCNC_TOOLPATH_MAX_THREADS];
+  int started = 0;
+  job->work = work;
+  job->items = items;
+  atomic_store(&job->next, 0);
+  for (int i = 1; i < threadCount && i < items; i++) {
+    if (pthread_create(&threads[started], NULL, renderWorker, job) == 0)
+      started++;
+  }
+  renderWorker(job);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+}
+
+static PIXEL colorToPixel(const float *color) {
+  GLint r = ((GLint)(color[0] * 255.0f + 0.5f) << 16) & COLOR_MASK;
+  GLint g = ((GLint)(color[1] * 255.0f + 0.5f) << 8) & COLOR_MASK;
+  GLint b = ((GLint)(color[2] * 255.0f + 0.5f)) & COLOR_MASK;
+  return RGB_TO_PIXEL(r, g, b);
+}
+
+void ucncToolpathRender(ucncToolpath *toolpath, ZBuffer *zb,
+                        const ucncRect *clip) {
+  if (!toolpath || !zb)
+    return;
+  RenderJob job;
+  memset(&job, 0, sizeof(job));
+  job.zb = zb;
+
+  // Snapshot the chunks; appends only ever write past these counts
+  pthread_mutex_lock(&toolpath->lock);
+  if (toolpath->chunkCount > toolpath->batchCapacity) {
+    ToolpathBatch *batches = realloc(
+        toolpath->batches, toolpath->chunkCount * sizeof(ToolpathBatch));
+    if (!batches) {
+      pthread_mutex_unlock(&toolpath->lock);
+      fprintf(stderr, "Memory allocation failed for toolpath rendering.\n");
+      return;
+    }
+    memset(batches + toolpath->batchCapacity, 0,
+           (toolpath->chunkCount - toolpath->batchCapacity) *
+               sizeof(ToolpathBatch));
+    toolpath->batches = batches;
+    toolpath->batchCapacity = toolpath->chunkCount;
+  }
+  for (int i = 0; i < toolpath->chunkCount; i++) {
+    toolpath->batches[i].chunk = toolpath->chunks[i];
+    toolpath->batches[i].points = toolpath->chunks[i]->count;
+    memcpy(toolpath->batches[i].min, toolpath->chunks[i]->min,
+           sizeof(float) * 3);
+    memcpy(toolpath->batches[i].max, toolpath->chunks[i]->max,
+           sizeof(float) * 3);
+  }
+  job.batches = toolpath->batches;
+  job.batchCount = toolpath->chunkCount;
+  unsigned long segments = toolpath->segmentCount;
+  job.feed = colorToPixel(toolpath->feedColor);
+  job.rapid = colorToPixel(toolpath->rapidColor);
+  pthread_mutex_unlock(&toolpath->lock);
+  if (job.batchCount == 0)
+    return;
+
+  // TinyGL returns row-major matrices
+  GLfloat modelview[16], projection[16];
+  GLint viewport[4];
+  glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+  glGetFloatv(GL_PROJECTION_MATRIX, projection);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      job.mvp[i * 4 + j] = projection[i * 4] * modelview[j] +
+                           projection[i * 4 + 1] * modelview[4 + j] +
+                           projection[i * 4 + 2] * modelview[8 + j] +
+                           projection[i * 4 + 3] * modelview[12 + j];
+    }
+  }
+  float zsize = (float)(1 << (ZB_Z_BITS + ZB_POINT_Z_FRAC_BITS));
+  job.scale[0] = (viewport[2] - 0.5f) / 2.0f;
+  job.scale[1] = -(viewport[3] - 0.5f) / 2.0f;
+  job.scale[2] = -((zsize - 0.5f) / 2.0f);
+  job.trans[0] = (viewport[2] - 0.5f) / 2.0f + viewport[0];
+  job.trans[1] = (viewport[3] - 0.5f) / 2.0f + viewport[1];
+  job.trans[2] = (zsize - 0.5f) / 2.0f + (1 << ZB_POINT_Z_FRAC_BITS) / 2;
+
+  job.clipX0 = 0;
+  job.clipY0 = 0;
+  job.clipX1 = zb->xsize;
+  job.clipY1 = zb->ysize;
+  if (clip) {
+    if (clip->x > job.clipX0)
+      job.clipX0 = clip->x;
+    if (clip->y > job.clipY0)
+      job.clipY0 = clip->y;
+    if (clip->x + clip->width < job.clipX1)
+      job.clipX1 = clip->x + clip->width;
+    if (clip->y + clip->height < job.clipY1)
+      job.clipY1 = clip->y + clip->height;
+  }
+  if (job.clipX0 >= job.clipX1 || job.clipY0 >= job.clipY1)
+    return;
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = (int)(segments / UCNC_TOOLPATH_THREAD_SEGMENTS) + 1;
+  if (threads > cpus)
+    threads = cpus > 0 ? (int)cpus : 1;
+  if (threads > UCNC_TOOLPATH_MAX_THREADS)
+    threads = UCNC_TOOLPATH_MAX_THREADS;
+
+  runParallel(&job, projectBatch, job.batchCount, threads);
+
+  // Tell TinyGL's dirty tracking where the lines can land
+  for (int b = 0; b < job.batchCount; b++) {
+    const ToolpathBatch *batch = &job.batches[b];
+    if (batch->count == 0)
+      continue;
+    int x0 = (int)floorf(batch->xmin), x1 = (int)ceilf(batch->xmax) + 1;
+    int y0 = (int)floorf(batch->ymin), y1 = (int)ceilf(batch->ymax) + 1;
+    x0 = x0 > job.clipX0 ? x0 : job.clipX0;
+    y0 = y0 > job.clipY0 ? y0 : job.clipY0;
+    x1 = x1 < job.clipX1 ? x1 : job.clipX1;
+    y1 = y1 < job.clipY1 ? y1 : job.clipY1;
+    if (x0 < x1 && y0 < y1)
+      ZB_markDirty(zb, x0, y0, x1 - x0, y1 - y0);
+  }
+
+  // Two bands per thread balance paths that crowd part of the screen
+  int rows = job.clipY1 - job.clipY0;
+  job.bandCount = threads * 2 < rows ? threads * 2 : rows;
+  job.bandRows = (rows + job.bandCount - 1) / job.bandCount;
+  job.bandCount = (rows + job.bandRows - 1) / job.bandRows;
+  runParallel(&job, rasterBand, job.bandCount, threads);
+}
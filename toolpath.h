@@ -0,0 +1,47 @@
+/* toolpath.h */
+
+#ifndef TOOLPATH_H
+#define TOOLPATH_H
+
+#include "cncvis.h"
+
+#define UCNC_TOOLPATH_CHUNK_POINTS 4096  // Points per storage chunk
+#define UCNC_TOOLPATH_MAX_THREADS 8      // Render threads at most
+#define UCNC_TOOLPATH_THREAD_SEGMENTS 65536 // Segments worth another thread
+
+// CAM toolpath overlay: polylines of feed (G1) and rapid (G0) moves kept in
+// fixed-size chunks of float points, each with a bounding box. Appending
+// only touches the last chunk and may run on another thread while the path
+// is rendered; clearing and freeing may not.
+//
+// Rendering bypasses the TinyGL line path: chunks outside the view are
+// culled, the rest are projected in parallel with runs of segments shorter
+// than a pixel merged, and the resulting lines are rasterized in horizontal
+// bands, one thread per band, depth tested against the scene.
+typedef struct ucncToolpath ucncToolpath;
+
+ucncToolpath *ucncToolpathNew(void);
+void ucncToolpathFree(ucncToolpath *toolpath);
+void ucncToolpathClear(ucncToolpath *toolpath);
+
+// Start a new polyline at a point
+int ucncToolpathMoveTo(ucncToolpath *toolpath, float x, float y, float z);
+// Segment from the last point; the first point of a path only moves there
+int ucncToolpathLineTo(ucncToolpath *toolpath, float x, float y, float z,
+                       int rapid);
+// LineTo for count points (3 floats each) under a single lock
+int ucncToolpathAppend(ucncToolpath *toolpath, const float *points,
+                       unsigned long count, int rapid);
+
+unsigned long ucncToolpathSegmentCount(ucncToolpath *toolpath);
+void ucncToolpathSetColors(ucncToolpath *toolpath, const float feed[3],
+                           const float rapid[3]);
+// Changes whenever the path or its colors change
+unsigned long ucncToolpathGeneration(const ucncToolpath *toolpath);
+
+// Draw into zb with the current TinyGL modelview, projection and viewport.
+// Only pixels inside clip (framebuffer pixels) are touched, if given.
+void ucncToolpathRender(ucncToolpath *toolpath, ZBuffer *zb,
+                        const ucncRect *clip);
+
+#endif // TOOLPATH_H
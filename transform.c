@@ -0,0 +1,78 @@
+/* transform.c */
+
+#include "transform.h"
+
+void ucncMatrixIdentity(float m[16]) {
+  memset(m, 0, 16 * sizeof(float));
+  m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+void ucncMatrixMultiply(float out[16], const float a[16], const float b[16]) {
+  float r[16];
+  for (int c = 0; c < 4; c++) {
+    for (int row = 0; row < 4; row++) {
+      r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] +
+                       a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+    }
+  }
+  memcpy(out, r, sizeof(r));
+}
+
+void ucncMatrixFromPose(float m[16], float positionX, float positionY,
+                        float positionZ, float originX, float originY,
+                        float originZ, float rotationX, float rotationY,
+                        float rotationZ) {
+  const float toRad = (float)M_PI / 180.0f;
+  float sx = sinf(rotationX * toRad), cx = cosf(rotationX * toRad);
+  float sy = sinf(rotationY * toRad), cy = cosf(rotationY * toRad);
+  float sz = sinf(rotationZ * toRad), cz = cosf(rotationZ * toRad);
+
+  // R = Rx * Ry * Rz, written out row by row
+  float r00 = cy * cz, r01 = -cy * sz, r02 = sy;
+  float r10 = sx * sy * cz + cx * sz, r11 = -sx * sy * sz + cx * cz,
+        r12 = -sx * cy;
+  float r20 = -cx * sy * cz + sx * sz, r21 = cx * sy * sz + sx * cz,
+        r22 = cx * cy;
+
+  m[0] = r00; m[4] = r01; m[8] = r02;
+  m[1] = r10; m[5] = r11; m[9] = r12;
+  m[2] = r20; m[6] = r21; m[10] = r22;
+  m[3] = m[7] = m[11] = 0.0f;
+
+  // Translation: position + origin - R * origin
+  m[12] = positionX + originX - (r00 * originX + r01 * originY + r02 * originZ);
+  m[13] = positionY + originY - (r10 * originX + r11 * originY + r12 * originZ);
+  m[14] = positionZ + originZ - (r20 * originX + r21 * originY + r22 * originZ);
+  m[15] = 1.0f;
+}
+
+void ucncMatrixTransformPoint(const float m[16], const float in[3],
+                              float out[3]) {
+  float x = in[0], y = in[1], z = in[2];
+  out[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+  out[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+  out[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+}
+
+int ucncMatrixIsIdentity(const float m[16]) {
+  for (int i = 0; i < 16; i++) {
+    if (m[i] != ((i % 5) == 0 ? 1.0f : 0.0f)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void ucncMatrixInvertRigid(float out[16], const float m[16]) {
+  // [R t]^-1 = [R^T -R^T t]
+  float r[16];
+  for (int c = 0; c < 3; c++) {
+    for (int row = 0; row < 3; row++)
+      r[c * 4 + row] = m[row * 4 + c];
+    r[c * 4 + 3] = 0.0f;
+  }
+  for (int row = 0; row < 3; row++)
+    r[12 + row] = -(r[row] * m[12] + r[4 + row] * m[13] + r[8 + row] * m[14]);
+  r[15] = 1.0f;
+  memcpy(out, r, sizeof(r));
+}
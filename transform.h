@@ -0,0 +1,25 @@
+/* transform.h */
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "cncvis.h"
+
+// 4x4 matrices are stored column-major, ready for glLoadMatrixf/glMultMatrixf.
+
+void ucncMatrixIdentity(float m[16]);
+// out = a * b (out may alias a or b)
+void ucncMatrixMultiply(float out[16], const float a[16], const float b[16]);
+// Build T(position) * T(origin) * Rx * Ry * Rz * T(-origin), angles in degrees.
+// This is the transform ucncAssemblyRender and ucncActorRender apply.
+void ucncMatrixFromPose(float m[16], float positionX, float positionY,
+                        float positionZ, float originX, float originY,
+                        float originZ, float rotationX, float rotationY,
+                        float rotationZ);
+void ucncMatrixTransformPoint(const float m[16], const float in[3],
+                              float out[3]);
+int ucncMatrixIsIdentity(const float m[16]);
+// Inverse of a rotation + translation matrix (out may alias m)
+void ucncMatrixInvertRigid(float out[16], const float m[16]);
+
+#endif // TRANSFORM_H
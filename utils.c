@@ -1,6 +1,7 @@
 /* utils.c */
 
 #include "utils.h"
+#include "imageexport.h"
 #include "tinygl/include/GL/gl.h"
 #include "tinygl/include/GL/glu.h"
 #include <stdio.h>
@@ -155,11 +156,12 @@ void drawAxis(float size) {
 
 void setBackgroundGradient(float topColor[3], float bottomColor[3]) {
     // Debug: Print framebuffer dimensions
+    ZBuffer *framebuffer = ucncGetFramebuffer();
     printf("Rendering background with framebuffer size: %d x %d\n", 
-           globalFramebuffer->xsize, globalFramebuffer->ysize);
+           framebuffer->xsize, framebuffer->ysize);
 
     // Ensure full viewport
-    glViewport(0, 0, globalFramebuffer->xsize, globalFramebuffer->ysize);
+    glViewport(0, 0, framebuffer->xsize, framebuffer->ysize);
 
     // Disable depth testing/writing to ensure background is behind the scene
     glDisable(GL_DEPTH_TEST);
@@ -209,27 +211,28 @@ void CreateGround(float sizeX, float sizeY) {
     glPopMatrix();
 }
 
-void saveFramebufferAsImage(ZBuffer *framebuffer,
-                            const char *filename,
-                            int width,
-                            int height) {
-    if (!framebuffer || !filename) return;
-    PIXEL *imbuf = calloc(width*height, sizeof(PIXEL));
-    if (!imbuf) return;
+int saveFramebufferAsImage(ZBuffer *framebuffer,
+                           const char *filename,
+                           int width,
+                           int height) {
+    if (!framebuffer || !filename) return -1;
+    if (width > framebuffer->xsize) width = framebuffer->xsize;
+    if (height > framebuffer->ysize) height = framebuffer->ysize;
     unsigned char *pbuf = malloc(3*width*height);
-    if (!pbuf) { free(imbuf); return; }
+    if (!pbuf) return -1;
 
-    ZB_copyFrameBuffer(framebuffer, imbuf, width * sizeof(PIXEL));
-    for (int i = 0; i < width*height; i++) {
-        pbuf[3*i+0] = GET_RED(imbuf[i]);
-        pbuf[3*i+1] = GET_GREEN(imbuf[i]);
-        pbuf[3*i+2] = GET_BLUE(imbuf[i]);
+    // Straight from the framebuffer rows; ucncImageExport does this off-thread
+    for (int y = 0; y < height; y++) {
+        const PIXEL *row = (const PIXEL *)((const unsigned char *)framebuffer->pbuf +
+                                           (size_t)y * framebuffer->linesize);
+        ucncPixelsToRgb(row, width, pbuf + (size_t)y * width * 3, 0);
     }
-    if (!stbi_write_png(filename, width, height, 3, pbuf, width*3)) {
+    int written = stbi_write_png(filename, width, height, 3, pbuf, width*3);
+    if (!written) {
         fprintf(stderr, "Failed to write image to %s\n", filename);
     }
-    free(imbuf);
     free(pbuf);
+    return written ? 0 : -1;
 }
 
 void printAssemblyHierarchy(ucncAssembly *assembly, int level) {
@@ -256,7 +259,7 @@ void printAssemblyHierarchy(ucncAssembly *assembly, int level) {
            assembly->colorR, assembly->colorG, assembly->colorB);
     for (int i=0; i<level+1; i++) printf("  ");
     printf("Motion: Type '%s', Axis '%c', Invert: %s\n",
-           assembly->motionType,
+           ucncMotionTypeToString(assembly->motionType),
            assembly->motionAxis,
            assembly->invertMotion ? "yes" : "no");
     for (int i=0; i<assembly->assemblyCount; i++) {
@@ -284,9 +287,9 @@ void scanAssembly(const ucncAssembly *assembly,
     (*totalAssemblies)++;
     for (int i=0; i<assembly->actorCount; i++) {
         ucncActor *actor = assembly->actors[i];
-        if (actor && actor->stlObject) {
+        if (actor && actor->mesh) {
             printf("  Actor: %s, Triangles: %lu\n",
-                   actor->name, actor->triangleCount);
+                   actor->name, actor->mesh->triangleCount);
             (*totalActors)++;
         } else {
             printf("  Actor: %s has no STL data.\n", actor->name);
@@ -311,23 +314,24 @@ void scanGlobalScene(const ucncAssembly *assembly) {
     printf("Total Actors: %d\n", totalAct);
 }
 
-static double previousTime = 0.0;
-static double currentTime  = 0.0;
-static int frameCount      = 0;
-static float fps           = 0.0f;
-
-float calculateFPS(void) {
+float updateFPS(FPSCounter *counter) {
     struct timeval time;
     gettimeofday(&time, NULL);
-    currentTime = time.tv_sec*1000.0 + time.tv_usec/1000.0;
-    frameCount++;
-    double delta = currentTime - previousTime;
+    double currentTime = time.tv_sec*1000.0 + time.tv_usec/1000.0;
+    counter->frameCount++;
+    double delta = currentTime - counter->previousTime;
     if (delta >= 1000.0) {
-        fps = frameCount / (delta/1000.0);
-        previousTime = currentTime;
-        frameCount = 0;
+        counter->fps = counter->frameCount / (delta/1000.0);
+        counter->previousTime = currentTime;
+        counter->frameCount = 0;
     }
-    return fps;
+    return counter->fps;
+}
+
+static FPSCounter gFPS;
+
+float calculateFPS(void) {
+    return updateFPS(&gFPS);
 }
 
 void renderFPSData(int frameNumber, float fps) {
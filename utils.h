@@ -9,6 +9,9 @@
 
 // allow utils.c to see the global TinyGL framebuffer
 extern ZBuffer *globalFramebuffer;
+// The framebuffer of the calling thread's current instance (see api.h);
+// globalFramebuffer while none is current
+ZBuffer *ucncGetFramebuffer(void);
 
 // Function to get current time in milliseconds
 double getCurrentTimeInMs();
@@ -53,7 +56,8 @@ void CreateGround(float sizeX, float sizeY);
 void printAssemblyHierarchy(ucncAssembly *assembly, int level);
 
 // Framebuffer Utilities
-void saveFramebufferAsImage(ZBuffer *framebuffer, const char *filename, int width, int height);
+// Write the framebuffer as PNG; -1 if the file could not be written
+int saveFramebufferAsImage(ZBuffer *framebuffer, const char *filename, int width, int height);
 
 void getDirectoryFromPath(const char *filePath, char *dirPath);
 
@@ -61,11 +65,15 @@ void scanAssembly(const ucncAssembly *assembly, int *totalAssemblies, int *total
 
 void scanGlobalScene(const ucncAssembly *assembly);
 
+// Frames per second, averaged over about a second
+typedef struct {
+    double previousTime;
+    int frameCount;
+    float fps;
+} FPSCounter;
 
-static double previousTime;
-static double currentTime;
-static int frameCount;
-static float fps;
+// Count a frame; every counter keeps its own rate
+float updateFPS(FPSCounter *counter);
 float calculateFPS(void);
 void renderFPSData(int frameNumber, float fps);
 
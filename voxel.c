@@ -0,0 +1,671 @@
+/* voxel.c */
+
+#include "voxel.h"
+
+#include <float.h>
+#include <stdatomic.h>
+
+#define BRICK UCNC_VOXEL_BRICK
+#define BRICK_ROWS (BRICK * BRICK) // One 32-bit row along x per (y, z)
+
+enum { BRICK_EMPTY, BRICK_FULL, BRICK_MIXED };
+enum { FACE_XM, FACE_XP, FACE_YM, FACE_YP, FACE_ZM, FACE_ZP };
+
+static const float faceNormal[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0},
+                                       {0, 1, 0},  {0, 0, -1}, {0, 0, 1}};
+
+typedef struct {
+  int state;
+  uint32_t *bits; // BRICK_MIXED only: row z * BRICK + y, bit x
+  float *quads;   // Four corners per face
+  unsigned char *faces;
+  int quadCount, quadCapacity;
+  int dirty;   // Mesh is out of date
+  int changed; // Set by the cut that touched it
+} VoxelBrick;
+
+// Tool at one point of a move: the segment its surface is around
+typedef struct {
+  float a[3], axis[3];
+  float min[3], max[3];
+} VoxelSample;
+
+struct ucncVoxelStock {
+  float origin[3];
+  float voxel;
+  int n[3];      // Voxels per axis
+  int bricks[3]; // Bricks per axis
+  VoxelBrick *brick;
+  uint32_t *validRow; // Row of a full brick, per brick column (edge bricks)
+  float radius, length;
+  int ballEnd;
+
+  pthread_mutex_t lock; // Serialises cuts with meshing and drawing
+
+  // Current cut or mesh update, read by the workers
+  VoxelSample *samples;
+  int sampleCount, sampleCapacity;
+  float reach; // Length of the sample segments
+  int cutMin[3], cutMax[3];
+  int *jobs;
+  int jobCount, jobCapacity;
+
+  // Workers help the calling thread with per-brick jobs
+  pthread_t threads[UCNC_VOXEL_MAX_THREADS - 1];
+  int threadCount;
+  pthread_mutex_t poolLock;
+  pthread_cond_t start, done;
+  unsigned long round;
+  int busy, quit;
+  void (*work)(ucncVoxelStock *stock, int item);
+  int items;
+  atomic_int next;
+};
+
+// === Worker pool ===
+
+static void runItems(ucncVoxelStock *stock) {
+  int item;
+  while ((item = atomic_fetch_add(&stock->next, 1)) < stock->items)
+    stock->work(stock, item);
+}
+
+static void *poolWorker(void *arg) {
+  ucncVoxelStock *stock = arg;
+  unsigned long seen = 0;
+  pthread_mutex_lock(&stock->poolLock);
+  for (;;) {
+    while (!stock->quit && stock->round == seen)
+      pthread_cond_wait(&stock->start, &stock->poolLock);
+    if (stock->quit)
+      break;
+    seen = stock->round;
+    pthread_mutex_unlock(&stock->poolLock);
+    runItems(stock);
+    pthread_mutex_lock(&stock->poolLock);
+    if (--stock->busy == 0)
+      pthread_cond_signal(&stock->done);
+  }
+  pthread_mutex_unlock(&stock->poolLock);
+  return NULL;
+}
+
+static void runPool(ucncVoxelStock *stock,
+                    void (*work)(ucncVoxelStock *, int), int items) {
+  stock->work = work;
+  stock->items = items;
+  atomic_store(&stock->next, 0);
+  if (stock->threadCount == 0 || items < 2) {
+    runItems(stock);
+    return;
+  }
+  pthread_mutex_lock(&stock->poolLock);
+  stock->busy = stock->threadCount;
+  stock->round++;
+  pthread_cond_broadcast(&stock->start);
+  pthread_mutex_unlock(&stock->poolLock);
+  runItems(stock);
+  pthread_mutex_lock(&stock->poolLock);
+  while (stock->busy > 0)
+    pthread_cond_wait(&stock->done, &stock->poolLock);
+  pthread_mutex_unlock(&stock->poolLock);
+}
+
+// === Voxel access ===
+
+static int brickIndex(const ucncVoxelStock *stock, int bx, int by, int bz) {
+  return (bz * stock->bricks[1] + by) * stock->bricks[0] + bx;
+}
+
+static void brickCoords(const ucncVoxelStock *stock, int index, int b[3]) {
+  b[0] = index % stock->bricks[0];
+  b[1] = index / stock->bricks[0] % stock->bricks[1];
+  b[2] = index / (stock->bricks[0] * stock->bricks[1]);
+}
+
+// Solid voxels of row (gy, gz) in brick column bx; nothing outside the grid
+static uint32_t rowBits(const ucncVoxelStock *stock, int bx, int gy, int gz) {
+  if (bx < 0 || bx >= stock->bricks[0] || gy < 0 || gy >= stock->n[1] ||
+      gz < 0 || gz >= stock->n[2])
+    return 0;
+  const VoxelBrick *brick =
+      &stock->brick[brickIndex(stock, bx, gy / BRICK, gz / BRICK)];
+  if (brick->state == BRICK_MIXED)
+    return brick->bits[(gz % BRICK) * BRICK + gy % BRICK];
+  return brick->state == BRICK_FULL ? stock->validRow[bx] : 0;
+}
+
+// === Cutting ===
+
+static int insideTool(const ucncVoxelStock *stock, const VoxelSample *s,
+                      const float *p) {
+  float d[3] = {p[0] - s->a[0], p[1] - s->a[1], p[2] - s->a[2]};
+  float t = d[0] * s->axis[0] + d[1] * s->axis[1] + d[2] * s->axis[2];
+  if (stock->ballEnd) {
+    t = t < 0.0f ? 0.0f : (t > stock->reach ? stock->reach : t);
+  } else if (t < 0.0f || t > stock->reach) {
+    return 0;
+  }
+  float e[3] = {d[0] - t * s->axis[0], d[1] - t * s->axis[1],
+                d[2] - t * s->axis[2]};
+  return e[0] * e[0] + e[1] * e[1] + e[2] * e[2] <=
+         stock->radius * stock->radius;
+}
+
+static void cutBrick(ucncVoxelStock *stock, int item) {
+  VoxelBrick *brick = &stock->brick[stock->jobs[item]];
+  brick->changed = 0;
+  if (brick->state == BRICK_EMPTY)
+    return;
+  int b[3], lo[3], hi[3];
+  brickCoords(stock, stock->jobs[item], b);
+  for (int k = 0; k < 3; k++) {
+    lo[k] = b[k] * BRICK;
+    hi[k] = lo[k] + BRICK - 1;
+    lo[k] = lo[k] > stock->cutMin[k] ? lo[k] : stock->cutMin[k];
+    hi[k] = hi[k] < stock->cutMax[k] ? hi[k] : stock->cutMax[k];
+    if (lo[k] > hi[k])
+      return;
+  }
+
+  // Samples reaching into the part of the brick the cut covers
+  int nearStack[128];
+  int *near = nearStack, nearCount = 0;
+  if (stock->sampleCount > 128 &&
+      !(near = malloc(stock->sampleCount * sizeof(int))))
+    return;
+  for (int i = 0; i < stock->sampleCount; i++) {
+    const VoxelSample *s = &stock->samples[i];
+    int overlaps = 1;
+    for (int k = 0; k < 3 && overlaps; k++) {
+      overlaps = s->max[k] >= stock->origin[k] + lo[k] * stock->voxel &&
+                 s->min[k] <= stock->origin[k] + (hi[k] + 1) * stock->voxel;
+    }
+    if (overlaps)
+      near[nearCount++] = i;
+  }
+
+  for (int gz = lo[2]; gz <= hi[2] && nearCount > 0; gz++) {
+    for (int gy = lo[1]; gy <= hi[1]; gy++) {
+      uint32_t row = rowBits(stock, b[0], gy, gz), removed = 0;
+      float p[3] = {0.0f, stock->origin[1] + (gy + 0.5f) * stock->voxel,
+                    stock->origin[2] + (gz + 0.5f) * stock->voxel};
+      for (int gx = lo[0]; gx <= hi[0] && row; gx++) {
+        uint32_t bit = 1u << (gx - b[0] * BRICK);
+        if (!(row & bit))
+          continue;
+        p[0] = stock->origin[0] + (gx + 0.5f) * stock->voxel;
+        for (int i = 0; i < nearCount; i++) {
+          if (insideTool(stock, &stock->samples[near[i]], p)) {
+            removed |= bit;
+            break;
+          }
+        }
+      }
+      if (!removed)
+        continue;
+      if (brick->state == BRICK_FULL) {
+        // First cut into the brick: give it a bit per voxel
+        uint32_t *bits = malloc(BRICK_ROWS * sizeof(uint32_t));
+        if (!bits) {
+          fprintf(stderr, "Memory allocation failed for voxel brick.\n");
+          goto done;
+        }
+        for (int z = 0; z < BRICK; z++) {
+          for (int y = 0; y < BRICK; y++)
+            bits[z * BRICK + y] =
+                rowBits(stock, b[0], b[1] * BRICK + y, b[2] * BRICK + z);
+        }
+        brick->bits = bits;
+        brick->state = BRICK_MIXED;
+      }
+      brick->bits[(gz % BRICK) * BRICK + gy % BRICK] &= ~removed;
+      brick->changed = 1;
+    }
+  }
+
+  if (brick->changed) {
+    int any = 0;
+    for (int i = 0; i < BRICK_ROWS && !any; i++)
+      any = brick->bits[i] != 0;
+    if (!any) {
+      free(brick->bits);
+      brick->bits = NULL;
+      brick->state = BRICK_EMPTY;
+    }
+  }
+done:
+  if (near != nearStack)
+    free(near);
+}
+
+static int reserveJobs(ucncVoxelStock *stock, int count) {
+  if (count <= stock->jobCapacity)
+    return 1;
+  int *jobs = realloc(stock->jobs, count * sizeof(int));
+  if (!jobs)
+    return 0;
+  stock->jobs = jobs;
+  stock->jobCapacity = count;
+  return 1;
+}
+
+static void markDirty(ucncVoxelStock *stock, int bx, int by, int bz) {
+  if (bx >= 0 && by >= 0 && bz >= 0 && bx < stock->bricks[0] &&
+      by < stock->bricks[1] && bz < stock->bricks[2])
+    stock->brick[brickIndex(stock, bx, by, bz)].dirty = 1;
+}
+
+int ucncVoxelStockCut(ucncVoxelStock *stock, const float fromTip[3],
+                      const float fromAxis[3], const float toTip[3],
+                      const float toAxis[3]) {
+  if (!stock || !fromTip || !fromAxis || !toTip || !toAxis)
+    return -1;
+  pthread_mutex_lock(&stock->lock);
+
+  // Sample the move finely enough that no voxel slips between two poses
+  float start = stock->ballEnd ? stock->radius : 0.0f;
+  stock->reach = stock->length - start;
+  if (stock->reach < 0.0f)
+    stock->reach = 0.0f;
+  float tipTravel = 0.0f, endTravel = 0.0f;
+  for (int k = 0; k < 3; k++) {
+    float d = toTip[k] - fromTip[k];
+    float e = d + stock->length * (toAxis[k] - fromAxis[k]);
+    tipTravel += d * d;
+    endTravel += e * e;
+  }
+  float travel = sqrtf(tipTravel > endTravel ? tipTravel : endTravel);
+  int steps = (int)ceilf(travel / (0.5f * stock->voxel));
+  steps = steps < 1 ? 1 : steps;
+  if (steps + 1 > stock->sampleCapacity) {
+    VoxelSample *samples =
+        realloc(stock->samples, (steps + 1) * sizeof(VoxelSample));
+    if (!samples) {
+      pthread_mutex_unlock(&stock->lock);
+      fprintf(stderr, "Memory allocation failed for voxel cut.\n");
+      return -1;
+    }
+    stock->samples = samples;
+    stock->sampleCapacity = steps + 1;
+  }
+  stock->sampleCount = steps + 1;
+  float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = 0; i <= steps; i++) {
+    VoxelSample *s = &stock->samples[i];
+    float t = (float)i / steps, len = 0.0f;
+    for (int k = 0; k < 3; k++) {
+      s->axis[k] = fromAxis[k] + t * (toAxis[k] - fromAxis[k]);
+      len += s->axis[k] * s->axis[k];
+    }
+    len = len > 0.0f ? 1.0f / sqrtf(len) : 0.0f;
+    for (int k = 0; k < 3; k++) {
+      s->axis[k] *= len;
+      s->a[k] = fromTip[k] + t * (toTip[k] - fromTip[k]) + start * s->axis[k];
+      float end = s->a[k] + stock->reach * s->axis[k];
+      s->min[k] = (s->a[k] < end ? s->a[k] : end) - stock->radius;
+      s->max[k] = (s->a[k] < end ? end : s->a[k]) + stock->radius;
+      lo[k] = s->min[k] < lo[k] ? s->min[k] : lo[k];
+      hi[k] = s->max[k] > hi[k] ? s->max[k] : hi[k];
+    }
+  }
+
+  // Bricks the swept volume reaches
+  int b0[3], b1[3], jobCount = 1;
+  for (int k = 0; k < 3; k++) {
+    stock->cutMin[k] = (int)floorf((lo[k] - stock->origin[k]) / stock->voxel);
+    stock->cutMax[k] = (int)floorf((hi[k] - stock->origin[k]) / stock->voxel);
+    if (stock->cutMin[k] < 0)
+      stock->cutMin[k] = 0;
+    if (stock->cutMax[k] >= stock->n[k])
+      stock->cutMax[k] = stock->n[k] - 1;
+    if (stock->cutMin[k] > stock->cutMax[k]) {
+      pthread_mutex_unlock(&stock->lock);
+      return 0; // Outside the stock
+    }
+    b0[k] = stock->cutMin[k] / BRICK;
+    b1[k] = stock->cutMax[k] / BRICK;
+    jobCount *= b1[k] - b0[k] + 1;
+  }
+  if (!reserveJobs(stock, jobCount)) {
+    pthread_mutex_unlock(&stock->lock);
+    fprintf(stderr, "Memory allocation failed for voxel cut.\n");
+    return -1;
+  }
+  stock->jobCount = 0;
+  for (int bz = b0[2]; bz <= b1[2]; bz++) {
+    for (int by = b0[1]; by <= b1[1]; by++) {
+      for (int bx = b0[0]; bx <= b1[0]; bx++) {
+        int index = brickIndex(stock, bx, by, bz);
+        if (stock->brick[index].state != BRICK_EMPTY)
+          stock->jobs[stock->jobCount++] = index;
+      }
+    }
+  }
+  runPool(stock, cutBrick, stock->jobCount);
+
+  // A brick's faces depend on its neighbours' voxels
+  int changed = 0;
+  for (int i = 0; i < stock->jobCount; i++) {
+    if (!stock->brick[stock->jobs[i]].changed)
+      continue;
+    int b[3];
+    brickCoords(stock, stock->jobs[i], b);
+    markDirty(stock, b[0], b[1], b[2]);
+    markDirty(stock, b[0] - 1, b[1], b[2]);
+    markDirty(stock, b[0] + 1, b[1], b[2]);
+    markDirty(stock, b[0], b[1] - 1, b[2]);
+    markDirty(stock, b[0], b[1] + 1, b[2]);
+    markDirty(stock, b[0], b[1], b[2] - 1);
+    markDirty(stock, b[0], b[1], b[2] + 1);
+    changed = 1;
+  }
+  pthread_mutex_unlock(&stock->lock);
+  if (changed)
+    ucncActorGeometryChanged();
+  return 0;
+}
+
+// === Meshing ===
+
+// Face of the box lo..hi on the given side, wound counter-clockwise seen
+// from outside
+static void addQuad(VoxelBrick *brick, int face, const float *lo,
+                    const float *hi) {
+  if (brick->quadCount == brick->quadCapacity) {
+    // Both arrays are allocated before the brick takes either, so a failure
+    // leaves it as it was (the quad is dropped)
+    int capacity = brick->quadCapacity ? brick->quadCapacity * 2 : 64;
+    float *quads = malloc(capacity * 12 * sizeof(float));
+    unsigned char *faces = malloc(capacity);
+    if (!quads || !faces) {
+      free(quads);
+      free(faces);
+      return;
+    }
+    if (brick->quadCount) {
+      memcpy(quads, brick->quads, brick->quadCount * 12 * sizeof(float));
+      memcpy(faces, brick->faces, brick->quadCount);
+    }
+    free(brick->quads);
+    free(brick->faces);
+    brick->quads = quads;
+    brick->faces = faces;
+    brick->quadCapacity = capacity;
+  }
+  // Corner k takes hi along the axes whose bit is set (x=1, y=2, z=4)
+  static const unsigned char corners[6][4] = {
+      {0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4},
+      {3, 2, 6, 7}, {0, 2, 3, 1}, {4, 5, 7, 6},
+  };
+  float *q = &brick->quads[brick->quadCount * 12];
+  for (int c = 0; c < 4; c++) {
+    int corner = corners[face][c];
+    q[c * 3] = (corner & 1) ? hi[0] : lo[0];
+    q[c * 3 + 1] = (corner & 2) ? hi[1] : lo[1];
+    q[c * 3 + 2] = (corner & 4) ? hi[2] : lo[2];
+  }
+  brick->faces[brick->quadCount++] = (unsigned char)face;
+}
+
+// Faces of one row and side, consecutive ones merged along x
+static void addRowFaces(const ucncVoxelStock *stock, VoxelBrick *brick,
+                        int face, uint32_t mask, int gx0, int gy, int gz) {
+  float lo[3], hi[3];
+  lo[1] = stock->origin[1] + gy * stock->voxel;
+  lo[2] = stock->origin[2] + gz * stock->voxel;
+  hi[1] = lo[1] + stock->voxel;
+  hi[2] = lo[2] + stock->voxel;
+  for (int x = 0; x < BRICK && mask; x++) {
+    if (!(mask & (1u << x)))
+      continue;
+    int end = x;
+    while (end + 1 < BRICK && (mask & (1u << (end + 1))))
+      end++;
+    lo[0] = stock->origin[0] + (gx0 + x) * stock->voxel;
+    hi[0] = stock->origin[0] + (gx0 + end + 1) * stock->voxel;
+    addQuad(brick, face, lo, hi);
+    for (int i = x; i <= end; i++)
+      mask &= ~(1u << i);
+    x = end;
+  }
+}
+
+// Faces across x of one layer, consecutive ones merged along y
+static void addLayerFaces(const ucncVoxelStock *stock, VoxelBrick *brick,
+                          int face, const uint32_t *masks, int rows, int gx0,
+                          int gy0, int gz) {
+  float lo[3], hi[3];
+  lo[2] = stock->origin[2] + gz * stock->voxel;
+  hi[2] = lo[2] + stock->voxel;
+  for (int x = 0; x < BRICK; x++) {
+    uint32_t bit = 1u << x;
+    lo[0] = stock->origin[0] + (gx0 + x) * stock->voxel;
+    hi[0] = lo[0] + stock->voxel;
+    for (int y = 0; y < rows; y++) {
+      if (!(masks[y] & bit))
+        continue;
+      int end = y;
+      while (end + 1 < rows && (masks[end + 1] & bit))
+        end++;
+      lo[1] = stock->origin[1] + (gy0 + y) * stock->voxel;
+      hi[1] = stock->origin[1] + (gy0 + end + 1) * stock->voxel;
+      addQuad(brick, face, lo, hi);
+      y = end;
+    }
+  }
+}
+
+// Emit the faces between solid and empty voxels, looking into the
+// neighbouring bricks at the borders
+static void meshBrick(ucncVoxelStock *stock, int item) {
+  VoxelBrick *brick = &stock->brick[stock->jobs[item]];
+  brick->quadCount = 0;
+  if (brick->state == BRICK_EMPTY)
+    return;
+  int b[3];
+  brickCoords(stock, stock->jobs[item], b);
+  int gx0 = b[0] * BRICK, gy0 = b[1] * BRICK, gz0 = b[2] * BRICK;
+  int rows = stock->n[1] - gy0 < BRICK ? stock->n[1] - gy0 : BRICK;
+  int layers = stock->n[2] - gz0 < BRICK ? stock->n[2] - gz0 : BRICK;
+
+  uint32_t minusX[BRICK], plusX[BRICK];
+  for (int z = 0; z < layers; z++) {
+    int gz = gz0 + z;
+    for (int y = 0; y < rows; y++) {
+      int gy = gy0 + y;
+      uint32_t row = rowBits(stock, b[0], gy, gz);
+      minusX[y] = plusX[y] = 0;
+      if (!row)
+        continue;
+      uint32_t left = rowBits(stock, b[0] - 1, gy, gz) >> (BRICK - 1);
+      uint32_t right = rowBits(stock, b[0] + 1, gy, gz) & 1u;
+      minusX[y] = row & ~((row << 1) | left);
+      plusX[y] = row & ~((row >> 1) | (right << (BRICK - 1)));
+      addRowFaces(stock, brick, FACE_YM,
+                  row & ~rowBits(stock, b[0], gy - 1, gz), gx0, gy, gz);
+      addRowFaces(stock, brick, FACE_YP,
+                  row & ~rowBits(stock, b[0], gy + 1, gz), gx0, gy, gz);
+      addRowFaces(stock, brick, FACE_ZM,
+                  row & ~rowBits(stock, b[0], gy, gz - 1), gx0, gy, gz);
+      addRowFaces(stock, brick, FACE_ZP,
+                  row & ~rowBits(stock, b[0], gy, gz + 1), gx0, gy, gz);
+    }
+    addLayerFaces(stock, brick, FACE_XM, minusX, rows, gx0, gy0, gz);
+    addLayerFaces(stock, brick, FACE_XP, plusX, rows, gx0, gy0, gz);
+  }
+}
+
+void ucncVoxelStockRender(ucncVoxelStock *stock) {
+  if (!stock)
+    return;
+  int total = stock->bricks[0] * stock->bricks[1] * stock->bricks[2];
+  pthread_mutex_lock(&stock->lock);
+  int dirty = 0;
+  for (int i = 0; i < total; i++)
+    dirty += stock->brick[i].dirty;
+  if (dirty > 0 && reserveJobs(stock, dirty)) {
+    stock->jobCount = 0;
+    for (int i = 0; i < total; i++) {
+      if (stock->brick[i].dirty) {
+        stock->brick[i].dirty = 0;
+        stock->jobs[stock->jobCount++] = i;
+      }
+    }
+    runPool(stock, meshBrick, stock->jobCount);
+  }
+
+  for (int i = 0; i < total; i++) {
+    const VoxelBrick *brick = &stock->brick[i];
+    if (brick->quadCount == 0)
+      continue;
+    glBegin(GL_QUADS);
+    for (int q = 0; q < brick->quadCount; q++) {
+      const float *n = faceNormal[brick->faces[q]];
+      const float *v = &brick->quads[q * 12];
+      glNormal3f(n[0], n[1], n[2]);
+      for (int c = 0; c < 4; c++)
+        glVertex3f(v[c * 3], v[c * 3 + 1], v[c * 3 + 2]);
+    }
+    glEnd();
+  }
+  pthread_mutex_unlock(&stock->lock);
+}
+
+// === Lifetime ===
+
+ucncVoxelStock *ucncVoxelStockNew(const float min[3], const float size[3],
+                                  float voxelSize) {
+  if (!min || !size || voxelSize <= 0.0f)
+    return NULL;
+  ucncVoxelStock *stock = calloc(1, sizeof(ucncVoxelStock));
+  if (!stock) {
+    fprintf(stderr, "Memory allocation failed for voxel stock.\n");
+    return NULL;
+  }
+  for (int k = 0; k < 3; k++) {
+    stock->origin[k] = min[k];
+    stock->n[k] = (int)ceilf(size[k] / voxelSize);
+    stock->n[k] = stock->n[k] < 1 ? 1 : stock->n[k];
+    stock->bricks[k] = (stock->n[k] + BRICK - 1) / BRICK;
+  }
+  stock->voxel = voxelSize;
+  stock->radius = 3.0f;
+  stock->length = 20.0f;
+  pthread_mutex_init(&stock->lock, NULL);
+  pthread_mutex_init(&stock->poolLock, NULL);
+  pthread_cond_init(&stock->start, NULL);
+  pthread_cond_init(&stock->done, NULL);
+  atomic_init(&stock->next, 0);
+
+  // Every brick starts out full; only those on the surface have faces
+  int total = stock->bricks[0] * stock->bricks[1] * stock->bricks[2];
+  stock->brick = calloc(total, sizeof(VoxelBrick));
+  stock->validRow = malloc(stock->bricks[0] * sizeof(uint32_t));
+  if (!stock->brick || !stock->validRow) {
+    fprintf(stderr, "Memory allocation failed for voxel stock.\n");
+    ucncVoxelStockFree(stock);
+    return NULL;
+  }
+  for (int bx = 0; bx < stock->bricks[0]; bx++) {
+    int count = stock->n[0] - bx * BRICK;
+    stock->validRow[bx] = count >= BRICK ? 0xffffffffu : (1u << count) - 1u;
+  }
+  for (int i = 0; i < total; i++) {
+    int b[3];
+    brickCoords(stock, i, b);
+    stock->brick[i].state = BRICK_FULL;
+    for (int k = 0; k < 3; k++)
+      stock->brick[i].dirty |= b[k] == 0 || b[k] == stock->bricks[k] - 1;
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = cpus > 1 ? (int)cpus - 1 : 0;
+  if (threads > UCNC_VOXEL_MAX_THREADS - 1)
+    threads = UCNC_VOXEL_MAX_THREADS - 1;
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&stock->threads[stock->threadCount], NULL, poolWorker,
+                       stock) == 0)
+      stock->threadCount++;
+  }
+  return stock;
+}
+
+void ucncVoxelStockFree(ucncVoxelStock *stock) {
+  if (!stock)
+    return;
+  pthread_mutex_lock(&stock->poolLock);
+  stock->quit = 1;
+  pthread_cond_broadcast(&stock->start);
+  pthread_mutex_unlock(&stock->poolLock);
+  for (int i = 0; i < stock->threadCount; i++)
+    pthread_join(stock->threads[i], NULL);
+  if (stock->brick) {
+    int total = stock->bricks[0] * stock->bricks[1] * stock->bricks[2];
+    for (int i = 0; i < total; i++) {
+      free(stock->brick[i].bits);
+      free(stock->brick[i].quads);
+      free(stock->brick[i].faces);
+    }
+  }
+  free(stock->brick);
+  free(stock->validRow);
+  free(stock->samples);
+  free(stock->jobs);
+  pthread_cond_destroy(&stock->start);
+  pthread_cond_destroy(&stock->done);
+  pthread_mutex_destroy(&stock->poolLock);
+  pthread_mutex_destroy(&stock->lock);
+  free(stock);
+}
+
+void ucncVoxelStockSetTool(ucncVoxelStock *stock, float radius, float length,
+                           int ballEnd) {
+  if (!stock || radius <= 0.0f || length <= 0.0f)
+    return;
+  pthread_mutex_lock(&stock->lock);
+  stock->radius = radius;
+  stock->length = length;
+  stock->ballEnd = ballEnd;
+  pthread_mutex_unlock(&stock->lock);
+}
+
+int ucncVoxelStockIsSolid(ucncVoxelStock *stock, const float p[3]) {
+  if (!stock || !p)
+    return 0;
+  int g[3];
+  for (int k = 0; k < 3; k++)
+    g[k] = (int)floorf((p[k] - stock->origin[k]) / stock->voxel);
+  if (g[0] < 0 || g[0] >= stock->n[0])
+    return 0;
+  pthread_mutex_lock(&stock->lock);
+  uint32_t row = rowBits(stock, g[0] / BRICK, g[1], g[2]);
+  pthread_mutex_unlock(&stock->lock);
+  return (row >> (g[0] % BRICK)) & 1u;
+}
+
+int ucncVoxelStockBrickCount(ucncVoxelStock *stock) {
+  if (!stock)
+    return 0;
+  int total = stock->bricks[0] * stock->bricks[1] * stock->bricks[2], count = 0;
+  pthread_mutex_lock(&stock->lock);
+  for (int i = 0; i < total; i++)
+    count += stock->brick[i].state == BRICK_MIXED;
+  pthread_mutex_unlock(&stock->lock);
+  return count;
+}
+
+static void renderActor(void *context) { ucncVoxelStockRender(context); }
+
+ucncActor *ucncVoxelStockNewActor(ucncVoxelStock *stock, const char *name,
+                                  float colorR, float colorG, float colorB) {
+  if (!stock)
+    return NULL;
+  float max[3];
+  for (int k = 0; k < 3; k++)
+    max[k] = stock->origin[k] + stock->n[k] * stock->voxel;
+  ucncActorGeometry geometry = {renderActor, stock};
+  return ucncActorNewProcedural(name, &geometry, stock->origin, max, colorR,
+                                colorG, colorB);
+}
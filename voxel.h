@@ -0,0 +1,51 @@
+/* voxel.h */
+
+#ifndef VOXEL_H
+#define VOXEL_H
+
+#include "actor.h"
+
+#define UCNC_VOXEL_BRICK 32       // Voxels per brick side
+#define UCNC_VOXEL_MAX_THREADS 8 // Brick workers at most, the caller included
+
+// Sparse voxel stock for 5-axis and robot milling, where a heightfield
+// cannot hold undercuts. The block is split into bricks of 32^3 voxels. A
+// brick the tool never touched stays a single "full" flag, a brick cut away
+// completely an "empty" one; only bricks in between keep a bit per voxel, so
+// memory follows the machined surface rather than the box. Cuts sweep a
+// flat or ball end mill between two poses and run in parallel per brick.
+// Only changed bricks (and the neighbours sharing their faces) are meshed
+// again, with hidden faces culled and coplanar faces merged, before the
+// next draw.
+typedef struct ucncVoxelStock ucncVoxelStock;
+
+// Block from min spanning size, in cubes of voxelSize
+ucncVoxelStock *ucncVoxelStockNew(const float min[3], const float size[3],
+                                  float voxelSize);
+// Free after the actors drawing the stock
+void ucncVoxelStockFree(ucncVoxelStock *stock);
+
+// Tool for the following cuts: radius, cutting length from the tip, and a
+// flat or ball end
+void ucncVoxelStockSetTool(ucncVoxelStock *stock, float radius, float length,
+                           int ballEnd);
+
+// Remove the volume swept by the tool moving from one pose to the other. A
+// pose is the tip position and the unit axis pointing from the tip into the
+// holder, both in stock space. Safe to call while another thread renders.
+int ucncVoxelStockCut(ucncVoxelStock *stock, const float fromTip[3],
+                      const float fromAxis[3], const float toTip[3],
+                      const float toAxis[3]);
+
+// 1 if the voxel containing p (stock space) is still there
+int ucncVoxelStockIsSolid(ucncVoxelStock *stock, const float p[3]);
+// Bricks holding per-voxel data; the rest are uniformly full or empty
+int ucncVoxelStockBrickCount(ucncVoxelStock *stock);
+
+// Actor drawing the stock, to attach to the workpiece assembly
+ucncActor *ucncVoxelStockNewActor(ucncVoxelStock *stock, const char *name,
+                                  float colorR, float colorG, float colorB);
+// Mesh the changed bricks and draw, in stock space
+void ucncVoxelStockRender(ucncVoxelStock *stock);
+
+#endif // VOXEL_H